@@ -17,7 +17,7 @@ if(GMP_FOUND)
     if(NOT GMP_FIND_QUIETLY)
         MESSAGE(STATUS "Found GMP: ${GMP_LIBRARY}")
     endif()
-elseif(GMP_FOUND)
+else()
     if(GMP_FIND_REQUIRED)
         message(FATAL_ERROR "Could not find GMP")
     endif()
@@ -0,0 +1,300 @@
+/**
+ * @file bench_tessellation.c
+ *
+ * @brief Throughput benchmark for the construction of the Delaunay and Voronoi
+ * tessellations of a single periodic cell.
+ *
+ * The benchmark sweeps the number of vertices from 10^3 to a maximum (10^7 by
+ * default) in steps of a factor 10, for a number of vertex distributions (see
+ * enum bench_distribution). Every construction phase is timed separately, and
+ * the results of every run are written to the standard output as a single
+ * line containing a JSON object, so that the output can be collected and
+ * compared between versions. Progress messages are written to the standard
+ * error.
+ *
+ * The benchmark should be compiled with optimisations and with
+ * CVORONOI_NO_CHECKS (see delaunay.h), without sanitizers. The dimensionality
+ * is set at compile time (see dimensionality.h); CMakeLists.txt builds a 2D
+ * and a 3D version.
+ *
+ * Usage: cVoronoiBench3D [max_count [repetitions]]
+ * Every configuration is run the given number of times (3 by default), and
+ * the fastest time of every phase is reported.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include "cell.h"
+#include "instrumentation.h"
+
+/**
+ * @brief Vertex distributions used in the benchmark.
+ */
+enum bench_distribution {
+  /*! @brief Uniform random positions. */
+  BENCH_UNIFORM = 0,
+  /*! @brief Regular grid with random perturbations of half a grid spacing. */
+  BENCH_PERTURBED_GRID,
+  /*! @brief Gaussian clusters of on average 100 vertices, on top of a uniform
+   *  background that contains 10% of the vertices. The width of the clusters
+   *  is a tenth of their average separation. The background makes sure that
+   *  there are no voids that are larger than the (periodic) box. */
+  BENCH_CLUSTERED,
+  /*! @brief Exact regular grid. This is the most degenerate input: every
+   *  Delaunay simplex has co-spherical neighbours. */
+  BENCH_LATTICE,
+  /*! @brief Number of distributions. */
+  BENCH_DISTRIBUTION_COUNT
+};
+
+/**
+ * @brief Get the name of the given distribution in the output.
+ *
+ * @param distribution Distribution.
+ * @return Name.
+ */
+inline static const char *bench_get_distribution_name(int distribution) {
+  static const char *names[BENCH_DISTRIBUTION_COUNT] = {
+      "uniform", "perturbed_grid", "clustered", "lattice"};
+  return names[distribution];
+}
+
+/**
+ * @brief Timed construction phases.
+ */
+enum bench_phase {
+  /*! @brief Initialisation of the cell: hilbert keys, sorting and memory
+   *  allocation. */
+  BENCH_INIT = 0,
+  /*! @brief Insertion of the local vertices. */
+  BENCH_LOCAL_DELAUNAY,
+  /*! @brief Insertion of the periodic ghost vertices. */
+  BENCH_PERIODIC_DELAUNAY,
+  /*! @brief Construction of the Voronoi grid. */
+  BENCH_VORONOI,
+  /*! @brief Number of phases. */
+  BENCH_PHASE_COUNT
+};
+
+/**
+ * @brief Get the name of the given phase in the output.
+ *
+ * @param phase Phase.
+ * @return Name.
+ */
+inline static const char *bench_get_phase_name(int phase) {
+  static const char *names[BENCH_PHASE_COUNT] = {"init", "local_delaunay",
+                                                 "periodic_delaunay",
+                                                 "voronoi"};
+  return names[phase];
+}
+
+/**
+ * @brief Generate a random number with a standard normal distribution.
+ *
+ * Uses the Box-Muller transform.
+ *
+ * @return Random number.
+ */
+inline static double bench_get_random_gaussian(void) {
+  /* uniform random numbers in ]0, 1[, to avoid log(0) */
+  const double u1 = (rand() + 1.) / (RAND_MAX + 2.);
+  const double u2 = (rand() + 1.) / (RAND_MAX + 2.);
+  return sqrt(-2. * log(u1)) * cos(2. * M_PI * u2);
+}
+
+/**
+ * @brief Wrap the given coordinate periodically into the range [0, 1[.
+ *
+ * @param x Coordinate.
+ * @return Wrapped coordinate.
+ */
+inline static double bench_wrap(double x) {
+  x -= floor(x);
+  /* floor() can round values just below 0 up to 1 */
+  return x < 1. ? x : 0.;
+}
+
+/**
+ * @brief Generate vertices in the unit box with the given distribution.
+ *
+ * The grid based distributions use the largest grid with at most the
+ * requested number of vertices.
+ *
+ * @param distribution Distribution (see enum bench_distribution).
+ * @param count Requested number of vertices.
+ * @param dim Number of dimensions (2 or 3).
+ * @param vertices Output array (3 coordinates per vertex, also in 2D). Needs
+ * to be able to store count vertices.
+ * @return Actual number of vertices.
+ */
+inline static int bench_generate_vertices(int distribution, int count,
+                                          int dim, double *vertices) {
+  if (distribution == BENCH_PERTURBED_GRID || distribution == BENCH_LATTICE) {
+    /* add a small margin to the root, so that perfect powers are exact */
+    const int n = (int)pow(count * (1. + 1.e-9), 1. / dim);
+    const int nz = dim == 3 ? n : 1;
+    const double pert = distribution == BENCH_LATTICE ? 0. : 0.5;
+    int index = 0;
+    for (int ix = 0; ix < n; ix++) {
+      for (int iy = 0; iy < n; iy++) {
+        for (int iz = 0; iz < nz; iz++) {
+          const int i[3] = {ix, iy, iz};
+          for (int j = 0; j < 3; j++) {
+            double x = 0.5;
+            if (j < dim) {
+              x = (i[j] + 0.5) / n;
+              if (pert > 0.) {
+                x += pert * (get_random_uniform_double() - 0.5) / n;
+              }
+            }
+            vertices[3 * index + j] = x;
+          }
+          index++;
+        }
+      }
+    }
+    return index;
+  }
+
+  if (distribution == BENCH_UNIFORM) {
+    for (int i = 0; i < count; i++) {
+      for (int j = 0; j < 3; j++) {
+        vertices[3 * i + j] =
+            j < dim ? bench_wrap(get_random_uniform_double()) : 0.5;
+      }
+    }
+    return count;
+  }
+
+  /* gaussian clusters on top of a uniform background */
+  const int ncluster = count / 100 > 0 ? count / 100 : 1;
+  const double sigma = 0.1 * pow(ncluster, -1. / dim);
+  double *centres = (double *)malloc(3 * ncluster * sizeof(double));
+  for (int i = 0; i < 3 * ncluster; i++) {
+    centres[i] = get_random_uniform_double();
+  }
+  for (int i = 0; i < count; i++) {
+    const int background = i % 10 == 0;
+    const double *centre = &centres[3 * (rand() % ncluster)];
+    for (int j = 0; j < 3; j++) {
+      double x = 0.5;
+      if (j < dim) {
+        x = background ? get_random_uniform_double()
+                       : centre[j] + sigma * bench_get_random_gaussian();
+        x = bench_wrap(x);
+      }
+      vertices[3 * i + j] = x;
+    }
+  }
+  free(centres);
+  return count;
+}
+
+/**
+ * @brief Run the benchmark for a single distribution and number of vertices,
+ * and write the result to the standard output.
+ *
+ * @param distribution Distribution (see enum bench_distribution).
+ * @param count Requested number of vertices.
+ * @param dim Number of dimensions (2 or 3).
+ * @param repetitions Number of times to repeat the construction.
+ */
+inline static void bench_run(int distribution, int count, int dim,
+                             int repetitions) {
+  double *vertices = (double *)malloc(3 * (size_t)count * sizeof(double));
+  double times[BENCH_PHASE_COUNT];
+  for (int i = 0; i < BENCH_PHASE_COUNT; i++) {
+    times[i] = HUGE_VAL;
+  }
+  int actual_count = 0;
+  int ghost_count = 0;
+  size_t memory_size = 0;
+  const double anchor[3] = {0., 0., 0.};
+  const double side[3] = {1., 1., 1.};
+
+  for (int rep = 0; rep < repetitions; rep++) {
+    /* every repetition uses the same vertices */
+    srand(42);
+    actual_count = bench_generate_vertices(distribution, count, dim, vertices);
+
+    struct cell c;
+    double time[BENCH_PHASE_COUNT + 1];
+    time[0] = instrumentation_get_time();
+    cell_init_from_vertices(&c, vertices, actual_count, anchor, side);
+    time[1] = instrumentation_get_time();
+    cell_construct_local_delaunay(&c);
+    time[2] = instrumentation_get_time();
+    cell_make_delaunay_periodic(&c);
+    time[3] = instrumentation_get_time();
+    cell_construct_voronoi(&c);
+    time[4] = instrumentation_get_time();
+
+    for (int i = 0; i < BENCH_PHASE_COUNT; i++) {
+      times[i] = fmin(times[i], time[i + 1] - time[i]);
+    }
+    ghost_count = c.ghost_count;
+    memory_size = cell_get_memory_size(&c);
+    cell_destroy(&c);
+  }
+  free(vertices);
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  double total_time = 0.;
+  printf("{\"dimension\": %i, \"distribution\": \"%s\", \"count\": %i, "
+         "\"ghost_count\": %i, \"repetitions\": %i, \"memory\": %zu, "
+         "\"max_rss\": %zu",
+         dim, bench_get_distribution_name(distribution), actual_count,
+         ghost_count, repetitions, memory_size,
+         (size_t)usage.ru_maxrss * 1024);
+  for (int i = 0; i < BENCH_PHASE_COUNT; i++) {
+    total_time += times[i];
+    printf(", \"%s\": {\"time\": %.6e, \"vertices_per_second\": %.6e}",
+           bench_get_phase_name(i), times[i], actual_count / times[i]);
+  }
+  printf(", \"total\": {\"time\": %.6e, \"vertices_per_second\": %.6e}}\n",
+         total_time, actual_count / total_time);
+  fflush(stdout);
+}
+
+/**
+ * @brief Benchmark entry point.
+ *
+ * The memory reported for every run is the size of all tessellation memory of
+ * the cell after the construction (see cell_get_memory_size()), the
+ * (monotonically increasing) peak resident set size of the process is
+ * reported as max_rss. Both are in bytes.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments: maximum number of vertices (10^7 by
+ * default) and number of repetitions (3 by default).
+ */
+int main(int argc, char **argv) {
+  const int max_count = argc > 1 ? atoi(argv[1]) : 10000000;
+  const int repetitions = argc > 2 ? atoi(argv[2]) : 3;
+#if defined(DIMENSIONALITY_2D)
+  const int dim = 2;
+#else
+  const int dim = 3;
+#endif
+#ifndef CVORONOI_NO_CHECKS
+  fprintf(stderr,
+          "Warning: the benchmark was compiled with runtime checks!\n");
+#endif
+
+  for (int count = 1000; count <= max_count; count *= 10) {
+    for (int i = 0; i < BENCH_DISTRIBUTION_COUNT; i++) {
+      fprintf(stderr, "%iD %s, %i vertices\n", dim,
+              bench_get_distribution_name(i), count);
+      bench_run(i, count, dim, repetitions);
+    }
+    /* avoid overflow of the loop counter */
+    if (count > max_count / 10) break;
+  }
+  return 0;
+}
@@ -0,0 +1,108 @@
+# Reader for the binary tessellation output format of cVoronoi (see
+# src/binary_output.h, voronoi_print_grid_binary() and
+# delaunay_print_tessellation_binary() for the layout of the files).
+#
+# Files are memory mapped, so that the returned arrays are read-only views
+# into the file.
+
+import numpy as np
+
+MAGIC = b"CVORONOI"
+VERSION = 1
+TYPE_VORONOI = 1
+TYPE_DELAUNAY = 2
+TYPE_GENERATORS = 3
+FLAG_GENERATORS = 1
+FLAG_CELL_STATS = 2
+FLAG_CONNECTIONS = 4
+HEADER_SIZE = 56
+
+
+class _ArrayReader:
+    """Reads consecutive little-endian arrays that are padded to 8 bytes."""
+
+    def __init__(self, data, offset):
+        self.data = data
+        self.offset = offset
+
+    def read(self, dtype, count, ncomp=1):
+        dtype = np.dtype(dtype)
+        array = np.frombuffer(self.data, dtype, count * ncomp, self.offset)
+        self.offset += count * ncomp * dtype.itemsize
+        self.offset += -self.offset % 8
+        if ncomp > 1:
+            array = array.reshape((count, ncomp))
+        return array
+
+
+def _read_header(fname, expected_type):
+    data = np.memmap(fname, np.uint8, "r")
+    if bytes(data[:8]) != MAGIC:
+        raise ValueError("{0} is not a cVoronoi binary file!".format(fname))
+    version, ftype, dim, flags = np.frombuffer(data, "<u4", 4, 8)
+    if version != VERSION:
+        raise ValueError("Unsupported file version: {0}!".format(version))
+    if ftype != expected_type:
+        raise ValueError("Wrong file type: {0}!".format(ftype))
+    counts = np.frombuffer(data, "<i8", 4, 24)
+    return _ArrayReader(data, HEADER_SIZE), int(dim), int(flags), counts
+
+
+def read_voronoi(fname):
+    """Read a Voronoi grid written by voronoi_print_grid_binary().
+
+    Returns a dictionary with the arrays in the file: "centroids", "volumes",
+    "left", "right", "sid", "areas" and "midpoints", and, depending on the
+    configuration, "generators", "nface" and "face_vertices" (a list with an
+    array of vertices for every face). Arrays that are not present are None.
+    """
+    reader, dim, flags, counts = _read_header(fname, TYPE_VORONOI)
+    ncell, nface, nface_vertex = counts[:3]
+
+    grid = {"dimension": dim}
+    grid["generators"] = None
+    if flags & FLAG_GENERATORS:
+        grid["generators"] = reader.read("<f8", ncell, dim)
+    grid["centroids"] = reader.read("<f8", ncell, dim)
+    grid["volumes"] = reader.read("<f8", ncell)
+    grid["nface"] = None
+    if flags & FLAG_CELL_STATS:
+        grid["nface"] = reader.read("<i4", ncell)
+    grid["left"] = reader.read("<i4", nface)
+    grid["right"] = reader.read("<i4", nface)
+    grid["sid"] = reader.read("<i4", nface)
+    grid["areas"] = reader.read("<f8", nface)
+    grid["midpoints"] = reader.read("<f8", nface, dim)
+    grid["face_vertices"] = None
+    if flags & FLAG_CONNECTIONS:
+        offsets = reader.read("<i8", nface + 1)
+        vertices = reader.read("<f8", nface_vertex, dim)
+        grid["face_vertices"] = np.split(vertices, offsets[1:-1])
+    return grid
+
+
+def read_delaunay(fname):
+    """Read a Delaunay tessellation written by
+    delaunay_print_tessellation_binary().
+
+    Returns the vertex coordinates (shape (nvertex, dim)) and the vertex
+    indices of the simplices (shape (nsimplex, dim + 1)).
+    """
+    reader, dim, flags, counts = _read_header(fname, TYPE_DELAUNAY)
+    nvertex, nsimplex = counts[:2]
+    vertices = reader.read("<f8", nvertex, dim)
+    simplices = reader.read("<i4", nsimplex, dim + 1)
+    return vertices, simplices
+
+
+def read_generators(fname):
+    """Read a generator file written by binary_output_print_generators().
+
+    Returns the anchor and side lengths of the simulation volume and the
+    generator positions (shape (count, 3), also in 2D).
+    """
+    reader, dim, flags, counts = _read_header(fname, TYPE_GENERATORS)
+    anchor = reader.read("<f8", 3)
+    side = reader.read("<f8", 3)
+    positions = reader.read("<f8", counts[0], 3)
+    return anchor, side, positions
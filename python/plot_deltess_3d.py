@@ -2,6 +2,8 @@ import mpl_toolkits.mplot3d as a3
 from matplotlib import pylab as pl
 import numpy as np
 
+from cvoronoi_io import read_delaunay
+
 
 def tetrahedra_to_triangles(ts):
     tris = np.zeros((4*len(ts), 3), int)
@@ -29,18 +31,7 @@ def plot(vs, ts):
 
 
 def main(fname):
-    vs = np.fromregex(
-        fname,
-        "V\s+(\d+)\s+(\S+)\s+(\S+)\s+(\S+)",
-        [("index", np.int32), ("x", np.float64), ("y", np.float64), ("z", np.float64)],
-    )
-    vs = np.array([[i for i in arr] for arr in vs])[:, 1:]
-    ts = np.fromregex(
-        fname,
-        "T\s+(\d+)\s+(\d+)\s+(\d+)\s+(\d+)",
-        [("v0", np.int32), ("v1", np.int32), ("v2", np.int32), ("v3", np.int32)],
-    )
-    ts = np.array([[i for i in arr] for arr in ts]).astype(int)
+    vs, ts = read_delaunay(fname)
 
     print(vs.shape, ts.shape)
 
@@ -50,4 +41,4 @@ def main(fname):
 
 
 if __name__ == "__main__":
-    main("test.txt")
+    main("test.bin")
@@ -1,4 +1,4 @@
-# Script that can be used to plot the Voronoi grid contained in vtest.txt
+# Script that can be used to plot the Voronoi grid contained in vtest.bin
 
 import numpy as np
 import matplotlib
@@ -8,28 +8,20 @@ matplotlib.use("Agg")
 import matplotlib.pyplot as pl
 import argparse
 
+from cvoronoi_io import read_voronoi
+
 argparser = argparse.ArgumentParser()
 argparser.add_argument("--file", "-f", action="store", required=True)
 argparser.add_argument("--zoom", "-z", action="store_true")
 args = argparser.parse_args()
 
-gs = np.fromregex(
-    args.file, "G\s+(\S+)\s+(\S+)", [("x", np.float64), ("y", np.float64)]
-)
-ms = np.fromregex(
-    args.file, "M\s+(\S+)\s+(\S+)", [("x", np.float64), ("y", np.float64)]
-)
-fs = np.fromregex(
-    args.file, "F\s+(\S+)\s+(\S+)\s+(\S+)\s+(\S+)", [("x0", np.float64), ("y0", np.float64), ("x1", np.float64), ("y1", np.float64)]
-)
-vs = np.fromregex(
-    args.file, "V\s+(\S+)\s+(\S+)", [("x", np.float64), ("y", np.float64)]
-)
-cs = np.fromregex(
-    args.file, "C\s+(\d+)\s+(\d+)", [("v0", np.int32), ("v1", np.int32)]
+grid = read_voronoi(args.file)
+gs = np.rec.fromarrays(grid["generators"].T, names="x, y")
+fs = np.rec.fromarrays(
+    np.stack(grid["face_vertices"]).reshape((-1, 4)).T, names="x0, y0, x1, y1"
 )
 
-print(gs.shape, vs.shape)
+print(gs.shape, fs.shape)
 
 for fi in range(len(fs)):
     f = fs[fi]
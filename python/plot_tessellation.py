@@ -1,4 +1,4 @@
-# Script that can be used to plot the Delaunay tessellation in test.txt.
+# Script that can be used to plot the Delaunay tessellation in test.bin.
 
 import numpy as np
 import matplotlib
@@ -7,6 +7,8 @@ matplotlib.use("Agg")
 import matplotlib.pyplot as pl
 import argparse
 
+from cvoronoi_io import read_delaunay
+
 argparser = argparse.ArgumentParser()
 argparser.add_argument("--circles", "-c", action="store_true", default=False)
 argparser.add_argument("--zoom", "-z", action="store_true")
@@ -14,16 +16,11 @@ args = argparser.parse_args()
 
 plotCircles = args.circles
 
-vs = np.fromregex(
-    "test.txt",
-    "V\s+(\d+)\s+(\S+)\s+(\S+)",
-    [("index", np.int32), ("x", np.float64), ("y", np.float64)],
-)
-ts = np.fromregex(
-    "test.txt",
-    "T\s+(\d+)\s+(\d+)\s+(\d+)",
-    [("v0", np.int32), ("v1", np.int32), ("v2", np.int32)],
-)
+vs, ts = read_delaunay("test.bin")
+vs = np.rec.fromarrays(vs.T, names="x, y")
+# skip the triangles that contain dummy vertices
+ts = ts[np.all(ts >= 0, axis=1)]
+ts = np.rec.fromarrays(ts.T, names="v0, v1, v2")
 
 print(vs.shape, ts.shape)
 
@@ -2,6 +2,8 @@ import mpl_toolkits.mplot3d as a3
 from matplotlib import pylab as pl
 import numpy as np
 
+from cvoronoi_io import read_voronoi
+
 
 def plot_voronoi(generators, vertices):
     fig = pl.figure()
@@ -21,25 +23,9 @@ def plot_voronoi(generators, vertices):
 
 
 def main(fname):
-    with open(fname, "r") as file:
-        lines = file.readlines()
-    lines = [line[:-1].split("\t") for line in lines]
-
-    generators = np.stack([np.array(line[1:]) for line in lines if line[0] == "G"]).astype(float)
-
-    centroids = [line for line in lines if line[0] == "C"]
-    volumes = np.array([np.array(line[-2]) for line in centroids]).astype(float)
-    n_neighbours = np.array([np.array(line[-1]) for line in centroids]).astype(int)
-    centroids = np.stack([np.array(line[1:-2]) for line in centroids]).astype(float)
-
-    faces = [line[1:] for line in lines if line[0] == "F"]
-    sid = np.array([np.array(line[0]) for line in faces]).astype(int)
-    areas = np.array([np.array(line[1]) for line in faces]).astype(float)
-    midpoints = np.stack([np.array(line[2:5]) for line in faces]).astype(float)
-    vertices = [np.stack([np.array(c[1:-1].split(", ")) for c in line[5:]]).astype(float) for line in faces]
-
-    plot_voronoi(generators, vertices)
+    grid = read_voronoi(fname)
+    plot_voronoi(grid["generators"], grid["face_vertices"])
 
 
 if __name__ == "__main__":
-    main("vtest001.txt")
+    main("vtest001.bin")
@@ -0,0 +1,64 @@
+/**
+ * @file allocator.h
+ *
+ * @brief Memory allocation hooks for all arrays owned by the tessellations
+ * and cells, and first-touch placement of these arrays.
+ *
+ * By default, the arrays are allocated with the standard library functions.
+ * Code that embeds the library can provide its own allocator (e.g. one that
+ * labels or tracks the allocations, or a NUMA aware one) by defining
+ * CVORONOI_MALLOC, CVORONOI_CALLOC, CVORONOI_REALLOC and CVORONOI_FREE before
+ * including any of the headers. The hooks have the same signatures as their
+ * standard library counterparts, and all four need to be defined together.
+ *
+ * On NUMA systems, the pages of an array are usually placed on the memory
+ * domain of the thread that first writes to them. allocator_first_touch() can
+ * be used to make sure that this is the thread that will use the array (see
+ * space_construct_tessellations()). The cache line aligned tetrahedron arrays
+ * of TETRAHEDRON_SOA do not use the hooks (see tetrahedron.h).
+ */
+
+#ifndef CVORONOI_ALLOCATOR_H
+#define CVORONOI_ALLOCATOR_H
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#if defined(CVORONOI_MALLOC) || defined(CVORONOI_CALLOC) || \
+    defined(CVORONOI_REALLOC) || defined(CVORONOI_FREE)
+#if !defined(CVORONOI_MALLOC) || !defined(CVORONOI_CALLOC) || \
+    !defined(CVORONOI_REALLOC) || !defined(CVORONOI_FREE)
+#error "All four allocation hooks need to be defined together!"
+#endif
+#else
+/*! @brief Allocate memory (same signature as malloc()). */
+#define CVORONOI_MALLOC(size) malloc(size)
+/*! @brief Allocate zeroed memory (same signature as calloc()). */
+#define CVORONOI_CALLOC(count, size) calloc(count, size)
+/*! @brief Resize an allocation (same signature as realloc()). */
+#define CVORONOI_REALLOC(ptr, size) realloc(ptr, size)
+/*! @brief Free memory allocated by one of the other hooks. */
+#define CVORONOI_FREE(ptr) free(ptr)
+#endif
+
+/**
+ * @brief Touch every page of the given array from the calling thread, without
+ * changing its contents.
+ *
+ * Pages that were not touched before are then placed on the memory domain of
+ * the calling thread (under the default first-touch policy of the operating
+ * system). Pages that were already touched are not moved.
+ *
+ * @param ptr Array (can be NULL).
+ * @param size Size of the array in bytes.
+ */
+inline static void allocator_first_touch(void *ptr, size_t size) {
+  if (ptr == NULL) return;
+  const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  volatile char *bytes = (volatile char *)ptr;
+  for (size_t i = 0; i < size; i += page_size) {
+    bytes[i] = bytes[i];
+  }
+}
+
+#endif  // CVORONOI_ALLOCATOR_H
@@ -0,0 +1,308 @@
+/**
+ * @file binary_input.h
+ *
+ * @brief Zero-copy reader for the binary output format (see binary_output.h).
+ *
+ * Files are memory mapped, and all arrays are returned as pointers into the
+ * mapping, so that reading a file only costs the page-ins of the parts that
+ * are actually used. This requires the host to use the byte order of the files
+ * (little-endian).
+ *
+ * Generator files can be mapped into a cell directly (see
+ * cell_init_from_file()). Voronoi grids and Delaunay tessellations can be
+ * reopened for post-processing with voronoi_snapshot_open() and
+ * delaunay_snapshot_open().
+ */
+
+#ifndef CVORONOI_BINARY_INPUT_H
+#define CVORONOI_BINARY_INPUT_H
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "binary_output.h"
+
+/*! @brief Size of the header of a binary file (see
+ *  binary_output_write_header()). */
+#define BINARY_INPUT_HEADER_SIZE 56
+
+/**
+ * @brief Memory mapped binary file.
+ */
+struct binary_input {
+  /*! @brief Start of the mapping (NULL if no file is mapped). */
+  char *data;
+
+  /*! @brief Size of the file (and the mapping). */
+  size_t size;
+
+  /*! @brief Offset of the next array in the file. */
+  size_t offset;
+
+  /*! @brief File type (BINARY_OUTPUT_TYPE_*). */
+  uint32_t type;
+
+  /*! @brief Number of dimensions. */
+  uint32_t dimension;
+
+  /*! @brief Flags (combination of BINARY_OUTPUT_FLAG_*). */
+  uint32_t flags;
+
+  /*! @brief Counts, their meaning depends on the file type. */
+  int64_t counts[BINARY_OUTPUT_NCOUNT];
+};
+
+/**
+ * @brief Map the binary file with the given name and read its header.
+ *
+ * The mapping is private: if it is writable, changes to the mapped data are
+ * never written back to the file, and only the pages that are changed are
+ * copied.
+ *
+ * @param in Binary input.
+ * @param file_name Name of the file.
+ * @param type Expected file type (BINARY_OUTPUT_TYPE_*).
+ * @param writable Map the file with write access?
+ */
+inline static void binary_input_open(struct binary_input *in,
+                                     const char *file_name, uint32_t type,
+                                     int writable) {
+#ifdef BINARY_OUTPUT_SWAP_BYTES
+  fprintf(stderr, "Binary input is not supported on big-endian hosts!\n");
+  abort();
+#endif
+  const int fd = open(file_name, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Unable to open file \"%s\" for reading!\n", file_name);
+    abort();
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < BINARY_INPUT_HEADER_SIZE) {
+    fprintf(stderr, "File \"%s\" is not a valid binary file!\n", file_name);
+    abort();
+  }
+  in->size = (size_t)st.st_size;
+  const int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+  void *data = mmap(NULL, in->size, prot, MAP_PRIVATE, fd, 0);
+  if (data == MAP_FAILED) {
+    fprintf(stderr, "Unable to map file \"%s\"!\n", file_name);
+    abort();
+  }
+  /* the mapping stays valid after closing the file */
+  close(fd);
+  in->data = (char *)data;
+
+  uint32_t header[4];
+  memcpy(header, in->data + 8, sizeof(header));
+  memcpy(in->counts, in->data + 24, sizeof(in->counts));
+  if (memcmp(in->data, BINARY_OUTPUT_MAGIC, 8) != 0 ||
+      header[0] != BINARY_OUTPUT_VERSION) {
+    fprintf(stderr, "File \"%s\" is not a valid binary file!\n", file_name);
+    abort();
+  }
+  if (header[1] != type) {
+    fprintf(stderr, "File \"%s\" has type %u (expected %u)!\n", file_name,
+            header[1], type);
+    abort();
+  }
+  in->type = header[1];
+  in->dimension = header[2];
+  in->flags = header[3];
+  in->offset = BINARY_INPUT_HEADER_SIZE;
+}
+
+/**
+ * @brief Get a pointer to the next array in the file.
+ *
+ * @param in Binary input.
+ * @param element_size Size of a single element of the array (in bytes).
+ * @param n Number of elements.
+ * @return Pointer to the array within the mapping.
+ */
+inline static void *binary_input_get_array(struct binary_input *in,
+                                           size_t element_size, size_t n) {
+  const size_t size = element_size * n;
+  if (in->offset + size > in->size) {
+    fprintf(stderr, "Binary file is truncated!\n");
+    abort();
+  }
+  void *array = in->data + in->offset;
+  /* arrays are padded to a multiple of 8 bytes */
+  in->offset += (size + 7) & ~(size_t)7;
+  return array;
+}
+
+/**
+ * @brief Unmap the file.
+ *
+ * All pointers into the mapping become invalid.
+ *
+ * @param in Binary input.
+ */
+inline static void binary_input_close(struct binary_input *in) {
+  munmap(in->data, in->size);
+  in->data = NULL;
+  in->size = 0;
+}
+
+/**
+ * @brief Voronoi grid that was read from a binary file (see
+ * voronoi_print_grid_binary() for the meaning of the arrays).
+ *
+ * All arrays point into the mapped file. Optional arrays that are not present
+ * in the file are NULL.
+ */
+struct voronoi_snapshot {
+  /*! @brief Mapped file. */
+  struct binary_input in;
+
+  /*! @brief Number of dimensions. */
+  int dimension;
+
+  /*! @brief Number of cells, faces and face vertices. */
+  int64_t ncell;
+  int64_t nface;
+  int64_t nface_vertex;
+
+  /*! @brief Cell arrays. */
+  const double *generators;
+  const double *centroids;
+  const double *volumes;
+  const int32_t *cell_nface;
+
+  /*! @brief Face arrays. */
+  const int32_t *left;
+  const int32_t *right;
+  const int32_t *sid;
+  const double *areas;
+  const double *midpoints;
+
+  /*! @brief Face vertices in compressed sparse row format: the vertices of
+   *  face i are at indices [face_vertex_offsets[i], face_vertex_offsets[i +
+   *  1][ of face_vertices. */
+  const int64_t *face_vertex_offsets;
+  const double *face_vertices;
+};
+
+/**
+ * @brief Reopen a Voronoi grid written by voronoi_print_grid_binary().
+ *
+ * @param s Voronoi snapshot.
+ * @param file_name Name of the file.
+ */
+inline static void voronoi_snapshot_open(struct voronoi_snapshot *s,
+                                         const char *file_name) {
+  struct binary_input *in = &s->in;
+  binary_input_open(in, file_name, BINARY_OUTPUT_TYPE_VORONOI, 0);
+  const size_t dim = in->dimension;
+  s->dimension = (int)dim;
+  s->ncell = in->counts[0];
+  s->nface = in->counts[1];
+  s->nface_vertex = in->counts[2];
+
+  s->generators = NULL;
+  if (in->flags & BINARY_OUTPUT_FLAG_GENERATORS) {
+    s->generators = (const double *)binary_input_get_array(
+        in, dim * sizeof(double), s->ncell);
+  }
+  s->centroids = (const double *)binary_input_get_array(
+      in, dim * sizeof(double), s->ncell);
+  s->volumes =
+      (const double *)binary_input_get_array(in, sizeof(double), s->ncell);
+  s->cell_nface = NULL;
+  if (in->flags & BINARY_OUTPUT_FLAG_CELL_STATS) {
+    s->cell_nface =
+        (const int32_t *)binary_input_get_array(in, sizeof(int32_t), s->ncell);
+  }
+
+  s->left =
+      (const int32_t *)binary_input_get_array(in, sizeof(int32_t), s->nface);
+  s->right =
+      (const int32_t *)binary_input_get_array(in, sizeof(int32_t), s->nface);
+  s->sid =
+      (const int32_t *)binary_input_get_array(in, sizeof(int32_t), s->nface);
+  s->areas =
+      (const double *)binary_input_get_array(in, sizeof(double), s->nface);
+  s->midpoints = (const double *)binary_input_get_array(
+      in, dim * sizeof(double), s->nface);
+
+  s->face_vertex_offsets = NULL;
+  s->face_vertices = NULL;
+  if (in->flags & BINARY_OUTPUT_FLAG_CONNECTIONS) {
+    s->face_vertex_offsets = (const int64_t *)binary_input_get_array(
+        in, sizeof(int64_t), s->nface + 1);
+    s->face_vertices = (const double *)binary_input_get_array(
+        in, dim * sizeof(double), s->nface_vertex);
+  }
+}
+
+/**
+ * @brief Close a Voronoi snapshot.
+ *
+ * @param s Voronoi snapshot.
+ */
+inline static void voronoi_snapshot_close(struct voronoi_snapshot *s) {
+  binary_input_close(&s->in);
+}
+
+/**
+ * @brief Delaunay tessellation that was read from a binary file (see
+ * delaunay_print_tessellation_binary()).
+ *
+ * All arrays point into the mapped file.
+ */
+struct delaunay_snapshot {
+  /*! @brief Mapped file. */
+  struct binary_input in;
+
+  /*! @brief Number of dimensions. */
+  int dimension;
+
+  /*! @brief Number of vertices and simplices (triangles or tetrahedra). */
+  int64_t nvertex;
+  int64_t nsimplex;
+
+  /*! @brief Vertex coordinates (dimension per vertex). */
+  const double *vertices;
+
+  /*! @brief Vertex indices of the simplices (dimension + 1 per simplex). */
+  const int32_t *simplices;
+};
+
+/**
+ * @brief Reopen a Delaunay tessellation written by
+ * delaunay_print_tessellation_binary().
+ *
+ * @param s Delaunay snapshot.
+ * @param file_name Name of the file.
+ */
+inline static void delaunay_snapshot_open(struct delaunay_snapshot *s,
+                                          const char *file_name) {
+  struct binary_input *in = &s->in;
+  binary_input_open(in, file_name, BINARY_OUTPUT_TYPE_DELAUNAY, 0);
+  const size_t dim = in->dimension;
+  s->dimension = (int)dim;
+  s->nvertex = in->counts[0];
+  s->nsimplex = in->counts[1];
+  s->vertices = (const double *)binary_input_get_array(
+      in, dim * sizeof(double), s->nvertex);
+  s->simplices = (const int32_t *)binary_input_get_array(
+      in, (dim + 1) * sizeof(int32_t), s->nsimplex);
+}
+
+/**
+ * @brief Close a Delaunay snapshot.
+ *
+ * @param s Delaunay snapshot.
+ */
+inline static void delaunay_snapshot_close(struct delaunay_snapshot *s) {
+  binary_input_close(&s->in);
+}
+
+#endif  // CVORONOI_BINARY_INPUT_H
@@ -0,0 +1,315 @@
+/**
+ * @file binary_output.h
+ *
+ * @brief Buffered writer for the binary tessellation output format.
+ *
+ * Binary output files (written by voronoi_print_grid_binary(),
+ * delaunay_print_tessellation_binary() and binary_output_print_generators())
+ * start with a fixed size header (see binary_output_write_header()), followed
+ * by a number of flat arrays of fixed width little-endian values. Every array
+ * starts at an offset that is a multiple of 8 bytes, so that the arrays can be
+ * read (or memory mapped) directly. The layout of the arrays is documented
+ * with the functions that write them; binary_input.h and python/cvoronoi_io.py
+ * contain matching readers.
+ *
+ * Unlike the text output, the binary output is exact (values are written in
+ * full double precision). All data is written through a single large buffer,
+ * arrays that are larger than the buffer are written directly.
+ */
+
+#ifndef CVORONOI_BINARY_OUTPUT_H
+#define CVORONOI_BINARY_OUTPUT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*! @brief Magic string at the start of every binary output file. */
+#define BINARY_OUTPUT_MAGIC "CVORONOI"
+
+/*! @brief Version of the binary output format. */
+#define BINARY_OUTPUT_VERSION 1
+
+/*! @brief Type of a binary output file containing a Voronoi grid. */
+#define BINARY_OUTPUT_TYPE_VORONOI 1
+
+/*! @brief Type of a binary output file containing a Delaunay tessellation. */
+#define BINARY_OUTPUT_TYPE_DELAUNAY 2
+
+/*! @brief Type of a binary output file containing generator positions. */
+#define BINARY_OUTPUT_TYPE_GENERATORS 3
+
+/*! @brief Flag: the file contains the positions of the cell generators. */
+#define BINARY_OUTPUT_FLAG_GENERATORS 1
+
+/*! @brief Flag: the file contains the number of faces of every cell. */
+#define BINARY_OUTPUT_FLAG_CELL_STATS 2
+
+/*! @brief Flag: the file contains the vertices of every face. */
+#define BINARY_OUTPUT_FLAG_CONNECTIONS 4
+
+/*! @brief Number of counts stored in the header. */
+#define BINARY_OUTPUT_NCOUNT 4
+
+/*! @brief Size of the output buffer (in bytes). */
+#define BINARY_OUTPUT_BUFFER_SIZE (1 << 20)
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+/*! @brief The host byte order differs from the file byte order, so that all
+ *  values need to be byte swapped. */
+#define BINARY_OUTPUT_SWAP_BYTES
+#endif
+
+/**
+ * @brief Buffered binary output file.
+ */
+struct binary_output {
+  /*! @brief File to write to. */
+  FILE *file;
+
+  /*! @brief Output buffer. */
+  char *buffer;
+
+  /*! @brief Number of bytes currently in the buffer. */
+  size_t buffer_index;
+
+  /*! @brief Total number of bytes written to the file (including the bytes
+   *  that are still in the buffer). */
+  size_t offset;
+};
+
+/**
+ * @brief Open the binary output file with the given name.
+ *
+ * @param o Binary output.
+ * @param file_name Name of the output file.
+ */
+inline static void binary_output_open(struct binary_output *o,
+                                      const char *file_name) {
+  o->file = fopen(file_name, "wb");
+  if (o->file == NULL) {
+    fprintf(stderr, "Unable to open file \"%s\" for writing!\n", file_name);
+    abort();
+  }
+  o->buffer = (char *)malloc(BINARY_OUTPUT_BUFFER_SIZE);
+  o->buffer_index = 0;
+  o->offset = 0;
+}
+
+/**
+ * @brief Write the contents of the buffer to the file.
+ *
+ * @param o Binary output.
+ */
+inline static void binary_output_flush(struct binary_output *o) {
+  if (o->buffer_index > 0 &&
+      fwrite(o->buffer, 1, o->buffer_index, o->file) != o->buffer_index) {
+    fprintf(stderr, "Error while writing binary output!\n");
+    abort();
+  }
+  o->buffer_index = 0;
+}
+
+/**
+ * @brief Write the given raw bytes.
+ *
+ * @param o Binary output.
+ * @param data Bytes to write.
+ * @param size Number of bytes.
+ */
+inline static void binary_output_write(struct binary_output *o,
+                                       const void *data, size_t size) {
+  if (o->buffer_index + size > BINARY_OUTPUT_BUFFER_SIZE) {
+    binary_output_flush(o);
+  }
+  if (size >= BINARY_OUTPUT_BUFFER_SIZE) {
+    /* no point in copying this into the buffer */
+    if (fwrite(data, 1, size, o->file) != size) {
+      fprintf(stderr, "Error while writing binary output!\n");
+      abort();
+    }
+  } else {
+    memcpy(o->buffer + o->buffer_index, data, size);
+    o->buffer_index += size;
+  }
+  o->offset += size;
+}
+
+/**
+ * @brief Write the given 32-bit signed integer.
+ *
+ * @param o Binary output.
+ * @param value Value.
+ */
+inline static void binary_output_write_int32(struct binary_output *o,
+                                             int32_t value) {
+#ifdef BINARY_OUTPUT_SWAP_BYTES
+  value = (int32_t)__builtin_bswap32((uint32_t)value);
+#endif
+  binary_output_write(o, &value, sizeof(value));
+}
+
+/**
+ * @brief Write the given 32-bit unsigned integer.
+ *
+ * @param o Binary output.
+ * @param value Value.
+ */
+inline static void binary_output_write_uint32(struct binary_output *o,
+                                              uint32_t value) {
+#ifdef BINARY_OUTPUT_SWAP_BYTES
+  value = __builtin_bswap32(value);
+#endif
+  binary_output_write(o, &value, sizeof(value));
+}
+
+/**
+ * @brief Write the given 64-bit signed integer.
+ *
+ * @param o Binary output.
+ * @param value Value.
+ */
+inline static void binary_output_write_int64(struct binary_output *o,
+                                             int64_t value) {
+#ifdef BINARY_OUTPUT_SWAP_BYTES
+  value = (int64_t)__builtin_bswap64((uint64_t)value);
+#endif
+  binary_output_write(o, &value, sizeof(value));
+}
+
+/**
+ * @brief Write the given double precision value.
+ *
+ * @param o Binary output.
+ * @param value Value.
+ */
+inline static void binary_output_write_double(struct binary_output *o,
+                                              double value) {
+#ifdef BINARY_OUTPUT_SWAP_BYTES
+  union {
+    double d;
+    uint64_t u;
+  } u;
+  u.d = value;
+  u.u = __builtin_bswap64(u.u);
+  value = u.d;
+#endif
+  binary_output_write(o, &value, sizeof(value));
+}
+
+/**
+ * @brief Write the given array of double precision values.
+ *
+ * @param o Binary output.
+ * @param values Values.
+ * @param n Number of values.
+ */
+inline static void binary_output_write_doubles(struct binary_output *o,
+                                               const double *values,
+                                               size_t n) {
+#ifdef BINARY_OUTPUT_SWAP_BYTES
+  for (size_t i = 0; i < n; i++) {
+    binary_output_write_double(o, values[i]);
+  }
+#else
+  binary_output_write(o, values, n * sizeof(double));
+#endif
+}
+
+/**
+ * @brief Pad the output with zeros until the offset is a multiple of 8 bytes.
+ *
+ * This should be called after every array.
+ *
+ * @param o Binary output.
+ */
+inline static void binary_output_align(struct binary_output *o) {
+  const char zeros[8] = {0};
+  if (o->offset % 8 != 0) {
+    binary_output_write(o, zeros, 8 - o->offset % 8);
+  }
+}
+
+/**
+ * @brief Write the file header.
+ *
+ * The header has a size of 56 bytes and consists of
+ *  - the magic string "CVORONOI" (8 characters, no terminating zero),
+ *  - 4 uint32 values: the format version, the file type
+ *    (BINARY_OUTPUT_TYPE_*), the number of dimensions and flags (a
+ *    combination of BINARY_OUTPUT_FLAG_*),
+ *  - 4 int64 counts, whose meaning depends on the file type.
+ *
+ * @param o Binary output.
+ * @param type File type.
+ * @param dimension Number of dimensions (2 or 3).
+ * @param flags Flags.
+ * @param counts Counts (BINARY_OUTPUT_NCOUNT values).
+ */
+inline static void binary_output_write_header(struct binary_output *o,
+                                              uint32_t type,
+                                              uint32_t dimension,
+                                              uint32_t flags,
+                                              const int64_t *counts) {
+  binary_output_write(o, BINARY_OUTPUT_MAGIC, 8);
+  binary_output_write_uint32(o, BINARY_OUTPUT_VERSION);
+  binary_output_write_uint32(o, type);
+  binary_output_write_uint32(o, dimension);
+  binary_output_write_uint32(o, flags);
+  for (int i = 0; i < BINARY_OUTPUT_NCOUNT; i++) {
+    binary_output_write_int64(o, counts[i]);
+  }
+}
+
+/**
+ * @brief Flush all remaining output, close the file and free up all memory
+ * associated with the binary output.
+ *
+ * @param o Binary output.
+ */
+inline static void binary_output_close(struct binary_output *o) {
+  binary_output_flush(o);
+  if (fclose(o->file) != 0) {
+    fprintf(stderr, "Error while closing binary output!\n");
+    abort();
+  }
+  free(o->buffer);
+  o->file = NULL;
+  o->buffer = NULL;
+}
+
+/**
+ * @brief Write the given generator positions to a binary file with the given
+ * name.
+ *
+ * The file starts with a header (see binary_output_write_header()) with file
+ * type BINARY_OUTPUT_TYPE_GENERATORS and the number of generators as first
+ * count, followed by the anchor (double[3]) and side lengths (double[3]) of
+ * the simulation volume and the generator positions (double[count][3], also in
+ * 2D). Since this is the layout of the vertices of a cell, these files can be
+ * mapped into a cell directly (see cell_init_from_file()).
+ *
+ * @param file_name Name of the output file.
+ * @param vertices Generator positions (3 per generator).
+ * @param count Number of generators.
+ * @param dimension Number of dimensions (2 or 3).
+ * @param anchor Anchor of the simulation volume.
+ * @param side Side lengths of the simulation volume.
+ */
+inline static void binary_output_print_generators(
+    const char *file_name, const double *vertices, int count,
+    uint32_t dimension, const double *anchor, const double *side) {
+  const int64_t counts[BINARY_OUTPUT_NCOUNT] = {count, 0, 0, 0};
+
+  struct binary_output o;
+  binary_output_open(&o, file_name);
+  binary_output_write_header(&o, BINARY_OUTPUT_TYPE_GENERATORS, dimension, 0,
+                             counts);
+  binary_output_write_doubles(&o, anchor, 3);
+  binary_output_write_doubles(&o, side, 3);
+  binary_output_write_doubles(&o, vertices, 3 * (size_t)count);
+  binary_output_close(&o);
+}
+
+#endif  // CVORONOI_BINARY_OUTPUT_H
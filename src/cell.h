@@ -19,13 +19,46 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "allocator.h"
+#include "binary_input.h"
+#include "binary_output.h"
 #include "delaunay.h"
 #include "dimensionality.h"
 #include "hilbert.h"
 #include "hydro_space.h"
+#include "instrumentation.h"
 #include "sort.h"
 #include "voronoi.h"
 
+/*! @brief Insert the local vertices in a biased randomized insertion order
+ *  instead of a single hilbert pass (see cell_get_brio_order()). In 3D, this
+ *  speeds up the local insertion by 20-60% for 10^6 vertices, depending on
+ *  the distribution (see bench/). In 2D, it only helps for very regular
+ *  vertices and slows down clustered vertices, so it is off by default. */
+#if defined(DIMENSIONALITY_3D)
+#define CELL_BRIO_INSERTION
+#endif
+
+/*! @brief Minimal number of vertices in the first round of the biased
+ *  randomized insertion order. */
+#define CELL_BRIO_MIN_ROUND_SIZE 1000
+
+/*! @brief Maximal number of rounds of the biased randomized insertion order. */
+#define CELL_BRIO_MAX_ROUNDS 32
+
+/*! @brief Number of coordinates used by the tessellations. */
+#if defined(DIMENSIONALITY_2D)
+#define CELL_DIM 2
+#else
+#define CELL_DIM 3
+#endif
+
+/*! @brief Maximal number of shells of ghost vertices considered by
+ *  cell_add_ghosts(). Every shell is 25% wider than the previous one, so this
+ *  is only reached if the cell is more than 10^6 times larger than the initial
+ *  search radius. */
+#define CELL_MAX_GHOST_SHELLS 64
+
 /**
  * @brief Generate a random uniform double in the range [0, 1].
  *
@@ -49,11 +82,17 @@ struct cell {
   /*! @brief Array of vertices */
   double *vertices;
 
+  /*! @brief Generator file the vertices were mapped from (see
+   * cell_init_from_file()). Its data is NULL if the vertices were allocated
+   * instead. */
+  struct binary_input vertex_file;
+
   /*! @brief Array of hilbert keys of vertices */
   unsigned long *hilbert_keys;
 
   /*! @brief Arg-sort indices for directions: x, y, xyp and xym and the hilbert
-   * key */
+   * key. The directional lists are only needed for the periodic boundaries in
+   * 2D, and are NULL in 3D. */
   int *r_sort_lists[5];
 
   /*! @brief Simulation volume */
@@ -65,9 +104,32 @@ struct cell {
   /*! @brief Voronoi tesselation, empty upon initialization */
   struct voronoi v;
 
+  /*! @brief Previous voronoi tesselation, which stays available while the
+   * next one is constructed in v (see cell_swap_voronoi()) */
+  struct voronoi v_previous;
+
+  /*! @brief Origin of every ghost vertex that was added by cell_add_ghosts():
+   * ghost i was copied from vertex ghost_vertices[i] of neighbour
+   * ghost_ngbs[i]. */
+  int *ghost_ngbs;
+  int *ghost_vertices;
+
+  /*! @brief Number of ghost vertices and size of the ghost origin arrays */
+  int ghost_count;
+  int ghost_size;
+
   /*! @brief Flag indication whether or not the current cell has already
    * constructed its voronoi tesselation */
   int voronoi_active;
+
+  /*! @brief Same as voronoi_active, for v_previous */
+  int voronoi_previous_active;
+
+#ifdef INSTRUMENTATION_ACTIVE
+  /*! @brief Accumulated time spent in the construction phases (see
+   * instrumentation.h) */
+  struct instrumentation_timers timers;
+#endif
 };
 
 /*! @brief Calculate the hilbert keys of the vertices
@@ -75,40 +137,95 @@ struct cell {
  * @param c Cell containing the vertices
  */
 static inline void cell_update_hilbert_keys(struct cell *c) {
-  for (int i = 0; i < c->count; i++) {
-#if defined(DIMENSIONALITY_2D)
-    unsigned long bits[2];
-    int nbits = 32;
-    bits[0] =
-        (c->vertices[3 * i] - c->hs.anchor[0]) / c->hs.side[0] * (1ul << nbits);
-    bits[1] = (c->vertices[3 * i + 1] - c->hs.anchor[1]) / c->hs.side[1] *
-              (1ul << nbits);
-#else
-    unsigned long bits[3];
-    int nbits = 21;
-    bits[0] =
-        (c->vertices[3 * i] - c->hs.anchor[0]) / c->hs.side[0] * (1ul << nbits);
-    bits[1] = (c->vertices[3 * i + 1] - c->hs.anchor[1]) / c->hs.side[1] *
-              (1ul << nbits);
-    bits[2] = (c->vertices[3 * i + 2] - c->hs.anchor[2]) / c->hs.side[2] *
-              (1ul << nbits);
-#endif
-    c->hilbert_keys[i] = hilbert_get_key(bits, nbits);
-  }
+  hilbert_get_keys(c->vertices, c->count, c->hs.anchor, c->hs.side,
+                   c->hilbert_keys);
 }
 
 /*! @brief Update the arg-sort arrays in the various directions
+ *
+ * The arrays are radix sorted (see sort.h). In 3D, only the hilbert order is
+ * used.
  *
  * @param c Cell containing the vertices to be sorted.
  */
 static inline void cell_update_sorts(struct cell *c) {
-  qsort_r(c->r_sort_lists[0], c->count, sizeof(int), sort_x_comp, c->vertices);
-  qsort_r(c->r_sort_lists[1], c->count, sizeof(int), sort_y_comp, c->vertices);
-  qsort_r(c->r_sort_lists[2], c->count, sizeof(int), sort_xyp_comp,
-          c->vertices);
-  qsort_r(c->r_sort_lists[3], c->count, sizeof(int), sort_xym_comp,
-          c->vertices);
-  qsort_r(c->r_sort_lists[4], c->count, sizeof(int), sort_h_comp, c->vertices);
+  uint64_t *keys = (uint64_t *)CVORONOI_MALLOC(c->count * sizeof(uint64_t));
+#if defined(DIMENSIONALITY_2D)
+  for (int i = 0; i < 4; i++) {
+    int *idx = c->r_sort_lists[i];
+    for (int j = 0; j < c->count; j++) {
+      const double x = c->vertices[3 * idx[j]];
+      const double y = c->vertices[3 * idx[j] + 1];
+      const double value = i == 0 ? x : i == 1 ? y : i == 2 ? x + y : x - y;
+      keys[j] = sort_double_to_key(value);
+    }
+    sort_radix_pairs(keys, idx, c->count);
+  }
+#endif
+  sort_arg_keys(c->hilbert_keys, c->r_sort_lists[4], c->count, keys);
+  CVORONOI_FREE(keys);
+}
+
+/*! @brief Initialize the hilbert keys and sort lists of a cell whose vertices
+ * have been set, and initialize its (empty) delaunay tessellation.
+ *
+ * The memory for the tessellation and the ghost origins is reserved up front,
+ * based on an estimate of the number of ghost vertices (see
+ * delaunay_estimate_size()).
+ *
+ * @param c Pointer to cell to be initialized
+ */
+static inline void cell_init_tessellations(struct cell *c) {
+  /* hilbert keys */
+  c->hilbert_keys =
+      (unsigned long *)CVORONOI_MALLOC(c->count * sizeof(unsigned long));
+  cell_update_hilbert_keys(c);
+
+  /* sorting arrays */
+  for (int i = 0; i < 5; i++) {
+#if defined(DIMENSIONALITY_3D)
+    if (i < 4) {
+      c->r_sort_lists[i] = NULL;
+      continue;
+    }
+#endif
+    c->r_sort_lists[i] = (int *)CVORONOI_MALLOC(c->count * sizeof(int));
+    for (int j = 0; j < c->count; j++) {
+      c->r_sort_lists[i][j] = j;
+    }
+  }
+  cell_update_sorts(c);
+
+  const int ghost_count = delaunay_estimate_ghost_count(c->count);
+  int vertex_size, simplex_size;
+  delaunay_estimate_size(c->count, ghost_count, &vertex_size, &simplex_size);
+  delaunay_init(&c->d, &c->hs, c->count, simplex_size);
+  delaunay_reserve(&c->d, vertex_size, simplex_size);
+  c->voronoi_active = 0;
+  c->voronoi_previous_active = 0;
+  instrumentation_reset(&c->timers);
+
+  /* ghost origins */
+  c->ghost_count = 0;
+  c->ghost_size = ghost_count;
+  c->ghost_ngbs = (int *)CVORONOI_MALLOC(c->ghost_size * sizeof(int));
+  c->ghost_vertices = (int *)CVORONOI_MALLOC(c->ghost_size * sizeof(int));
+}
+
+/*! @brief Place the memory of the tessellations of this cell on the memory
+ * domain of the calling thread (see allocator_first_touch()).
+ *
+ * This should be called by the thread that will construct the tessellations
+ * (see space_construct_tessellations()). The voronoi grid is only allocated
+ * when it is constructed, so that its memory is placed by the thread that
+ * constructs it.
+ *
+ * @param c Cell with initialized tessellations.
+ */
+static inline void cell_first_touch(struct cell *c) {
+  delaunay_first_touch(&c->d);
+  allocator_first_touch(c->ghost_ngbs, c->ghost_size * sizeof(int));
+  allocator_first_touch(c->ghost_vertices, c->ghost_size * sizeof(int));
 }
 
 /*! @brief Initialize a new cell with slightly randomized vertices
@@ -122,9 +239,10 @@ static inline void cell_init(struct cell *c, const int *count,
                              const double pert, const double *dim) {
   hydro_space_init(&c->hs, dim);
   c->count = count[0] * count[1] * count[2];
+  c->vertex_file.data = NULL;
 
   /* slightly randomized vertices */
-  c->vertices = (double *)malloc(3 * c->count * sizeof(double));
+  c->vertices = (double *)CVORONOI_MALLOC(3 * c->count * sizeof(double));
   int index = 0;
   for (int ix = 0; ix < count[0]; ++ix) {
     for (int iy = 0; iy < count[1]; ++iy) {
@@ -145,21 +263,75 @@ static inline void cell_init(struct cell *c, const int *count,
     }
   }
 
-  /* hilbert keys */
-  c->hilbert_keys = (unsigned long *)malloc(c->count * sizeof(unsigned long));
-  cell_update_hilbert_keys(c);
+  cell_init_tessellations(c);
+}
 
-  /* sorting arrays */
-  for (int i = 0; i < 5; i++) {
-    c->r_sort_lists[i] = (int *)malloc(c->count * sizeof(int));
-    for (int j = 0; j < c->count; j++) {
-      c->r_sort_lists[i][j] = j;
-    }
+/*! @brief Initialize a new cell containing the given vertices
+ *
+ * @param c Pointer to cell to be initialized
+ * @param vertices Coordinates of the vertices (3 per vertex, also in 2D). The
+ * vertices are copied into the cell.
+ * @param count Number of vertices
+ * @param anchor Anchor of the cell. All vertices should lie within the box
+ * [anchor, anchor + side[.
+ * @param side Side lengths of the cell
+ */
+static inline void cell_init_from_vertices(struct cell *c,
+                                           const double *vertices,
+                                           const int count,
+                                           const double *anchor,
+                                           const double *side) {
+  hydro_space_init(&c->hs, side);
+  c->hs.anchor[0] = anchor[0];
+  c->hs.anchor[1] = anchor[1];
+  c->hs.anchor[2] = anchor[2];
+  c->count = count;
+  c->vertex_file.data = NULL;
+
+  c->vertices = (double *)CVORONOI_MALLOC(3 * c->count * sizeof(double));
+  for (int i = 0; i < 3 * c->count; i++) {
+    c->vertices[i] = vertices[i];
   }
-  cell_update_sorts(c);
 
-  delaunay_init(&c->d, &c->hs, c->count, 10 * c->count);
-  c->voronoi_active = 0;
+  cell_init_tessellations(c);
+}
+
+/*! @brief Initialize a new cell containing the vertices in the given generator
+ * file (see binary_output_print_generators()).
+ *
+ * The file is memory mapped and the cell uses the mapped positions as its
+ * vertices, without copying them. The mapping is private, so that moving the
+ * vertices (e.g. in cell_lloyd_relax_vertices()) does not change the file.
+ *
+ * @param c Pointer to cell to be initialized
+ * @param file_name Name of the generator file
+ */
+static inline void cell_init_from_file(struct cell *c, const char *file_name) {
+  struct binary_input *in = &c->vertex_file;
+  binary_input_open(in, file_name, BINARY_OUTPUT_TYPE_GENERATORS, 1);
+#if defined(DIMENSIONALITY_2D)
+  const uint32_t dimension = 2;
+#else
+  const uint32_t dimension = 3;
+#endif
+  if (in->dimension != dimension) {
+    fprintf(stderr, "Generator file \"%s\" has the wrong dimensionality!\n",
+            file_name);
+    abort();
+  }
+  const double *anchor =
+      (const double *)binary_input_get_array(in, sizeof(double), 3);
+  const double *side =
+      (const double *)binary_input_get_array(in, sizeof(double), 3);
+  hydro_space_init(&c->hs, side);
+  c->hs.anchor[0] = anchor[0];
+  c->hs.anchor[1] = anchor[1];
+  c->hs.anchor[2] = anchor[2];
+  c->count = (int)in->counts[0];
+  c->vertices = (double *)binary_input_get_array(in, 3 * sizeof(double),
+                                                 c->count);
+
+  cell_init_tessellations(c);
 }
 
 /*! @brief Clean up cell
@@ -167,30 +339,157 @@ static inline void cell_init(struct cell *c, const int *count,
  * @param c pointer to cell to be freed
  */
 static inline void cell_destroy(struct cell *c) {
-  free(c->vertices);
-  free(c->hilbert_keys);
+  if (c->vertex_file.data != NULL) {
+    binary_input_close(&c->vertex_file);
+  } else {
+    CVORONOI_FREE(c->vertices);
+  }
+  CVORONOI_FREE(c->hilbert_keys);
   for (int i = 0; i < 5; i++) {
-    free(c->r_sort_lists[i]);
+    CVORONOI_FREE(c->r_sort_lists[i]);
   }
+  CVORONOI_FREE(c->ghost_ngbs);
+  CVORONOI_FREE(c->ghost_vertices);
   delaunay_destroy(&c->d);
   if (c->voronoi_active) {
     voronoi_destroy(&c->v);
   }
+  if (c->voronoi_previous_active) {
+    voronoi_destroy(&c->v_previous);
+  }
+}
+
+/*! @brief Get a pseudo-random 64 bit number for the given integer (splitmix64
+ * finalizer).
+ *
+ * This is used instead of rand(), so that the insertion order only depends on
+ * the vertices and does not change the state of the global random generator.
+ *
+ * @param i Integer.
+ * @return Pseudo-random number.
+ */
+static inline uint64_t cell_hash(uint64_t i) {
+  uint64_t z = i + 0x9e3779b97f4a7c15ull;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+/*! @brief Get the biased randomized insertion order (BRIO) of the vertices.
+ *
+ * The vertices are randomly divided into rounds of geometrically increasing
+ * size: every vertex ends up in the last round with probability 1/2, in the
+ * round before that with probability 1/4, and so on, down to a first round of
+ * about CELL_BRIO_MIN_ROUND_SIZE vertices. Within every round, the vertices
+ * keep their hilbert order. Every round then refines a tessellation of a
+ * random sample of the vertices, which keeps the point location walks short
+ * and local, also for strongly clustered vertices (for which a single hilbert
+ * pass can walk through long chains of thin simplices).
+ *
+ * Every vertex also gets a walk hint (see delaunay_set_walk_hint()): its
+ * closest predecessor along the hilbert curve among the vertices that were
+ * already inserted, if that is a vertex of an earlier round (otherwise the walk
+ * simply starts from the previous vertex of the same round).
+ *
+ * @param c Cell (with up to date sort lists, see cell_update_sorts()).
+ * @param order (Returned) Indices of the vertices in insertion order.
+ * @param hints (Returned) For every vertex in order, the index of the vertex to
+ * start the walk from, or -1 to start from the previously inserted vertex.
+ */
+static inline void cell_get_brio_order(const struct cell *c, int *order,
+                                       int *hints) {
+  int nround = 1;
+  while (nround < CELL_BRIO_MAX_ROUNDS &&
+         (c->count >> nround) >= CELL_BRIO_MIN_ROUND_SIZE) {
+    nround++;
+  }
+
+  /* round of every hilbert position */
+  int *rounds = (int *)CVORONOI_MALLOC(c->count * sizeof(int));
+  int round_count[CELL_BRIO_MAX_ROUNDS] = {0};
+  for (int i = 0; i < c->count; i++) {
+    const int v = c->r_sort_lists[4][i];
+    /* the number of trailing zeros of a random number is i with probability
+       1/2^(i+1) */
+    uint64_t key = cell_hash(v) | (1ull << (nround - 1));
+    int zeros = 0;
+    while (!(key & 1)) {
+      key >>= 1;
+      zeros++;
+    }
+    const int round = nround - 1 - zeros;
+    rounds[i] = round;
+    round_count[round]++;
+  }
+
+  /* stable counting sort of the hilbert order on the rounds */
+  int round_offset[CELL_BRIO_MAX_ROUNDS];
+  int last_position[CELL_BRIO_MAX_ROUNDS];
+  int last_vertex[CELL_BRIO_MAX_ROUNDS];
+  int offset = 0;
+  for (int r = 0; r < nround; r++) {
+    round_offset[r] = offset;
+    offset += round_count[r];
+    last_position[r] = -1;
+    last_vertex[r] = -1;
+  }
+  for (int i = 0; i < c->count; i++) {
+    const int v = c->r_sort_lists[4][i];
+    const int round = rounds[i];
+    /* find the closest preceding vertex along the hilbert curve */
+    int position = last_position[round];
+    int hint = -1;
+    for (int r = 0; r < round; r++) {
+      if (last_position[r] > position) {
+        position = last_position[r];
+        hint = last_vertex[r];
+      }
+    }
+    last_position[round] = i;
+    last_vertex[round] = v;
+    order[round_offset[round]] = v;
+    hints[round_offset[round]] = hint;
+    round_offset[round]++;
+  }
+  CVORONOI_FREE(rounds);
 }
 
 /*! @brief Construct the delaunay triangulation of all the local vertices (no
  * periodic boundaries).
  *
+ * The vertices are inserted in hilbert order, or in a biased randomized
+ * insertion order if CELL_BRIO_INSERTION is defined (see
+ * cell_get_brio_order()).
+ *
  * @param c Pointer to cell containing the vertices to add to the delaunay
  * triangulation.
  */
 static inline void cell_construct_local_delaunay(struct cell *c) {
+  instrumentation_timer_start(start);
+#ifdef CELL_BRIO_INSERTION
+  int *order = (int *)CVORONOI_MALLOC(c->count * sizeof(int));
+  int *hints = (int *)CVORONOI_MALLOC(c->count * sizeof(int));
+  cell_get_brio_order(c, order, hints);
+  for (int i = 0; i < c->count; ++i) {
+    const int j = order[i];
+    if (hints[i] >= 0) {
+      delaunay_set_walk_hint(&c->d, hints[i]);
+    }
+    delaunay_add_local_vertex(&c->d, j, c->vertices[3 * j],
+                              c->vertices[3 * j + 1], c->vertices[3 * j + 2]);
+  }
+  CVORONOI_FREE(order);
+  CVORONOI_FREE(hints);
+#else
   /* Add the local vertices, one by one, in Hilbert order. */
   for (int i = 0; i < c->count; ++i) {
     int j = c->r_sort_lists[4][i];
     delaunay_add_local_vertex(&c->d, j, c->vertices[3 * j],
                               c->vertices[3 * j + 1], c->vertices[3 * j + 2]);
   }
+#endif
+  instrumentation_timer_stop(&c->timers, INSTRUMENTATION_LOCAL_INSERTION,
+                             start);
 
   /* we are done adding the original vertices. We need to consolidate the
      indices of the original vertices within the Delaunay tessellation, so
@@ -199,6 +498,545 @@ static inline void cell_construct_local_delaunay(struct cell *c) {
   delaunay_consolidate(&c->d);
 }
 
+/*! @brief Update the search radii of the delaunay tessellation of this cell
+ * (see delaunay_update_search_radii()).
+ *
+ * @param c Cell containing the delaunay triangulation.
+ * @param r Current search radius.
+ * @return Number of vertices with a search radius larger than r.
+ */
+static inline int cell_update_search_radii(struct cell *c, double r) {
+  instrumentation_timer_start(start);
+  const int count = delaunay_update_search_radii(&c->d, r);
+  instrumentation_timer_stop(&c->timers, INSTRUMENTATION_SEARCH_RADII, start);
+  return count;
+}
+
+/*! @brief Store the origin of a new ghost vertex of this cell.
+ *
+ * @param c Cell.
+ * @param ngb_index Index of the neighbour the ghost was copied from.
+ * @param vertex Index of the vertex in the neighbour the ghost was copied
+ * from.
+ * @return Index of the ghost in the ghost origin arrays.
+ */
+static inline int cell_add_ghost_origin(struct cell *c, int ngb_index,
+                                        int vertex) {
+  if (c->ghost_count == c->ghost_size) {
+    c->ghost_size = delaunay_grow_size(c->ghost_size);
+    c->ghost_ngbs =
+        (int *)CVORONOI_REALLOC(c->ghost_ngbs, c->ghost_size * sizeof(int));
+    c->ghost_vertices =
+        (int *)CVORONOI_REALLOC(c->ghost_vertices, c->ghost_size * sizeof(int));
+  }
+  c->ghost_ngbs[c->ghost_count] = ngb_index;
+  c->ghost_vertices[c->ghost_count] = vertex;
+  return c->ghost_count++;
+}
+
+/*! @brief Distance between the given position and the closest point of the
+ * box of this cell (0 if the position lies inside the box).
+ *
+ * @param c Cell.
+ * @param x Position.
+ * @return Distance.
+ */
+static inline double cell_get_box_distance(const struct cell *c,
+                                           const double *x) {
+  double dist2 = 0.;
+  for (int i = 0; i < CELL_DIM; i++) {
+    double dx = 0.;
+    if (x[i] < c->hs.anchor[i]) {
+      dx = c->hs.anchor[i] - x[i];
+    } else if (x[i] > c->hs.anchor[i] + c->hs.side[i]) {
+      dx = x[i] - (c->hs.anchor[i] + c->hs.side[i]);
+    }
+    dist2 += dx * dx;
+  }
+  return sqrt(dist2);
+}
+
+/*! @brief Grid of the local vertices of a cell that still need ghosts, used
+ * to test which ghosts are needed (see cell_add_ghosts()).
+ *
+ * The grid covers the box of the cell. The vertices are stored per bin, along
+ * with the largest search radius of every bin, so that bins that are too far
+ * away from a ghost can be skipped.
+ */
+struct cell_search_grid {
+  /*! @brief Number of bins in every direction */
+  int nbin[3];
+
+  /*! @brief Side lengths of a single bin */
+  double bin_side[3];
+
+  /*! @brief Offsets of the bins in vertices (size: number of bins + 1) */
+  int *offsets;
+
+  /*! @brief Indices of the vertices, sorted per bin */
+  int *vertices;
+
+  /*! @brief Largest search radius of the vertices in every bin */
+  double *max_radii;
+
+  /*! @brief Largest search radius of all vertices in the grid */
+  double max_radius;
+};
+
+/*! @brief Get the index of the bin containing the given coordinate.
+ *
+ * Coordinates outside the box of the cell are clamped to the closest bin.
+ *
+ * @param grid Grid.
+ * @param c Cell.
+ * @param i Direction.
+ * @param x Coordinate.
+ * @return Bin index in direction i.
+ */
+static inline int cell_search_grid_get_bin(const struct cell_search_grid *grid,
+                                           const struct cell *c, int i,
+                                           double x) {
+  const double b = (x - c->hs.anchor[i]) / grid->bin_side[i];
+  if (!(b > 0.)) return 0;
+  if (b >= grid->nbin[i]) return grid->nbin[i] - 1;
+  return (int)b;
+}
+
+/*! @brief Initialize the grid of the local vertices of this cell that still
+ * need ghosts after all ghosts within a distance old_r of the cell were
+ * considered.
+ *
+ * These are the vertices whose search radius is larger than old_r and that
+ * are closer than their search radius to the boundary of the cell, since only
+ * ghosts within its search radius can change the tessellation of a vertex.
+ *
+ * @param grid Grid to initialize.
+ * @param c Cell with up to date search radii.
+ * @param old_r Distance within which all ghosts were already considered.
+ * @param r Distance of the ghosts that will be tested, used to size the bins.
+ * @return Number of vertices in the grid.
+ */
+static inline int cell_search_grid_init(struct cell_search_grid *grid,
+                                        const struct cell *c, double old_r,
+                                        double r) {
+  const double *search_radii = c->d.search_radii;
+  int *vertices = (int *)CVORONOI_MALLOC(c->count * sizeof(int));
+  int nvertex = 0;
+  for (int j = 0; j < c->count; j++) {
+    const double radius = search_radii[c->d.vertex_start + j];
+    if (radius <= old_r) continue;
+    double boundary_dist = DBL_MAX;
+    for (int i = 0; i < CELL_DIM; i++) {
+      const double x = c->vertices[3 * j + i];
+      boundary_dist = fmin(boundary_dist, x - c->hs.anchor[i]);
+      boundary_dist =
+          fmin(boundary_dist, c->hs.anchor[i] + c->hs.side[i] - x);
+    }
+    if (radius > boundary_dist) {
+      vertices[nvertex++] = j;
+    }
+  }
+
+  /* bins of roughly size r, with at most one bin per vertex */
+  const int max_nbin = (int)pow(nvertex, 1. / CELL_DIM);
+  int nbin = 1;
+  for (int i = 0; i < 3; i++) {
+    grid->nbin[i] = 1;
+    if (i < CELL_DIM) {
+      grid->nbin[i] = (int)fmin(c->hs.side[i] / r, max_nbin);
+      if (grid->nbin[i] < 1) grid->nbin[i] = 1;
+    }
+    grid->bin_side[i] = c->hs.side[i] / grid->nbin[i];
+    nbin *= grid->nbin[i];
+  }
+
+  /* counting sort of the vertices on their bins */
+  int *bins = (int *)CVORONOI_MALLOC(nvertex * sizeof(int));
+  grid->offsets = (int *)CVORONOI_CALLOC(nbin + 1, sizeof(int));
+  grid->max_radii = (double *)CVORONOI_CALLOC(nbin, sizeof(double));
+  grid->max_radius = 0.;
+  for (int k = 0; k < nvertex; k++) {
+    const int j = vertices[k];
+    int bin = 0;
+    for (int i = CELL_DIM - 1; i >= 0; i--) {
+      bin = bin * grid->nbin[i] +
+            cell_search_grid_get_bin(grid, c, i, c->vertices[3 * j + i]);
+    }
+    bins[k] = bin;
+    grid->offsets[bin + 1]++;
+    const double radius = search_radii[c->d.vertex_start + j];
+    grid->max_radii[bin] = fmax(grid->max_radii[bin], radius);
+    grid->max_radius = fmax(grid->max_radius, radius);
+  }
+  for (int b = 0; b < nbin; b++) {
+    grid->offsets[b + 1] += grid->offsets[b];
+  }
+  grid->vertices = (int *)CVORONOI_MALLOC(nvertex * sizeof(int));
+  for (int k = 0; k < nvertex; k++) {
+    grid->vertices[grid->offsets[bins[k]]++] = vertices[k];
+  }
+  /* the offsets were shifted by one bin while filling */
+  for (int b = nbin; b > 0; b--) {
+    grid->offsets[b] = grid->offsets[b - 1];
+  }
+  grid->offsets[0] = 0;
+
+  CVORONOI_FREE(bins);
+  CVORONOI_FREE(vertices);
+  return nvertex;
+}
+
+/*! @brief Check whether the given bin contains a vertex whose search radius
+ * contains the given position.
+ *
+ * @param grid Grid.
+ * @param c Cell.
+ * @param bin Bin index.
+ * @param x Position.
+ * @return 1 if such a vertex exists, 0 otherwise.
+ */
+static inline int cell_search_grid_test_bin(const struct cell_search_grid *grid,
+                                            const struct cell *c, int bin,
+                                            const double *x) {
+  for (int k = grid->offsets[bin]; k < grid->offsets[bin + 1]; k++) {
+    const int j = grid->vertices[k];
+    double dist2 = 0.;
+    for (int i = 0; i < CELL_DIM; i++) {
+      const double dx = x[i] - c->vertices[3 * j + i];
+      dist2 += dx * dx;
+    }
+    const double radius = c->d.search_radii[c->d.vertex_start + j];
+    if (dist2 < radius * radius) return 1;
+  }
+  return 0;
+}
+
+/*! @brief Check whether the given (ghost) position lies within the search
+ * radius of one of the vertices in the grid.
+ *
+ * The bin closest to the position is tested first, since it is by far the
+ * most likely to contain such a vertex. The other bins are only tested if
+ * they are within the largest search radius of their vertices.
+ *
+ * @param grid Grid.
+ * @param c Cell.
+ * @param x Position.
+ * @return 1 if the position is within the search radius of a vertex in the
+ * grid, 0 otherwise.
+ */
+static inline int cell_search_grid_test(const struct cell_search_grid *grid,
+                                        const struct cell *c, const double *x) {
+  int lo[3] = {0, 0, 0}, hi[3] = {0, 0, 0}, closest[3] = {0, 0, 0};
+  for (int i = 0; i < CELL_DIM; i++) {
+    lo[i] = cell_search_grid_get_bin(grid, c, i, x[i] - grid->max_radius);
+    hi[i] = cell_search_grid_get_bin(grid, c, i, x[i] + grid->max_radius);
+    closest[i] = cell_search_grid_get_bin(grid, c, i, x[i]);
+  }
+  const int closest_bin =
+      (closest[2] * grid->nbin[1] + closest[1]) * grid->nbin[0] + closest[0];
+  if (cell_search_grid_test_bin(grid, c, closest_bin, x)) return 1;
+
+  for (int bz = lo[2]; bz <= hi[2]; bz++) {
+    for (int by = lo[1]; by <= hi[1]; by++) {
+      for (int bx = lo[0]; bx <= hi[0]; bx++) {
+        const int bin = (bz * grid->nbin[1] + by) * grid->nbin[0] + bx;
+        if (bin == closest_bin ||
+            grid->offsets[bin] == grid->offsets[bin + 1]) {
+          continue;
+        }
+        /* distance between x and the box of the bin */
+        const int b[3] = {bx, by, bz};
+        double dist2 = 0.;
+        for (int i = 0; i < CELL_DIM; i++) {
+          const double min = c->hs.anchor[i] + b[i] * grid->bin_side[i];
+          double dx = 0.;
+          if (x[i] < min) {
+            dx = min - x[i];
+          } else if (x[i] > min + grid->bin_side[i]) {
+            dx = x[i] - (min + grid->bin_side[i]);
+          }
+          dist2 += dx * dx;
+        }
+        if (dist2 >= grid->max_radii[bin] * grid->max_radii[bin]) continue;
+        if (cell_search_grid_test_bin(grid, c, bin, x)) return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+/*! @brief Free the memory used by the grid.
+ *
+ * @param grid Grid.
+ */
+static inline void cell_search_grid_destroy(struct cell_search_grid *grid) {
+  CVORONOI_FREE(grid->offsets);
+  CVORONOI_FREE(grid->vertices);
+  CVORONOI_FREE(grid->max_radii);
+}
+
+/*! @brief Add a vertex of the given cell as ghost vertex to the delaunay
+ * tessellation of this cell.
+ *
+ * The origin of every ghost is recorded, so that the ghosts can be moved
+ * together with the vertices they were copied from (see cell_move_ghosts()).
+ * If the tessellation stores periodic ghosts (see
+ * delaunay_set_periodic_shifts()), ngb has to be c and the ghost is added
+ * without coordinates.
+ *
+ * @param c Cell containing the consolidated delaunay triangulation.
+ * @param ngb_index Index of ngb in the list of neighbours of c.
+ * @param ngb Cell to copy the vertex from (can be the same as c, e.g. for
+ * periodic copies).
+ * @param l Index of the vertex in ngb.
+ * @param x Position of the ghost (the shifted position of the vertex).
+ */
+static inline void cell_add_ghost(struct cell *c, int ngb_index,
+                                  const struct cell *ngb, int l,
+                                  const double *x) {
+#if defined(DIMENSIONALITY_2D)
+  delaunay_add_new_vertex(&c->d, x[0], x[1]);
+#else
+  if (c->d.periodic_shift_count > 0) {
+    /* periodic copy: ngb_index is also the index of its shift */
+    delaunay_assert(ngb == c);
+    delaunay_add_periodic_ghost(&c->d, l, ngb_index);
+  } else {
+    delaunay_add_new_vertex(&c->d, x[0], x[1], x[2]);
+  }
+#endif
+  cell_add_ghost_origin(c, ngb_index, l);
+}
+
+/*! @brief Add the ghost vertices from the given neighbouring cells that are
+ * necessary to complete the delaunay tessellation of the local vertices.
+ *
+ * We use the completeness criterion of Springel (2010): the tessellation of a
+ * local vertex is complete if all vertices within its search radius (twice the
+ * radius of the largest circumsphere of the tetrahedra it is part of) have
+ * been added. Starting from an initial guess, we iteratively consider the
+ * ghosts within a distance r of this cell, update the search radii of all
+ * local vertices and increase r, until all search radii are smaller than r.
+ *
+ * The vertices of the neighbours are sorted once on the shell between two
+ * successive values of r they lie in, so that every iteration only considers
+ * the ghosts in the new shell. A ghost is only added if it lies within the
+ * search radius of a local vertex that still needs ghosts (see
+ * cell_search_grid_init()). Adding vertices only shrinks the voronoi cells,
+ * and hence the search radii, so that ghosts that were not needed never become
+ * needed in a later iteration. Within a shell, the ghosts are added in the
+ * hilbert order of the cell they are copied from.
+ *
+ * The ghosts that were already added (during a previous call with the same
+ * list of neighbours) are skipped, so that no ghost is added twice. This makes
+ * it possible to call this function again after vertices were moved.
+ *
+ * @param c Cell containing the consolidated delaunay triangulation.
+ * @param ngbs Cells to copy the ghosts from (can contain c itself, e.g. for
+ * periodic copies).
+ * @param shifts Shifts to apply to the vertices of every cell in ngbs (3 per
+ * cell).
+ * @param nngb Number of cells in ngbs.
+ */
+static inline void cell_add_ghosts(struct cell *c, const struct cell **ngbs,
+                                   const double *shifts, int nngb) {
+  /* Initial search radius. We use twice the average inter-particle
+     separation, but other values would also work. */
+#if defined(DIMENSIONALITY_2D)
+  double r = 2. * sqrt(c->hs.side[0] * c->hs.side[1] / c->count);
+  const double max_r = fmax(c->hs.side[0], c->hs.side[1]);
+#else
+  double r =
+      2. * cbrt(c->hs.side[0] * c->hs.side[1] * c->hs.side[2] / c->count);
+  const double max_r =
+      fmax(c->hs.side[0], fmax(c->hs.side[1], c->hs.side[2]));
+#endif
+
+  /* the outer radii of the shells */
+  int nshell = 1;
+  double radii[CELL_MAX_GHOST_SHELLS];
+  radii[0] = fmin(r, max_r);
+  while (radii[nshell - 1] < max_r && nshell < CELL_MAX_GHOST_SHELLS) {
+    radii[nshell] = fmin(1.25 * radii[nshell - 1], max_r);
+    nshell++;
+  }
+  radii[nshell - 1] = max_r;
+
+  /* shell of every vertex of the neighbours, or -1 if it was already added as
+     a ghost or lies beyond the largest shell */
+  int *ngb_offsets = (int *)CVORONOI_MALLOC((nngb + 1) * sizeof(int));
+  ngb_offsets[0] = 0;
+  for (int i = 0; i < nngb; i++) {
+    ngb_offsets[i + 1] = ngb_offsets[i] + ngbs[i]->count;
+  }
+  int *shell = (int *)CVORONOI_MALLOC(ngb_offsets[nngb] * sizeof(int));
+  for (int i = 0; i < ngb_offsets[nngb]; i++) {
+    shell[i] = 0;
+  }
+  for (int i = 0; i < c->ghost_count; i++) {
+    shell[ngb_offsets[c->ghost_ngbs[i]] + c->ghost_vertices[i]] = -1;
+  }
+
+  /* stable counting sort of the vertices of every neighbour (in hilbert
+     order) on their shell */
+  int *shell_offsets =
+      (int *)CVORONOI_CALLOC(nngb * nshell + 1, sizeof(int));
+  for (int i = 0; i < nngb; i++) {
+    const struct cell *ngb = ngbs[i];
+    for (int l = 0; l < ngb->count; l++) {
+      if (shell[ngb_offsets[i] + l] < 0) continue;
+      double x[3];
+      for (int k = 0; k < 3; k++) {
+        x[k] = ngb->vertices[3 * l + k] + shifts[3 * i + k];
+      }
+      const double dist = cell_get_box_distance(c, x);
+      int s = 0;
+      while (s < nshell && dist >= radii[s]) s++;
+      if (s == nshell) {
+        shell[ngb_offsets[i] + l] = -1;
+      } else {
+        shell[ngb_offsets[i] + l] = s;
+        shell_offsets[i * nshell + s + 1]++;
+      }
+    }
+  }
+  for (int i = 0; i < nngb * nshell; i++) {
+    shell_offsets[i + 1] += shell_offsets[i];
+  }
+  int *candidates =
+      (int *)CVORONOI_MALLOC(shell_offsets[nngb * nshell] * sizeof(int));
+  for (int i = 0; i < nngb; i++) {
+    const struct cell *ngb = ngbs[i];
+    for (int k = 0; k < ngb->count; k++) {
+      const int l = ngb->r_sort_lists[4][k];
+      const int s = shell[ngb_offsets[i] + l];
+      if (s < 0) continue;
+      candidates[shell_offsets[i * nshell + s]++] = l;
+    }
+  }
+  /* the offsets were shifted by one shell while filling */
+  for (int i = nngb * nshell; i > 0; i--) {
+    shell_offsets[i] = shell_offsets[i - 1];
+  }
+  shell_offsets[0] = 0;
+
+  int count = cell_update_search_radii(c, -DBL_MAX);
+  double old_r = 0.;
+  for (int s = 0; count > 0; s++) {
+    if (s == nshell) {
+      /* Ghosts are only copied from the direct neighbours of this cell, so
+         larger search radii cannot be dealt with */
+      fprintf(stderr,
+              "Search radius larger than cell size, "
+              "not enough vertices to construct ghosts!\n");
+      abort();
+    }
+    r = radii[s];
+    instrumentation_timer_start(start);
+    struct cell_search_grid grid;
+    if (cell_search_grid_init(&grid, c, old_r, r) > 0) {
+      for (int i = 0; i < nngb; i++) {
+        const int *ngb_candidates = &candidates[shell_offsets[i * nshell + s]];
+        const int ncandidate = shell_offsets[i * nshell + s + 1] -
+                               shell_offsets[i * nshell + s];
+        for (int k = 0; k < ncandidate; k++) {
+          const int l = ngb_candidates[k];
+          double x[3];
+          for (int j = 0; j < 3; j++) {
+            x[j] = ngbs[i]->vertices[3 * l + j] + shifts[3 * i + j];
+          }
+          if (cell_search_grid_test(&grid, c, x)) {
+            cell_add_ghost(c, i, ngbs[i], l, x);
+          }
+        }
+      }
+    }
+    cell_search_grid_destroy(&grid);
+    instrumentation_timer_stop(&c->timers, INSTRUMENTATION_GHOST_INSERTION,
+                               start);
+    count = cell_update_search_radii(c, r);
+    old_r = r;
+  }
+
+  CVORONOI_FREE(candidates);
+  CVORONOI_FREE(shell_offsets);
+  CVORONOI_FREE(shell);
+  CVORONOI_FREE(ngb_offsets);
+}
+
+/*! @brief Move the ghost vertices that were added by cell_add_ghosts() to the
+ * current positions of the vertices they were copied from.
+ *
+ * Like delaunay_move_vertex(), this does not update the tessellation.
+ * Periodic ghosts (see delaunay_set_periodic_shifts()) already follow the
+ * vertices they were copied from and are left alone.
+ *
+ * @param c Cell containing the delaunay triangulation with ghosts.
+ * @param ngbs Cells the ghosts were copied from (same as for
+ * cell_add_ghosts()).
+ * @param shifts Shifts to apply to the vertices of every cell in ngbs.
+ */
+static inline void cell_move_ghosts(struct cell *c, const struct cell **ngbs,
+                                    const double *shifts) {
+#if defined(DIMENSIONALITY_3D)
+  if (c->d.periodic_shift_count > 0) return;
+  for (int i = 0; i < c->ghost_count; i++) {
+    const int ngb_index = c->ghost_ngbs[i];
+    const double *x = &ngbs[ngb_index]->vertices[3 * c->ghost_vertices[i]];
+    const double *shift = &shifts[3 * ngb_index];
+    delaunay_move_vertex(&c->d, c->d.ghost_offset + i, x[0] + shift[0],
+                         x[1] + shift[1], x[2] + shift[2]);
+  }
+#endif
+}
+
+/*! @brief Check that the ghost vertices of this cell are sufficient to
+ * guarantee that the delaunay tessellation of the local vertices is complete.
+ *
+ * This is the case if the search radius of all local vertices is at least
+ * twice the radius of the circumsphere of the tetrahedra they are connected to.
+ * This check is only done when DELAUNAY_CHECKS is activated.
+ *
+ * @param c Cell containing the delaunay triangulation with ghosts.
+ */
+static inline void cell_check_ghosts(struct cell *c) {
+#if defined(DELAUNAY_CHECKS) && defined(DIMENSIONALITY_3D)
+  /* recompute all search radii in a single pass */
+  delaunay_update_search_radii(&c->d, -DBL_MAX);
+  for (int i = c->d.vertex_start; i < c->d.vertex_end; i++) {
+    double search_radius = c->d.search_radii[i];
+    double radius =
+        delaunay_get_radius(&c->d, c->d.vertex_tetrahedron_links[i]);
+    delaunay_assert(search_radius >= 2. * radius);
+    delaunay_assert(search_radius < c->hs.side[0]);
+  }
+#endif
+}
+
+/*! @brief Get the neighbours of a periodic cell, which are all periodic
+ * copies of the cell itself.
+ *
+ * @param c Cell.
+ * @param ngbs (Returned) Neighbouring cells (26 in 3D).
+ * @param shifts (Returned) Shifts to apply to the vertices of every cell in
+ * ngbs (3 per cell).
+ * @return Number of neighbours.
+ */
+static inline int cell_get_periodic_ngbs(struct cell *c,
+                                         const struct cell **ngbs,
+                                         double *shifts) {
+  int nngb = 0;
+  for (int i = 0; i < 27; i++) {
+    if (i == 13) continue; /* skip (0, 0, 0) */
+    ngbs[nngb] = c;
+    shifts[3 * nngb] = ((i % 3) - 1.) * c->hs.side[0];
+    shifts[3 * nngb + 1] = ((i / 3) % 3 - 1.) * c->hs.side[1];
+    shifts[3 * nngb + 2] = ((i / 9) % 3 - 1.) * c->hs.side[2];
+    ++nngb;
+  }
+  return nngb;
+}
+
 /*! @brief Impose periodic boundaries by adding the necessary ghost vertices
  *
  * Add ghosts to impose the periodic boundaries. These ghosts will be
@@ -227,147 +1065,102 @@ static inline void cell_make_delaunay_periodic(struct cell *c) {
   /* update the search radii for all triangles in the tessellation and count
      the number of triangles with circumcircles larger than the current search
      radius */
-  int count = delaunay_update_search_radii(&c->d, old_r);
+  int count = cell_update_search_radii(c, old_r);
 //  printf("count: %i\n", count);
   while (count > 0) {
+    instrumentation_timer_start(start);
     /* add ghosts for the positive horizontal boundary */
-    int i = 0;
-    int vi = c->r_sort_lists[0][i];
-    while (c->vertices[3 * vi] < r) {
-      if (i == c->count) break;
-      ++i;
-      if (c->vertices[3 * vi] < old_r) {
-        vi = c->r_sort_lists[0][i];
-        continue;
-      }
+    for (int i = 0; i < c->count; ++i) {
+      const int vi = c->r_sort_lists[0][i];
+      const double dist = c->vertices[3 * vi];
+      if (dist >= r) break;
+      if (dist < old_r) continue;
       delaunay_add_new_vertex(
           &c->d, c->vertices[3 * vi] + c->hs.anchor[0] + c->hs.side[0],
           c->vertices[3 * vi + 1]);
-      vi = c->r_sort_lists[0][i];
     }
     /* add ghosts for the negative horizontal boundary */
-    i = c->count - 1;
-    vi = c->r_sort_lists[0][i];
-    while (c->hs.anchor[0] + c->hs.side[0] - c->vertices[3 * vi] < r) {
-      if (i == -1) break;
-      --i;
-      if (c->hs.anchor[0] + c->hs.side[0] - c->vertices[3 * vi] < old_r) {
-        vi = c->r_sort_lists[0][i];
-        continue;
-      }
-      delaunay_log("x: %g, old_r: %g, r: %g",
-                   c->hs.anchor[0] + c->hs.side[0] - c->vertices[3 * vi], old_r,
-                   r);
+    for (int i = c->count - 1; i >= 0; --i) {
+      const int vi = c->r_sort_lists[0][i];
+      const double dist = c->hs.anchor[0] + c->hs.side[0] - c->vertices[3 * vi];
+      if (dist >= r) break;
+      if (dist < old_r) continue;
+      delaunay_log("x: %g, old_r: %g, r: %g", dist, old_r, r);
       delaunay_add_new_vertex(
           &c->d, c->vertices[3 * vi] - (c->hs.anchor[0] + c->hs.side[0]),
           c->vertices[3 * vi + 1]);
-      vi = c->r_sort_lists[0][i];
     }
     /* add ghosts for the positive vertical boundary */
-    i = 0;
-    vi = c->r_sort_lists[1][i];
-    while (c->vertices[3 * vi + 1] < r) {
-      if (i == c->count) break;
-      ++i;
-      if (c->vertices[3 * vi + 1] < old_r) {
-        vi = c->r_sort_lists[1][i];
-        continue;
-      }
+    for (int i = 0; i < c->count; ++i) {
+      const int vi = c->r_sort_lists[1][i];
+      const double dist = c->vertices[3 * vi + 1];
+      if (dist >= r) break;
+      if (dist < old_r) continue;
       delaunay_add_new_vertex(
           &c->d, c->vertices[3 * vi],
           c->vertices[3 * vi + 1] + c->hs.anchor[1] + c->hs.side[1]);
-      vi = c->r_sort_lists[1][i];
     }
     /* add ghosts for the negative vertical boundary */
-    i = c->count - 1;
-    vi = c->r_sort_lists[1][i];
-    while (c->hs.anchor[1] + c->hs.side[1] - c->vertices[3 * vi + 1] < r) {
-      if (i == -1) break;
-      --i;
-      if (c->hs.anchor[1] + c->hs.side[1] - c->vertices[3 * vi + 1] < old_r) {
-        vi = c->r_sort_lists[1][i];
-        continue;
-      }
+    for (int i = c->count - 1; i >= 0; --i) {
+      const int vi = c->r_sort_lists[1][i];
+      const double dist =
+          c->hs.anchor[1] + c->hs.side[1] - c->vertices[3 * vi + 1];
+      if (dist >= r) break;
+      if (dist < old_r) continue;
       delaunay_add_new_vertex(
           &c->d, c->vertices[3 * vi],
           c->vertices[3 * vi + 1] - (c->hs.anchor[1] + c->hs.side[1]));
-      vi = c->r_sort_lists[1][i];
     }
     /* add ghosts for the positive x=y diagonal (top right) corner */
-    i = 0;
-    vi = c->r_sort_lists[2][i];
-    while (c->vertices[3 * vi] + c->vertices[3 * vi + 1] < r * sqrt2) {
-      if (i == c->count) break;
-      ++i;
-      if (c->vertices[3 * vi] + c->vertices[3 * vi + 1] < old_r * sqrt2) {
-        vi = c->r_sort_lists[2][i];
-        continue;
-      }
+    for (int i = 0; i < c->count; ++i) {
+      const int vi = c->r_sort_lists[2][i];
+      const double dist = c->vertices[3 * vi] + c->vertices[3 * vi + 1];
+      if (dist >= r * sqrt2) break;
+      if (dist < old_r * sqrt2) continue;
       delaunay_add_new_vertex(
           &c->d, c->vertices[3 * vi] + c->hs.anchor[0] + c->hs.side[0],
           c->vertices[3 * vi + 1] + c->hs.anchor[1] + c->hs.side[1]);
-      vi = c->r_sort_lists[2][i];
     }
     /* add ghosts for the negative x=y diagonal (bottom left) corner */
-    i = c->count - 1;
-    vi = c->r_sort_lists[2][i];
-    while (c->hs.anchor[0] + c->hs.side[0] - c->vertices[3 * vi] +
-               c->hs.anchor[1] + c->hs.side[1] - c->vertices[3 * vi + 1] <
-           r * sqrt2) {
-      if (i == -1) break;
-      --i;
-      if (c->hs.anchor[0] + c->hs.side[0] - c->vertices[3 * vi] +
-              c->hs.anchor[1] + c->hs.side[1] - c->vertices[3 * vi + 1] <
-          old_r * sqrt2) {
-        vi = c->r_sort_lists[2][i];
-        continue;
-      }
+    for (int i = c->count - 1; i >= 0; --i) {
+      const int vi = c->r_sort_lists[2][i];
+      const double dist = c->hs.anchor[0] + c->hs.side[0] -
+                          c->vertices[3 * vi] + c->hs.anchor[1] +
+                          c->hs.side[1] - c->vertices[3 * vi + 1];
+      if (dist >= r * sqrt2) break;
+      if (dist < old_r * sqrt2) continue;
       delaunay_add_new_vertex(
           &c->d, c->vertices[3 * vi] - (c->hs.anchor[0] + c->hs.side[0]),
           c->vertices[3 * vi + 1] - (c->hs.anchor[1] + c->hs.side[1]));
-      vi = c->r_sort_lists[2][i];
     }
     /* add ghosts for the positive x=-y diagonal (bottom right) corner */
-    i = 0;
-    vi = c->r_sort_lists[3][i];
-    while (c->vertices[3 * vi] - (c->hs.anchor[1] + c->hs.side[1]) +
-               c->vertices[3 * vi + 1] <
-           r * sqrt2) {
-      if (i == c->count) break;
-      ++i;
-      if (c->vertices[3 * vi] - (c->hs.anchor[1] + c->hs.side[1]) +
-              c->vertices[3 * vi + 1] <
-          old_r * sqrt2) {
-        vi = c->r_sort_lists[3][i];
-        continue;
-      }
+    for (int i = 0; i < c->count; ++i) {
+      const int vi = c->r_sort_lists[3][i];
+      const double dist = c->vertices[3 * vi] -
+                          (c->hs.anchor[1] + c->hs.side[1]) +
+                          c->vertices[3 * vi + 1];
+      if (dist >= r * sqrt2) break;
+      if (dist < old_r * sqrt2) continue;
       delaunay_add_new_vertex(
           &c->d, c->vertices[3 * vi] + c->hs.anchor[0] + c->hs.side[0],
           c->vertices[3 * vi + 1] - (c->hs.anchor[1] + c->hs.side[1]));
-      vi = c->r_sort_lists[3][i];
     }
     /* add ghosts for the negative x=-y diagonal (top left) corner */
-    i = c->count - 1;
-    vi = c->r_sort_lists[3][i];
-    while (c->hs.anchor[0] + c->hs.side[0] - c->vertices[3 * vi] -
-               c->vertices[3 * vi + 1] <
-           r * sqrt2) {
-      if (i == -1) break;
-      --i;
-      if (c->hs.anchor[0] + c->hs.side[0] - c->vertices[3 * vi] -
-              c->vertices[3 * vi + 1] <
-          old_r * sqrt2) {
-        vi = c->r_sort_lists[3][i];
-        continue;
-      }
+    for (int i = c->count - 1; i >= 0; --i) {
+      const int vi = c->r_sort_lists[3][i];
+      const double dist = c->hs.anchor[0] + c->hs.side[0] -
+                          c->vertices[3 * vi] - c->vertices[3 * vi + 1];
+      if (dist >= r * sqrt2) break;
+      if (dist < old_r * sqrt2) continue;
       delaunay_add_new_vertex(
           &c->d, c->vertices[3 * vi] - (c->hs.anchor[0] + c->hs.side[0]),
           c->vertices[3 * vi + 1] + c->hs.anchor[1] + c->hs.side[1]);
-      vi = c->r_sort_lists[3][i];
     }
+    instrumentation_timer_stop(&c->timers, INSTRUMENTATION_GHOST_INSERTION,
+                               start);
     /* update the search radii to the new value and count the number of larger
        circumcircles. */
-    count = delaunay_update_search_radii(&c->d, r);
+    count = cell_update_search_radii(c, r);
 //    printf("count: %i\n", count);
 
     /* we do not want to add the same ghost twice (this causes the incremental
@@ -379,44 +1172,149 @@ static inline void cell_make_delaunay_periodic(struct cell *c) {
     r *= 1.25;
   }
 #else
-  for (int i = 0; i < 27; i++) {
-    if (i == 13) continue; /* skip (0, 0, 0) */
-    double shiftx = ((i % 3) - 1.) * c->hs.side[0];
-    double shifty = ((i / 3) % 3 - 1.) * c->hs.side[1];
-    double shiftz = ((i / 9) % 3 - 1.) * c->hs.side[2];
-
-    for (int k = 0; k < c->count; ++k) {
-      int l = c->r_sort_lists[4][k];
-      delaunay_add_new_vertex(&c->d, c->vertices[3 * l] + shiftx,
-                              c->vertices[3 * l + 1] + shifty,
-                              c->vertices[3 * l + 2] + shiftz);
-    }
-  }
-#ifdef DELAUNAY_CHECKS
-  for (int i = c->d.vertex_start; i < c->d.vertex_end; i++){
-    double search_radius = delaunay_get_search_radius(&c->d, i);
-    double radius = delaunay_get_radius(&c->d, c->d.vertex_tetrahedron_links[i]);
-    delaunay_assert(search_radius >= 2. * radius);
-    delaunay_assert(search_radius < c->hs.side[0]);
-  }
-#endif
+  /* The neighbours of this cell are all periodic copies of the cell itself */
+  const struct cell *ngbs[26];
+  double shifts[3 * 26];
+  const int nngb = cell_get_periodic_ngbs(c, ngbs, shifts);
+  /* so the ghosts can be stored as (vertex, shift) pairs */
+  delaunay_set_periodic_shifts(&c->d, shifts, nngb);
+  cell_add_ghosts(c, ngbs, shifts, nngb);
+  cell_check_ghosts(c);
 #endif
 }
 
+/*! @brief Construct (the given parts of) the voronoi grid from this cells
+ * delaunay triangulation (see voronoi_set_mode()). */
+static inline void cell_construct_voronoi_mode(struct cell *c, int mode) {
+  instrumentation_timer_start(start);
+  if (!c->voronoi_active) {
+    c->voronoi_active = 1;
+    voronoi_init_empty(&c->v, 0);
+  }
+  voronoi_set_mode(&c->v, mode);
+  voronoi_reset(&c->v, &c->d);
+  instrumentation_timer_stop(&c->timers, INSTRUMENTATION_VORONOI, start);
+}
+
 /*! @brief Construct the voronoi grid from this cells delaunay triangulation
+ *
+ * If the cell already has a voronoi grid, its memory is reused (see
+ * voronoi_reset()).
  *
  * @param c The cell containing the delaunay triangulation
  */
 static inline void cell_construct_voronoi(struct cell *c) {
-  c->voronoi_active = 1;
-  voronoi_init(&c->v, &c->d);
+  cell_construct_voronoi_mode(c, VORONOI_MODE_FULL);
+}
+
+/*! @brief Only compute the volumes and centroids of the voronoi cells from
+ * this cells delaunay triangulation, without storing any faces.
+ *
+ * This is cheaper than cell_construct_voronoi() (see voronoi_set_mode()). A
+ * later call to cell_construct_voronoi() constructs the complete grid.
+ *
+ * @param c The cell containing the delaunay triangulation
+ */
+static inline void cell_construct_voronoi_volumes(struct cell *c) {
+  cell_construct_voronoi_mode(c, VORONOI_MODE_VOLUMES);
+}
+
+/*! @brief Swap the voronoi grid of this cell with its previous grid.
+ *
+ * This double buffers the voronoi grid: after the swap, the current grid is
+ * available as c->v_previous, and the next call to cell_construct_voronoi()
+ * builds the new grid in c->v, reusing the memory of the grid before that.
+ * The voronoi grid does not reference the delaunay tessellation or the
+ * vertices, so that the previous grid can be read (e.g. written to a file)
+ * while the tessellations of the cell are rebuilt.
+ *
+ * @param c The cell
+ */
+static inline void cell_swap_voronoi(struct cell *c) {
+  const struct voronoi v = c->v;
+  c->v = c->v_previous;
+  c->v_previous = v;
+  const int active = c->voronoi_active;
+  c->voronoi_active = c->voronoi_previous_active;
+  c->voronoi_previous_active = active;
+}
+
+/*! @brief Reset the delaunay tessellation of this cell after its vertices
+ * were changed, so that the tessellations can be rebuilt from scratch.
+ *
+ * The hilbert keys and sort lists are updated and all ghosts are removed, but
+ * the memory of the tessellation is kept (see delaunay_reset()).
+ *
+ * @param c The cell
+ */
+static inline void cell_reset_delaunay(struct cell *c) {
+  c->ghost_count = 0;
+  cell_update_hilbert_keys(c);
+  cell_update_sorts(c);
+  delaunay_reset(&c->d, &c->hs, c->count);
+}
+
+#if defined(DIMENSIONALITY_3D)
+/*! @brief Compact the delaunay tessellation of this cell once it is complete
+ * (see delaunay_compact()).
+ *
+ * This frees the memory that is only needed to change the tessellation, and
+ * removes the tetrahedra that are not part of the voronoi grid, which is
+ * useful for cells whose grid is kept for a long time. The voronoi grid can
+ * still be (re)constructed from the compacted tessellation; moving the
+ * vertices afterwards rebuilds the tessellation from scratch.
+ *
+ * @param c Cell containing the delaunay tessellation with ghosts.
+ * @param hilbert_order Whether to reorder the tetrahedra along the Hilbert
+ * curve.
+ */
+static inline void cell_compact_delaunay(struct cell *c, int hilbert_order) {
+  delaunay_compact(&c->d, hilbert_order);
+}
+#endif
+
+/*! @brief Update the delaunay tessellation of a periodic cell after its
+ * vertices have been moved, without rebuilding it.
+ *
+ * The local and ghost vertices are moved in place and the tessellation is
+ * repaired by flipping (see delaunay_repair()). Afterwards, the ghosts that
+ * are missing for the new vertex positions are added.
+ *
+ * @param c Cell containing the delaunay triangulation with ghosts.
+ * @return 1 if the tessellation was updated, 0 if it could not be repaired
+ * (or was compacted) and has to be rebuilt.
+ */
+static inline int cell_move_vertices(struct cell *c) {
+#if defined(DIMENSIONALITY_3D)
+  if (c->d.compact) {
+    return 0;
+  }
+  for (int i = 0; i < c->count; i++) {
+    delaunay_move_vertex(&c->d, i, c->vertices[3 * i], c->vertices[3 * i + 1],
+                         c->vertices[3 * i + 2]);
+  }
+  const struct cell *ngbs[26];
+  double shifts[3 * 26];
+  const int nngb = cell_get_periodic_ngbs(c, ngbs, shifts);
+  cell_move_ghosts(c, ngbs, shifts);
+  if (!delaunay_repair(&c->d)) {
+    return 0;
+  }
+  cell_add_ghosts(c, ngbs, shifts, nngb);
+  cell_check_ghosts(c);
+  return 1;
+#else
+  return 0;
+#endif
 }
 
 /*! @brief Relax this cells vertices by moving them to the centroids of their
  * corresponding voronoi faces (Lloyds relaxation).
  *
- * After moving the vertices, the hilbert keys and sort lists are updated and
- * the tessellations are rebuild.
+ * Lloyd's relaxation only moves the vertices by a small amount, so that the
+ * existing delaunay tessellation can usually be updated in place (see
+ * cell_move_vertices()). Only if this fails, the hilbert keys and sort lists
+ * are updated and the tessellations are rebuilt (reusing their memory).
  *
  * @param c The cell containing the voronoi tessellation
  */
@@ -426,31 +1324,31 @@ static inline void cell_lloyd_relax_vertices(struct cell *c) {
     abort();
   }
 
+  /* voronoi cell i belongs to local vertex i */
   for (int i = 0; i < c->count; ++i) {
-    int j = c->r_sort_lists[4][i];
 #if defined(DIMENSIONALITY_2D)
-    c->vertices[3 * j] = c->v.cells[i].centroid[0];
-    c->vertices[3 * j + 1] = c->v.cells[i].centroid[1];
+    c->vertices[3 * i] = c->v.cells[i].centroid[0];
+    c->vertices[3 * i + 1] = c->v.cells[i].centroid[1];
 #else
-    c->vertices[3 * j] = c->v.cells[i].centroid[0];
-    c->vertices[3 * j + 1] = c->v.cells[i].centroid[1];
-    c->vertices[3 * j + 2] = c->v.cells[i].centroid[2];
+    c->vertices[3 * i] = c->v.cells[i].centroid[0];
+    c->vertices[3 * i + 1] = c->v.cells[i].centroid[1];
+    c->vertices[3 * i + 2] = c->v.cells[i].centroid[2];
 #endif
   }
-  /* Destroy existing tesselations */
-  delaunay_destroy(&c->d);
-  voronoi_destroy(&c->v);
-  /* Update sorts */
-  cell_update_hilbert_keys(c);
-  cell_update_sorts(c);
-  /* Rebuild tesselations */
-  delaunay_init(&c->d, &c->hs, c->count, 10 * c->count);
-  cell_construct_local_delaunay(c);
-  cell_make_delaunay_periodic(c);
+
+  if (!cell_move_vertices(c)) {
+    /* Reset existing tesselation (this keeps its memory) and rebuild */
+    cell_reset_delaunay(c);
+    cell_construct_local_delaunay(c);
+    cell_make_delaunay_periodic(c);
+  }
   cell_construct_voronoi(c);
 }
 
 /*! @brief Print this cells voronoi and delaunay tessellations
+ *
+ * The tessellations are written in the binary output format (see
+ * voronoi_print_grid_binary() and delaunay_print_tessellation_binary()).
  *
  * @param c The cell containing the tessellations
  * @param vor_file_name Filename to write the voronoi tessellation to
@@ -464,8 +1362,124 @@ static inline void cell_print_tesselations(const struct cell *c,
     abort();
   }
 
-  voronoi_print_grid(&c->v, vor_file_name);
-  delaunay_print_tessellation(&c->d, del_file_name);
+  voronoi_print_grid_binary(&c->v, vor_file_name);
+  delaunay_print_tessellation_binary(&c->d, del_file_name);
+}
+
+/*! @brief Print the current positions of this cells vertices to a generator
+ * file, from which the cell can be restarted (see cell_init_from_file()).
+ *
+ * @param c The cell containing the vertices
+ * @param file_name Filename to write the vertices to
+ */
+static inline void cell_print_generators(const struct cell *c,
+                                         const char *file_name) {
+#if defined(DIMENSIONALITY_2D)
+  const uint32_t dimension = 2;
+#else
+  const uint32_t dimension = 3;
+#endif
+  binary_output_print_generators(file_name, c->vertices, c->count, dimension,
+                                 c->hs.anchor, c->hs.side);
+}
+
+/*! @brief Get the memory used by this cell.
+ *
+ * Since the arrays of a cell never shrink, this is also the high-water mark of
+ * its memory use.
+ *
+ * @param c The cell
+ * @return Size in bytes (excluding vertices that are mapped from a file)
+ */
+static inline size_t cell_get_memory_size(const struct cell *c) {
+  size_t size = (size_t)c->count * (sizeof(unsigned long) + sizeof(int)) +
+                (size_t)c->ghost_size * 2 * sizeof(int) +
+                delaunay_get_memory_size(&c->d);
+#if defined(DIMENSIONALITY_2D)
+  size += (size_t)c->count * 4 * sizeof(int);
+#endif
+  if (c->vertex_file.data == NULL) {
+    size += (size_t)c->count * 3 * sizeof(double);
+  }
+  if (c->voronoi_active) {
+    size += voronoi_get_memory_size(&c->v);
+  }
+  if (c->voronoi_previous_active) {
+    size += voronoi_get_memory_size(&c->v_previous);
+  }
+  return size;
+}
+
+/*! @brief Write the instrumentation results of this cell as a JSON object to
+ * the given file.
+ *
+ * The object always contains the number of local and ghost vertices and (in
+ * 3D) the number of exact geometric tests that were decided by the floating
+ * point filter or needed the exact fallback. If INSTRUMENTATION_ACTIVE is
+ * defined, it also contains the event counters of the delaunay tessellation,
+ * the high-water marks of its queues (3D only) and the time spent in every
+ * construction phase (see instrumentation.h).
+ *
+ * @param c The cell
+ * @param file File to write to
+ */
+static inline void cell_write_instrumentation(const struct cell *c,
+                                              FILE *file) {
+  fprintf(file, "{\"count\": %i, \"ghost_count\": %i", c->count,
+          c->ghost_count);
+#if defined(DIMENSIONALITY_3D)
+  const struct geometry3d *g = &c->d.geometry;
+  fprintf(file,
+          ", \"predicates\": {\"orient_filtered\": %li, "
+          "\"orient_exact\": %li, \"in_sphere_filtered\": %li, "
+          "\"in_sphere_exact\": %li}",
+          g->orient_filter_hits, g->orient_filter_misses,
+          g->in_sphere_filter_hits, g->in_sphere_filter_misses);
+#endif
+#ifdef INSTRUMENTATION_ACTIVE
+  fprintf(file, ", \"counters\": {");
+  for (int i = 0; i < INSTRUMENTATION_COUNTER_COUNT; i++) {
+    fprintf(file, "%s\"%s\": %lli", i ? ", " : "",
+            instrumentation_get_counter_name(i), c->d.counters.values[i]);
+  }
+  fprintf(file, "}");
+#if defined(DIMENSIONALITY_3D)
+  fprintf(file,
+          ", \"queue_high_water\": {\"tetrahedra_containing_vertex\": %i, "
+          "\"tetrahedra_to_check\": %i, \"free_tetrahedron_indices\": %i, "
+          "\"freed_tetrahedra\": %i, \"get_radius_neighbour_info_queue\": %i}",
+          c->d.tetrahedra_containing_vertex.high_water,
+          c->d.tetrahedra_to_check.high_water,
+          c->d.free_tetrahedron_indices.high_water,
+          c->d.freed_tetrahedra.high_water,
+          c->d.get_radius_neighbour_info_queue.high_water);
+#endif
+  fprintf(file, ", \"timers\": {");
+  for (int i = 0; i < INSTRUMENTATION_TIMER_COUNT; i++) {
+    fprintf(file, "%s\"%s\": %g", i ? ", " : "",
+            instrumentation_get_timer_name(i), c->timers.values[i]);
+  }
+  fprintf(file, "}");
+#endif
+  fprintf(file, "}");
+}
+
+/*! @brief Write the instrumentation results of this cell to a JSON file (see
+ * cell_write_instrumentation()).
+ *
+ * @param c The cell
+ * @param file_name Name of the JSON file
+ */
+static inline void cell_print_instrumentation(const struct cell *c,
+                                              const char *file_name) {
+  FILE *file = fopen(file_name, "w");
+  if (file == NULL) {
+    fprintf(stderr, "Unable to open file \"%s\" for writing!\n", file_name);
+    abort();
+  }
+  cell_write_instrumentation(c, file);
+  fprintf(file, "\n");
+  fclose(file);
 }
 
 #endif  // CVORONOI_CELL_H
@@ -0,0 +1,143 @@
+/**
+ * @file cvoronoi.c
+ *
+ * @brief Dimension independent front-end of the cvoronoi library (see
+ * cvoronoi.h).
+ *
+ * This file does not include any of the dimension specific headers, and only
+ * dispatches to the cvoronoi2d_grid_* and cvoronoi3d_grid_* functions.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cvoronoi.h"
+
+/**
+ * @brief Voronoi grid of either dimensionality.
+ *
+ * Only one of the two grid pointers is used.
+ */
+struct cvoronoi_grid {
+  /*! @brief Number of dimensions (2 or 3). */
+  int dimension;
+
+  /*! @brief 2D grid (NULL in 3D). */
+  struct cvoronoi2d_grid *grid2d;
+
+  /*! @brief 3D grid (NULL in 2D). */
+  struct cvoronoi3d_grid *grid3d;
+};
+
+/**
+ * @brief Construct the Voronoi grid of the given vertices in a periodic box.
+ */
+struct cvoronoi_grid *cvoronoi_grid_create(int dimension,
+                                           const double *vertices, int count,
+                                           const double *anchor,
+                                           const double *side) {
+  if (dimension != 2 && dimension != 3) {
+    fprintf(stderr, "Unsupported dimensionality: %i!\n", dimension);
+    abort();
+  }
+  struct cvoronoi_grid *g =
+      (struct cvoronoi_grid *)malloc(sizeof(struct cvoronoi_grid));
+  g->dimension = dimension;
+  g->grid2d = NULL;
+  g->grid3d = NULL;
+  if (dimension == 2) {
+    g->grid2d = cvoronoi2d_grid_create(vertices, count, anchor, side);
+  } else {
+    g->grid3d = cvoronoi3d_grid_create(vertices, count, anchor, side);
+  }
+  return g;
+}
+
+/**
+ * @brief Free up all memory associated with the grid.
+ */
+void cvoronoi_grid_destroy(struct cvoronoi_grid *g) {
+  if (g->dimension == 2) {
+    cvoronoi2d_grid_destroy(g->grid2d);
+  } else {
+    cvoronoi3d_grid_destroy(g->grid3d);
+  }
+  free(g);
+}
+
+/**
+ * @brief Get the number of dimensions of the grid.
+ */
+int cvoronoi_grid_get_dimension(const struct cvoronoi_grid *g) {
+  return g->dimension;
+}
+
+/**
+ * @brief Get the number of cells of the grid.
+ */
+int cvoronoi_grid_get_cell_count(const struct cvoronoi_grid *g) {
+  return g->dimension == 2 ? cvoronoi2d_grid_get_cell_count(g->grid2d)
+                           : cvoronoi3d_grid_get_cell_count(g->grid3d);
+}
+
+/**
+ * @brief Get the number of faces of the grid.
+ */
+int cvoronoi_grid_get_face_count(const struct cvoronoi_grid *g) {
+  return g->dimension == 2 ? cvoronoi2d_grid_get_face_count(g->grid2d)
+                           : cvoronoi3d_grid_get_face_count(g->grid3d);
+}
+
+/**
+ * @brief Get the volumes and centroids of all cells.
+ */
+void cvoronoi_grid_get_cells(const struct cvoronoi_grid *g, double *volumes,
+                             double *centroids) {
+  if (g->dimension == 2) {
+    cvoronoi2d_grid_get_cells(g->grid2d, volumes, centroids);
+  } else {
+    cvoronoi3d_grid_get_cells(g->grid3d, volumes, centroids);
+  }
+}
+
+/**
+ * @brief Get the generators, areas and midpoints of all faces.
+ */
+void cvoronoi_grid_get_faces(const struct cvoronoi_grid *g, int *left,
+                             int *right, double *areas, double *midpoints) {
+  if (g->dimension == 2) {
+    cvoronoi2d_grid_get_faces(g->grid2d, left, right, areas, midpoints);
+  } else {
+    cvoronoi3d_grid_get_faces(g->grid3d, left, right, areas, midpoints);
+  }
+}
+
+/**
+ * @brief Get the unit normals of all faces.
+ */
+void cvoronoi_grid_get_face_normals(const struct cvoronoi_grid *g,
+                                    double *normals) {
+  if (g->dimension == 2) {
+    cvoronoi2d_grid_get_face_normals(g->grid2d, normals);
+  } else {
+    cvoronoi3d_grid_get_face_normals(g->grid3d, normals);
+  }
+}
+
+/**
+ * @brief Get the faces of every cell.
+ */
+int cvoronoi_grid_get_cell_faces(const struct cvoronoi_grid *g, int *offsets,
+                                 int *faces) {
+  return g->dimension == 2
+             ? cvoronoi2d_grid_get_cell_faces(g->grid2d, offsets, faces)
+             : cvoronoi3d_grid_get_cell_faces(g->grid3d, offsets, faces);
+}
+
+/**
+ * @brief Get the version of the library.
+ */
+void cvoronoi_get_version(int *major, int *minor) {
+  *major = CVORONOI_VERSION_MAJOR;
+  *minor = CVORONOI_VERSION_MINOR;
+}
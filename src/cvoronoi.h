@@ -0,0 +1,217 @@
+/**
+ * @file cvoronoi.h
+ *
+ * @brief Public API of the cvoronoi library: dimension independent
+ * construction of periodic Voronoi grids.
+ *
+ * The Delaunay and Voronoi implementations are selected at compile time (see
+ * dimensionality.h), so that a single translation unit can only contain either
+ * the 2D or the 3D version. cvoronoi_grid.c is therefore compiled once for
+ * every dimensionality, and wraps the construction of a grid into functions
+ * with a dimension specific prefix (cvoronoi2d_ and cvoronoi3d_, see
+ * CVORONOI_DECLARE_GRID_API()). Both versions can be linked into the same
+ * program (see the cvoronoi library in CMakeLists.txt).
+ *
+ * The cvoronoi_grid_* functions (implemented in cvoronoi.c) select the right
+ * version based on the dimensionality of the grid. The dimensionality is only
+ * checked once per call, so that the construction itself is fully specialised
+ * at compile time.
+ *
+ * This is the only header a program that links against the library needs. It
+ * does not depend on any of the other headers, and can be included together
+ * with the 2D or 3D headers. The library only exports the functions declared
+ * in this header (see CVORONOI_API). Functions are only added to it in new
+ * minor versions, and changed or removed in new major versions.
+ *
+ * All positions are stored with 3 coordinates, also in 2D (the third
+ * coordinate is ignored for input and 0 for output).
+ */
+
+#ifndef CVORONOI_CVORONOI_H
+#define CVORONOI_CVORONOI_H
+
+/*! @brief Major version of the API. */
+#define CVORONOI_VERSION_MAJOR 1
+
+/*! @brief Minor version of the API. */
+#define CVORONOI_VERSION_MINOR 1
+
+/*! @brief Mark a function as part of the public API, so that it is exported
+ *  from the library (which is built with hidden symbol visibility). */
+#if defined(__GNUC__)
+#define CVORONOI_API __attribute__((visibility("default")))
+#else
+#define CVORONOI_API
+#endif
+
+/**
+ * @brief Declare the functions of the dimension specific grid API with the
+ * given prefix.
+ *
+ *  - prefix_grid_create(): construct the Voronoi grid of the given vertices in
+ *    the periodic box [anchor, anchor + side[.
+ *  - prefix_grid_destroy(): free all memory used by the grid.
+ *  - prefix_grid_get_cell_count() and prefix_grid_get_face_count(): number of
+ *    cells (equal to the number of vertices) and faces.
+ *  - prefix_grid_get_cells(): copy the volume and centroid (3 coordinates) of
+ *    every cell into the given arrays (either can be NULL).
+ *  - prefix_grid_get_faces(): copy the generator indices on both sides, the
+ *    area and the midpoint (3 coordinates) of every face into the given arrays
+ *    (all can be NULL). Every face is only stored once. Faces on the boundary
+ *    of the box connect a generator with a periodic copy of another generator;
+ *    for these faces the right index is the index of the original generator in
+ *    3D and -1 in 2D.
+ *  - prefix_grid_get_face_normals(): copy the unit normal (3 coordinates) of
+ *    every face, pointing from the left to the right generator.
+ *  - prefix_grid_get_cell_faces(): copy the index of the faces of every cell
+ *    (see cvoronoi_grid_get_cell_faces()).
+ *
+ * @param prefix Prefix (cvoronoi2d or cvoronoi3d).
+ */
+#define CVORONOI_DECLARE_GRID_API(prefix)                                    \
+  struct prefix##_grid;                                                      \
+  CVORONOI_API struct prefix##_grid *prefix##_grid_create(                   \
+      const double *vertices, int count, const double *anchor,               \
+      const double *side);                                                   \
+  CVORONOI_API void prefix##_grid_destroy(struct prefix##_grid *g);          \
+  CVORONOI_API int prefix##_grid_get_cell_count(                             \
+      const struct prefix##_grid *g);                                        \
+  CVORONOI_API int prefix##_grid_get_face_count(                             \
+      const struct prefix##_grid *g);                                        \
+  CVORONOI_API void prefix##_grid_get_cells(                                 \
+      const struct prefix##_grid *g, double *volumes, double *centroids);    \
+  CVORONOI_API void prefix##_grid_get_faces(                                 \
+      const struct prefix##_grid *g, int *left, int *right, double *areas,   \
+      double *midpoints);                                                    \
+  CVORONOI_API void prefix##_grid_get_face_normals(                          \
+      const struct prefix##_grid *g, double *normals);                       \
+  CVORONOI_API int prefix##_grid_get_cell_faces(                             \
+      const struct prefix##_grid *g, int *offsets, int *faces);
+
+CVORONOI_DECLARE_GRID_API(cvoronoi2d)
+CVORONOI_DECLARE_GRID_API(cvoronoi3d)
+
+/**
+ * @brief Voronoi grid of either dimensionality.
+ *
+ * The layout of the grid is private to the library (see cvoronoi.c).
+ */
+struct cvoronoi_grid;
+
+/**
+ * @brief Construct the Voronoi grid of the given vertices in a periodic box.
+ *
+ * @param dimension Number of dimensions (2 or 3).
+ * @param vertices Coordinates of the vertices (3 per vertex, also in 2D). All
+ * vertices should lie within the box.
+ * @param count Number of vertices.
+ * @param anchor Anchor of the periodic box.
+ * @param side Side lengths of the periodic box.
+ * @return New grid, which should be freed with cvoronoi_grid_destroy().
+ */
+CVORONOI_API struct cvoronoi_grid *cvoronoi_grid_create(
+    int dimension, const double *vertices, int count, const double *anchor,
+    const double *side);
+
+/**
+ * @brief Free up all memory associated with the grid.
+ *
+ * @param g Grid.
+ */
+CVORONOI_API void cvoronoi_grid_destroy(struct cvoronoi_grid *g);
+
+/**
+ * @brief Get the number of dimensions of the grid.
+ *
+ * @param g Grid.
+ * @return Number of dimensions (2 or 3).
+ */
+CVORONOI_API int cvoronoi_grid_get_dimension(const struct cvoronoi_grid *g);
+
+/**
+ * @brief Get the number of cells of the grid.
+ *
+ * @param g Grid.
+ * @return Number of cells.
+ */
+CVORONOI_API int cvoronoi_grid_get_cell_count(const struct cvoronoi_grid *g);
+
+/**
+ * @brief Get the number of faces of the grid.
+ *
+ * @param g Grid.
+ * @return Number of faces.
+ */
+CVORONOI_API int cvoronoi_grid_get_face_count(const struct cvoronoi_grid *g);
+
+/**
+ * @brief Get the volumes and centroids of all cells.
+ *
+ * @param g Grid.
+ * @param volumes (Returned) Volumes (one per cell, can be NULL).
+ * @param centroids (Returned) Centroids (3 per cell, can be NULL).
+ */
+CVORONOI_API void cvoronoi_grid_get_cells(const struct cvoronoi_grid *g,
+                                          double *volumes, double *centroids);
+
+/**
+ * @brief Get the generators, areas and midpoints of all faces.
+ *
+ * @param g Grid.
+ * @param left (Returned) Index of the generator on the left of every face
+ * (can be NULL).
+ * @param right (Returned) Index of the generator on the right of every face
+ * (see CVORONOI_DECLARE_GRID_API() for boundary faces, can be NULL).
+ * @param areas (Returned) Areas (one per face, can be NULL).
+ * @param midpoints (Returned) Midpoints (3 per face, can be NULL).
+ */
+CVORONOI_API void cvoronoi_grid_get_faces(const struct cvoronoi_grid *g,
+                                          int *left, int *right,
+                                          double *areas, double *midpoints);
+
+/**
+ * @brief Get the unit normals of all faces.
+ *
+ * The normals point from the generator on the left to the generator on the
+ * right of the face (see cvoronoi_grid_get_faces()).
+ *
+ * @param g Grid.
+ * @param normals (Returned) Normals (3 per face).
+ * @since 1.1
+ */
+CVORONOI_API void cvoronoi_grid_get_face_normals(const struct cvoronoi_grid *g,
+                                                 double *normals);
+
+/**
+ * @brief Get the faces of every cell.
+ *
+ * The faces of cell i are faces[offsets[i]] to faces[offsets[i + 1] - 1], in
+ * increasing order. Faces between two generators are part of both cells,
+ * faces on the boundary of the box only of their left cell. The number of
+ * faces that is returned is offsets[cell count], so that the function can
+ * first be called without faces to get the size of that array.
+ *
+ * @param g Grid.
+ * @param offsets (Returned) Offsets of the faces of every cell (cell count + 1
+ * values, can be NULL).
+ * @param faces (Returned) Indices of the faces of every cell (see
+ * cvoronoi_grid_get_faces(), can be NULL).
+ * @return Total number of faces of all cells.
+ * @since 1.1
+ */
+CVORONOI_API int cvoronoi_grid_get_cell_faces(const struct cvoronoi_grid *g,
+                                              int *offsets, int *faces);
+
+/**
+ * @brief Get the version of the library.
+ *
+ * This can differ from CVORONOI_VERSION_MAJOR and CVORONOI_VERSION_MINOR if
+ * the program is linked against a different (shared) library than the one it
+ * was compiled with.
+ *
+ * @param major (Returned) Major version.
+ * @param minor (Returned) Minor version.
+ */
+CVORONOI_API void cvoronoi_get_version(int *major, int *minor);
+
+#endif  // CVORONOI_CVORONOI_H
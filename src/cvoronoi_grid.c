@@ -0,0 +1,176 @@
+/**
+ * @file cvoronoi_grid.c
+ *
+ * @brief Dimension specific implementation of the grid API in cvoronoi.h.
+ *
+ * This file is compiled once for every dimensionality (with either
+ * DIMENSIONALITY_2D or DIMENSIONALITY_3D defined), and defines the
+ * cvoronoi2d_grid_* or cvoronoi3d_grid_* functions accordingly. All other
+ * functions are static, so that both versions can be linked together.
+ */
+
+#include <stdlib.h>
+
+#include "cell.h"
+#include "cvoronoi.h"
+
+#if defined(DIMENSIONALITY_2D)
+/*! @brief Dimension specific grid type. */
+#define CVORONOI_GRID_TYPE cvoronoi2d_grid
+/*! @brief Add the dimension specific prefix to the given function name. */
+#define CVORONOI_GRID_FUNCTION(name) cvoronoi2d_grid_##name
+/*! @brief Number of dimensions. */
+#define CVORONOI_GRID_DIMENSION 2
+#else
+#define CVORONOI_GRID_TYPE cvoronoi3d_grid
+#define CVORONOI_GRID_FUNCTION(name) cvoronoi3d_grid_##name
+#define CVORONOI_GRID_DIMENSION 3
+#endif
+
+#ifndef VORONOI_STORE_FACE_TABLE
+#error "The grid API needs the face table (see VORONOI_STORE_FACE_TABLE)!"
+#endif
+
+/**
+ * @brief Periodic grid: a single cell, whose ghosts are periodic copies of its
+ * own vertices.
+ */
+struct CVORONOI_GRID_TYPE {
+  /*! @brief Cell containing the vertices and tessellations. */
+  struct cell c;
+};
+
+/**
+ * @brief Construct the Voronoi grid of the given vertices in the periodic box
+ * [anchor, anchor + side[ (see CVORONOI_DECLARE_GRID_API()).
+ */
+struct CVORONOI_GRID_TYPE *CVORONOI_GRID_FUNCTION(create)(
+    const double *vertices, int count, const double *anchor,
+    const double *side) {
+  struct CVORONOI_GRID_TYPE *g =
+      (struct CVORONOI_GRID_TYPE *)malloc(sizeof(struct CVORONOI_GRID_TYPE));
+  cell_init_from_vertices(&g->c, vertices, count, anchor, side);
+  cell_construct_local_delaunay(&g->c);
+  cell_make_delaunay_periodic(&g->c);
+  cell_construct_voronoi(&g->c);
+  return g;
+}
+
+/**
+ * @brief Free up all memory associated with the grid.
+ */
+void CVORONOI_GRID_FUNCTION(destroy)(struct CVORONOI_GRID_TYPE *g) {
+  cell_destroy(&g->c);
+  free(g);
+}
+
+/**
+ * @brief Get the number of cells of the grid.
+ */
+int CVORONOI_GRID_FUNCTION(get_cell_count)(const struct CVORONOI_GRID_TYPE *g) {
+  return g->c.v.number_of_cells;
+}
+
+/**
+ * @brief Get the number of faces of the grid.
+ */
+int CVORONOI_GRID_FUNCTION(get_face_count)(const struct CVORONOI_GRID_TYPE *g) {
+  return g->c.v.pair_index[0] + g->c.v.pair_index[1];
+}
+
+/**
+ * @brief Get the volumes and centroids (3 per cell) of all cells.
+ */
+void CVORONOI_GRID_FUNCTION(get_cells)(const struct CVORONOI_GRID_TYPE *g,
+                                       double *volumes, double *centroids) {
+  const struct voronoi *v = &g->c.v;
+  for (int i = 0; i < v->number_of_cells; i++) {
+    if (volumes != NULL) {
+      volumes[i] = v->cells[i].volume;
+    }
+    if (centroids != NULL) {
+      for (int j = 0; j < 3; j++) {
+        centroids[3 * i + j] =
+            j < CVORONOI_GRID_DIMENSION ? v->cells[i].centroid[j] : 0.;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Get the generators on both sides, the areas and the midpoints (3 per
+ * face) of all faces.
+ *
+ * The faces between local generators come first, followed by the faces on the
+ * boundary of the box.
+ */
+void CVORONOI_GRID_FUNCTION(get_faces)(const struct CVORONOI_GRID_TYPE *g,
+                                       int *left, int *right, double *areas,
+                                       double *midpoints) {
+  const struct cell *c = &g->c;
+  int f = 0;
+  for (int sid = 0; sid < 2; sid++) {
+    for (int i = 0; i < c->v.pair_index[sid]; i++, f++) {
+      const struct voronoi_pair *pair = &c->v.pairs[sid][i];
+      if (left != NULL) {
+        left[f] = pair->left;
+      }
+      if (right != NULL) {
+        right[f] = pair->right;
+        if (sid == 1) {
+#if defined(DIMENSIONALITY_3D)
+          /* replace the ghost by the vertex it is a periodic copy of */
+          right[f] = c->ghost_vertices[pair->right - c->d.ghost_offset];
+#else
+          /* the periodic ghosts in 2D do not store their origin */
+          right[f] = -1;
+#endif
+        }
+      }
+      if (areas != NULL) {
+        areas[f] = pair->surface_area;
+      }
+      if (midpoints != NULL) {
+        for (int j = 0; j < 3; j++) {
+          midpoints[3 * f + j] =
+              j < CVORONOI_GRID_DIMENSION ? pair->midpoint[j] : 0.;
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief Get the unit normals (3 per face) of all faces.
+ *
+ * The faces are in the same order as for get_faces(), which is also the order
+ * of the face table of the grid.
+ */
+void CVORONOI_GRID_FUNCTION(get_face_normals)(
+    const struct CVORONOI_GRID_TYPE *g, double *normals) {
+  const struct voronoi_face_table *t = &g->c.v.faces;
+  for (int i = 0; i < 3 * t->count; i++) {
+    normals[i] = t->normal[i];
+  }
+}
+
+/**
+ * @brief Get the offsets and indices of the faces of every cell, and return
+ * the total number of faces of all cells.
+ */
+int CVORONOI_GRID_FUNCTION(get_cell_faces)(const struct CVORONOI_GRID_TYPE *g,
+                                           int *offsets, int *faces) {
+  const struct voronoi_face_table *t = &g->c.v.faces;
+  const int total = t->cell_offsets[t->number_of_cells];
+  if (offsets != NULL) {
+    for (int i = 0; i <= t->number_of_cells; i++) {
+      offsets[i] = t->cell_offsets[i];
+    }
+  }
+  if (faces != NULL) {
+    for (int i = 0; i < total; i++) {
+      faces[i] = t->cell_faces[i];
+    }
+  }
+  return total;
+}
@@ -17,10 +17,18 @@
 #include "dimensionality.h"
 #include "geometry.h"
 
+/*! @brief Disable all runtime assertions and consistency checks
+ *  (DELAUNAY_DO_ASSERTIONS and DELAUNAY_CHECKS below, the corresponding
+ *  VORONOI_* flags in voronoi.h and QUEUE_SAFETY_CHECKS in queues.h). This is
+ *  meant to be set on the command line (-DCVORONOI_NO_CHECKS), e.g. for
+ *  benchmarks and production runs. */
+//#define CVORONOI_NO_CHECKS
 /*! @brief Activate extensive log output. */
 //#define DELAUNAY_LOG_OUTPUT
+#ifndef CVORONOI_NO_CHECKS
 /*! @brief Activate runtime assertions. */
 #define DELAUNAY_DO_ASSERTIONS
+#endif
 /*! @brief Use and output non-exact floating point geometrical tests as well as
  *  the default exact integer tests. This is especially helpful when trying to
  *  visualise the geometry3d, since the integer coordinates are very hard to
@@ -30,7 +38,33 @@
  *  of a new vertex. This feature is very helpful when debugging to catch
  *  problems as they happen, but adds a very significant runtime cost. It should
  *  never be activated for production runs! */
+#ifndef CVORONOI_NO_CHECKS
 #define DELAUNAY_CHECKS
+#endif
+/*! @brief Store the tetrahedra in a compact structure-of-arrays layout instead
+ *  of an array of structs (3D only, see tetrahedron.h). */
+//#define TETRAHEDRON_SOA
+/*! @brief Cache the circumcenters and circumradii of the tetrahedra, so that
+ *  they are computed only once for the search radius computation and the
+ *  construction of the Voronoi grid (3D only). */
+#define DELAUNAY_CACHE_CIRCUMCENTERS
+/*! @brief Back the tetrahedron arrays and the circumcenter cache with
+ *  transparent huge pages, if the system supports this (3D only, see
+ *  tetrahedron.h). */
+//#define TETRAHEDRON_HUGE_PAGES
+/*! @brief Do not store the integer coordinates of the vertices, but recover
+ *  them from the 52-bit mantissas of the rescaled coordinates when an exact
+ *  test is needed, and start from a cube of 5 tetrahedra instead of a single
+ *  large tetrahedron, which gives the vertices more bits of precision (3D
+ *  only). This saves 24 of the 72 bytes of coordinates per vertex, which is
+ *  small compared to the memory used by the tetrahedra. This requires
+ *  DELAUNAY_NONEXACT. */
+//#define DELAUNAY_IMPLICIT_INTEGER_COORDINATES
+
+#if defined(DELAUNAY_IMPLICIT_INTEGER_COORDINATES) && \
+    !defined(DELAUNAY_NONEXACT)
+#error "DELAUNAY_IMPLICIT_INTEGER_COORDINATES requires DELAUNAY_NONEXACT!"
+#endif
 
 /**
  * @brief Print the given message to the standard output.
@@ -31,10 +31,22 @@
 #include <float.h>
 #include <math.h>
 
+#include "allocator.h"
+#include "binary_output.h"
 #include "geometry.h"
 #include "hydro_space.h"
+#include "instrumentation.h"
 #include "triangle.h"
 
+/*! @brief Average number of triangles per vertex of a 2D Delaunay
+ *  tessellation (the exact value for a periodic tessellation). */
+#define DELAUNAY_TRIANGLES_PER_VERTEX 2.
+
+/*! @brief Thickness of the layer of ghost vertices that is needed around a
+ *  cell to complete the tessellation of its local vertices, in units of the
+ *  mean interparticle distance. */
+#define DELAUNAY_GHOST_LAYER_THICKNESS 2.5
+
 /**
  * @brief Delaunay tessellation.
  *
@@ -149,6 +161,12 @@ struct delaunay {
    *  geometry2d tests that need to be stored in between tests, since allocating
    *  and deallocating them for every test is too expensive. */
   struct geometry2d geometry;
+
+#ifdef INSTRUMENTATION_ACTIVE
+  /*! @brief Event counters (see instrumentation.h). These are accumulated
+   *  over all constructions, also if the tessellation is reset. */
+  struct instrumentation_counters counters;
+#endif
 };
 
 inline static void delaunay_init_vertex(struct delaunay* restrict d,
@@ -191,6 +209,127 @@ inline static void delaunay_init_vertex(struct delaunay* restrict d,
   delaunay_log("Initialized new vertex with index %i", v);
 }
 
+/**
+ * @brief Estimate the number of ghost vertices needed to complete the
+ * tessellation of the given number of local vertices, assuming that these are
+ * distributed roughly uniformly within a square cell.
+ *
+ * @param count Number of local vertices.
+ * @return Estimated number of ghost vertices.
+ */
+inline static int delaunay_estimate_ghost_count(int count) {
+  const double n = sqrt((double)count);
+  const double m = n + 2. * DELAUNAY_GHOST_LAYER_THICKNESS;
+  return (int)ceil(m * m) - count;
+}
+
+/**
+ * @brief Estimate the final sizes of the vertex and triangle arrays of a
+ * tessellation with the given number of local and ghost vertices.
+ *
+ * These sizes can be reserved up front (see delaunay_reserve()), so that
+ * constructing the tessellation does not have to grow (and copy) the arrays.
+ *
+ * @param count Number of local vertices.
+ * @param ghost_count Number of ghost vertices (e.g. the result of
+ * delaunay_estimate_ghost_count()).
+ * @param vertex_size Estimated size of the vertex arrays (including the 3
+ * dummy vertices).
+ * @param triangle_size Estimated size of the triangle array (including the 3
+ * dummy triangles).
+ */
+inline static void delaunay_estimate_size(int count, int ghost_count,
+                                          int* vertex_size,
+                                          int* triangle_size) {
+  *vertex_size = count + ghost_count + 3;
+  *triangle_size =
+      3 + (int)ceil(DELAUNAY_TRIANGLES_PER_VERTEX * (*vertex_size));
+}
+
+/**
+ * @brief Get the new size of an array that is full.
+ *
+ * The arrays are usually created with an estimate of their final size, so that
+ * they only need to grow if that estimate was slightly too small. We therefore
+ * grow them by 50% instead of doubling their size.
+ *
+ * @param size Current size.
+ * @return New size.
+ */
+inline static int delaunay_grow_size(int size) {
+  return size + (size >> 1) + 1;
+}
+
+/**
+ * @brief Resize the vertex arrays.
+ *
+ * @param d Delaunay tessellation.
+ * @param vertex_size New size of the vertex arrays.
+ */
+inline static void delaunay_resize_vertex_arrays(struct delaunay* restrict d,
+                                                 int vertex_size) {
+  d->vertex_size = vertex_size;
+  d->vertices = (double*)CVORONOI_REALLOC(d->vertices,
+                                          d->vertex_size * 2 * sizeof(double));
+#ifdef DELAUNAY_NONEXACT
+  d->rescaled_vertices = (double*)CVORONOI_REALLOC(
+      d->rescaled_vertices, d->vertex_size * 2 * sizeof(double));
+#endif
+  d->integer_vertices = (unsigned long int*)CVORONOI_REALLOC(
+      d->integer_vertices, d->vertex_size * 2 * sizeof(unsigned long int));
+  d->vertex_triangles =
+      (int*)CVORONOI_REALLOC(d->vertex_triangles, d->vertex_size * sizeof(int));
+  d->vertex_triangle_index =
+      (int*)CVORONOI_REALLOC(d->vertex_triangle_index,
+                             d->vertex_size * sizeof(int));
+  d->search_radii = (double*)CVORONOI_REALLOC(d->search_radii,
+                                              d->vertex_size * sizeof(double));
+}
+
+/**
+ * @brief Make sure the tessellation can hold at least the given number of
+ * vertices and triangles without growing its arrays.
+ *
+ * @param d Delaunay tessellation.
+ * @param vertex_size Number of vertices (see delaunay_estimate_size()).
+ * @param triangle_size Number of triangles.
+ */
+inline static void delaunay_reserve(struct delaunay* restrict d,
+                                    int vertex_size, int triangle_size) {
+  if (vertex_size > d->vertex_size) {
+    delaunay_resize_vertex_arrays(d, vertex_size);
+  }
+  if (triangle_size > d->triangle_size) {
+    d->triangle_size = triangle_size;
+    d->triangles = (struct triangle*)CVORONOI_REALLOC(
+        d->triangles, d->triangle_size * sizeof(struct triangle));
+  }
+}
+
+/**
+ * @brief Place the memory of the vertex and triangle arrays on the memory
+ * domain of the calling thread (see allocator_first_touch()).
+ *
+ * This should be called by the thread that will construct the tessellation,
+ * after the arrays were reserved (see delaunay_reserve()).
+ *
+ * @param d Delaunay tessellation.
+ */
+inline static void delaunay_first_touch(struct delaunay* restrict d) {
+  const size_t n = (size_t)d->vertex_size;
+  allocator_first_touch(d->vertices, n * 2 * sizeof(double));
+#ifdef DELAUNAY_NONEXACT
+  allocator_first_touch(d->rescaled_vertices, n * 2 * sizeof(double));
+#endif
+  allocator_first_touch(d->integer_vertices,
+                        n * 2 * sizeof(unsigned long int));
+  allocator_first_touch(d->vertex_triangles, n * sizeof(int));
+  allocator_first_touch(d->vertex_triangle_index, n * sizeof(int));
+  allocator_first_touch(d->search_radii, n * sizeof(double));
+  allocator_first_touch(d->triangles,
+                        (size_t)d->triangle_size * sizeof(struct triangle));
+}
+
 /**
  * @brief Add a new vertex with the given coordinates.
  *
@@ -210,22 +349,8 @@ inline static int delaunay_new_vertex(struct delaunay* restrict d, double x,
 
   /* check the size of the vertex arrays against the allocated memory size */
   if (d->vertex_index == d->vertex_size) {
-    /* dynamically grow the size of the arrays with a factor 2 */
-    d->vertex_size <<= 1;
-    d->vertices =
-        (double*)realloc(d->vertices, d->vertex_size * 2 * sizeof(double));
-#ifdef DELAUNAY_NONEXACT
-    d->rescaled_vertices = (double*)realloc(
-        d->rescaled_vertices, d->vertex_size * 2 * sizeof(double));
-#endif
-    d->integer_vertices = (unsigned long int*)realloc(
-        d->integer_vertices, d->vertex_size * 2 * sizeof(unsigned long int));
-    d->vertex_triangles =
-        (int*)realloc(d->vertex_triangles, d->vertex_size * sizeof(int));
-    d->vertex_triangle_index =
-        (int*)realloc(d->vertex_triangle_index, d->vertex_size * sizeof(int));
-    d->search_radii =
-        (double*)realloc(d->search_radii, d->vertex_size * sizeof(double));
+    /* dynamically grow the size of the arrays */
+    delaunay_resize_vertex_arrays(d, delaunay_grow_size(d->vertex_size));
   }
 
   delaunay_init_vertex(d, d->vertex_index, x, y);
@@ -251,10 +376,10 @@ inline static int delaunay_new_triangle(struct delaunay* restrict d) {
 
   /* check that we still have triangles available */
   if (d->triangle_index == d->triangle_size) {
-    /* no: increase the size of the triangle array with a factor 2 and
-       reallocate it in memory */
-    d->triangle_size <<= 1;
-    d->triangles = (struct triangle*)realloc(
+    /* no: increase the size of the triangle array and reallocate it in
+       memory */
+    d->triangle_size = delaunay_grow_size(d->triangle_size);
+    d->triangles = (struct triangle*)CVORONOI_REALLOC(
         d->triangles, d->triangle_size * sizeof(struct triangle));
   }
 
@@ -266,37 +391,25 @@ inline static int delaunay_new_triangle(struct delaunay* restrict d) {
 }
 
 /**
- * @brief Initialize the Delaunay tessellation.
+ * @brief Reset the Delaunay tessellation, so that a new tessellation can be
+ * constructed.
  *
- * This function allocates memory for all arrays that make up the tessellation
- * and initializes the variables used for bookkeeping.
- *
- * It then sets up a large triangle that contains the entire simulation box and
- * additional buffer space to deal with boundary ghost vertices, and 3
- * additional dummy triangles that provide valid neighbours for the 3 sides of
- * this triangle (these dummy triangles themselves have an invalid tip vertex
- * and are therefore simply placeholders).
+ * This removes all vertices and triangles and sets up the large initial
+ * triangle and its 3 dummy neighbours (see delaunay_init()), but keeps all
+ * memory (and the exact geometry variables) of the tessellation.
  *
  * @param d Delaunay tesselation.
  * @param hs Spatial extents of the simulation box.
- * @param vertex_size Initial size of the vertex array.
- * @param triangle_size Initial size of the triangle array.
+ * @param vertex_size Number of local vertices. The vertex arrays are only
+ * resized if they are smaller than this.
  */
-inline static void delaunay_init(struct delaunay* restrict d,
-                                 const struct hydro_space* restrict hs,
-                                 int vertex_size, int triangle_size) {
+inline static void delaunay_reset(struct delaunay* restrict d,
+                                  const struct hydro_space* restrict hs,
+                                  int vertex_size) {
 
-  /* allocate memory for the vertex arrays */
-  d->vertices = (double*)malloc(vertex_size * 2 * sizeof(double));
-#ifdef DELAUNAY_NONEXACT
-  d->rescaled_vertices = (double*)malloc(vertex_size * 2 * sizeof(double));
-#endif
-  d->integer_vertices =
-      (unsigned long int*)malloc(vertex_size * 2 * sizeof(unsigned long int));
-  d->vertex_triangles = (int*)malloc(vertex_size * sizeof(int));
-  d->vertex_triangle_index = (int*)malloc(vertex_size * sizeof(int));
-  d->search_radii = (double*)malloc(vertex_size * sizeof(double));
-  d->vertex_size = vertex_size;
+  if (vertex_size > d->vertex_size) {
+    delaunay_resize_vertex_arrays(d, vertex_size);
+  }
   /* set vertex start and end (indicating where the local vertices start and
    * end)*/
   d->vertex_start = 0;
@@ -306,18 +419,8 @@ inline static void delaunay_init(struct delaunay* restrict d,
    * vertices (see below) */
   d->vertex_index = vertex_size;
 
-  /* allocate memory for the triangle array */
-  d->triangles =
-      (struct triangle*)malloc(triangle_size * sizeof(struct triangle));
   d->triangle_index = 0;
-  d->triangle_size = triangle_size;
-
-  /* allocate memory for the queue (note that the queue size of 10 was chosen
-     arbitrarily, and a proper value should be chosen based on performance
-     measurements) */
-  d->queue = (int*)malloc(10 * sizeof(int));
   d->queue_index = 0;
-  d->queue_size = 10;
 
   /* determine the size of a box large enough to accommodate the entire
      simulation volume and all possible ghost vertices required to deal with
@@ -337,9 +440,6 @@ inline static void delaunay_init(struct delaunay* restrict d,
    * [1,2] (unlike Springel, 2010) */
   d->inverse_side = (1. - 1.e-13) / box_side;
 
-  /* initialise the structure used to perform exact geometrical tests */
-  geometry2d_init(&d->geometry);
-
   /* set up the large triangle and the 3 dummies */
   /* mind the orientation: counterclockwise w.r.t. the z-axis. */
   int v0 = delaunay_new_vertex(d, box_anchor[0], box_anchor[1]);
@@ -388,6 +488,60 @@ inline static void delaunay_init(struct delaunay* restrict d,
 //  delaunay_check_tessellation(d);
 }
 
+/**
+ * @brief Initialize the Delaunay tessellation.
+ *
+ * This function allocates memory for all arrays that make up the tessellation
+ * and initializes the variables used for bookkeeping.
+ *
+ * It then sets up a large triangle that contains the entire simulation box and
+ * additional buffer space to deal with boundary ghost vertices, and 3
+ * additional dummy triangles that provide valid neighbours for the 3 sides of
+ * this triangle (these dummy triangles themselves have an invalid tip vertex
+ * and are therefore simply placeholders). This is done by delaunay_reset(),
+ * which can also be used to rebuild the tessellation without reallocating its
+ * memory.
+ *
+ * @param d Delaunay tesselation.
+ * @param hs Spatial extents of the simulation box.
+ * @param vertex_size Initial size of the vertex array.
+ * @param triangle_size Initial size of the triangle array.
+ */
+inline static void delaunay_init(struct delaunay* restrict d,
+                                 const struct hydro_space* restrict hs,
+                                 int vertex_size, int triangle_size) {
+
+  /* allocate memory for the vertex arrays */
+  d->vertices = (double*)CVORONOI_MALLOC(vertex_size * 2 * sizeof(double));
+#ifdef DELAUNAY_NONEXACT
+  d->rescaled_vertices =
+      (double*)CVORONOI_MALLOC(vertex_size * 2 * sizeof(double));
+#endif
+  d->integer_vertices = (unsigned long int*)CVORONOI_MALLOC(
+      vertex_size * 2 * sizeof(unsigned long int));
+  d->vertex_triangles = (int*)CVORONOI_MALLOC(vertex_size * sizeof(int));
+  d->vertex_triangle_index = (int*)CVORONOI_MALLOC(vertex_size * sizeof(int));
+  d->search_radii = (double*)CVORONOI_MALLOC(vertex_size * sizeof(double));
+  d->vertex_size = vertex_size;
+
+  /* allocate memory for the triangle array */
+  d->triangles = (struct triangle*)CVORONOI_MALLOC(
+      triangle_size * sizeof(struct triangle));
+  d->triangle_size = triangle_size;
+
+  /* allocate memory for the queue (note that the queue size of 10 was chosen
+     arbitrarily, and a proper value should be chosen based on performance
+     measurements) */
+  d->queue = (int*)CVORONOI_MALLOC(10 * sizeof(int));
+  d->queue_size = 10;
+
+  /* initialise the structure used to perform exact geometrical tests */
+  geometry2d_init(&d->geometry);
+  instrumentation_reset(&d->counters);
+
+  delaunay_reset(d, hs, vertex_size);
+}
+
 /**
  * @brief Randomly choose a neighbour from the given two options.
  *
@@ -458,7 +612,7 @@ inline static int delaunay_test_point_inside_triangle(
   int vt2 = d->triangles[t].vertices[2];
   delaunay_log("Triangle vertices: %i %i %i", vt0, vt1, vt2);
 
-#ifdef DELAUNAY_NONEXACT
+#if defined(DELAUNAY_NONEXACT) && defined(DELAUNAY_DO_ASSERTIONS)
   double ax = d->rescaled_vertices[2 * v];
   double ay = d->rescaled_vertices[2 * v + 1];
 
@@ -507,7 +661,7 @@ inline static int delaunay_test_point_inside_triangle(
   int testi2 =
       geometry2d_orient_exact(&d->geometry, bix, biy, cix, ciy, aix, aiy);
 
-#ifdef DELAUNAY_NONEXACT
+#if defined(DELAUNAY_NONEXACT) && defined(DELAUNAY_DO_ASSERTIONS)
   delaunay_assert(test0 * testi0 >= 0);
   delaunay_assert(test1 * testi1 >= 0);
   delaunay_assert(test2 * testi2 >= 0);
@@ -598,7 +752,7 @@ inline static void delaunay_enqueue(struct delaunay* restrict d, int t) {
   if (d->queue_index == d->queue_size) {
     /* there isn't: increase the size of the queue with a factor 2. */
     d->queue_size <<= 1;
-    d->queue = (int*)realloc(d->queue, d->queue_size * sizeof(int));
+    d->queue = (int*)CVORONOI_REALLOC(d->queue, d->queue_size * sizeof(int));
   }
 
   delaunay_log("Enqueuing triangle %i and vertex 2", t);
@@ -680,7 +834,7 @@ inline static void delaunay_check_triangle(struct delaunay* restrict d, int t) {
 
   delaunay_log("Opposite vertex: %i", vt2_0);
 
-#ifdef DELAUNAY_NONEXACT
+#if defined(DELAUNAY_NONEXACT) && defined(DELAUNAY_DO_ASSERTIONS)
   double ax = d->rescaled_vertices[2 * vt1_0];
   double ay = d->rescaled_vertices[2 * vt1_0 + 1];
 
@@ -714,7 +868,7 @@ inline static void delaunay_check_triangle(struct delaunay* restrict d, int t) {
   int testi = geometry2d_in_sphere_exact(&d->geometry, aix, aiy, bix, biy, cix,
                                          ciy, dix, diy);
 
-#ifdef DELAUNAY_NONEXACT
+#if defined(DELAUNAY_NONEXACT) && defined(DELAUNAY_DO_ASSERTIONS)
   delaunay_assert(test * testi >= 0);
 #endif
 
@@ -828,9 +982,11 @@ inline static void delaunay_add_vertex(struct delaunay* restrict d, int v) {
      current guess. */
   int t0, t1, ngb_index;
   t0 = d->last_triangle;
+  instrumentation_count(&d->counters, INSTRUMENTATION_WALK_STEPS);
   int flag = delaunay_test_point_inside_triangle(d, v, t0, &t1, &ngb_index);
   int count = 0;
   while (flag == 0) {
+    instrumentation_count(&d->counters, INSTRUMENTATION_WALK_STEPS);
     t0 = t1;
     flag = delaunay_test_point_inside_triangle(d, v, t0, &t1, &ngb_index);
     ++count;
@@ -1014,6 +1170,22 @@ inline static void delaunay_add_local_vertex(struct delaunay* restrict d, int v,
   delaunay_add_vertex(d, v);
 }
 
+/**
+ * @brief Start the point location of the next vertex insertion from a triangle
+ * that contains the given vertex, instead of from the last triangle that was
+ * accessed.
+ *
+ * This is useful if the next vertex is known to lie closer to the given vertex
+ * than to the previously inserted vertex (see cell_get_brio_order()).
+ *
+ * @param d Delaunay tessellation
+ * @param v Index of a vertex that is already part of the tessellation
+ */
+inline static void delaunay_set_walk_hint(struct delaunay* restrict d, int v) {
+  delaunay_assert(d->vertex_triangles[v] >= 0);
+  d->last_triangle = d->vertex_triangles[v];
+}
+
 inline static void delaunay_add_new_vertex(struct delaunay* restrict d,
                                            double x, double y) {
   int v = delaunay_new_vertex(d, x, y);
@@ -1027,19 +1199,39 @@ inline static void delaunay_add_new_vertex(struct delaunay* restrict d,
  * @param d Delaunay tessellation.
  */
 inline static void delaunay_destroy(struct delaunay* restrict d) {
-  free(d->vertices);
+  CVORONOI_FREE(d->vertices);
 #ifdef DELAUNAY_NONEXACT
-  free(d->rescaled_vertices);
+  CVORONOI_FREE(d->rescaled_vertices);
 #endif
-  free(d->integer_vertices);
-  free(d->vertex_triangles);
-  free(d->vertex_triangle_index);
-  free(d->search_radii);
-  free(d->triangles);
-  free(d->queue);
+  CVORONOI_FREE(d->integer_vertices);
+  CVORONOI_FREE(d->vertex_triangles);
+  CVORONOI_FREE(d->vertex_triangle_index);
+  CVORONOI_FREE(d->search_radii);
+  CVORONOI_FREE(d->triangles);
+  CVORONOI_FREE(d->queue);
   geometry2d_destroy(&d->geometry);
 }
 
+/**
+ * @brief Get the memory used by the tessellation.
+ *
+ * Since the arrays of a tessellation never shrink (also not when it is reset),
+ * this is also the high-water mark of its memory use.
+ *
+ * @param d Delaunay tessellation.
+ * @return Size in bytes (excluding the exact geometry variables).
+ */
+inline static size_t delaunay_get_memory_size(const struct delaunay* d) {
+  size_t vertex_bytes = 2 * sizeof(double) + 2 * sizeof(unsigned long int) +
+                        2 * sizeof(int) + sizeof(double);
+#ifdef DELAUNAY_NONEXACT
+  vertex_bytes += 2 * sizeof(double);
+#endif
+  return (size_t)d->vertex_size * vertex_bytes +
+         (size_t)d->triangle_size * sizeof(struct triangle) +
+         (size_t)d->queue_size * sizeof(int);
+}
+
 /**
  * @brief Get the radius of the circumcircle of the given triangle.
  *
@@ -1332,4 +1524,36 @@ inline static void delaunay_print_tessellation(
   fclose(file);
 }
 
+/**
+ * @brief Write the tessellation to a binary file with the given name.
+ *
+ * The file starts with a header (see binary_output_write_header()) with file
+ * type BINARY_OUTPUT_TYPE_DELAUNAY, with as counts the number of vertices and
+ * the number of triangles. The header is followed by the vertex coordinates
+ * (double[nvertex][2]) and the vertex indices of the triangles
+ * (int32[ntriangle][3], padded to a multiple of 8 bytes). As for
+ * delaunay_print_tessellation(), all triangles are written.
+ *
+ * @param d Delaunay tessellation (read-only).
+ * @param file_name Name of the output file.
+ */
+inline static void delaunay_print_tessellation_binary(
+    const struct delaunay* restrict d, const char* file_name) {
+
+  const int64_t counts[BINARY_OUTPUT_NCOUNT] = {d->vertex_index,
+                                                d->triangle_index, 0, 0};
+
+  struct binary_output o;
+  binary_output_open(&o, file_name);
+  binary_output_write_header(&o, BINARY_OUTPUT_TYPE_DELAUNAY, 2, 0, counts);
+  binary_output_write_doubles(&o, d->vertices, 2 * d->vertex_index);
+  for (int i = 0; i < d->triangle_index; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      binary_output_write_int32(&o, d->triangles[i].vertices[j]);
+    }
+  }
+  binary_output_align(&o);
+  binary_output_close(&o);
+}
+
 #endif /* CVORONOI_DELAUNAY2D_H */
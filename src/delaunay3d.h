@@ -14,11 +14,69 @@
 #include <float.h>
 #include <math.h>
 
+#include "allocator.h"
+#include "binary_output.h"
 #include "geometry.h"
+#include "hilbert.h"
 #include "hydro_space.h"
+#include "instrumentation.h"
 #include "queues.h"
+#include "sort.h"
 #include "tetrahedron.h"
 
+/*! @brief Average number of tetrahedra per vertex of a 3D Delaunay
+ *  tessellation. This is the value for a Poisson point set; more regular point
+ *  sets have slightly fewer tetrahedra. */
+#define DELAUNAY_TETRAHEDRA_PER_VERTEX 6.77
+
+/*! @brief Thickness of the layer of ghost vertices that is needed around a
+ *  cell to complete the tessellation of its local vertices, in units of the
+ *  mean interparticle distance. */
+#define DELAUNAY_GHOST_LAYER_THICKNESS 2.5
+
+/*! @brief Largest number of periodic shifts (see
+ *  delaunay_set_periodic_shifts()): one for every neighbour of a cubic cell. */
+#define DELAUNAY_MAX_PERIODIC_SHIFTS 26
+
+#ifdef DELAUNAY_IMPLICIT_INTEGER_COORDINATES
+/*! @brief Number of dummy vertices: the corners of the initial cube. */
+#define DELAUNAY_DUMMY_VERTEX_COUNT 8
+/*! @brief Number of dummy tetrahedra: one for every triangle on the surface of
+ *  the initial cube. */
+#define DELAUNAY_DUMMY_TETRAHEDRON_COUNT 12
+/*! @brief Number of tetrahedra in the initial tessellation of the cube. */
+#define DELAUNAY_INITIAL_TETRAHEDRON_COUNT 5
+#else
+/*! @brief Number of dummy vertices: the corners of the initial tetrahedron. */
+#define DELAUNAY_DUMMY_VERTEX_COUNT 4
+/*! @brief Number of dummy tetrahedra: one for every face of the initial
+ *  tetrahedron. */
+#define DELAUNAY_DUMMY_TETRAHEDRON_COUNT 4
+/*! @brief Number of tetrahedra in the initial tessellation. */
+#define DELAUNAY_INITIAL_TETRAHEDRON_COUNT 1
+#endif
+
+/*! @brief Initial size of the queue of tetrahedra containing a new vertex.
+ *  This is 1 for almost every vertex, but exact lattices need up to 40. */
+#define DELAUNAY_QUEUE_RESERVE_CONTAINING 64
+
+/*! @brief Initial size of the queue of tetrahedra to check. The high-water
+ *  mark is about 40 for random point sets and 140 for exact lattices. */
+#define DELAUNAY_QUEUE_RESERVE_CHECK 256
+
+/*! @brief Initial size of the queues of freed tetrahedra. The high-water mark
+ *  is about 200 for random point sets (mostly during the insertion of the
+ *  first vertices) and 1300 for exact lattices. */
+#define DELAUNAY_QUEUE_RESERVE_FREE 256
+
+/*! @brief Initial size of the queue of neighbours of a vertex (see
+ *  delaunay_get_search_radius()). */
+#define DELAUNAY_QUEUE_RESERVE_NEIGHBOURS 64
+
+/*! @brief Initial size of the queue of moved vertices (see
+ *  delaunay_repair()). */
+#define DELAUNAY_QUEUE_RESERVE_MOVED 64
+
 /* Forward declarations */
 struct delaunay;
 inline static void delaunay_check_tessellation(struct delaunay* d);
@@ -26,6 +84,10 @@ inline static int delaunay_new_vertex(struct delaunay* restrict d, double x,
                                       double y, double z);
 inline static void delaunay_add_vertex(struct delaunay* restrict d, int v);
 inline static int delaunay_new_tetrahedron(struct delaunay* restrict d);
+#ifdef DELAUNAY_IMPLICIT_INTEGER_COORDINATES
+inline static void delaunay_init_cube(struct delaunay* restrict d,
+                                      double box_side);
+#endif
 inline static void delaunay_init_tetrahedron(struct delaunay* d, int t, int v0,
                                              int v1, int v2, int v3);
 inline static int get_next_tetrahedron_to_check(struct delaunay* restrict d);
@@ -38,11 +100,14 @@ inline static void delaunay_n_to_2n_flip(struct delaunay* d, int v,
                                          const int* t, int n);
 inline static void delaunay_check_tetrahedra(struct delaunay* d, int v);
 inline static int delaunay_check_tetrahedron(struct delaunay* d, int t, int v);
+inline static int delaunay_check_tetrahedron_face(struct delaunay* d, int t,
+                                                  int top, int* freed);
 inline static int positive_permutation(int a, int b, int c, int d);
-inline static double delaunay_get_radius(const struct delaunay* restrict d,
-                                         int t);
+inline static double delaunay_get_radius(struct delaunay* restrict d, int t);
 inline static int delaunay_test_orientation(struct delaunay* restrict d, int v0,
                                             int v1, int v2, int v3);
+inline static int delaunay_test_in_sphere(struct delaunay* restrict d, int v0,
+                                          int v1, int v2, int v3, int v4);
 
 struct delaunay {
 
@@ -64,9 +129,13 @@ struct delaunay {
   double* rescaled_vertices;
 #endif
 
+#ifndef DELAUNAY_IMPLICIT_INTEGER_COORDINATES
   /*! @brief Integer vertex_indices. These are the vertex coordinates that are
-   *  actually used during the incremental construction. */
+   *  actually used during the incremental construction. With
+   *  DELAUNAY_IMPLICIT_INTEGER_COORDINATES, they are recovered from the
+   *  rescaled coordinates instead (see delaunay_get_integer_vertex()). */
   unsigned long int* integer_vertices;
+#endif
 
   /*! @brief Vertex-tetrahedron connections. For every vertex in the
    * tessellation, this array stores the index of a tetrahedron that contains
@@ -114,8 +183,37 @@ struct delaunay {
    * grid. */
   int ghost_offset;
 
+  /*! @brief Number of periodic shifts (see delaunay_set_periodic_shifts()). If
+   *  this is not 0, all ghosts are periodic copies of local vertices, whose
+   *  coordinates are not stored but computed when they are needed from the
+   *  coordinates of the local vertex and the shift (see
+   *  delaunay_get_vertex()). The coordinate arrays then only contain the local
+   *  and dummy vertices. */
+  int periodic_shift_count;
+
+  /*! @brief Periodic shifts (3 per shift). */
+  double periodic_shifts[3 * DELAUNAY_MAX_PERIODIC_SHIFTS];
+
+  /*! @brief Local vertex every periodic ghost is a copy of (indexed by the
+   *  ghost index minus ghost_offset). */
+  int* ghost_vertices;
+
+  /*! @brief Index of the periodic shift of every periodic ghost. */
+  int* ghost_shifts;
+
+  /*! @brief Current size of the periodic ghost arrays in memory. */
+  int ghost_size;
+
   /*! @brief Tetrahedra that make up the tessellation. */
-  struct tetrahedron* tetrahedra;
+  struct tetrahedron_array tetrahedra;
+
+#ifdef DELAUNAY_CACHE_CIRCUMCENTERS
+  /*! @brief Cached circumcenters and squared circumradii of the tetrahedra (4
+   *  values per tetrahedron). These are computed on first use (see
+   *  delaunay_get_circumcenter()); a negative squared radius marks an entry
+   *  that still needs to be computed. */
+  double* circumcenters;
+#endif
 
   /*! @brief Next available index within the tetrahedron array. Corresponds to
    * the actual size of the tetrahedron array. */
@@ -126,6 +224,18 @@ struct delaunay {
    * needs to be expanded. */
   int tetrahedron_size;
 
+  /*! @brief Index of the first tetrahedron that is not one of the dummy
+   * tetrahedra. This is DELAUNAY_DUMMY_TETRAHEDRON_COUNT during the
+   * construction, and 0 after the tessellation was compacted (see
+   * delaunay_compact()). */
+  int tetrahedron_start;
+
+  /*! @brief Flag indicating whether the tessellation was compacted (see
+   * delaunay_compact()). A compacted tessellation only contains the active
+   * tetrahedra with a local vertex and no longer has the arrays needed to add
+   * or move vertices, so it has to be reset before it can be changed. */
+  int compact;
+
   /*! @brief Index of the last tetrahedron that was created or modified. Used as
    * initial guess for the tetrahedron that contains the next vertex that will
    * be added. If vertex_indices are added in some sensible order (e.g. in
@@ -146,68 +256,242 @@ struct delaunay {
    */
   struct int_lifo_queue free_tetrahedron_indices;
 
-  /*! @brief Array of tetrahedra containing the current vertex */
+  /*! @brief Lifo queue of tetrahedra that were freed while restoring the
+   *  Delaunay criterion after the insertion of a vertex. These are only added
+   *  to free_tetrahedron_indices afterwards (see delaunay_check_tetrahedra()).
+   */
+  struct int_lifo_queue freed_tetrahedra;
+
+  /*! @brief Array of tetrahedra containing the current vertex. Also used to
+   *  collect the tetrahedra around a moved vertex and the faces that could not
+   *  be flipped yet in delaunay_repair(). */
   struct int_lifo_queue tetrahedra_containing_vertex;
 
+  /*! @brief Lifo queue of vertices that were moved since the last repair (see
+   *  delaunay_move_vertex() and delaunay_repair()). */
+  struct int_lifo_queue moved_vertices;
+
   /*! @brief Queue to store neighbouring vertices of the current vertex when
    * looping over all the tetrahedra containing the current vertex to calculate
    * its search radius */
   struct int3_fifo_queue get_radius_neighbour_info_queue;
 
   /*! @brief Array to indicate which neighbours have already been added to the
-   * get_radius_neighbour_info_queue during the search radius calculation. */
+   * get_radius_neighbour_info_queue during the search radius calculation. Also
+   * used to flag the vertices whose search radius is updated in
+   * delaunay_update_search_radii(), and the moved vertices in
+   * delaunay_repair(). */
   int* get_radius_neighbour_flags;
 
   /*! @brief Geometry variables. Auxiliary variables used by the exact integer
    *  geometry3d tests that need to be stored in between tests, since allocating
    *  and deallocating them for every test is too expensive. */
   struct geometry3d geometry;
+
+#ifdef INSTRUMENTATION_ACTIVE
+  /*! @brief Event counters (see instrumentation.h). These are accumulated
+   *  over all constructions, also if the tessellation is reset. */
+  struct instrumentation_counters counters;
+#endif
 };
 
 /**
- * @brief Initialize the Delaunay tessellation.
+ * @brief Estimate the number of ghost vertices needed to complete the
+ * tessellation of the given number of local vertices, assuming that these are
+ * distributed roughly uniformly within a cubic cell.
  *
- * This function allocates memory for all arrays that make up the tessellation
- * and initializes the variables used for bookkeeping.
+ * @param count Number of local vertices.
+ * @return Estimated number of ghost vertices.
+ */
+inline static int delaunay_estimate_ghost_count(int count) {
+  const double n = cbrt((double)count);
+  const double m = n + 2. * DELAUNAY_GHOST_LAYER_THICKNESS;
+  return (int)ceil(m * m * m) - count;
+}
+
+/**
+ * @brief Estimate the final sizes of the vertex and tetrahedron arrays of a
+ * tessellation with the given number of local and ghost vertices.
  *
- * It then sets up a large tetrahedron that contains the entire simulation box
- * and additional buffer space to deal with boundary ghost vertex_indices, and 4
- * additional dummy tetrahedron that provide valid neighbours for the 4 sides of
- * this tetrahedron (these dummy tetrahedra themselves have an invalid tip
- * vertex and are therefore simply placeholders).
+ * These sizes can be reserved up front (see delaunay_reserve()), so that
+ * constructing the tessellation does not have to grow (and copy) the arrays.
+ *
+ * @param count Number of local vertices.
+ * @param ghost_count Number of ghost vertices (e.g. the result of
+ * delaunay_estimate_ghost_count()).
+ * @param vertex_size Estimated size of the vertex arrays (including the
+ * dummy vertices).
+ * @param tetrahedron_size Estimated size of the tetrahedron array (including
+ * the dummy tetrahedra).
+ */
+inline static void delaunay_estimate_size(int count, int ghost_count,
+                                          int* vertex_size,
+                                          int* tetrahedron_size) {
+  *vertex_size = count + ghost_count + DELAUNAY_DUMMY_VERTEX_COUNT;
+  *tetrahedron_size =
+      DELAUNAY_DUMMY_TETRAHEDRON_COUNT +
+      (int)ceil(DELAUNAY_TETRAHEDRA_PER_VERTEX * (*vertex_size));
+}
+
+/**
+ * @brief Get the new size of an array that is full.
+ *
+ * The arrays are usually created with an estimate of their final size, so that
+ * they only need to grow if that estimate was slightly too small. We therefore
+ * grow them by 50% instead of doubling their size.
+ *
+ * @param size Current size.
+ * @return New size.
+ */
+inline static int delaunay_grow_size(int size) {
+  return size + (size >> 1) + 1;
+}
+
+/**
+ * @brief Resize the vertex arrays.
+ *
+ * If the ghosts are periodic copies (see delaunay_set_periodic_shifts()), the
+ * coordinate arrays only hold the vertices before the ghost offset.
  *
  * @param d Delaunay tessellation.
- * @param hs Spatial extents of the simulation box.
- * @param vertex_size Initial size of the vertex array.
- * @param tetrahedron_size Initial size of the tetrahedra array.
+ * @param vertex_size New size of the vertex arrays.
  */
-inline static void delaunay_init(struct delaunay* restrict d,
-                                 const struct hydro_space* restrict hs,
-                                 int vertex_size, int tetrahedron_size) {
-  /* allocate memory for all the arrays and queues */
-  d->vertices = (double*)malloc(vertex_size * 3 * sizeof(double));
+inline static void delaunay_resize_vertex_arrays(struct delaunay* restrict d,
+                                                 int vertex_size) {
+  d->vertex_size = vertex_size;
+  const int coordinate_size =
+      d->periodic_shift_count > 0 ? d->ghost_offset : vertex_size;
+  d->vertices = (double*)CVORONOI_REALLOC(d->vertices,
+                                          coordinate_size * 3 * sizeof(double));
 #ifdef DELAUNAY_NONEXACT
-  d->rescaled_vertices = (double*)malloc(vertex_size * 3 * sizeof(double));
+  d->rescaled_vertices = (double*)CVORONOI_REALLOC(
+      d->rescaled_vertices, coordinate_size * 3 * sizeof(double));
 #endif
-  d->integer_vertices =
-      (unsigned long int*)malloc(vertex_size * 3 * sizeof(unsigned long int));
-  d->vertex_tetrahedron_links = (int*)malloc(vertex_size * sizeof(int));
-  d->vertex_tetrahedron_index = (int*)malloc(vertex_size * sizeof(int));
-  d->search_radii = (double*)malloc(vertex_size * sizeof(double));
-  d->tetrahedra = (struct tetrahedron*)malloc(tetrahedron_size *
-                                              sizeof(struct tetrahedron));
-  int_lifo_queue_init(&d->tetrahedra_containing_vertex, 10);
-  int_lifo_queue_init(&d->tetrahedra_to_check, 10);
-  int_lifo_queue_init(&d->free_tetrahedron_indices, 10);
-  int3_fifo_queue_init(&d->get_radius_neighbour_info_queue, 10);
-  d->get_radius_neighbour_flags = (int*)malloc(vertex_size * sizeof(int));
-
-  /* Initialise the vertex and tetrahedra array indices and sizes. */
-  d->vertex_size = vertex_size;
-  d->vertex_index = vertex_size;
+#ifndef DELAUNAY_IMPLICIT_INTEGER_COORDINATES
+  d->integer_vertices = (unsigned long int*)CVORONOI_REALLOC(
+      d->integer_vertices, coordinate_size * 3 * sizeof(unsigned long int));
+#endif
+  d->vertex_tetrahedron_links =
+      (int*)CVORONOI_REALLOC(d->vertex_tetrahedron_links,
+                             d->vertex_size * sizeof(int));
+  d->vertex_tetrahedron_index =
+      (int*)CVORONOI_REALLOC(d->vertex_tetrahedron_index,
+                             d->vertex_size * sizeof(int));
+  d->search_radii = (double*)CVORONOI_REALLOC(d->search_radii,
+                                              d->vertex_size * sizeof(double));
+  d->get_radius_neighbour_flags = (int*)CVORONOI_REALLOC(
+      d->get_radius_neighbour_flags, d->vertex_size * sizeof(int));
+}
 
-  d->tetrahedron_index = 0;
+/**
+ * @brief Resize the tetrahedron arrays.
+ *
+ * @param d Delaunay tessellation.
+ * @param tetrahedron_size New size of the tetrahedron arrays.
+ */
+inline static void delaunay_resize_tetrahedron_arrays(
+    struct delaunay* restrict d, int tetrahedron_size) {
+  tetrahedron_array_resize(&d->tetrahedra, d->tetrahedron_index,
+                           tetrahedron_size);
+#ifdef DELAUNAY_CACHE_CIRCUMCENTERS
+  d->circumcenters = (double*)CVORONOI_REALLOC(
+      d->circumcenters, tetrahedron_size * 4 * sizeof(double));
+  tetrahedron_advise_huge_pages(d->circumcenters,
+                                tetrahedron_size * 4 * sizeof(double));
+#endif
   d->tetrahedron_size = tetrahedron_size;
+}
+
+/**
+ * @brief Make sure the tessellation can hold at least the given number of
+ * vertices and tetrahedra without growing its arrays.
+ *
+ * @param d Delaunay tessellation.
+ * @param vertex_size Number of vertices (see delaunay_estimate_size()).
+ * @param tetrahedron_size Number of tetrahedra.
+ */
+inline static void delaunay_reserve(struct delaunay* restrict d,
+                                    int vertex_size, int tetrahedron_size) {
+  if (vertex_size > d->vertex_size) {
+    delaunay_resize_vertex_arrays(d, vertex_size);
+  }
+  if (tetrahedron_size > d->tetrahedron_size) {
+    delaunay_resize_tetrahedron_arrays(d, tetrahedron_size);
+  }
+}
+
+/**
+ * @brief Place the memory of the vertex and tetrahedron arrays on the memory
+ * domain of the calling thread (see allocator_first_touch()).
+ *
+ * This should be called by the thread that will construct the tessellation,
+ * after the arrays were reserved (see delaunay_reserve()).
+ *
+ * @param d Delaunay tessellation.
+ */
+inline static void delaunay_first_touch(struct delaunay* restrict d) {
+  const size_t n = (size_t)d->vertex_size;
+  const size_t coordinate_size =
+      d->periodic_shift_count > 0 ? (size_t)d->ghost_offset : n;
+  allocator_first_touch(d->vertices, coordinate_size * 3 * sizeof(double));
+#ifdef DELAUNAY_NONEXACT
+  allocator_first_touch(d->rescaled_vertices,
+                        coordinate_size * 3 * sizeof(double));
+#endif
+#ifndef DELAUNAY_IMPLICIT_INTEGER_COORDINATES
+  allocator_first_touch(d->integer_vertices,
+                        coordinate_size * 3 * sizeof(unsigned long int));
+#endif
+  allocator_first_touch(d->vertex_tetrahedron_links, n * sizeof(int));
+  allocator_first_touch(d->vertex_tetrahedron_index, n * sizeof(int));
+  allocator_first_touch(d->search_radii, n * sizeof(double));
+  allocator_first_touch(d->get_radius_neighbour_flags, n * sizeof(int));
+  tetrahedron_array_first_touch(&d->tetrahedra, d->tetrahedron_size);
+#ifdef DELAUNAY_CACHE_CIRCUMCENTERS
+  allocator_first_touch(d->circumcenters,
+                        (size_t)d->tetrahedron_size * 4 * sizeof(double));
+#endif
+}
+
+/**
+ * @brief Reset the Delaunay tessellation, so that a new tessellation can be
+ * constructed.
+ *
+ * This removes all vertices and tetrahedra and sets up the large initial
+ * tetrahedron and its 4 dummy neighbours (see delaunay_init()), but keeps all
+ * memory (and the exact geometry variables) of the tessellation. Rebuilding a
+ * tessellation with a similar number of vertices therefore does not allocate
+ * any memory.
+ *
+ * @param d Delaunay tessellation.
+ * @param hs Spatial extents of the simulation box.
+ * @param vertex_size Number of local vertices. The vertex arrays are only
+ * resized if they are smaller than this.
+ */
+inline static void delaunay_reset(struct delaunay* restrict d,
+                                  const struct hydro_space* restrict hs,
+                                  int vertex_size) {
+  if (d->compact || d->periodic_shift_count > 0) {
+    /* reallocate the arrays that were freed by delaunay_compact() or shrunk
+       by delaunay_set_periodic_shifts() */
+    d->compact = 0;
+    d->periodic_shift_count = 0;
+    delaunay_resize_vertex_arrays(
+        d, vertex_size > d->vertex_size ? vertex_size : d->vertex_size);
+  } else if (vertex_size > d->vertex_size) {
+    delaunay_resize_vertex_arrays(d, vertex_size);
+  }
+  int_lifo_queue_reset(&d->tetrahedra_containing_vertex);
+  int_lifo_queue_reset(&d->tetrahedra_to_check);
+  int_lifo_queue_reset(&d->free_tetrahedron_indices);
+  int_lifo_queue_reset(&d->freed_tetrahedra);
+  int_lifo_queue_reset(&d->moved_vertices);
+  int3_fifo_queue_reset(&d->get_radius_neighbour_info_queue);
+
+  /* Initialise the vertex and tetrahedra array indices. */
+  d->vertex_index = vertex_size;
+  d->tetrahedron_index = 0;
+  d->tetrahedron_start = DELAUNAY_DUMMY_TETRAHEDRON_COUNT;
 
   /* Initialise the indices indicating where the local vertices start and end.*/
   d->vertex_start = 0;
@@ -220,16 +504,28 @@ inline static void delaunay_init(struct delaunay* restrict d,
    * simulation volume and all possible ghost vertex_indices required to deal
    * with boundaries. Note that we convert the generally rectangular box to a
    * square. */
+  double box_side = fmax(hs->side[0], hs->side[1]);
+  box_side = fmax(box_side, hs->side[2]);
+#ifdef DELAUNAY_IMPLICIT_INTEGER_COORDINATES
+  /* The cell and all neighbouring cells fit inside a cube with side 3. We add a
+   * small margin, so that ghost vertices on the outer boundary of the
+   * neighbouring cells do not end up on the surface of the cube. */
+  const double margin = 0.005 * box_side;
+  double box_anchor[3] = {hs->anchor[0] - hs->side[0] - margin,
+                          hs->anchor[1] - hs->side[1] - margin,
+                          hs->anchor[2] - hs->side[2] - margin};
+  box_side = 3 * box_side + 2 * margin;
+#else
   double box_anchor[3] = {hs->anchor[0] - hs->side[0],
                           hs->anchor[1] - hs->side[1],
                           hs->anchor[2] - hs->side[2]};
   /* Notice we have to take box_side rather large, because we want to fit the
    * cell and all neighbouring cells inside the first tetrahedron. This comes at
    * a loss of precision in the integer arithmetic, though... A better solution
-   * would possibly be to start from 5 tetrahedra forming a cube (box_side would
-   * have to be 3 in that case). */
-  double box_side = fmax(hs->side[0], hs->side[1]);
-  box_side = 9 * fmax(box_side, hs->side[2]);
+   * is to start from 5 tetrahedra forming a cube (box_side is 3 in that case,
+   * see DELAUNAY_IMPLICIT_INTEGER_COORDINATES). */
+  box_side = 9 * box_side;
+#endif
   /* store the anchor and inverse side_length for the conversion from box
      coordinates to rescaled (integer) coordinates */
   d->anchor[0] = box_anchor[0];
@@ -239,9 +535,9 @@ inline static void delaunay_init(struct delaunay* restrict d,
    * [1,2] (unlike Springel, 2010) */
   d->inverse_side = (1. - 1.e-13) / box_side;
 
-  /* initialise the structure used to perform exact geometrical tests */
-  geometry3d_init(&d->geometry);
-
+#ifdef DELAUNAY_IMPLICIT_INTEGER_COORDINATES
+  delaunay_init_cube(d, box_side);
+#else
   /* set up vertex_indices for large initial tetrahedron */
   int v0 = delaunay_new_vertex(d, d->anchor[0], d->anchor[1], d->anchor[2]);
   int v1 = delaunay_new_vertex(d, d->anchor[0] + box_side, d->anchor[1],
@@ -259,62 +555,188 @@ inline static void delaunay_init(struct delaunay* restrict d,
   delaunay_log(
       "Creating dummy tetrahedron at %i with vertex_indices: %i %i %i %i",
       dummy0, v1, v2, v3, -1);
-  tetrahedron_init(&d->tetrahedra[dummy0], v1, v2, v3, -1);
+  tetrahedron_init(&d->tetrahedra, dummy0, v1, v2, v3, -1);
   delaunay_log(
       "Creating dummy tetrahedron at %i with vertex_indices: %i %i %i %i",
       dummy1, v2, v0, v3, -1);
-  tetrahedron_init(&d->tetrahedra[dummy1], v2, v0, v3, -1);
+  tetrahedron_init(&d->tetrahedra, dummy1, v2, v0, v3, -1);
   delaunay_log(
       "Creating dummy tetrahedron at %i with vertex_indices: %i %i %i %i",
       dummy2, v3, v0, v1, -1);
-  tetrahedron_init(&d->tetrahedra[dummy2], v3, v0, v1, -1);
+  tetrahedron_init(&d->tetrahedra, dummy2, v3, v0, v1, -1);
   delaunay_log(
       "Creating dummy tetrahedron at %i with vertex_indices: %i %i %i %i",
       dummy3, v0, v2, v1, -1);
-  tetrahedron_init(&d->tetrahedra[dummy3], v0, v2, v1, -1);
+  tetrahedron_init(&d->tetrahedra, dummy3, v0, v2, v1, -1);
   delaunay_init_tetrahedron(d, first_tetrahedron, v0, v1, v2, v3);
 
   /* Setup neighbour relations */
-  tetrahedron_swap_neighbour(&d->tetrahedra[dummy0], 3, first_tetrahedron, 0);
-  tetrahedron_swap_neighbour(&d->tetrahedra[dummy1], 3, first_tetrahedron, 1);
-  tetrahedron_swap_neighbour(&d->tetrahedra[dummy2], 3, first_tetrahedron, 2);
-  tetrahedron_swap_neighbour(&d->tetrahedra[dummy3], 3, first_tetrahedron, 3);
-  tetrahedron_swap_neighbours(&d->tetrahedra[first_tetrahedron], dummy0, dummy1,
+  tetrahedron_swap_neighbour(&d->tetrahedra, dummy0, 3, first_tetrahedron, 0);
+  tetrahedron_swap_neighbour(&d->tetrahedra, dummy1, 3, first_tetrahedron, 1);
+  tetrahedron_swap_neighbour(&d->tetrahedra, dummy2, 3, first_tetrahedron, 2);
+  tetrahedron_swap_neighbour(&d->tetrahedra, dummy3, 3, first_tetrahedron, 3);
+  tetrahedron_swap_neighbours(&d->tetrahedra, first_tetrahedron, dummy0, dummy1,
                               dummy2, dummy3, 3, 3, 3, 3);
+#endif
 
   /* Perform sanity checks */
   delaunay_check_tessellation(d);
   delaunay_log("Passed post init check");
 }
 
+/**
+ * @brief Initialize the Delaunay tessellation.
+ *
+ * This function allocates memory for all arrays that make up the tessellation
+ * and initializes the variables used for bookkeeping.
+ *
+ * It then sets up a large tetrahedron that contains the entire simulation box
+ * and additional buffer space to deal with boundary ghost vertex_indices, and 4
+ * additional dummy tetrahedron that provide valid neighbours for the 4 sides of
+ * this tetrahedron (these dummy tetrahedra themselves have an invalid tip
+ * vertex and are therefore simply placeholders). This is done by
+ * delaunay_reset(), which can also be used to rebuild the tessellation without
+ * reallocating its memory.
+ *
+ * @param d Delaunay tessellation.
+ * @param hs Spatial extents of the simulation box.
+ * @param vertex_size Initial size of the vertex array.
+ * @param tetrahedron_size Initial size of the tetrahedra array.
+ */
+inline static void delaunay_init(struct delaunay* restrict d,
+                                 const struct hydro_space* restrict hs,
+                                 int vertex_size, int tetrahedron_size) {
+  /* allocate memory for all the arrays and queues */
+  d->vertices = (double*)CVORONOI_MALLOC(vertex_size * 3 * sizeof(double));
+#ifdef DELAUNAY_NONEXACT
+  d->rescaled_vertices =
+      (double*)CVORONOI_MALLOC(vertex_size * 3 * sizeof(double));
+#endif
+#ifndef DELAUNAY_IMPLICIT_INTEGER_COORDINATES
+  d->integer_vertices = (unsigned long int*)CVORONOI_MALLOC(
+      vertex_size * 3 * sizeof(unsigned long int));
+#endif
+  d->vertex_tetrahedron_links =
+      (int*)CVORONOI_MALLOC(vertex_size * sizeof(int));
+  d->vertex_tetrahedron_index =
+      (int*)CVORONOI_MALLOC(vertex_size * sizeof(int));
+  d->search_radii = (double*)CVORONOI_MALLOC(vertex_size * sizeof(double));
+  tetrahedron_array_init(&d->tetrahedra, tetrahedron_size);
+#ifdef DELAUNAY_CACHE_CIRCUMCENTERS
+  d->circumcenters =
+      (double*)CVORONOI_MALLOC(tetrahedron_size * 4 * sizeof(double));
+  tetrahedron_advise_huge_pages(d->circumcenters,
+                                tetrahedron_size * 4 * sizeof(double));
+#endif
+  /* the queues are sized for typical tessellations, so that they are hardly
+     ever grown during the construction (see the queue high-water marks in the
+     instrumentation output) */
+  int_lifo_queue_init(&d->tetrahedra_containing_vertex,
+                      DELAUNAY_QUEUE_RESERVE_CONTAINING);
+  int_lifo_queue_init(&d->tetrahedra_to_check, DELAUNAY_QUEUE_RESERVE_CHECK);
+  int_lifo_queue_init(&d->free_tetrahedron_indices,
+                      DELAUNAY_QUEUE_RESERVE_FREE);
+  int_lifo_queue_init(&d->freed_tetrahedra, DELAUNAY_QUEUE_RESERVE_FREE);
+  int_lifo_queue_init(&d->moved_vertices, DELAUNAY_QUEUE_RESERVE_MOVED);
+  int3_fifo_queue_init(&d->get_radius_neighbour_info_queue,
+                       DELAUNAY_QUEUE_RESERVE_NEIGHBOURS);
+  d->get_radius_neighbour_flags =
+      (int*)CVORONOI_MALLOC(vertex_size * sizeof(int));
+  d->ghost_vertices = NULL;
+  d->ghost_shifts = NULL;
+  d->ghost_size = 0;
+
+  /* Initialise the vertex and tetrahedra array sizes. */
+  d->vertex_size = vertex_size;
+  d->tetrahedron_size = tetrahedron_size;
+  d->compact = 0;
+  d->periodic_shift_count = 0;
+
+  /* initialise the structure used to perform exact geometrical tests */
+  geometry3d_init(&d->geometry);
+  instrumentation_reset(&d->counters);
+
+  delaunay_reset(d, hs, vertex_size);
+}
+
 inline static void delaunay_destroy(struct delaunay* restrict d) {
-  free(d->vertices);
+  CVORONOI_FREE(d->vertices);
 #ifdef DELAUNAY_NONEXACT
-  free(d->rescaled_vertices);
+  CVORONOI_FREE(d->rescaled_vertices);
+#endif
+#ifndef DELAUNAY_IMPLICIT_INTEGER_COORDINATES
+  CVORONOI_FREE(d->integer_vertices);
+#endif
+  CVORONOI_FREE(d->vertex_tetrahedron_links);
+  CVORONOI_FREE(d->vertex_tetrahedron_index);
+  CVORONOI_FREE(d->search_radii);
+  tetrahedron_array_destroy(&d->tetrahedra);
+#ifdef DELAUNAY_CACHE_CIRCUMCENTERS
+  CVORONOI_FREE(d->circumcenters);
 #endif
-  free(d->integer_vertices);
-  free(d->vertex_tetrahedron_links);
-  free(d->vertex_tetrahedron_index);
-  free(d->search_radii);
-  free(d->tetrahedra);
   int_lifo_queue_destroy(&d->tetrahedra_to_check);
   int_lifo_queue_destroy(&d->free_tetrahedron_indices);
+  int_lifo_queue_destroy(&d->freed_tetrahedra);
+  int_lifo_queue_destroy(&d->moved_vertices);
   int_lifo_queue_destroy(&d->tetrahedra_containing_vertex);
   int3_fifo_queue_destroy(&d->get_radius_neighbour_info_queue);
-  free(d->get_radius_neighbour_flags);
+  CVORONOI_FREE(d->get_radius_neighbour_flags);
+  CVORONOI_FREE(d->ghost_vertices);
+  CVORONOI_FREE(d->ghost_shifts);
   geometry3d_destroy(&d->geometry);
 }
 
+/**
+ * @brief Get the memory used by the tessellation.
+ *
+ * Since the arrays of a tessellation never shrink (also not when it is reset),
+ * this is also the high-water mark of its memory use, unless the tessellation
+ * was compacted (see delaunay_compact()).
+ *
+ * @param d Delaunay tessellation.
+ * @return Size in bytes (excluding the exact geometry variables).
+ */
+inline static size_t delaunay_get_memory_size(const struct delaunay* d) {
+  size_t vertex_bytes = 2 * sizeof(int);
+  size_t coordinate_bytes = 3 * sizeof(double);
+  if (!d->compact) {
+    /* the arrays that are freed by delaunay_compact() */
+    vertex_bytes += sizeof(int) + sizeof(double);
+#ifndef DELAUNAY_IMPLICIT_INTEGER_COORDINATES
+    coordinate_bytes += 3 * sizeof(unsigned long int);
+#endif
+#ifdef DELAUNAY_NONEXACT
+    coordinate_bytes += 3 * sizeof(double);
+#endif
+  }
+  const int coordinate_size =
+      d->periodic_shift_count > 0 ? d->ghost_offset : d->vertex_size;
+  size_t size = (size_t)d->vertex_size * vertex_bytes +
+                (size_t)coordinate_size * coordinate_bytes +
+                (size_t)d->ghost_size * 2 * sizeof(int) +
+                tetrahedron_array_get_memory_size(d->tetrahedron_size);
+#ifdef DELAUNAY_CACHE_CIRCUMCENTERS
+  size += (size_t)d->tetrahedron_size * 4 * sizeof(double);
+#endif
+  size += (size_t)(d->tetrahedra_containing_vertex.size +
+                   d->tetrahedra_to_check.size +
+                   d->free_tetrahedron_indices.size +
+                   d->freed_tetrahedra.size + d->moved_vertices.size) *
+              sizeof(int) +
+          (size_t)d->get_radius_neighbour_info_queue.size * sizeof(int3);
+  return size;
+}
+
 inline static int delaunay_new_tetrahedron(struct delaunay* restrict d) {
   /* check whether there is a free spot somewhere in the array */
   if (!int_lifo_queue_is_empty(&d->free_tetrahedron_indices)) {
+    instrumentation_count(&d->counters, INSTRUMENTATION_RECYCLED_TETRAHEDRA);
     return int_lifo_queue_pop(&d->free_tetrahedron_indices);
   }
   /* Else: check that we still have space for tetrahedrons available */
   if (d->tetrahedron_index == d->tetrahedron_size) {
-    d->tetrahedron_size <<= 1;
-    d->tetrahedra = (struct tetrahedron*)realloc(
-        d->tetrahedra, d->tetrahedron_size * sizeof(struct tetrahedron));
+    delaunay_resize_tetrahedron_arrays(
+        d, delaunay_grow_size(d->tetrahedron_size));
   }
   /* return and then increase */
   return d->tetrahedron_index++;
@@ -344,7 +766,12 @@ inline static void delaunay_init_tetrahedron(struct delaunay* d, int t, int v0,
     abort();
   }
 #endif
-  tetrahedron_init(&d->tetrahedra[t], v0, v1, v2, v3);
+  tetrahedron_init(&d->tetrahedra, t, v0, v1, v2, v3);
+#ifdef DELAUNAY_CACHE_CIRCUMCENTERS
+  /* the index could belong to a tetrahedron that was removed by a flip, so
+   * invalidate its cached circumcenter */
+  d->circumcenters[4 * t + 3] = -1.;
+#endif
 
   /* Update vertex-tetrahedron links */
   d->vertex_tetrahedron_links[v0] = t;
@@ -361,9 +788,32 @@ inline static void delaunay_init_tetrahedron(struct delaunay* d, int t, int v0,
   d->last_tetrahedron = t;
 }
 
-inline static void delaunay_init_vertex(struct delaunay* restrict d,
-                                        const int v, double x, double y,
-                                        double z) {
+/**
+ * @brief Convert a coordinate to the range [1, 2[ of the rescaled coordinates.
+ *
+ * @param d Delaunay tessellation.
+ * @param x Coordinate.
+ * @param k Index of the coordinate (0-2).
+ * @return Rescaled coordinate.
+ */
+inline static double delaunay_rescale_coordinate(
+    const struct delaunay* restrict d, double x, int k) {
+  return 1. + (x - d->anchor[k]) * d->inverse_side;
+}
+
+/**
+ * @brief Set the coordinates of the given vertex.
+ *
+ * This stores the coordinates and computes the rescaled and integer
+ * coordinates used by the geometrical tests.
+ *
+ * @param d Delaunay tessellation.
+ * @param v Index of the vertex.
+ * @param x, y, z Position of the vertex.
+ */
+inline static void delaunay_set_vertex_coordinates(struct delaunay* restrict d,
+                                                   const int v, double x,
+                                                   double y, double z) {
   /* store a copy of the vertex coordinates (we should get rid of this for
      SWIFT) */
   d->vertices[3 * v] = x;
@@ -373,9 +823,9 @@ inline static void delaunay_init_vertex(struct delaunay* restrict d,
   /* compute the rescaled coordinates. We do this because floating point values
      in the range [1,2[ all have the same exponent (0), which guarantees that
      their mantissas form a linear sequence */
-  double rescaled_x = 1. + (x - d->anchor[0]) * d->inverse_side;
-  double rescaled_y = 1. + (y - d->anchor[1]) * d->inverse_side;
-  double rescaled_z = 1. + (z - d->anchor[2]) * d->inverse_side;
+  double rescaled_x = delaunay_rescale_coordinate(d, x, 0);
+  double rescaled_y = delaunay_rescale_coordinate(d, y, 1);
+  double rescaled_z = delaunay_rescale_coordinate(d, z, 2);
 
   delaunay_assert(rescaled_x >= 1.);
   delaunay_assert(rescaled_x < 2.);
@@ -391,10 +841,114 @@ inline static void delaunay_init_vertex(struct delaunay* restrict d,
   d->rescaled_vertices[3 * v + 2] = rescaled_z;
 #endif
 
+#ifndef DELAUNAY_IMPLICIT_INTEGER_COORDINATES
   /* convert the rescaled coordinates to integer coordinates and store these */
   d->integer_vertices[3 * v] = delaunay_double_to_int(rescaled_x);
   d->integer_vertices[3 * v + 1] = delaunay_double_to_int(rescaled_y);
   d->integer_vertices[3 * v + 2] = delaunay_double_to_int(rescaled_z);
+#endif
+}
+
+/**
+ * @brief Check whether the given vertex is a periodic ghost, whose coordinates
+ * are not stored (see delaunay_set_periodic_shifts()).
+ *
+ * @param d Delaunay tessellation.
+ * @param v Index of the vertex.
+ * @return 1 if the vertex is a periodic ghost.
+ */
+inline static int delaunay_is_periodic_ghost(const struct delaunay* restrict d,
+                                             int v) {
+  return d->periodic_shift_count > 0 && v >= d->ghost_offset;
+}
+
+/**
+ * @brief Get the position of the given vertex.
+ *
+ * The position of a periodic ghost is computed from the position of the local
+ * vertex it is a copy of, in exactly the same way as it would be when the
+ * ghost was added with its shifted coordinates.
+ *
+ * @param d Delaunay tessellation.
+ * @param v Index of the vertex.
+ * @param buffer Buffer for the position of a periodic ghost (3 coordinates).
+ * @return Position of the vertex: a pointer into the vertex array, or buffer.
+ */
+inline static const double* delaunay_get_vertex(
+    const struct delaunay* restrict d, int v, double* buffer) {
+  if (!delaunay_is_periodic_ghost(d, v)) {
+    return &d->vertices[3 * v];
+  }
+  const int g = v - d->ghost_offset;
+  const double* x = &d->vertices[3 * d->ghost_vertices[g]];
+  const double* shift = &d->periodic_shifts[3 * d->ghost_shifts[g]];
+  buffer[0] = x[0] + shift[0];
+  buffer[1] = x[1] + shift[1];
+  buffer[2] = x[2] + shift[2];
+  return buffer;
+}
+
+#ifdef DELAUNAY_NONEXACT
+/**
+ * @brief Get the rescaled coordinates of the given vertex (see
+ * delaunay_get_vertex()).
+ *
+ * @param d Delaunay tessellation.
+ * @param v Index of the vertex.
+ * @param buffer Buffer for the coordinates of a periodic ghost.
+ * @return Rescaled coordinates of the vertex.
+ */
+inline static const double* delaunay_get_rescaled_vertex(
+    const struct delaunay* restrict d, int v, double* buffer) {
+  if (!delaunay_is_periodic_ghost(d, v)) {
+    return &d->rescaled_vertices[3 * v];
+  }
+  double x[3];
+  delaunay_get_vertex(d, v, x);
+  for (int k = 0; k < 3; k++) {
+    buffer[k] = delaunay_rescale_coordinate(d, x[k], k);
+  }
+  return buffer;
+}
+#endif
+
+/**
+ * @brief Get the integer coordinates of the given vertex (see
+ * delaunay_get_vertex()).
+ *
+ * With DELAUNAY_IMPLICIT_INTEGER_COORDINATES, the integer coordinates are the
+ * mantissas of the rescaled coordinates and are always written to the buffer.
+ *
+ * @param d Delaunay tessellation.
+ * @param v Index of the vertex.
+ * @param buffer Buffer for the coordinates of a periodic ghost.
+ * @return Integer coordinates of the vertex.
+ */
+inline static const unsigned long* delaunay_get_integer_vertex(
+    const struct delaunay* restrict d, int v, unsigned long* buffer) {
+  if (!delaunay_is_periodic_ghost(d, v)) {
+#ifdef DELAUNAY_IMPLICIT_INTEGER_COORDINATES
+    const double* x = &d->rescaled_vertices[3 * v];
+    for (int k = 0; k < 3; k++) {
+      buffer[k] = delaunay_double_to_int(x[k]);
+    }
+    return buffer;
+#else
+    return &d->integer_vertices[3 * v];
+#endif
+  }
+  double x[3];
+  delaunay_get_vertex(d, v, x);
+  for (int k = 0; k < 3; k++) {
+    buffer[k] = delaunay_double_to_int(delaunay_rescale_coordinate(d, x[k], k));
+  }
+  return buffer;
+}
+
+inline static void delaunay_init_vertex(struct delaunay* restrict d,
+                                        const int v, double x, double y,
+                                        double z) {
+  delaunay_set_vertex_coordinates(d, v, x, y, z);
 
   /* Initialise the variables that keep track of the link between vertex_indices
    * and tetrahedra. We use negative values so that we can later detect missing
@@ -427,24 +981,8 @@ inline static int delaunay_new_vertex(struct delaunay* restrict d, double x,
                d->vertex_index, x, y, z);
   /* check the size of the vertex arrays against the allocated memory size */
   if (d->vertex_index == d->vertex_size) {
-    /* dynamically grow the size of the arrays with a factor 2 */
-    d->vertex_size <<= 1;
-    d->vertices =
-        (double*)realloc(d->vertices, d->vertex_size * 3 * sizeof(double));
-#ifdef DELAUNAY_NONEXACT
-    d->rescaled_vertices = (double*)realloc(
-        d->rescaled_vertices, d->vertex_size * 3 * sizeof(double));
-#endif
-    d->integer_vertices = (unsigned long int*)realloc(
-        d->integer_vertices, d->vertex_size * 3 * sizeof(unsigned long int));
-    d->vertex_tetrahedron_links = (int*)realloc(d->vertex_tetrahedron_links,
-                                                d->vertex_size * sizeof(int));
-    d->vertex_tetrahedron_index = (int*)realloc(d->vertex_tetrahedron_index,
-                                                d->vertex_size * sizeof(int));
-    d->search_radii =
-        (double*)realloc(d->search_radii, d->vertex_size * sizeof(double));
-    d->get_radius_neighbour_flags =
-        (int*)realloc(d->get_radius_neighbour_flags, d->vertex_size * sizeof(int));
+    /* dynamically grow the size of the arrays */
+    delaunay_resize_vertex_arrays(d, delaunay_grow_size(d->vertex_size));
   }
 
   delaunay_init_vertex(d, d->vertex_index, x, y, z);
@@ -456,6 +994,100 @@ inline static int delaunay_new_vertex(struct delaunay* restrict d, double x,
   return d->vertex_index++;
 }
 
+#ifdef DELAUNAY_IMPLICIT_INTEGER_COORDINATES
+/**
+ * @brief Set up the initial tessellation of a cube with the given side length
+ * at the anchor of the tessellation: a central tetrahedron and the 4
+ * tetrahedra that cut off the remaining corners of the cube. Every triangle on
+ * the surface of the cube gets a dummy neighbour.
+ *
+ * @param d Delaunay tessellation.
+ * @param box_side Side length of the cube.
+ */
+inline static void delaunay_init_cube(struct delaunay* restrict d,
+                                      double box_side) {
+  /* the bits of the corner index are the x, y and z offsets of the corner */
+  int v[8];
+  for (int i = 0; i < 8; i++) {
+    v[i] = delaunay_new_vertex(d, d->anchor[0] + (i & 1) * box_side,
+                               d->anchor[1] + ((i >> 1) & 1) * box_side,
+                               d->anchor[2] + ((i >> 2) & 1) * box_side);
+  }
+  /* the 8 corners have to be exactly cospherical, or the initial tessellation
+     might not be Delaunay. Roundoff in the different anchor coordinates could
+     break this, so we set the rescaled coordinates of the corners directly */
+  const double top =
+      delaunay_rescale_coordinate(d, d->anchor[0] + box_side, 0);
+  for (int i = 0; i < 8; i++) {
+    for (int k = 0; k < 3; k++) {
+      d->rescaled_vertices[3 * v[i] + k] = ((i >> k) & 1) ? top : 1.;
+    }
+  }
+
+  /* positively oriented tetrahedra */
+  static const int corners[DELAUNAY_INITIAL_TETRAHEDRON_COUNT][4] = {
+      {1, 2, 4, 7}, {0, 1, 2, 4}, {3, 2, 1, 7}, {5, 1, 4, 7}, {6, 4, 2, 7}};
+  int dummy = 0;
+  for (int i = 0; i < DELAUNAY_DUMMY_TETRAHEDRON_COUNT; i++) {
+    delaunay_new_tetrahedron(d);
+  }
+  int t[DELAUNAY_INITIAL_TETRAHEDRON_COUNT];
+  for (int i = 0; i < DELAUNAY_INITIAL_TETRAHEDRON_COUNT; i++) {
+    t[i] = delaunay_new_tetrahedron(d);
+    delaunay_init_tetrahedron(d, t[i], v[corners[i][0]], v[corners[i][1]],
+                              v[corners[i][2]], v[corners[i][3]]);
+  }
+
+  /* Setup neighbour relations */
+  for (int i = 0; i < DELAUNAY_INITIAL_TETRAHEDRON_COUNT; i++) {
+    for (int j = 0; j < 4; j++) {
+      /* look for another tetrahedron that contains the face opposite j */
+      int ngb = -1;
+      int idx_in_ngb = -1;
+      for (int n = 0; n < DELAUNAY_INITIAL_TETRAHEDRON_COUNT && ngb < 0; n++) {
+        if (n == i) continue;
+        int shared = 0;
+        int not_shared = -1;
+        for (int l = 0; l < 4; l++) {
+          int in_face = 0;
+          for (int m = 0; m < 4; m++) {
+            in_face |= m != j && corners[n][l] == corners[i][m];
+          }
+          shared += in_face;
+          if (!in_face) not_shared = l;
+        }
+        if (shared == 3) {
+          ngb = t[n];
+          idx_in_ngb = not_shared;
+        }
+      }
+      if (ngb < 0) {
+        /* a face on the surface of the cube: the dummy has the same vertices
+           in an order that gives the opposite orientation, and an invalid tip
+           vertex */
+        int f[4] = {v[corners[i][0]], v[corners[i][1]], v[corners[i][2]],
+                    v[corners[i][3]]};
+        if (j < 3) {
+          f[j] = f[3];
+        } else {
+          f[0] = v[corners[i][1]];
+          f[1] = v[corners[i][0]];
+        }
+        ngb = dummy++;
+        idx_in_ngb = 3;
+        delaunay_log(
+            "Creating dummy tetrahedron at %i with vertex_indices: %i %i %i %i",
+            ngb, f[0], f[1], f[2], -1);
+        tetrahedron_init(&d->tetrahedra, ngb, f[0], f[1], f[2], -1);
+        tetrahedron_swap_neighbour(&d->tetrahedra, ngb, 3, t[i], j);
+      }
+      tetrahedron_swap_neighbour(&d->tetrahedra, t[i], j, ngb, idx_in_ngb);
+    }
+  }
+  delaunay_assert(dummy == DELAUNAY_DUMMY_TETRAHEDRON_COUNT);
+}
+#endif
+
 /**
  * @brief Add a local (non ghost) vertex at the given index.
  * @param d Delaunay tessellation
@@ -471,6 +1103,22 @@ inline static void delaunay_add_local_vertex(struct delaunay* restrict d, int v,
   delaunay_add_vertex(d, v);
 }
 
+/**
+ * @brief Start the point location of the next vertex insertion from a
+ * tetrahedron that contains the given vertex, instead of from the last
+ * tetrahedron that was created.
+ *
+ * This is useful if the next vertex is known to lie closer to the given vertex
+ * than to the previously inserted vertex (see cell_get_brio_order()).
+ *
+ * @param d Delaunay tessellation
+ * @param v Index of a vertex that is already part of the tessellation
+ */
+inline static void delaunay_set_walk_hint(struct delaunay* restrict d, int v) {
+  delaunay_assert(d->vertex_tetrahedron_links[v] >= 0);
+  d->last_tetrahedron = d->vertex_tetrahedron_links[v];
+}
+
 /**
  * @brief Add a new (ghost) vertex.
  * @param d Delaunay tessellation
@@ -482,6 +1130,100 @@ inline static void delaunay_add_new_vertex(struct delaunay* restrict d,
   delaunay_add_vertex(d, v);
 }
 
+/**
+ * @brief Store all ghosts that are added from now on as periodic copies of the
+ * local vertices, with one of the given shifts (see
+ * delaunay_add_periodic_ghost()).
+ *
+ * The coordinates of periodic ghosts are not stored, but computed whenever
+ * they are needed, which saves the memory for 3 sets of coordinates per ghost.
+ * It also means that the ghosts automatically follow the local vertices they
+ * are a copy of when these are moved (see delaunay_move_vertex()). The
+ * tessellation only stays in this mode until it is reset.
+ *
+ * This has to be called after delaunay_consolidate() and before any ghost is
+ * added.
+ *
+ * @param d Delaunay tessellation.
+ * @param shifts Periodic shifts (3 per shift).
+ * @param count Number of shifts (at most DELAUNAY_MAX_PERIODIC_SHIFTS).
+ */
+inline static void delaunay_set_periodic_shifts(struct delaunay* restrict d,
+                                                const double* shifts,
+                                                int count) {
+  if (d->ghost_offset == 0 || d->vertex_index > d->ghost_offset ||
+      count > DELAUNAY_MAX_PERIODIC_SHIFTS) {
+    fprintf(stderr, "Cannot set the periodic shifts of this tessellation!\n");
+    abort();
+  }
+  for (int i = 0; i < 3 * count; i++) {
+    d->periodic_shifts[i] = shifts[i];
+  }
+  d->periodic_shift_count = count;
+  /* the coordinate arrays no longer hold the ghosts */
+  delaunay_resize_vertex_arrays(d, d->vertex_size);
+}
+
+/**
+ * @brief Add a periodic copy of a local vertex as a new ghost vertex (see
+ * delaunay_set_periodic_shifts()).
+ *
+ * @param d Delaunay tessellation
+ * @param vertex Local vertex to copy.
+ * @param shift Index of the periodic shift of the copy.
+ */
+inline static void delaunay_add_periodic_ghost(struct delaunay* restrict d,
+                                               int vertex, int shift) {
+  delaunay_assert(d->periodic_shift_count > 0 && vertex >= d->vertex_start &&
+                  vertex < d->vertex_end && shift >= 0 &&
+                  shift < d->periodic_shift_count);
+  if (d->vertex_index == d->vertex_size) {
+    delaunay_resize_vertex_arrays(d, delaunay_grow_size(d->vertex_size));
+  }
+  const int v = d->vertex_index;
+  const int g = v - d->ghost_offset;
+  if (g == d->ghost_size) {
+    d->ghost_size = delaunay_grow_size(d->ghost_size);
+    d->ghost_vertices =
+        (int*)CVORONOI_REALLOC(d->ghost_vertices, d->ghost_size * sizeof(int));
+    d->ghost_shifts =
+        (int*)CVORONOI_REALLOC(d->ghost_shifts, d->ghost_size * sizeof(int));
+  }
+  delaunay_log("Adding periodic ghost at %i: copy %i of vertex %i", v, shift,
+               vertex);
+  d->ghost_vertices[g] = vertex;
+  d->ghost_shifts[g] = shift;
+  d->vertex_tetrahedron_links[v] = -1;
+  d->vertex_tetrahedron_index[v] = -1;
+  d->search_radii[v] = DBL_MAX;
+  d->get_radius_neighbour_flags[v] = 0;
+  d->vertex_index++;
+  delaunay_add_vertex(d, v);
+}
+
+/**
+ * @brief Move an existing vertex to a new position, without updating the
+ * tessellation.
+ *
+ * After moving vertices, delaunay_repair() has to be called to restore the
+ * tessellation (this also invalidates the cached circumcenters of the
+ * tetrahedra around the moved vertices). The search radius of the vertex is
+ * reset. Periodic ghosts cannot be moved, since they always follow the local
+ * vertex they are a copy of.
+ *
+ * @param d Delaunay tessellation
+ * @param v Index of the vertex
+ * @param x, y, z New position of vertex
+ */
+inline static void delaunay_move_vertex(struct delaunay* restrict d, int v,
+                                        double x, double y, double z) {
+  delaunay_log("Moving vertex %i to coordinates: %g %g %g", v, x, y, z);
+  delaunay_assert(!delaunay_is_periodic_ghost(d, v));
+  delaunay_set_vertex_coordinates(d, v, x, y, z);
+  d->search_radii[v] = DBL_MAX;
+  int_lifo_queue_push(&d->moved_vertices, v);
+}
+
 /**
  * @brief Finalize adding a new vertex to the tessellation.
  *
@@ -555,41 +1297,15 @@ inline static int delaunay_find_tetrahedra_containing_vertex(
   int tetrahedron_idx = d->last_tetrahedron;
 
   while (int_lifo_queue_is_empty(&d->tetrahedra_containing_vertex)) {
-    const struct tetrahedron* tetrahedron = &d->tetrahedra[tetrahedron_idx];
-    const int v0 = tetrahedron->vertices[0];
-    const int v1 = tetrahedron->vertices[1];
-    const int v2 = tetrahedron->vertices[2];
-    const int v3 = tetrahedron->vertices[3];
-    /* Get the coordinates of the vertex_indices of the tetrahedron */
-    const unsigned long aiy = d->integer_vertices[3 * v0 + 1];
-    const unsigned long aiz = d->integer_vertices[3 * v0 + 2];
-
-    const unsigned long bix = d->integer_vertices[3 * v1];
-    const unsigned long biy = d->integer_vertices[3 * v1 + 1];
-    const unsigned long biz = d->integer_vertices[3 * v1 + 2];
-
-    const unsigned long cix = d->integer_vertices[3 * v2];
-    const unsigned long ciy = d->integer_vertices[3 * v2 + 1];
-    const unsigned long ciz = d->integer_vertices[3 * v2 + 2];
-
-    const unsigned long dix = d->integer_vertices[3 * v3];
-    const unsigned long diy = d->integer_vertices[3 * v3 + 1];
-    const unsigned long diz = d->integer_vertices[3 * v3 + 2];
-
-    /* Get the coordinates of the test vertex */
-    const unsigned long eix = d->integer_vertices[3 * v];
-    const unsigned long eiy = d->integer_vertices[3 * v + 1];
-    const unsigned long eiz = d->integer_vertices[3 * v + 2];
+    instrumentation_count(&d->counters, INSTRUMENTATION_WALK_STEPS);
+    const int v0 = tetrahedron_get_vertex(&d->tetrahedra, tetrahedron_idx, 0);
+    const int v1 = tetrahedron_get_vertex(&d->tetrahedra, tetrahedron_idx, 1);
+    const int v2 = tetrahedron_get_vertex(&d->tetrahedra, tetrahedron_idx, 2);
+    const int v3 = tetrahedron_get_vertex(&d->tetrahedra, tetrahedron_idx, 3);
 
-#ifdef DELAUNAY_NONEXACT
-    // TODO get non-exact coordinates
-#endif
-
-    const unsigned long aix = d->integer_vertices[3 * v0];
 #ifdef DELAUNAY_CHECKS
     /* made sure the tetrahedron is correctly oriented */
-    if (geometry3d_orient_exact(&d->geometry, aix, aiy, aiz, bix, biy, biz, cix,
-                                ciy, ciz, dix, diy, diz) >= 0) {
+    if (delaunay_test_orientation(d, v0, v1, v2, v3) >= 0) {
       fprintf(stderr, "Incorrect orientation for tetrahedron %i!",
               tetrahedron_idx);
       abort();
@@ -597,36 +1313,32 @@ inline static int delaunay_find_tetrahedra_containing_vertex(
 #endif
     int non_axis_v_idx[2];
     /* Check whether the point is inside or outside all four faces */
-    const int test_abce =
-        geometry3d_orient_exact(&d->geometry, aix, aiy, aiz, bix, biy, biz, cix,
-                                ciy, ciz, eix, eiy, eiz);
+    const int test_abce = delaunay_test_orientation(d, v0, v1, v2, v);
     if (test_abce > 0) {
       /* v outside face opposite of v3 */
-      tetrahedron_idx = tetrahedron->neighbours[3];
+      tetrahedron_idx =
+          tetrahedron_get_neighbour(&d->tetrahedra, tetrahedron_idx, 3);
       continue;
     }
-    const int test_acde =
-        geometry3d_orient_exact(&d->geometry, aix, aiy, aiz, cix, ciy, ciz, dix,
-                                diy, diz, eix, eiy, eiz);
+    const int test_acde = delaunay_test_orientation(d, v0, v2, v3, v);
     if (test_acde > 0) {
       /* v outside face opposite of v1 */
-      tetrahedron_idx = tetrahedron->neighbours[1];
+      tetrahedron_idx =
+          tetrahedron_get_neighbour(&d->tetrahedra, tetrahedron_idx, 1);
       continue;
     }
-    const int test_adbe =
-        geometry3d_orient_exact(&d->geometry, aix, aiy, aiz, dix, diy, diz, bix,
-                                biy, biz, eix, eiy, eiz);
+    const int test_adbe = delaunay_test_orientation(d, v0, v3, v1, v);
     if (test_adbe > 0) {
       /* v outside face opposite of v2 */
-      tetrahedron_idx = tetrahedron->neighbours[2];
+      tetrahedron_idx =
+          tetrahedron_get_neighbour(&d->tetrahedra, tetrahedron_idx, 2);
       continue;
     }
-    const int test_bdce =
-        geometry3d_orient_exact(&d->geometry, bix, biy, biz, dix, diy, diz, cix,
-                                ciy, ciz, eix, eiy, eiz);
+    const int test_bdce = delaunay_test_orientation(d, v1, v3, v2, v);
     if (test_bdce > 0) {
       /* v outside face opposite of v0 */
-      tetrahedron_idx = tetrahedron->neighbours[0];
+      tetrahedron_idx =
+          tetrahedron_get_neighbour(&d->tetrahedra, tetrahedron_idx, 0);
       continue;
     }
 
@@ -636,25 +1348,29 @@ inline static int delaunay_find_tetrahedra_containing_vertex(
     if (test_abce == 0) {
       non_axis_v_idx[n_zero_tests] = 3;
       int_lifo_queue_push(&d->tetrahedra_containing_vertex,
-                          tetrahedron->neighbours[3]);
+                          tetrahedron_get_neighbour(&d->tetrahedra,
+                                                    tetrahedron_idx, 3));
       n_zero_tests++;
     }
     if (test_adbe == 0) {
       non_axis_v_idx[n_zero_tests] = 2;
       int_lifo_queue_push(&d->tetrahedra_containing_vertex,
-                          tetrahedron->neighbours[2]);
+                          tetrahedron_get_neighbour(&d->tetrahedra,
+                                                    tetrahedron_idx, 2));
       n_zero_tests++;
     }
     if (test_acde == 0) {
       non_axis_v_idx[n_zero_tests] = 1;
       int_lifo_queue_push(&d->tetrahedra_containing_vertex,
-                          tetrahedron->neighbours[1]);
+                          tetrahedron_get_neighbour(&d->tetrahedra,
+                                                    tetrahedron_idx, 1));
       n_zero_tests++;
     }
     if (test_bdce == 0) {
       non_axis_v_idx[n_zero_tests] = 0;
       int_lifo_queue_push(&d->tetrahedra_containing_vertex,
-                          tetrahedron->neighbours[0]);
+                          tetrahedron_get_neighbour(&d->tetrahedra,
+                                                    tetrahedron_idx, 0));
       n_zero_tests++;
     }
 
@@ -684,14 +1400,18 @@ inline static int delaunay_find_tetrahedra_containing_vertex(
           axis_idx1 != non_axis_idx1 && non_axis_idx0 != non_axis_idx1);
 
       /* a0 and a1 are the vertex_indices shared by all tetrahedra */
-      const int a0 = tetrahedron->vertices[axis_idx0];
-      const int a1 = tetrahedron->vertices[axis_idx1];
+      const int a0 =
+          tetrahedron_get_vertex(&d->tetrahedra, tetrahedron_idx, axis_idx0);
+      const int a1 =
+          tetrahedron_get_vertex(&d->tetrahedra, tetrahedron_idx, axis_idx1);
 
       /* We now walk around the axis and add all tetrahedra to the list of
        * tetrahedra containing v. */
       const int last_t = d->tetrahedra_containing_vertex.values[1];
       int next_t = d->tetrahedra_containing_vertex.values[2];
-      int next_vertex = tetrahedron->index_in_neighbour[non_axis_idx1];
+      int next_vertex = tetrahedron_get_index_in_neighbour(&d->tetrahedra,
+                                                           tetrahedron_idx,
+                                                           non_axis_idx1);
 
       /* We are going to add next_t and last_t back to the array of tetrahedra
        * containing v, but now with all other tetrahedra that also share the
@@ -700,20 +1420,22 @@ inline static int delaunay_find_tetrahedra_containing_vertex(
       while (next_t != last_t) {
         int_lifo_queue_push(&d->tetrahedra_containing_vertex, next_t);
         next_vertex = (next_vertex + 1) % 4;
-        if (d->tetrahedra[next_t].vertices[next_vertex] == a0 ||
-            d->tetrahedra[next_t].vertices[next_vertex] == a1) {
+        if (tetrahedron_get_vertex(&d->tetrahedra, next_t, next_vertex) == a0 ||
+            tetrahedron_get_vertex(&d->tetrahedra, next_t, next_vertex) == a1) {
           next_vertex = (next_vertex + 1) % 4;
         }
-        if (d->tetrahedra[next_t].vertices[next_vertex] == a0 ||
-            d->tetrahedra[next_t].vertices[next_vertex] == a1) {
+        if (tetrahedron_get_vertex(&d->tetrahedra, next_t, next_vertex) == a0 ||
+            tetrahedron_get_vertex(&d->tetrahedra, next_t, next_vertex) == a1) {
           next_vertex = (next_vertex + 1) % 4;
         }
-        delaunay_assert(d->tetrahedra[next_t].vertices[next_vertex] != a0 &&
-                        d->tetrahedra[next_t].vertices[next_vertex] != a1);
+        delaunay_assert(
+            tetrahedron_get_vertex(&d->tetrahedra, next_t, next_vertex) != a0 &&
+            tetrahedron_get_vertex(&d->tetrahedra, next_t, next_vertex) != a1);
 
         const int cur_vertex = next_vertex;
-        next_vertex = d->tetrahedra[next_t].index_in_neighbour[cur_vertex];
-        next_t = d->tetrahedra[next_t].neighbours[cur_vertex];
+        next_vertex = tetrahedron_get_index_in_neighbour(&d->tetrahedra, next_t,
+                                                         cur_vertex);
+        next_t = tetrahedron_get_neighbour(&d->tetrahedra, next_t, cur_vertex);
       }
       /* Don't forget to add back last_t (which was overwritten) */
       int_lifo_queue_push(&d->tetrahedra_containing_vertex, last_t);
@@ -748,18 +1470,24 @@ inline static int delaunay_find_tetrahedra_containing_vertex(
  */
 inline static void delaunay_one_to_four_flip(struct delaunay* d, int v, int t) {
   delaunay_log("Flipping tetrahedron %i to 4 new ones.", t);
+  instrumentation_count(&d->counters, INSTRUMENTATION_FLIP_1_TO_4);
 
   /* Extract necessary information */
   const int vertices[4] = {
-      d->tetrahedra[t].vertices[0], d->tetrahedra[t].vertices[1],
-      d->tetrahedra[t].vertices[2], d->tetrahedra[t].vertices[3]};
+      tetrahedron_get_vertex(&d->tetrahedra, t, 0),
+      tetrahedron_get_vertex(&d->tetrahedra, t, 1),
+      tetrahedron_get_vertex(&d->tetrahedra, t, 2),
+      tetrahedron_get_vertex(&d->tetrahedra, t, 3)};
   const int ngbs[4] = {
-      d->tetrahedra[t].neighbours[0], d->tetrahedra[t].neighbours[1],
-      d->tetrahedra[t].neighbours[2], d->tetrahedra[t].neighbours[3]};
-  const int idx_in_ngbs[4] = {d->tetrahedra[t].index_in_neighbour[0],
-                              d->tetrahedra[t].index_in_neighbour[1],
-                              d->tetrahedra[t].index_in_neighbour[2],
-                              d->tetrahedra[t].index_in_neighbour[3]};
+      tetrahedron_get_neighbour(&d->tetrahedra, t, 0),
+      tetrahedron_get_neighbour(&d->tetrahedra, t, 1),
+      tetrahedron_get_neighbour(&d->tetrahedra, t, 2),
+      tetrahedron_get_neighbour(&d->tetrahedra, t, 3)};
+  const int idx_in_ngbs[4] = {
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t, 0),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t, 1),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t, 2),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t, 3)};
 
   /* Replace t and create 3 new tetrahedra */
   delaunay_init_tetrahedron(d, t, vertices[0], vertices[1], vertices[2], v);
@@ -771,19 +1499,19 @@ inline static void delaunay_one_to_four_flip(struct delaunay* d, int v, int t) {
   delaunay_init_tetrahedron(d, t3, v, vertices[1], vertices[2], vertices[3]);
 
   /* update neighbour relations */
-  tetrahedron_swap_neighbours(&d->tetrahedra[t], t3, t2, t1, ngbs[3], 3, 3, 3,
+  tetrahedron_swap_neighbours(&d->tetrahedra, t, t3, t2, t1, ngbs[3], 3, 3, 3,
                               idx_in_ngbs[3]);
-  tetrahedron_swap_neighbours(&d->tetrahedra[t1], t3, t2, ngbs[2], t, 2, 2,
+  tetrahedron_swap_neighbours(&d->tetrahedra, t1, t3, t2, ngbs[2], t, 2, 2,
                               idx_in_ngbs[2], 2);
-  tetrahedron_swap_neighbours(&d->tetrahedra[t2], t3, ngbs[1], t1, t, 1,
+  tetrahedron_swap_neighbours(&d->tetrahedra, t2, t3, ngbs[1], t1, t, 1,
                               idx_in_ngbs[1], 1, 1);
-  tetrahedron_swap_neighbours(&d->tetrahedra[t3], ngbs[0], t2, t1, t,
+  tetrahedron_swap_neighbours(&d->tetrahedra, t3, ngbs[0], t2, t1, t,
                               idx_in_ngbs[0], 0, 0, 0);
 
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[0]], idx_in_ngbs[0], t3, 0);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[1]], idx_in_ngbs[1], t2, 1);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[2]], idx_in_ngbs[2], t1, 2);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[3]], idx_in_ngbs[3], t, 3);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[0], idx_in_ngbs[0], t3, 0);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[1], idx_in_ngbs[1], t2, 1);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[2], idx_in_ngbs[2], t1, 2);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[3], idx_in_ngbs[3], t, 3);
 
   /* enqueue all new/updated tetrahedra for delaunay checks */
   int_lifo_queue_push(&d->tetrahedra_to_check, t);
@@ -810,18 +1538,19 @@ inline static void delaunay_one_to_four_flip(struct delaunay* d, int v, int t) {
  */
 inline static void delaunay_two_to_six_flip(struct delaunay* d, int v,
                                             const int* t) {
+  instrumentation_count(&d->counters, INSTRUMENTATION_FLIP_2_TO_6);
   /* Find the indices of the vertex_indices of the common triangle in both
    * tetrahedra
    */
   int triangle_indices[2][3];
   int num_vertices = 0;
-  struct tetrahedron* t0 = &d->tetrahedra[t[0]];
-  struct tetrahedron* t1 = &d->tetrahedra[t[1]];
   for (int current_vertex_idx_in_t0 = 0; current_vertex_idx_in_t0 < 4;
        current_vertex_idx_in_t0++) {
     int test_idx = 0;
     while (test_idx < 4 &&
-           t0->vertices[current_vertex_idx_in_t0] != t1->vertices[test_idx]) {
+           tetrahedron_get_vertex(&d->tetrahedra, t[0],
+                                  current_vertex_idx_in_t0) !=
+               tetrahedron_get_vertex(&d->tetrahedra, t[1], test_idx)) {
       test_idx++;
     }
     if (test_idx < 4) {
@@ -857,27 +1586,31 @@ inline static void delaunay_two_to_six_flip(struct delaunay* d, int v,
   const int v0_1 = triangle_indices[1][0];
   const int v1_1 = triangle_indices[1][1];
   const int v3_1 = triangle_indices[1][2];
-  const int v4_1 = d->tetrahedra[t[0]].index_in_neighbour[v2_0];
+  const int v4_1 =
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t[0], v2_0);
 
   // now set some variables to the names in the documentation figure
   const int vert[6] = {
-      d->tetrahedra[t[0]].vertices[v0_0], d->tetrahedra[t[0]].vertices[v1_0],
-      d->tetrahedra[t[0]].vertices[v2_0], d->tetrahedra[t[0]].vertices[v3_0],
-      d->tetrahedra[t[1]].vertices[v4_1], v};
-
-  const int ngbs[6] = {d->tetrahedra[t[0]].neighbours[v0_0],
-                       d->tetrahedra[t[1]].neighbours[v0_1],
-                       d->tetrahedra[t[1]].neighbours[v1_1],
-                       d->tetrahedra[t[0]].neighbours[v1_0],
-                       d->tetrahedra[t[0]].neighbours[v3_0],
-                       d->tetrahedra[t[1]].neighbours[v3_1]};
-
-  const int idx_in_ngbs[6] = {d->tetrahedra[t[0]].index_in_neighbour[v0_0],
-                              d->tetrahedra[t[1]].index_in_neighbour[v0_1],
-                              d->tetrahedra[t[1]].index_in_neighbour[v1_1],
-                              d->tetrahedra[t[0]].index_in_neighbour[v1_0],
-                              d->tetrahedra[t[0]].index_in_neighbour[v3_0],
-                              d->tetrahedra[t[1]].index_in_neighbour[v3_1]};
+      tetrahedron_get_vertex(&d->tetrahedra, t[0], v0_0),
+      tetrahedron_get_vertex(&d->tetrahedra, t[0], v1_0),
+      tetrahedron_get_vertex(&d->tetrahedra, t[0], v2_0),
+      tetrahedron_get_vertex(&d->tetrahedra, t[0], v3_0),
+      tetrahedron_get_vertex(&d->tetrahedra, t[1], v4_1), v};
+
+  const int ngbs[6] = {tetrahedron_get_neighbour(&d->tetrahedra, t[0], v0_0),
+                       tetrahedron_get_neighbour(&d->tetrahedra, t[1], v0_1),
+                       tetrahedron_get_neighbour(&d->tetrahedra, t[1], v1_1),
+                       tetrahedron_get_neighbour(&d->tetrahedra, t[0], v1_0),
+                       tetrahedron_get_neighbour(&d->tetrahedra, t[0], v3_0),
+                       tetrahedron_get_neighbour(&d->tetrahedra, t[1], v3_1)};
+
+  const int idx_in_ngbs[6] = {
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t[0], v0_0),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t[1], v0_1),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t[1], v1_1),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t[0], v1_0),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t[0], v3_0),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t[1], v3_1)};
 
   /* Overwrite the two existing tetrahedra and create 4 new ones */
   delaunay_init_tetrahedron(d, t[0], vert[0], vert[1], vert[2], vert[5]);
@@ -892,25 +1625,25 @@ inline static void delaunay_two_to_six_flip(struct delaunay* d, int v,
   delaunay_init_tetrahedron(d, tn5, vert[5], vert[1], vert[3], vert[4]);
 
   /* Update neighbour relations */
-  tetrahedron_swap_neighbours(&d->tetrahedra[t[0]], tn2, t[1], tn3, ngbs[4], 3,
+  tetrahedron_swap_neighbours(&d->tetrahedra, t[0], tn2, t[1], tn3, ngbs[4], 3,
                               3, 3, idx_in_ngbs[4]);
-  tetrahedron_swap_neighbours(&d->tetrahedra[t[1]], tn2, ngbs[3], tn4, t[0], 1,
+  tetrahedron_swap_neighbours(&d->tetrahedra, t[1], tn2, ngbs[3], tn4, t[0], 1,
                               idx_in_ngbs[3], 3, 1);
-  tetrahedron_swap_neighbours(&d->tetrahedra[tn2], ngbs[0], t[1], tn5, t[0],
+  tetrahedron_swap_neighbours(&d->tetrahedra, tn2, ngbs[0], t[1], tn5, t[0],
                               idx_in_ngbs[0], 0, 3, 0);
-  tetrahedron_swap_neighbours(&d->tetrahedra[tn3], tn5, tn4, ngbs[5], t[0], 2,
+  tetrahedron_swap_neighbours(&d->tetrahedra, tn3, tn5, tn4, ngbs[5], t[0], 2,
                               2, idx_in_ngbs[5], 2);
-  tetrahedron_swap_neighbours(&d->tetrahedra[tn4], tn5, ngbs[2], tn3, t[1], 1,
+  tetrahedron_swap_neighbours(&d->tetrahedra, tn4, tn5, ngbs[2], tn3, t[1], 1,
                               idx_in_ngbs[2], 1, 2);
-  tetrahedron_swap_neighbours(&d->tetrahedra[tn5], ngbs[1], tn4, tn3, tn2,
+  tetrahedron_swap_neighbours(&d->tetrahedra, tn5, ngbs[1], tn4, tn3, tn2,
                               idx_in_ngbs[1], 0, 0, 2);
 
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[0]], idx_in_ngbs[0], tn2, 0);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[1]], idx_in_ngbs[1], tn5, 0);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[2]], idx_in_ngbs[2], tn4, 1);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[3]], idx_in_ngbs[3], t[1], 1);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[4]], idx_in_ngbs[4], t[0], 3);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[5]], idx_in_ngbs[5], tn3, 2);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[0], idx_in_ngbs[0], tn2, 0);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[1], idx_in_ngbs[1], tn5, 0);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[2], idx_in_ngbs[2], tn4, 1);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[3], idx_in_ngbs[3], t[1], 1);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[4], idx_in_ngbs[4], t[0], 3);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[5], idx_in_ngbs[5], tn3, 2);
 
   /* Add new/updated tetrahedra to queue for checking */
   int_lifo_queue_push(&d->tetrahedra_to_check, t[0]);
@@ -954,20 +1687,20 @@ inline static void delaunay_two_to_six_flip(struct delaunay* d, int v,
  */
 inline static void delaunay_n_to_2n_flip(struct delaunay* d, int v,
                                          const int* t, int n) {
+  instrumentation_count(&d->counters, INSTRUMENTATION_FLIP_N_TO_2N);
   /* find the indices of the common axis vertex_indices in all tetrahedra */
   int axis_idx_in_tj[n][2];
   int tn_min_1_idx_in_t0 = 0;
   int num_axis = 0;
-  struct tetrahedron* t0 = &d->tetrahedra[t[0]];
   for (int cur_v_idx_in_t0 = 0; cur_v_idx_in_t0 < 4; cur_v_idx_in_t0++) {
     int current_vertex_idx_in_tj[n];
     current_vertex_idx_in_tj[0] = cur_v_idx_in_t0;
     int current_vertex_is_axis = 1;
     for (int j = 1; j < n; ++j) {
-      struct tetrahedron* tj = &d->tetrahedra[t[j]];
       int test_idx = 0;
       while (test_idx < 4 &&
-             t0->vertices[cur_v_idx_in_t0] != tj->vertices[test_idx]) {
+             tetrahedron_get_vertex(&d->tetrahedra, t[0], cur_v_idx_in_t0) !=
+                 tetrahedron_get_vertex(&d->tetrahedra, t[j], test_idx)) {
         test_idx++;
       }
       current_vertex_is_axis &= (test_idx < 4);
@@ -1005,16 +1738,21 @@ inline static void delaunay_n_to_2n_flip(struct delaunay* d, int v,
   for (int j = 0; j < n; ++j) {
     const int tnext_in_tcur =
         6 - tprev_in_tcur - axis_idx_in_tj[j][0] - axis_idx_in_tj[j][1];
-    struct tetrahedron* tj = &d->tetrahedra[t[j]];
-    vert[j] = tj->vertices[tnext_in_tcur];
-    tprev_in_tcur = tj->index_in_neighbour[tnext_in_tcur];
-    ngbs[2 * j] = tj->neighbours[axis_idx_in_tj[j][0]];
-    ngbs[2 * j + 1] = tj->neighbours[axis_idx_in_tj[j][1]];
-    idx_in_ngb[2 * j] = tj->index_in_neighbour[axis_idx_in_tj[j][0]];
-    idx_in_ngb[2 * j + 1] = tj->index_in_neighbour[axis_idx_in_tj[j][1]];
-  }
-  vert[n] = d->tetrahedra[t[0]].vertices[axis_idx_in_tj[0][0]];
-  vert[n + 1] = d->tetrahedra[t[0]].vertices[axis_idx_in_tj[0][1]];
+    vert[j] = tetrahedron_get_vertex(&d->tetrahedra, t[j], tnext_in_tcur);
+    tprev_in_tcur =
+        tetrahedron_get_index_in_neighbour(&d->tetrahedra, t[j], tnext_in_tcur);
+    ngbs[2 * j] =
+        tetrahedron_get_neighbour(&d->tetrahedra, t[j], axis_idx_in_tj[j][0]);
+    ngbs[2 * j + 1] =
+        tetrahedron_get_neighbour(&d->tetrahedra, t[j], axis_idx_in_tj[j][1]);
+    idx_in_ngb[2 * j] = tetrahedron_get_index_in_neighbour(
+        &d->tetrahedra, t[j], axis_idx_in_tj[j][0]);
+    idx_in_ngb[2 * j + 1] = tetrahedron_get_index_in_neighbour(
+        &d->tetrahedra, t[j], axis_idx_in_tj[j][1]);
+  }
+  vert[n] = tetrahedron_get_vertex(&d->tetrahedra, t[0], axis_idx_in_tj[0][0]);
+  vert[n + 1] =
+      tetrahedron_get_vertex(&d->tetrahedra, t[0], axis_idx_in_tj[0][1]);
   vert[n + 2] = v;
 
   /* create n new tetrahedra and overwrite the n existing ones */
@@ -1048,10 +1786,10 @@ inline static void delaunay_n_to_2n_flip(struct delaunay* d, int v,
     int t_prev_upper = tn[(2 * (j - 1) + 2 * n) % (2 * n)];
     int t_ngb_upper = ngbs[2 * j + 1];
     int idx_in_t_ngb_upper = idx_in_ngb[2 * j + 1];
-    tetrahedron_swap_neighbours(&d->tetrahedra[tn0], t_next_upper, tn1,
+    tetrahedron_swap_neighbours(&d->tetrahedra, tn0, t_next_upper, tn1,
                                 t_prev_upper, t_ngb_upper, 2, 3, 0,
                                 idx_in_t_ngb_upper);
-    tetrahedron_swap_neighbour(&d->tetrahedra[t_ngb_upper], idx_in_t_ngb_upper,
+    tetrahedron_swap_neighbour(&d->tetrahedra, t_ngb_upper, idx_in_t_ngb_upper,
                                tn0, 3);
 
     /* Lower tetrahedron (see figure) */
@@ -1059,9 +1797,9 @@ inline static void delaunay_n_to_2n_flip(struct delaunay* d, int v,
     int t_prev_lower = tn[(2 * (j - 1) + 1 + 2 * n) % (2 * n)];
     int t_ngb_lower = ngbs[2 * j];
     int idx_in_t_ngb_lower = idx_in_ngb[2 * j];
-    tetrahedron_swap_neighbours(&d->tetrahedra[tn1], t_next_lower, t_ngb_lower,
+    tetrahedron_swap_neighbours(&d->tetrahedra, tn1, t_next_lower, t_ngb_lower,
                                 t_prev_lower, tn0, 2, idx_in_t_ngb_lower, 0, 1);
-    tetrahedron_swap_neighbour(&d->tetrahedra[t_ngb_lower], idx_in_t_ngb_lower,
+    tetrahedron_swap_neighbour(&d->tetrahedra, t_ngb_lower, idx_in_t_ngb_lower,
                                tn1, 1);
   }
 
@@ -1103,14 +1841,15 @@ inline static void delaunay_n_to_2n_flip(struct delaunay* d, int v,
 inline static void delaunay_two_to_three_flip(struct delaunay* restrict d,
                                               int t0, int t1, int top0,
                                               int top1) {
+  instrumentation_count(&d->counters, INSTRUMENTATION_FLIP_2_TO_3);
   /* get the indices of the common triangle of the tetrahedra, and make sure we
    * know which index in tetrahedron0 matches which index in tetrahedron1 */
   int triangle[2][3];
   for (int i = 0; i < 3; ++i) {
     triangle[0][i] = (top0 + i + 1) % 4;
     triangle[1][i] = 0;
-    while (d->tetrahedra[t0].vertices[triangle[0][i]] !=
-           d->tetrahedra[t1].vertices[triangle[1][i]]) {
+    while (tetrahedron_get_vertex(&d->tetrahedra, t0, triangle[0][i]) !=
+           tetrahedron_get_vertex(&d->tetrahedra, t1, triangle[1][i])) {
       ++triangle[1][i];
     }
   }
@@ -1140,21 +1879,27 @@ inline static void delaunay_two_to_three_flip(struct delaunay* restrict d,
 
   /* set some variables to the names used in the documentation figure */
   const int vert[5] = {
-      d->tetrahedra[t0].vertices[v0_0], d->tetrahedra[t0].vertices[v1_0],
-      d->tetrahedra[t0].vertices[v2_0], d->tetrahedra[t0].vertices[v3_0],
-      d->tetrahedra[t1].vertices[v4_1]};
+      tetrahedron_get_vertex(&d->tetrahedra, t0, v0_0),
+      tetrahedron_get_vertex(&d->tetrahedra, t0, v1_0),
+      tetrahedron_get_vertex(&d->tetrahedra, t0, v2_0),
+      tetrahedron_get_vertex(&d->tetrahedra, t0, v3_0),
+      tetrahedron_get_vertex(&d->tetrahedra, t1, v4_1)};
 
   const int ngbs[6] = {
-      d->tetrahedra[t0].neighbours[v0_0], d->tetrahedra[t1].neighbours[v0_1],
-      d->tetrahedra[t1].neighbours[v1_1], d->tetrahedra[t0].neighbours[v1_0],
-      d->tetrahedra[t0].neighbours[v3_0], d->tetrahedra[t1].neighbours[v3_1]};
-
-  const int idx_in_ngb[6] = {d->tetrahedra[t0].index_in_neighbour[v0_0],
-                             d->tetrahedra[t1].index_in_neighbour[v0_1],
-                             d->tetrahedra[t1].index_in_neighbour[v1_1],
-                             d->tetrahedra[t0].index_in_neighbour[v1_0],
-                             d->tetrahedra[t0].index_in_neighbour[v3_0],
-                             d->tetrahedra[t1].index_in_neighbour[v3_1]};
+      tetrahedron_get_neighbour(&d->tetrahedra, t0, v0_0),
+      tetrahedron_get_neighbour(&d->tetrahedra, t1, v0_1),
+      tetrahedron_get_neighbour(&d->tetrahedra, t1, v1_1),
+      tetrahedron_get_neighbour(&d->tetrahedra, t0, v1_0),
+      tetrahedron_get_neighbour(&d->tetrahedra, t0, v3_0),
+      tetrahedron_get_neighbour(&d->tetrahedra, t1, v3_1)};
+
+  const int idx_in_ngb[6] = {
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t0, v0_0),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t1, v0_1),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t1, v1_1),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t0, v1_0),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t0, v3_0),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t1, v3_1)};
 
   /* overwrite t0 and t1 and create a new tetrahedron */
   delaunay_init_tetrahedron(d, t0, vert[0], vert[1], vert[2], vert[4]);
@@ -1163,19 +1908,19 @@ inline static void delaunay_two_to_three_flip(struct delaunay* restrict d,
   delaunay_init_tetrahedron(d, t2, vert[4], vert[1], vert[2], vert[3]);
 
   /* fix neighbour relations */
-  tetrahedron_swap_neighbours(&d->tetrahedra[t0], t2, t1, ngbs[5], ngbs[4], 3,
+  tetrahedron_swap_neighbours(&d->tetrahedra, t0, t2, t1, ngbs[5], ngbs[4], 3,
                               3, idx_in_ngb[5], idx_in_ngb[4]);
-  tetrahedron_swap_neighbours(&d->tetrahedra[t1], t2, ngbs[3], ngbs[2], t0, 1,
+  tetrahedron_swap_neighbours(&d->tetrahedra, t1, t2, ngbs[3], ngbs[2], t0, 1,
                               idx_in_ngb[3], idx_in_ngb[2], 1);
-  tetrahedron_swap_neighbours(&d->tetrahedra[t2], ngbs[0], t1, ngbs[1], t0,
+  tetrahedron_swap_neighbours(&d->tetrahedra, t2, ngbs[0], t1, ngbs[1], t0,
                               idx_in_ngb[0], 0, idx_in_ngb[1], 0);
 
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[0]], idx_in_ngb[0], t2, 0);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[1]], idx_in_ngb[1], t2, 2);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[2]], idx_in_ngb[2], t1, 2);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[3]], idx_in_ngb[3], t1, 1);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[4]], idx_in_ngb[4], t0, 3);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[5]], idx_in_ngb[5], t0, 2);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[0], idx_in_ngb[0], t2, 0);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[1], idx_in_ngb[1], t2, 2);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[2], idx_in_ngb[2], t1, 2);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[3], idx_in_ngb[3], t1, 1);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[4], idx_in_ngb[4], t0, 3);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[5], idx_in_ngb[5], t0, 2);
 
   /* add new/updated tetrahedrons to queue */
   int_lifo_queue_push(&d->tetrahedra_to_check, t0);
@@ -1227,6 +1972,7 @@ inline static void delaunay_two_to_three_flip(struct delaunay* restrict d,
  */
 inline static void delaunay_four_to_four_flip(struct delaunay* restrict d,
                                               int t0, int t1, int t2, int t3) {
+  instrumentation_count(&d->counters, INSTRUMENTATION_FLIP_4_TO_4);
   /* the four tetrahedra share an axis, find the indices of the axis points
    * in the four tetrahedra */
   int axis[4][4];
@@ -1235,18 +1981,21 @@ inline static void delaunay_four_to_four_flip(struct delaunay* restrict d,
     int idx_in_t0, idx_in_t1, idx_in_t2, idx_in_t3;
     idx_in_t0 = i;
     idx_in_t1 = 0;
-    while (idx_in_t1 < 4 && d->tetrahedra[t0].vertices[idx_in_t0] !=
-                                d->tetrahedra[t1].vertices[idx_in_t1]) {
+    while (idx_in_t1 < 4 &&
+           tetrahedron_get_vertex(&d->tetrahedra, t0, idx_in_t0) !=
+               tetrahedron_get_vertex(&d->tetrahedra, t1, idx_in_t1)) {
       ++idx_in_t1;
     }
     idx_in_t2 = 0;
-    while (idx_in_t2 < 4 && d->tetrahedra[t0].vertices[idx_in_t0] !=
-                                d->tetrahedra[t2].vertices[idx_in_t2]) {
+    while (idx_in_t2 < 4 &&
+           tetrahedron_get_vertex(&d->tetrahedra, t0, idx_in_t0) !=
+               tetrahedron_get_vertex(&d->tetrahedra, t2, idx_in_t2)) {
       ++idx_in_t2;
     }
     idx_in_t3 = 0;
-    while (idx_in_t3 < 4 && d->tetrahedra[t0].vertices[idx_in_t0] !=
-                                d->tetrahedra[t3].vertices[idx_in_t3]) {
+    while (idx_in_t3 < 4 &&
+           tetrahedron_get_vertex(&d->tetrahedra, t0, idx_in_t0) !=
+               tetrahedron_get_vertex(&d->tetrahedra, t3, idx_in_t3)) {
       ++idx_in_t3;
     }
     if (idx_in_t1 < 4 && idx_in_t2 < 4 && idx_in_t3 < 4) {
@@ -1293,36 +2042,44 @@ inline static void delaunay_four_to_four_flip(struct delaunay* restrict d,
   /* t1 = (v0v1v3v4) */
   const int v0_1 = axis[1][0];
   const int v1_1 = axis[1][1];
-  const int v4_1 = d->tetrahedra[t0].index_in_neighbour[v2_0];
+  const int v4_1 = tetrahedron_get_index_in_neighbour(&d->tetrahedra, t0, v2_0);
 
   /* t2 = (v0v1v5v2) */
   const int v0_2 = axis[2][0];
   const int v1_2 = axis[2][1];
-  const int v5_2 = d->tetrahedra[t0].index_in_neighbour[v3_0];
+  const int v5_2 = tetrahedron_get_index_in_neighbour(&d->tetrahedra, t0, v3_0);
 
   /* t3 = (v0v5v1v4) */
   const int v0_3 = axis[3][0];
   const int v1_3 = axis[3][1];
 
   const int vert[6] = {
-      d->tetrahedra[t0].vertices[v0_0], d->tetrahedra[t0].vertices[v1_0],
-      d->tetrahedra[t0].vertices[v2_0], d->tetrahedra[t0].vertices[v3_0],
-      d->tetrahedra[t1].vertices[v4_1], d->tetrahedra[t2].vertices[v5_2]};
+      tetrahedron_get_vertex(&d->tetrahedra, t0, v0_0),
+      tetrahedron_get_vertex(&d->tetrahedra, t0, v1_0),
+      tetrahedron_get_vertex(&d->tetrahedra, t0, v2_0),
+      tetrahedron_get_vertex(&d->tetrahedra, t0, v3_0),
+      tetrahedron_get_vertex(&d->tetrahedra, t1, v4_1),
+      tetrahedron_get_vertex(&d->tetrahedra, t2, v5_2)};
 
   const int ngbs[8] = {
-      d->tetrahedra[t0].neighbours[v0_0], d->tetrahedra[t1].neighbours[v0_1],
-      d->tetrahedra[t1].neighbours[v1_1], d->tetrahedra[t0].neighbours[v1_0],
-      d->tetrahedra[t2].neighbours[v0_2], d->tetrahedra[t3].neighbours[v0_3],
-      d->tetrahedra[t3].neighbours[v1_3], d->tetrahedra[t2].neighbours[v1_2]};
-
-  const int idx_in_ngb[8] = {d->tetrahedra[t0].index_in_neighbour[v0_0],
-                             d->tetrahedra[t1].index_in_neighbour[v0_1],
-                             d->tetrahedra[t1].index_in_neighbour[v1_1],
-                             d->tetrahedra[t0].index_in_neighbour[v1_0],
-                             d->tetrahedra[t2].index_in_neighbour[v0_2],
-                             d->tetrahedra[t3].index_in_neighbour[v0_3],
-                             d->tetrahedra[t3].index_in_neighbour[v1_3],
-                             d->tetrahedra[t2].index_in_neighbour[v1_2]};
+      tetrahedron_get_neighbour(&d->tetrahedra, t0, v0_0),
+      tetrahedron_get_neighbour(&d->tetrahedra, t1, v0_1),
+      tetrahedron_get_neighbour(&d->tetrahedra, t1, v1_1),
+      tetrahedron_get_neighbour(&d->tetrahedra, t0, v1_0),
+      tetrahedron_get_neighbour(&d->tetrahedra, t2, v0_2),
+      tetrahedron_get_neighbour(&d->tetrahedra, t3, v0_3),
+      tetrahedron_get_neighbour(&d->tetrahedra, t3, v1_3),
+      tetrahedron_get_neighbour(&d->tetrahedra, t2, v1_2)};
+
+  const int idx_in_ngb[8] = {
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t0, v0_0),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t1, v0_1),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t1, v1_1),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t0, v1_0),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t2, v0_2),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t3, v0_3),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t3, v1_3),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t2, v1_2)};
 
   /* Replace the tetrahedra */
   /* t0 becomes (v0v3v5v2) */
@@ -1335,23 +2092,23 @@ inline static void delaunay_four_to_four_flip(struct delaunay* restrict d,
   delaunay_init_tetrahedron(d, t3, vert[1], vert[3], vert[5], vert[4]);
 
   /* Setup neighbour information */
-  tetrahedron_swap_neighbours(&d->tetrahedra[t0], t1, ngbs[7], ngbs[3], t2, 0,
+  tetrahedron_swap_neighbours(&d->tetrahedra, t0, t1, ngbs[7], ngbs[3], t2, 0,
                               idx_in_ngb[7], idx_in_ngb[3], 3);
-  tetrahedron_swap_neighbours(&d->tetrahedra[t1], t0, ngbs[0], ngbs[4], t3, 0,
+  tetrahedron_swap_neighbours(&d->tetrahedra, t1, t0, ngbs[0], ngbs[4], t3, 0,
                               idx_in_ngb[0], idx_in_ngb[4], 3);
-  tetrahedron_swap_neighbours(&d->tetrahedra[t2], t3, ngbs[2], ngbs[6], t0, 0,
+  tetrahedron_swap_neighbours(&d->tetrahedra, t2, t3, ngbs[2], ngbs[6], t0, 0,
                               idx_in_ngb[2], idx_in_ngb[6], 3);
-  tetrahedron_swap_neighbours(&d->tetrahedra[t3], t2, ngbs[5], ngbs[1], t1, 0,
+  tetrahedron_swap_neighbours(&d->tetrahedra, t3, t2, ngbs[5], ngbs[1], t1, 0,
                               idx_in_ngb[5], idx_in_ngb[1], 3);
 
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[0]], idx_in_ngb[0], t1, 1);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[1]], idx_in_ngb[1], t3, 2);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[2]], idx_in_ngb[2], t2, 1);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[3]], idx_in_ngb[3], t0, 2);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[4]], idx_in_ngb[4], t1, 2);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[5]], idx_in_ngb[5], t3, 1);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[6]], idx_in_ngb[6], t2, 2);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[7]], idx_in_ngb[7], t0, 1);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[0], idx_in_ngb[0], t1, 1);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[1], idx_in_ngb[1], t3, 2);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[2], idx_in_ngb[2], t2, 1);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[3], idx_in_ngb[3], t0, 2);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[4], idx_in_ngb[4], t1, 2);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[5], idx_in_ngb[5], t3, 1);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[6], idx_in_ngb[6], t2, 2);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[7], idx_in_ngb[7], t0, 1);
 
   /* append updated tetrahedra to queue for checking */
   int_lifo_queue_push(&d->tetrahedra_to_check, t0);
@@ -1399,19 +2156,22 @@ inline static void delaunay_four_to_four_flip(struct delaunay* restrict d,
  */
 inline static int delaunay_three_to_two_flip(struct delaunay* restrict d,
                                              int t0, int t1, int t2) {
+  instrumentation_count(&d->counters, INSTRUMENTATION_FLIP_3_TO_2);
   /* get the common axis of the three tetrahedra */
   int axis[3][4];
   int num_axis = 0;
   for (int i = 0; i < 4; ++i) {
     int idx_in_t0 = i;
     int idx_in_t1 = 0;
-    while (idx_in_t1 < 4 && d->tetrahedra[t0].vertices[idx_in_t0] !=
-                                d->tetrahedra[t1].vertices[idx_in_t1]) {
+    while (idx_in_t1 < 4 &&
+           tetrahedron_get_vertex(&d->tetrahedra, t0, idx_in_t0) !=
+               tetrahedron_get_vertex(&d->tetrahedra, t1, idx_in_t1)) {
       ++idx_in_t1;
     }
     int idx_in_t2 = 0;
-    while (idx_in_t2 < 4 && d->tetrahedra[t0].vertices[idx_in_t0] !=
-                                d->tetrahedra[t2].vertices[idx_in_t2]) {
+    while (idx_in_t2 < 4 &&
+           tetrahedron_get_vertex(&d->tetrahedra, t0, idx_in_t0) !=
+               tetrahedron_get_vertex(&d->tetrahedra, t2, idx_in_t2)) {
       ++idx_in_t2;
     }
     if (idx_in_t1 < 4 && idx_in_t2 < 4) {
@@ -1446,7 +2206,7 @@ inline static int delaunay_three_to_two_flip(struct delaunay* restrict d,
   const int v4_0 = axis[0][1];
 
   const int v2_1 = axis[1][0];
-  const int v3_1 = d->tetrahedra[t0].index_in_neighbour[v1_0];
+  const int v3_1 = tetrahedron_get_index_in_neighbour(&d->tetrahedra, t0, v1_0);
   const int v4_1 = axis[1][1];
 
   const int v2_2 = axis[2][0];
@@ -1454,40 +2214,46 @@ inline static int delaunay_three_to_two_flip(struct delaunay* restrict d,
 
   /* set some variables to the names used in the documentation figure */
   const int vert[5] = {
-      d->tetrahedra[t0].vertices[v0_0], d->tetrahedra[t0].vertices[v1_0],
-      d->tetrahedra[t0].vertices[v2_0], d->tetrahedra[t1].vertices[v3_1],
-      d->tetrahedra[t0].vertices[v4_0],
+      tetrahedron_get_vertex(&d->tetrahedra, t0, v0_0),
+      tetrahedron_get_vertex(&d->tetrahedra, t0, v1_0),
+      tetrahedron_get_vertex(&d->tetrahedra, t0, v2_0),
+      tetrahedron_get_vertex(&d->tetrahedra, t1, v3_1),
+      tetrahedron_get_vertex(&d->tetrahedra, t0, v4_0),
   };
 
   const int ngbs[6] = {
-      d->tetrahedra[t2].neighbours[v4_2], d->tetrahedra[t2].neighbours[v2_2],
-      d->tetrahedra[t1].neighbours[v2_1], d->tetrahedra[t1].neighbours[v4_1],
-      d->tetrahedra[t0].neighbours[v4_0], d->tetrahedra[t0].neighbours[v2_0]};
-
-  const int idx_in_ngb[6] = {d->tetrahedra[t2].index_in_neighbour[v4_2],
-                             d->tetrahedra[t2].index_in_neighbour[v2_2],
-                             d->tetrahedra[t1].index_in_neighbour[v2_1],
-                             d->tetrahedra[t1].index_in_neighbour[v4_1],
-                             d->tetrahedra[t0].index_in_neighbour[v4_0],
-                             d->tetrahedra[t0].index_in_neighbour[v2_0]};
+      tetrahedron_get_neighbour(&d->tetrahedra, t2, v4_2),
+      tetrahedron_get_neighbour(&d->tetrahedra, t2, v2_2),
+      tetrahedron_get_neighbour(&d->tetrahedra, t1, v2_1),
+      tetrahedron_get_neighbour(&d->tetrahedra, t1, v4_1),
+      tetrahedron_get_neighbour(&d->tetrahedra, t0, v4_0),
+      tetrahedron_get_neighbour(&d->tetrahedra, t0, v2_0)};
+
+  const int idx_in_ngb[6] = {
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t2, v4_2),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t2, v2_2),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t1, v2_1),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t1, v4_1),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t0, v4_0),
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t0, v2_0)};
 
   /* Overwrite two new tetrahedra and free the third one. */
   delaunay_init_tetrahedron(d, t0, vert[0], vert[1], vert[2], vert[3]);
   delaunay_init_tetrahedron(d, t1, vert[0], vert[1], vert[3], vert[4]);
   delaunay_log("Deactivating tetrahedron %i", t2);
-  tetrahedron_deactivate(&d->tetrahedra[t2]);
+  tetrahedron_deactivate(&d->tetrahedra, t2);
 
   /* update neighbour relations */
-  tetrahedron_swap_neighbours(&d->tetrahedra[t0], ngbs[0], ngbs[3], t1, ngbs[4],
+  tetrahedron_swap_neighbours(&d->tetrahedra, t0, ngbs[0], ngbs[3], t1, ngbs[4],
                               idx_in_ngb[0], idx_in_ngb[3], 3, idx_in_ngb[4]);
-  tetrahedron_swap_neighbours(&d->tetrahedra[t1], ngbs[1], ngbs[2], ngbs[5], t0,
+  tetrahedron_swap_neighbours(&d->tetrahedra, t1, ngbs[1], ngbs[2], ngbs[5], t0,
                               idx_in_ngb[1], idx_in_ngb[2], idx_in_ngb[5], 2);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[0]], idx_in_ngb[0], t0, 0);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[1]], idx_in_ngb[1], t1, 0);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[2]], idx_in_ngb[2], t1, 1);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[3]], idx_in_ngb[3], t0, 1);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[4]], idx_in_ngb[4], t0, 3);
-  tetrahedron_swap_neighbour(&d->tetrahedra[ngbs[5]], idx_in_ngb[5], t1, 2);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[0], idx_in_ngb[0], t0, 0);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[1], idx_in_ngb[1], t1, 0);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[2], idx_in_ngb[2], t1, 1);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[3], idx_in_ngb[3], t0, 1);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[4], idx_in_ngb[4], t0, 3);
+  tetrahedron_swap_neighbour(&d->tetrahedra, ngbs[5], idx_in_ngb[5], t1, 2);
 
   /* add updated tetrahedra to queue */
   int_lifo_queue_push(&d->tetrahedra_to_check, t0);
@@ -1504,31 +2270,25 @@ inline static int delaunay_three_to_two_flip(struct delaunay* restrict d,
  * @param v The new vertex that might cause invalidation of tetrahedra.
  */
 inline static void delaunay_check_tetrahedra(struct delaunay* d, int v) {
-  int n_freed = 0;
-  int* freed = (int*)malloc(10 * sizeof(int));
-  int freed_size = 10;
+  delaunay_assert(int_lifo_queue_is_empty(&d->freed_tetrahedra));
   int freed_tetrahedron;
   int t = get_next_tetrahedron_to_check(d);
   while (t >= 0) {
     freed_tetrahedron = delaunay_check_tetrahedron(d, t, v);
     /* Did we free a tetrahedron? */
     if (freed_tetrahedron >= 0) {
-      if (n_freed >= freed_size) {
-        /* Grow array */
-        freed_size <<= 1;
-        freed = (int*)realloc(freed, freed_size * sizeof(int));
-      }
-      freed[n_freed] = freed_tetrahedron;
-      n_freed++;
+      int_lifo_queue_push(&d->freed_tetrahedra, freed_tetrahedron);
     }
     /* Pop next tetrahedron to check */
     t = get_next_tetrahedron_to_check(d);
   }
-  /* Enqueue the newly freed tetrahedra indices */
-  for (int i = 0; i < n_freed; i++) {
-    int_lifo_queue_push(&d->free_tetrahedron_indices, freed[i]);
+  /* Enqueue the newly freed tetrahedra indices (in the order in which they
+     were freed) */
+  struct int_lifo_queue* freed = &d->freed_tetrahedra;
+  for (int i = 0; i < freed->index; i++) {
+    int_lifo_queue_push(&d->free_tetrahedron_indices, freed->values[i]);
   }
-  free(freed);
+  int_lifo_queue_reset(freed);
 }
 
 /**
@@ -1546,21 +2306,16 @@ inline static void delaunay_check_tetrahedra(struct delaunay* d, int v) {
  */
 inline static int delaunay_check_tetrahedron(struct delaunay* d, const int t,
                                              const int v) {
-  struct tetrahedron* tetrahedron = &d->tetrahedra[t];
-  const int v0 = tetrahedron->vertices[0];
-  const int v1 = tetrahedron->vertices[1];
-  const int v2 = tetrahedron->vertices[2];
-  const int v3 = tetrahedron->vertices[3];
 
   /* Determine which vertex is the newly added vertex */
   int top;
-  if (v == v0) {
+  if (v == tetrahedron_get_vertex(&d->tetrahedra, t, 0)) {
     top = 0;
-  } else if (v == v1) {
+  } else if (v == tetrahedron_get_vertex(&d->tetrahedra, t, 1)) {
     top = 1;
-  } else if (v == v2) {
+  } else if (v == tetrahedron_get_vertex(&d->tetrahedra, t, 2)) {
     top = 2;
-  } else if (v == v3) {
+  } else if (v == tetrahedron_get_vertex(&d->tetrahedra, t, 3)) {
     top = 3;
   } else {
     fprintf(stderr,
@@ -1570,66 +2325,68 @@ inline static int delaunay_check_tetrahedron(struct delaunay* d, const int t,
     abort();
   }
 
+  int freed;
+  delaunay_check_tetrahedron_face(d, t, top, &freed);
+  return freed;
+}
+
+/**
+ * @brief Check if the given tetrahedron and its neighbour opposite the given
+ * vertex satisfy the empty circumsphere criterion.
+ *
+ * If this check fails, this function also performs the necessary flip (if
+ * possible). All new tetrahedra created by this function are pushed to the
+ * queue for checking.
+ *
+ * @param d Delaunay tessellation
+ * @param t The tetrahedron to check.
+ * @param top Index of the vertex of t opposite the face to check.
+ * @param freed (Returned) Index of freed tetrahedron, or negative if no
+ * tetrahedra are freed.
+ * @return 0 if the face is valid, 1 if a flip was performed, -1 if the face
+ * is invalid but could not be flipped (yet).
+ */
+inline static int delaunay_check_tetrahedron_face(struct delaunay* d,
+                                                  const int t, const int top,
+                                                  int* freed) {
+  const int v0 = tetrahedron_get_vertex(&d->tetrahedra, t, 0);
+  const int v1 = tetrahedron_get_vertex(&d->tetrahedra, t, 1);
+  const int v2 = tetrahedron_get_vertex(&d->tetrahedra, t, 2);
+  const int v3 = tetrahedron_get_vertex(&d->tetrahedra, t, 3);
+  const int v = tetrahedron_get_vertex(&d->tetrahedra, t, top);
+  *freed = -1;
+
   /* Get neighbouring tetrahedron opposite of newly added vertex */
-  const int ngb = tetrahedron->neighbours[top];
-  const int idx_in_ngb = tetrahedron->index_in_neighbour[top];
+  const int ngb = tetrahedron_get_neighbour(&d->tetrahedra, t, top);
+  const int idx_in_ngb =
+      tetrahedron_get_index_in_neighbour(&d->tetrahedra, t, top);
   /* Get the vertex in the neighbouring tetrahedron opposite of t */
-  const int v4 = d->tetrahedra[ngb].vertices[idx_in_ngb];
+  const int v4 = tetrahedron_get_vertex(&d->tetrahedra, ngb, idx_in_ngb);
 
   /* check if we have a neighbour that can be checked (dummies are not real and
      should not be tested) */
-  if (ngb < 4) {
+  if (ngb < d->tetrahedron_start) {
     delaunay_log("Dummy neighbour! Skipping checks for %i...", t);
     delaunay_assert(v4 == -1);
-    return -1;
+    return 0;
   }
 
-  /* Get the coordinates of all vertex_indices */
-#ifdef DELAUNAY_NONEXACT
-  // TODO
-#endif
-  const unsigned long aix = d->integer_vertices[3 * v0];
-  const unsigned long aiy = d->integer_vertices[3 * v0 + 1];
-  const unsigned long aiz = d->integer_vertices[3 * v0 + 2];
-
-  const unsigned long bix = d->integer_vertices[3 * v1];
-  const unsigned long biy = d->integer_vertices[3 * v1 + 1];
-  const unsigned long biz = d->integer_vertices[3 * v1 + 2];
-
-  const unsigned long cix = d->integer_vertices[3 * v2];
-  const unsigned long ciy = d->integer_vertices[3 * v2 + 1];
-  const unsigned long ciz = d->integer_vertices[3 * v2 + 2];
-
-  const unsigned long dix = d->integer_vertices[3 * v3];
-  const unsigned long diy = d->integer_vertices[3 * v3 + 1];
-  const unsigned long diz = d->integer_vertices[3 * v3 + 2];
-
-  const unsigned long eix = d->integer_vertices[3 * v4];
-  const unsigned long eiy = d->integer_vertices[3 * v4 + 1];
-  const unsigned long eiz = d->integer_vertices[3 * v4 + 2];
-
-  const int test =
-      geometry3d_in_sphere_exact(&d->geometry, aix, aiy, aiz, bix, biy, biz,
-                                 cix, ciy, ciz, dix, diy, diz, eix, eiy, eiz);
+  const int test = delaunay_test_in_sphere(d, v0, v1, v2, v3, v4);
   if (test < 0) {
     delaunay_log("Tetrahedron %i was invalidated by adding vertex %i", t, v);
     /* Figure out which flip is needed to restore the tetrahedra */
     int tests[4] = {-1, -1, -1, -1};
     if (top != 3) {
-      tests[0] = geometry3d_orient_exact(&d->geometry, aix, aiy, aiz, bix, biy,
-                                         biz, cix, ciy, ciz, eix, eiy, eiz);
+      tests[0] = delaunay_test_orientation(d, v0, v1, v2, v4);
     }
     if (top != 2) {
-      tests[1] = geometry3d_orient_exact(&d->geometry, aix, aiy, aiz, bix, biy,
-                                         biz, eix, eiy, eiz, dix, diy, diz);
+      tests[1] = delaunay_test_orientation(d, v0, v1, v4, v3);
     }
     if (top != 1) {
-      tests[2] = geometry3d_orient_exact(&d->geometry, aix, aiy, aiz, eix, eiy,
-                                         eiz, cix, ciy, ciz, dix, diy, diz);
+      tests[2] = delaunay_test_orientation(d, v0, v4, v2, v3);
     }
     if (top != 0) {
-      tests[3] = geometry3d_orient_exact(&d->geometry, eix, eiy, eiz, bix, biy,
-                                         biz, cix, ciy, ciz, dix, diy, diz);
+      tests[3] = delaunay_test_orientation(d, v4, v1, v2, v3);
     }
     int i;
     for (i = 0; i < 4 && tests[i] < 0; ++i) {
@@ -1638,6 +2395,7 @@ inline static int delaunay_check_tetrahedron(struct delaunay* d, const int t,
       /* v4 inside sphere around v1, v2 and v4: need to do a 2 to 3 flip */
       delaunay_log("Performing 2 to 3 flip with %i and %i", t, ngb);
       delaunay_two_to_three_flip(d, t, ngb, top, idx_in_ngb);
+      return 1;
     } else if (tests[i] == 0) {
       /* degenerate case: possible 4 to 4 flip needed. The line that connects v
        * and v4 intersects an edge of the triangle formed by the other 3
@@ -1650,24 +2408,27 @@ inline static int delaunay_check_tetrahedron(struct delaunay* d, const int t,
        * orientation test */
       const int non_axis = 3 - i;
       /* get the other involved neighbour of t */
-      const int other_ngb = d->tetrahedra[t].neighbours[non_axis];
+      const int other_ngb =
+          tetrahedron_get_neighbour(&d->tetrahedra, t, non_axis);
       /* get the index of 'new_vertex' in 'other_ngb', as the neighbour
        * opposite that vertex is the other neighbour we need to check */
       int idx_v_in_other_ngb;
       for (idx_v_in_other_ngb = 0;
            idx_v_in_other_ngb < 4 &&
-           d->tetrahedra[other_ngb].vertices[idx_v_in_other_ngb] != v;
+               tetrahedron_get_vertex(&d->tetrahedra, other_ngb,
+                                      idx_v_in_other_ngb) != v;
            idx_v_in_other_ngb++) {
       }
-      const int other_ngbs_ngb =
-          d->tetrahedra[other_ngb].neighbours[idx_v_in_other_ngb];
+      const int other_ngbs_ngb = tetrahedron_get_neighbour(
+          &d->tetrahedra, other_ngb, idx_v_in_other_ngb);
       /* check if other_ngbs_ngb is also a neighbour of ngb. */
       int second_idx_in_ngb =
-          tetrahedron_is_neighbour(&d->tetrahedra[ngb], other_ngbs_ngb);
+          tetrahedron_is_neighbour(&d->tetrahedra, ngb, other_ngbs_ngb);
       if (second_idx_in_ngb < 4) {
         delaunay_log("Performing 4 to 4 flip between %i, %i, %i and %i!", t,
                      other_ngb, ngb, other_ngbs_ngb);
         delaunay_four_to_four_flip(d, t, other_ngb, ngb, other_ngbs_ngb);
+        return 1;
       } else {
         delaunay_log("4 to 4 with %i and %i flip not possible!", t, ngb);
       }
@@ -1687,60 +2448,287 @@ inline static int delaunay_check_tetrahedron(struct delaunay* d, const int t,
        * orientation test */
       const int non_axis = 3 - i;
       /* get the other involved neighbour of t */
-      const int other_ngb = d->tetrahedra[t].neighbours[non_axis];
+      const int other_ngb =
+          tetrahedron_get_neighbour(&d->tetrahedra, t, non_axis);
       /* check if other_ngb is also a neigbour of ngb */
       const int other_ngb_idx_in_ngb =
-          tetrahedron_is_neighbour(&d->tetrahedra[ngb], other_ngb);
+          tetrahedron_is_neighbour(&d->tetrahedra, ngb, other_ngb);
       if (other_ngb_idx_in_ngb < 4) {
         delaunay_log("Performing 3 to 2 flip with %i, %i and %i!", t, ngb,
                      other_ngb);
-        return delaunay_three_to_two_flip(d, t, ngb, other_ngb);
+        *freed = delaunay_three_to_two_flip(d, t, ngb, other_ngb);
+        return 1;
       } else {
         delaunay_log("3 to 2 with %i and %i flip not possible!", t, ngb);
       }
     }
+    return -1;
   } else {
     delaunay_log("Tetrahedron %i is valid!", t)
   }
-  return -1;
+  return 0;
 }
 
 /**
- * @brief Get the radius of the circumsphere of the given tetrahedron.
+ * @brief Collect all tetrahedra that contain the given vertex in
+ * d->tetrahedra_containing_vertex.
+ *
+ * Starting from the tetrahedron linked to the vertex, the neighbours across
+ * all faces that contain the vertex are visited. A vertex is only part of a
+ * few tens of tetrahedra, so that a linear search is enough to avoid visiting
+ * them twice.
+ *
+ * @param d Delaunay tessellation.
+ * @param v Index of the vertex.
+ */
+inline static void delaunay_get_vertex_tetrahedra(struct delaunay* restrict d,
+                                                  int v) {
+  struct int_lifo_queue* star = &d->tetrahedra_containing_vertex;
+  int_lifo_queue_reset(star);
+  int_lifo_queue_push(star, d->vertex_tetrahedron_links[v]);
+  for (int i = 0; i < star->index; i++) {
+    const int t = star->values[i];
+    for (int j = 0; j < 4; j++) {
+      if (tetrahedron_get_vertex(&d->tetrahedra, t, j) == v) continue;
+      const int ngb = tetrahedron_get_neighbour(&d->tetrahedra, t, j);
+      if (ngb < d->tetrahedron_start) continue;
+      int k = 0;
+      while (k < star->index && star->values[k] != ngb) k++;
+      if (k == star->index) {
+        int_lifo_queue_push(star, ngb);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Restore the Delaunay tessellation after some of its vertices were
+ * moved using delaunay_move_vertex().
+ *
+ * As long as the moved vertices did not cross the faces of any of their
+ * tetrahedra, the tessellation is still a valid (but in general no longer
+ * Delaunay) tetrahedralisation. It can then be repaired using the same 2 to 3,
+ * 3 to 2 and 4 to 4 flips used when adding new vertices (Lawson's flip
+ * algorithm). Every flip lowers the lifted tessellation, so that this is
+ * guaranteed to finish. Invalid faces that cannot be flipped yet are checked
+ * again after the other tetrahedra have been processed.
+ *
+ * Only the tetrahedra around the moved vertices (and around the periodic
+ * ghosts of moved vertices) can have changed, so only these are checked and
+ * only their cached circumcenters are invalidated. Every tetrahedron is
+ * handled once, by the moved vertex with the lowest index it contains. The
+ * work is hence proportional to the number of moved vertices, apart from a
+ * pass over the periodic ghosts (if any) to find the ghosts that moved.
+ *
+ * If some tetrahedron is no longer positively oriented, or if none of the
+ * remaining invalid faces can be flipped, the tessellation cannot be repaired
+ * and has to be reconstructed from scratch.
+ *
+ * @param d Delaunay tessellation.
+ * @return 1 if the tessellation was repaired, 0 if it has to be
+ * reconstructed.
+ */
+inline static int delaunay_repair(struct delaunay* restrict d) {
+  struct int_lifo_queue* moved = &d->moved_vertices;
+  /* a compacted tessellation cannot be changed (see delaunay_compact()) */
+  if (d->compact) {
+    int_lifo_queue_reset(moved);
+    return 0;
+  }
+
+  /* flag the moved vertices (only once, a vertex can be moved more than once)
+   */
+  int* flags = d->get_radius_neighbour_flags;
+  int nmoved = 0;
+  for (int i = 0; i < moved->index; i++) {
+    const int v = moved->values[i];
+    if (!flags[v]) {
+      flags[v] = 1;
+      moved->values[nmoved++] = v;
+    }
+  }
+  moved->index = nmoved;
+  /* periodic ghosts move with the vertex they are a copy of */
+  if (d->periodic_shift_count > 0) {
+    for (int v = d->ghost_offset; v < d->vertex_index; v++) {
+      if (flags[d->ghost_vertices[v - d->ghost_offset]]) {
+        flags[v] = 1;
+        int_lifo_queue_push(moved, v);
+      }
+    }
+  }
+
+  /* check that no vertex crossed a face of one of its tetrahedra, and queue
+   * the tetrahedra around the moved vertices */
+  int_lifo_queue_reset(&d->tetrahedra_to_check);
+  int success = 1;
+  for (int i = 0; i < moved->index && success; i++) {
+    const int v = moved->values[i];
+    delaunay_get_vertex_tetrahedra(d, v);
+    for (int k = 0; k < d->tetrahedra_containing_vertex.index; k++) {
+      const int t = d->tetrahedra_containing_vertex.values[k];
+      int vt[4];
+      int lowest = 1;
+      for (int j = 0; j < 4; j++) {
+        vt[j] = tetrahedron_get_vertex(&d->tetrahedra, t, j);
+        if (vt[j] < v && flags[vt[j]]) lowest = 0;
+      }
+      if (!lowest) continue;
+#ifdef DELAUNAY_CACHE_CIRCUMCENTERS
+      d->circumcenters[4 * t + 3] = -1.;
+#endif
+      if (delaunay_test_orientation(d, vt[0], vt[1], vt[2], vt[3]) >= 0) {
+        delaunay_log("Tetrahedron %i was inverted by moving its vertices!", t);
+        success = 0;
+        break;
+      }
+      int_lifo_queue_push(&d->tetrahedra_to_check, t);
+    }
+  }
+  for (int i = 0; i < moved->index; i++) {
+    flags[moved->values[i]] = 0;
+  }
+  int_lifo_queue_reset(moved);
+  if (!success) return 0;
+
+  /* the faces that cannot be flipped yet are collected in
+   * tetrahedra_containing_vertex, which is not used by the flips */
+  struct int_lifo_queue* freed = &d->freed_tetrahedra;
+  struct int_lifo_queue* unresolved = &d->tetrahedra_containing_vertex;
+  delaunay_assert(int_lifo_queue_is_empty(freed));
+  int_lifo_queue_reset(unresolved);
+  while (1) {
+    int n_flips = 0;
+    int t = get_next_tetrahedron_to_check(d);
+    while (t >= 0) {
+      int is_unresolved = 0;
+      for (int top = 0; top < 4; top++) {
+        int freed_tetrahedron;
+        const int result =
+            delaunay_check_tetrahedron_face(d, t, top, &freed_tetrahedron);
+        if (result > 0) {
+          /* t was changed by the flip and has been queued again (if it is
+           * still active) */
+          n_flips++;
+          is_unresolved = 0;
+          if (freed_tetrahedron >= 0) {
+            int_lifo_queue_push(freed, freed_tetrahedron);
+          }
+          break;
+        } else if (result < 0) {
+          is_unresolved = 1;
+        }
+      }
+      if (is_unresolved) {
+        int_lifo_queue_push(unresolved, t);
+      }
+      t = get_next_tetrahedron_to_check(d);
+    }
+    /* freed tetrahedra can only be reused once no more references to them are
+     * queued */
+    while (!int_lifo_queue_is_empty(freed)) {
+      int_lifo_queue_push(&d->free_tetrahedron_indices,
+                          int_lifo_queue_pop(freed));
+    }
+    if (int_lifo_queue_is_empty(unresolved)) break;
+    if (n_flips == 0) {
+      delaunay_log("Unable to repair the tessellation by flipping!");
+      success = 0;
+      break;
+    }
+    /* check the faces that could not be flipped before again */
+    while (!int_lifo_queue_is_empty(unresolved)) {
+      int_lifo_queue_push(&d->tetrahedra_to_check,
+                          int_lifo_queue_pop(unresolved));
+    }
+  }
+  int_lifo_queue_reset(unresolved);
+
+  if (success) {
+    delaunay_check_tessellation(d);
+  }
+  return success;
+}
+
+/**
+ * @brief Get the center and squared radius of the circumsphere of the given
+ * tetrahedron.
+ *
+ * If DELAUNAY_CACHE_CIRCUMCENTERS is defined, the result is computed only once
+ * per tetrahedron and then reused until the tetrahedron is replaced (or its
+ * vertices are moved). This saves a lot of work, since every tetrahedron is
+ * visited once for each of its vertices in delaunay_get_search_radius(), and
+ * once more during the construction of the Voronoi grid.
  *
  * @param d Delaunay tessellation.
  * @param t Tetrahedron index.
- * @return Radius of the circumsphere of the given tetrahedron.
+ * @param circumcenter (Returned) Center of the circumsphere.
+ * @return Squared radius of the circumsphere.
  */
-inline static double delaunay_get_radius(const struct delaunay* restrict d,
-                                         int t) {
-  int v0 = d->tetrahedra[t].vertices[0];
-  int v1 = d->tetrahedra[t].vertices[1];
-  int v2 = d->tetrahedra[t].vertices[2];
-  int v3 = d->tetrahedra[t].vertices[3];
-
-  double v0x = d->vertices[3 * v0];
-  double v0y = d->vertices[3 * v0 + 1];
-  double v0z = d->vertices[3 * v0 + 2];
-  double v1x = d->vertices[3 * v1];
-  double v1y = d->vertices[3 * v1 + 1];
-  double v1z = d->vertices[3 * v1 + 2];
-  double v2x = d->vertices[3 * v2];
-  double v2y = d->vertices[3 * v2 + 1];
-  double v2z = d->vertices[3 * v2 + 2];
-  double v3x = d->vertices[3 * v3];
-  double v3y = d->vertices[3 * v3 + 1];
-  double v3z = d->vertices[3 * v3 + 2];
+inline static double delaunay_get_circumcenter(struct delaunay* restrict d,
+                                               int t, double* circumcenter) {
+#ifdef DELAUNAY_CACHE_CIRCUMCENTERS
+  double* cached = &d->circumcenters[4 * t];
+  if (cached[3] >= 0.) {
+    circumcenter[0] = cached[0];
+    circumcenter[1] = cached[1];
+    circumcenter[2] = cached[2];
+    return cached[3];
+  }
+#endif
+
+  int v0 = tetrahedron_get_vertex(&d->tetrahedra, t, 0);
+  int v1 = tetrahedron_get_vertex(&d->tetrahedra, t, 1);
+  int v2 = tetrahedron_get_vertex(&d->tetrahedra, t, 2);
+  int v3 = tetrahedron_get_vertex(&d->tetrahedra, t, 3);
+
+  double buffer[4][3];
+  const double* x0 = delaunay_get_vertex(d, v0, buffer[0]);
+  const double* x1 = delaunay_get_vertex(d, v1, buffer[1]);
+  const double* x2 = delaunay_get_vertex(d, v2, buffer[2]);
+  const double* x3 = delaunay_get_vertex(d, v3, buffer[3]);
+
+  double v0x = x0[0];
+  double v0y = x0[1];
+  double v0z = x0[2];
+  double v1x = x1[0];
+  double v1y = x1[1];
+  double v1z = x1[2];
+  double v2x = x2[0];
+  double v2y = x2[1];
+  double v2z = x2[2];
+  double v3x = x3[0];
+  double v3y = x3[1];
+  double v3z = x3[2];
 
-  double circumcenter[3];
   geometry3d_compute_circumcenter(v0x, v0y, v0z, v1x, v1y, v1z, v2x, v2y, v2z,
                                   v3x, v3y, v3z, circumcenter);
 
   double Rx = circumcenter[0] - v0x;
   double Ry = circumcenter[1] - v0y;
   double Rz = circumcenter[2] - v0z;
+  double r2 = Rx * Rx + Ry * Ry + Rz * Rz;
+
+#ifdef DELAUNAY_CACHE_CIRCUMCENTERS
+  cached[0] = circumcenter[0];
+  cached[1] = circumcenter[1];
+  cached[2] = circumcenter[2];
+  cached[3] = r2;
+#endif
 
-  return sqrt(Rx * Rx + Ry * Ry + Rz * Rz);
+  return r2;
+}
+
+/**
+ * @brief Get the radius of the circumsphere of the given tetrahedron.
+ *
+ * @param d Delaunay tessellation.
+ * @param t Tetrahedron index.
+ * @return Radius of the circumsphere of the given tetrahedron.
+ */
+inline static double delaunay_get_radius(struct delaunay* restrict d, int t) {
+  double circumcenter[3];
+  return sqrt(delaunay_get_circumcenter(d, t, circumcenter));
 }
 
 inline static double delaunay_get_search_radius(struct delaunay* restrict d,
@@ -1767,8 +2755,8 @@ inline static double delaunay_get_search_radius(struct delaunay* restrict d,
   /* Pick another vertex (generator) from this tetrahedron and add it to the
    * queue */
   int other_v_idx_in_t = (gen_idx_in_t + 1) % 4;
-  struct tetrahedron* t = &d->tetrahedra[t_idx];
-  int other_v_idx_in_d = t->vertices[other_v_idx_in_t];
+  int other_v_idx_in_d =
+      tetrahedron_get_vertex(&d->tetrahedra, t_idx, other_v_idx_in_t);
   /* Add the vertex info to the queue */
   int3 vertex_info = {
       ._0 = t_idx, ._1 = other_v_idx_in_d, ._2 = other_v_idx_in_t};
@@ -1790,14 +2778,15 @@ inline static double delaunay_get_search_radius(struct delaunay* restrict d,
     search_radius =
         fmax(search_radius, 2. * delaunay_get_radius(d, prev_t_idx));
 
-    struct tetrahedron* prev_t = &d->tetrahedra[prev_t_idx];
 
     /* Get a non axis vertex from first_t */
     int non_axis_idx_in_prev_t = (axis_idx_in_t + 1) % 4;
-    if (prev_t->vertices[non_axis_idx_in_prev_t] == gen_idx_in_d) {
+    if (tetrahedron_get_vertex(&d->tetrahedra, prev_t_idx,
+                               non_axis_idx_in_prev_t) == gen_idx_in_d) {
       non_axis_idx_in_prev_t = (non_axis_idx_in_prev_t + 1) % 4;
     }
-    int non_axis_idx_in_d = prev_t->vertices[non_axis_idx_in_prev_t];
+    int non_axis_idx_in_d = tetrahedron_get_vertex(&d->tetrahedra, prev_t_idx,
+                                                   non_axis_idx_in_prev_t);
 
     if (!d->get_radius_neighbour_flags[non_axis_idx_in_d]) {
       /* Add this vertex and tetrahedron to the queue and update its flag */
@@ -1810,9 +2799,10 @@ inline static double delaunay_get_search_radius(struct delaunay* restrict d,
     }
 
     /* Get a neighbouring tetrahedron of first_t sharing the axis */
-    int cur_t_idx = prev_t->neighbours[non_axis_idx_in_prev_t];
-    int prev_t_idx_in_cur_t =
-        prev_t->index_in_neighbour[non_axis_idx_in_prev_t];
+    int cur_t_idx = tetrahedron_get_neighbour(&d->tetrahedra, prev_t_idx,
+                                              non_axis_idx_in_prev_t);
+    int prev_t_idx_in_cur_t = tetrahedron_get_index_in_neighbour(
+        &d->tetrahedra, prev_t_idx, non_axis_idx_in_prev_t);
 
     /* Loop around the axis */
     int first_t_idx = prev_t_idx;
@@ -1823,14 +2813,15 @@ inline static double delaunay_get_search_radius(struct delaunay* restrict d,
 
       /* Update the variables */
       prev_t_idx = cur_t_idx;
-      prev_t = &d->tetrahedra[prev_t_idx];
       /* get the next non axis vertex */
       non_axis_idx_in_prev_t = (prev_t_idx_in_cur_t + 1) % 4;
-      non_axis_idx_in_d = prev_t->vertices[non_axis_idx_in_prev_t];
+      non_axis_idx_in_d = tetrahedron_get_vertex(&d->tetrahedra, prev_t_idx,
+                                                 non_axis_idx_in_prev_t);
       while (non_axis_idx_in_d == axis_idx_in_d ||
              non_axis_idx_in_d == gen_idx_in_d) {
         non_axis_idx_in_prev_t = (non_axis_idx_in_prev_t + 1) % 4;
-        non_axis_idx_in_d = prev_t->vertices[non_axis_idx_in_prev_t];
+        non_axis_idx_in_d = tetrahedron_get_vertex(&d->tetrahedra, prev_t_idx,
+                                                   non_axis_idx_in_prev_t);
       }
       /* Add it to the queue if necessary */
       if (!d->get_radius_neighbour_flags[non_axis_idx_in_d]) {
@@ -1843,8 +2834,10 @@ inline static double delaunay_get_search_radius(struct delaunay* restrict d,
         d->get_radius_neighbour_flags[non_axis_idx_in_d] |= 1;
       }
       /* Get the next tetrahedron sharing the same axis */
-      cur_t_idx = prev_t->neighbours[non_axis_idx_in_prev_t];
-      prev_t_idx_in_cur_t = prev_t->index_in_neighbour[non_axis_idx_in_prev_t];
+      cur_t_idx = tetrahedron_get_neighbour(&d->tetrahedra, prev_t_idx,
+                                            non_axis_idx_in_prev_t);
+      prev_t_idx_in_cur_t = tetrahedron_get_index_in_neighbour(
+          &d->tetrahedra, prev_t_idx, non_axis_idx_in_prev_t);
     }
   }
 
@@ -1866,6 +2859,78 @@ inline static double delaunay_get_search_radius(struct delaunay* restrict d,
   return search_radius;
 }
 
+/**
+ * @brief Update the search radii of all vertices based on the given radius.
+ *
+ * If the current search radius of a vertex is larger than the given value,
+ * the search radius is recomputed based on all the tetrahedra that vertex is
+ * part of (and set to twice the largest circumsphere radius among those
+ * tetrahedra, see delaunay_get_search_radius()). This function also counts the
+ * vertices for which this updated radius is still larger than the given
+ * radius.
+ *
+ * Instead of looping over the tetrahedra around every vertex separately, all
+ * search radii are updated in a single pass over the tetrahedra array: every
+ * active tetrahedron contributes twice its circumradius to the search radii of
+ * the vertices that need updating. Tetrahedra can be processed in any order
+ * (and hence in parallel, if the maximum is reduced atomically), and no
+ * per-vertex queues are needed.
+ *
+ * This function is meant to be called after all ghost vertices with a distance
+ * smaller than the given radius to all of the vertices have been added to the
+ * tessellation.
+ *
+ * @param d Delaunay tessellation.
+ * @param r Radius.
+ * @return Number of vertices with a search radius larger than the given radius.
+ */
+inline static int delaunay_update_search_radii(struct delaunay* restrict d,
+                                               double r) {
+  /* flag the vertices that need updating and reset their search radius */
+  int* restrict flags = d->get_radius_neighbour_flags;
+  int nflagged = 0;
+  for (int i = d->vertex_start; i < d->vertex_end; ++i) {
+    if (d->search_radii[i] > r) {
+      flags[i] = 1;
+      d->search_radii[i] = 0.;
+      ++nflagged;
+    }
+  }
+  if (nflagged == 0) return 0;
+
+  for (int t = d->tetrahedron_start; t < d->tetrahedron_index; t++) {
+    if (!tetrahedron_is_active(&d->tetrahedra, t)) continue;
+    const int v0 = tetrahedron_get_vertex(&d->tetrahedra, t, 0);
+    const int v1 = tetrahedron_get_vertex(&d->tetrahedra, t, 1);
+    const int v2 = tetrahedron_get_vertex(&d->tetrahedra, t, 2);
+    const int v3 = tetrahedron_get_vertex(&d->tetrahedra, t, 3);
+    /* the flags of the dummy and ghost vertices are never set (note that the
+     * dummy tetrahedra were skipped, so that all vertices are valid) */
+    const int f0 = v0 < d->vertex_end && flags[v0];
+    const int f1 = v1 < d->vertex_end && flags[v1];
+    const int f2 = v2 < d->vertex_end && flags[v2];
+    const int f3 = v3 < d->vertex_end && flags[v3];
+    if (!(f0 || f1 || f2 || f3)) continue;
+
+    const double diameter = 2. * delaunay_get_radius(d, t);
+    if (f0) d->search_radii[v0] = fmax(d->search_radii[v0], diameter);
+    if (f1) d->search_radii[v1] = fmax(d->search_radii[v1], diameter);
+    if (f2) d->search_radii[v2] = fmax(d->search_radii[v2], diameter);
+    if (f3) d->search_radii[v3] = fmax(d->search_radii[v3], diameter);
+  }
+
+  int count = 0;
+  for (int i = d->vertex_start; i < d->vertex_end; ++i) {
+    if (flags[i]) {
+      flags[i] = 0;
+      if (d->search_radii[i] > r) {
+        ++count;
+      }
+    }
+  }
+  return count;
+}
+
 /**
  * @brief Pop the next active tetrahedron to check from the end of the queue.
  *
@@ -1883,7 +2948,7 @@ inline static int get_next_tetrahedron_to_check(struct delaunay* restrict d) {
   int t;
   while (!active && !int_lifo_queue_is_empty(&d->tetrahedra_to_check)) {
     t = int_lifo_queue_pop(&d->tetrahedra_to_check);
-    active = d->tetrahedra[t].active;
+    active = tetrahedron_is_active(&d->tetrahedra, t);
   }
   return active ? t : -1;
 }
@@ -1907,59 +2972,377 @@ inline static void delaunay_consolidate(struct delaunay* restrict d) {
   /* loop over all vertex_indices to check vertex-tetrahedron links */
   for (int v = 0; v < d->vertex_end; v++) {
     int t_idx = d->vertex_tetrahedron_links[v];
-    struct tetrahedron* t = &d->tetrahedra[t_idx];
     int idx_in_t = d->vertex_tetrahedron_index[v];
-    if (v != t->vertices[d->vertex_tetrahedron_index[v]]) {
+    if (v != tetrahedron_get_vertex(&d->tetrahedra, t_idx,
+                                    d->vertex_tetrahedron_index[v])) {
       fprintf(stderr, "Wrong vertex-tetrahedron link!\n");
       fprintf(stderr, "\tVertex %i at index %i in\n", v, idx_in_t);
-      fprintf(stderr, "\ttetrahedron %i: %i %i %i %i\n", t_idx, t->vertices[0],
-              t->vertices[1], t->vertices[2], t->vertices[3]);
+      fprintf(stderr, "\ttetrahedron %i: %i %i %i %i\n", t_idx,
+              tetrahedron_get_vertex(&d->tetrahedra, t_idx, 0),
+              tetrahedron_get_vertex(&d->tetrahedra, t_idx, 1),
+              tetrahedron_get_vertex(&d->tetrahedra, t_idx, 2),
+              tetrahedron_get_vertex(&d->tetrahedra, t_idx, 3));
       abort();
     }
   }
 #endif
 }
 
+/**
+ * @brief Compact the (consolidated) Delaunay tessellation.
+ *
+ * After the construction, the tetrahedron array contains the 4 dummy
+ * tetrahedra, inactive tetrahedra that were removed by flips and tetrahedra
+ * that only consist of ghost vertices, which are all skipped by the
+ * construction of the Voronoi grid. This function renumbers the active
+ * tetrahedra with at least one local vertex into a dense array starting at
+ * index 0 (so that d->tetrahedron_start becomes 0), optionally in the order of
+ * the Hilbert keys of their centroids, and remaps the neighbour relations, the
+ * cached circumcenters and the vertex-tetrahedron links accordingly.
+ * Neighbours that were removed are set to -1; these are never visited when
+ * looping around the edges of a local vertex. Ghost vertices that are no
+ * longer part of any tetrahedron are linked to tetrahedron -1.
+ *
+ * The arrays that are only needed to add or move vertices (the integer
+ * coordinates, search radii and flags) are freed and all other arrays are
+ * shrunk to their actual size. A compacted tessellation can still be used to
+ * construct a Voronoi grid and to write output, but has to be reset (which
+ * reallocates the freed arrays) before it can be changed.
+ *
+ * @param d Delaunay tessellation.
+ * @param hilbert_order Whether to reorder the tetrahedra along the Hilbert
+ * curve.
+ */
+inline static void delaunay_compact(struct delaunay* restrict d,
+                                    int hilbert_order) {
+  delaunay_assert(d->ghost_offset > 0 && !d->compact);
+
+  /* select the tetrahedra to keep, in order */
+  int* new_index = (int*)CVORONOI_MALLOC(d->tetrahedron_index * sizeof(int));
+  int* order = (int*)CVORONOI_MALLOC(d->tetrahedron_index * sizeof(int));
+  int count = 0;
+  for (int t = 0; t < d->tetrahedron_index; t++) {
+    new_index[t] = -1;
+    if (t < d->tetrahedron_start || !tetrahedron_is_active(&d->tetrahedra, t)) {
+      continue;
+    }
+    int is_local = 0;
+    for (int i = 0; i < 4; i++) {
+      const int v = tetrahedron_get_vertex(&d->tetrahedra, t, i);
+      is_local |= v >= d->vertex_start && v < d->vertex_end;
+    }
+    if (is_local) {
+      order[count++] = t;
+    }
+  }
+
+  if (hilbert_order) {
+    /* the centroids are inside the box of the large initial tetrahedron */
+    double* centroids = (double*)CVORONOI_MALLOC(3 * count * sizeof(double));
+    for (int i = 0; i < count; i++) {
+      for (int k = 0; k < 3; k++) {
+        double x = 0.;
+        for (int j = 0; j < 4; j++) {
+          const int v = tetrahedron_get_vertex(&d->tetrahedra, order[i], j);
+          double buffer[3];
+          x += delaunay_get_vertex(d, v, buffer)[k];
+        }
+        centroids[3 * i + k] = 0.25 * x;
+      }
+    }
+    const double box_side = 1. / d->inverse_side;
+    const double side[3] = {box_side, box_side, box_side};
+    unsigned long* keys =
+        (unsigned long*)CVORONOI_MALLOC(count * sizeof(unsigned long));
+    hilbert_get_keys(centroids, count, d->anchor, side, keys);
+    int* idx = (int*)CVORONOI_MALLOC(count * sizeof(int));
+    for (int i = 0; i < count; i++) {
+      idx[i] = i;
+    }
+    uint64_t* tmp = (uint64_t*)CVORONOI_MALLOC(count * sizeof(uint64_t));
+    sort_arg_keys(keys, idx, count, tmp);
+    int* sorted_order =
+        (int*)CVORONOI_MALLOC(d->tetrahedron_index * sizeof(int));
+    for (int i = 0; i < count; i++) {
+      sorted_order[i] = order[idx[i]];
+    }
+    CVORONOI_FREE(order);
+    order = sorted_order;
+    CVORONOI_FREE(centroids);
+    CVORONOI_FREE(keys);
+    CVORONOI_FREE(idx);
+    CVORONOI_FREE(tmp);
+  }
+  for (int i = 0; i < count; i++) {
+    new_index[order[i]] = i;
+  }
+
+  /* copy the tetrahedra and remap their neighbours */
+  struct tetrahedron_array tetrahedra;
+  tetrahedron_array_init(&tetrahedra, count);
+  for (int i = 0; i < count; i++) {
+    const int t = order[i];
+    tetrahedron_init(&tetrahedra, i,
+                     tetrahedron_get_vertex(&d->tetrahedra, t, 0),
+                     tetrahedron_get_vertex(&d->tetrahedra, t, 1),
+                     tetrahedron_get_vertex(&d->tetrahedra, t, 2),
+                     tetrahedron_get_vertex(&d->tetrahedra, t, 3));
+    for (int j = 0; j < 4; j++) {
+      const int ngb =
+          new_index[tetrahedron_get_neighbour(&d->tetrahedra, t, j)];
+      if (ngb >= 0) {
+        tetrahedron_swap_neighbour(
+            &tetrahedra, i, j, ngb,
+            tetrahedron_get_index_in_neighbour(&d->tetrahedra, t, j));
+      }
+    }
+  }
+#ifdef DELAUNAY_CACHE_CIRCUMCENTERS
+  double* circumcenters = (double*)CVORONOI_MALLOC(count * 4 * sizeof(double));
+  for (int i = 0; i < count; i++) {
+    for (int j = 0; j < 4; j++) {
+      circumcenters[4 * i + j] = d->circumcenters[4 * order[i] + j];
+    }
+  }
+  CVORONOI_FREE(d->circumcenters);
+  d->circumcenters = circumcenters;
+#endif
+
+  /* the tetrahedra linked to local vertices are all kept, other vertices are
+     linked to the first tetrahedron they are part of */
+  for (int v = 0; v < d->vertex_index; v++) {
+    if (v >= d->vertex_start && v < d->vertex_end) {
+      d->vertex_tetrahedron_links[v] =
+          new_index[d->vertex_tetrahedron_links[v]];
+      delaunay_assert(d->vertex_tetrahedron_links[v] >= 0);
+    } else {
+      d->vertex_tetrahedron_links[v] = -1;
+    }
+  }
+  for (int i = count - 1; i >= 0; i--) {
+    for (int j = 0; j < 4; j++) {
+      const int v = tetrahedron_get_vertex(&tetrahedra, i, j);
+      if (v < d->vertex_start || v >= d->vertex_end) {
+        d->vertex_tetrahedron_links[v] = i;
+        d->vertex_tetrahedron_index[v] = j;
+      }
+    }
+  }
+  CVORONOI_FREE(new_index);
+  CVORONOI_FREE(order);
+
+  tetrahedron_array_destroy(&d->tetrahedra);
+  d->tetrahedra = tetrahedra;
+  d->tetrahedron_index = count;
+  d->tetrahedron_size = count;
+  d->tetrahedron_start = 0;
+  d->last_tetrahedron = 0;
+
+  /* free the arrays that are only used to add or move vertices, and shrink
+     the other vertex arrays */
+  d->vertex_size = d->vertex_index;
+  const int coordinate_size =
+      d->periodic_shift_count > 0 ? d->ghost_offset : d->vertex_size;
+  d->vertices = (double*)CVORONOI_REALLOC(d->vertices,
+                                          coordinate_size * 3 * sizeof(double));
+  d->vertex_tetrahedron_links =
+      (int*)CVORONOI_REALLOC(d->vertex_tetrahedron_links,
+                             d->vertex_size * sizeof(int));
+  d->vertex_tetrahedron_index =
+      (int*)CVORONOI_REALLOC(d->vertex_tetrahedron_index,
+                             d->vertex_size * sizeof(int));
+  if (d->periodic_shift_count > 0) {
+    d->ghost_size = d->vertex_index - d->ghost_offset;
+    d->ghost_vertices =
+        (int*)CVORONOI_REALLOC(d->ghost_vertices, d->ghost_size * sizeof(int));
+    d->ghost_shifts =
+        (int*)CVORONOI_REALLOC(d->ghost_shifts, d->ghost_size * sizeof(int));
+  }
+#ifdef DELAUNAY_NONEXACT
+  CVORONOI_FREE(d->rescaled_vertices);
+  d->rescaled_vertices = NULL;
+#endif
+#ifndef DELAUNAY_IMPLICIT_INTEGER_COORDINATES
+  CVORONOI_FREE(d->integer_vertices);
+  d->integer_vertices = NULL;
+#endif
+  CVORONOI_FREE(d->search_radii);
+  d->search_radii = NULL;
+  CVORONOI_FREE(d->get_radius_neighbour_flags);
+  d->get_radius_neighbour_flags = NULL;
+  int_lifo_queue_reset(&d->tetrahedra_containing_vertex);
+  int_lifo_queue_reset(&d->tetrahedra_to_check);
+  int_lifo_queue_reset(&d->free_tetrahedron_indices);
+  int_lifo_queue_reset(&d->freed_tetrahedra);
+  int_lifo_queue_reset(&d->moved_vertices);
+  int3_fifo_queue_reset(&d->get_radius_neighbour_info_queue);
+  d->compact = 1;
+}
+
 inline static void delaunay_print_tessellation(
     const struct delaunay* restrict d, const char* file_name) {
   FILE* file = fopen(file_name, "w");
 
   for (int i = 0; i < d->vertex_index; ++i) {
-    fprintf(file, "V\t%i\t%g\t%g\t%g\n", i, d->vertices[3 * i],
-            d->vertices[3 * i + 1], d->vertices[3 * i + 2]);
+    double buffer[3];
+    const double* x = delaunay_get_vertex(d, i, buffer);
+    fprintf(file, "V\t%i\t%g\t%g\t%g\n", i, x[0], x[1], x[2]);
   }
-  for (int i = 4; i < d->tetrahedron_index; ++i) {
-    if (!d->tetrahedra[i].active) {
+  for (int i = d->tetrahedron_start; i < d->tetrahedron_index; ++i) {
+    if (!tetrahedron_is_active(&d->tetrahedra, i)) {
       continue;
     }
-    fprintf(file, "T\t%i\t%i\t%i\t%i\n", d->tetrahedra[i].vertices[0],
-            d->tetrahedra[i].vertices[1], d->tetrahedra[i].vertices[2],
-            d->tetrahedra[i].vertices[3]);
+    fprintf(file, "T\t%i\t%i\t%i\t%i\n",
+            tetrahedron_get_vertex(&d->tetrahedra, i, 0),
+            tetrahedron_get_vertex(&d->tetrahedra, i, 1),
+            tetrahedron_get_vertex(&d->tetrahedra, i, 2),
+            tetrahedron_get_vertex(&d->tetrahedra, i, 3));
   }
 
   fclose(file);
 }
 
+/**
+ * @brief Write the tessellation to a binary file with the given name.
+ *
+ * The file starts with a header (see binary_output_write_header()) with file
+ * type BINARY_OUTPUT_TYPE_DELAUNAY, with as counts the number of vertices and
+ * the number of tetrahedra. The header is followed by the vertex coordinates
+ * (double[nvertex][3]) and the vertex indices of the tetrahedra
+ * (int32[ntetrahedron][4]). As for delaunay_print_tessellation(), only the
+ * active tetrahedra are written, excluding the dummy tetrahedra.
+ *
+ * @param d Delaunay tessellation (read-only).
+ * @param file_name Name of the output file.
+ */
+inline static void delaunay_print_tessellation_binary(
+    const struct delaunay* restrict d, const char* file_name) {
+  int64_t ntetrahedron = 0;
+  for (int i = d->tetrahedron_start; i < d->tetrahedron_index; ++i) {
+    if (tetrahedron_is_active(&d->tetrahedra, i)) ++ntetrahedron;
+  }
+  const int64_t counts[BINARY_OUTPUT_NCOUNT] = {d->vertex_index, ntetrahedron,
+                                                0, 0};
+
+  struct binary_output o;
+  binary_output_open(&o, file_name);
+  binary_output_write_header(&o, BINARY_OUTPUT_TYPE_DELAUNAY, 3, 0, counts);
+  if (d->periodic_shift_count > 0) {
+    binary_output_write_doubles(&o, d->vertices, 3 * d->ghost_offset);
+    for (int i = d->ghost_offset; i < d->vertex_index; ++i) {
+      double buffer[3];
+      binary_output_write_doubles(&o, delaunay_get_vertex(d, i, buffer), 3);
+    }
+  } else {
+    binary_output_write_doubles(&o, d->vertices, 3 * d->vertex_index);
+  }
+  for (int i = d->tetrahedron_start; i < d->tetrahedron_index; ++i) {
+    if (!tetrahedron_is_active(&d->tetrahedra, i)) {
+      continue;
+    }
+    for (int j = 0; j < 4; ++j) {
+      binary_output_write_int32(&o,
+                                tetrahedron_get_vertex(&d->tetrahedra, i, j));
+    }
+  }
+  binary_output_close(&o);
+}
+
+/**
+ * @brief Test the orientation of the tetrahedron formed by the given vertices.
+ *
+ * If DELAUNAY_NONEXACT is defined, a floating point filter on the rescaled
+ * coordinates is tried first, and the exact integer test is only used when the
+ * filter cannot guarantee the correct sign. With
+ * DELAUNAY_IMPLICIT_INTEGER_COORDINATES, the integer coordinates are only
+ * recovered in that case.
+ *
+ * @param d Delaunay tessellation.
+ * @param v0, v1, v2, v3 Indices of the vertices.
+ * @return Result of geometry3d_orient_exact() for the given vertices.
+ */
 inline static int delaunay_test_orientation(struct delaunay* restrict d, int v0,
                                             int v1, int v2, int v3) {
-  const unsigned long aix = d->integer_vertices[3 * v0];
-  const unsigned long aiy = d->integer_vertices[3 * v0 + 1];
-  const unsigned long aiz = d->integer_vertices[3 * v0 + 2];
-
-  const unsigned long bix = d->integer_vertices[3 * v1];
-  const unsigned long biy = d->integer_vertices[3 * v1 + 1];
-  const unsigned long biz = d->integer_vertices[3 * v1 + 2];
-
-  const unsigned long cix = d->integer_vertices[3 * v2];
-  const unsigned long ciy = d->integer_vertices[3 * v2 + 1];
-  const unsigned long ciz = d->integer_vertices[3 * v2 + 2];
-
-  const unsigned long dix = d->integer_vertices[3 * v3];
-  const unsigned long diy = d->integer_vertices[3 * v3 + 1];
-  const unsigned long diz = d->integer_vertices[3 * v3 + 2];
+#ifdef DELAUNAY_IMPLICIT_INTEGER_COORDINATES
+  /* the integer coordinates are only recovered if the filter fails */
+  double rbuffer[4][3];
+  const int result = geometry3d_orient_filter(
+      &d->geometry, delaunay_get_rescaled_vertex(d, v0, rbuffer[0]),
+      delaunay_get_rescaled_vertex(d, v1, rbuffer[1]),
+      delaunay_get_rescaled_vertex(d, v2, rbuffer[2]),
+      delaunay_get_rescaled_vertex(d, v3, rbuffer[3]));
+  if (result != 0) {
+    return result;
+  }
+#endif
+  /* buffers for the coordinates of periodic ghosts */
+  unsigned long ibuffer[4][3];
+  const unsigned long* a = delaunay_get_integer_vertex(d, v0, ibuffer[0]);
+  const unsigned long* b = delaunay_get_integer_vertex(d, v1, ibuffer[1]);
+  const unsigned long* c = delaunay_get_integer_vertex(d, v2, ibuffer[2]);
+  const unsigned long* e = delaunay_get_integer_vertex(d, v3, ibuffer[3]);
+#if defined(DELAUNAY_NONEXACT) && \
+    !defined(DELAUNAY_IMPLICIT_INTEGER_COORDINATES)
+  double rbuffer[4][3];
+  return geometry3d_orient_adaptive(
+      &d->geometry, delaunay_get_rescaled_vertex(d, v0, rbuffer[0]),
+      delaunay_get_rescaled_vertex(d, v1, rbuffer[1]),
+      delaunay_get_rescaled_vertex(d, v2, rbuffer[2]),
+      delaunay_get_rescaled_vertex(d, v3, rbuffer[3]), a, b, c, e);
+#else
+  return geometry3d_orient_exact(&d->geometry, a[0], a[1], a[2], b[0], b[1],
+                                 b[2], c[0], c[1], c[2], e[0], e[1], e[2]);
+#endif
+}
 
-  return geometry3d_orient_exact(&d->geometry, aix, aiy, aiz, bix, biy, biz,
-                                 cix, ciy, ciz, dix, diy, diz);
+/**
+ * @brief Test whether the vertex v4 lies inside the circumsphere of the
+ * positively oriented tetrahedron formed by v0, v1, v2 and v3.
+ *
+ * Like delaunay_test_orientation(), this uses a floating point filter if
+ * DELAUNAY_NONEXACT is defined.
+ *
+ * @param d Delaunay tessellation.
+ * @param v0, v1, v2, v3 Indices of the vertices of the tetrahedron.
+ * @param v4 Index of the test vertex.
+ * @return Result of geometry3d_in_sphere_exact() for the given vertices.
+ */
+inline static int delaunay_test_in_sphere(struct delaunay* restrict d, int v0,
+                                          int v1, int v2, int v3, int v4) {
+#ifdef DELAUNAY_IMPLICIT_INTEGER_COORDINATES
+  /* the integer coordinates are only recovered if the filter fails */
+  double rbuffer[5][3];
+  const int result = geometry3d_in_sphere_filter(
+      &d->geometry, delaunay_get_rescaled_vertex(d, v0, rbuffer[0]),
+      delaunay_get_rescaled_vertex(d, v1, rbuffer[1]),
+      delaunay_get_rescaled_vertex(d, v2, rbuffer[2]),
+      delaunay_get_rescaled_vertex(d, v3, rbuffer[3]),
+      delaunay_get_rescaled_vertex(d, v4, rbuffer[4]));
+  if (result != 0) {
+    return result;
+  }
+#endif
+  /* buffers for the coordinates of periodic ghosts */
+  unsigned long ibuffer[5][3];
+  const unsigned long* a = delaunay_get_integer_vertex(d, v0, ibuffer[0]);
+  const unsigned long* b = delaunay_get_integer_vertex(d, v1, ibuffer[1]);
+  const unsigned long* c = delaunay_get_integer_vertex(d, v2, ibuffer[2]);
+  const unsigned long* e = delaunay_get_integer_vertex(d, v3, ibuffer[3]);
+  const unsigned long* f = delaunay_get_integer_vertex(d, v4, ibuffer[4]);
+#if defined(DELAUNAY_NONEXACT) && \
+    !defined(DELAUNAY_IMPLICIT_INTEGER_COORDINATES)
+  double rbuffer[5][3];
+  return geometry3d_in_sphere_adaptive(
+      &d->geometry, delaunay_get_rescaled_vertex(d, v0, rbuffer[0]),
+      delaunay_get_rescaled_vertex(d, v1, rbuffer[1]),
+      delaunay_get_rescaled_vertex(d, v2, rbuffer[2]),
+      delaunay_get_rescaled_vertex(d, v3, rbuffer[3]),
+      delaunay_get_rescaled_vertex(d, v4, rbuffer[4]), a, b, c, e, f);
+#else
+  return geometry3d_in_sphere_exact(&d->geometry, a[0], a[1], a[2], b[0], b[1],
+                                    b[2], c[0], c[1], c[2], e[0], e[1], e[2],
+                                    f[0], f[1], f[2]);
+#endif
 }
 
 /**
@@ -1996,85 +3379,80 @@ inline static void delaunay_check_tessellation(struct delaunay* restrict d) {
 #endif
 
   /* loop over all non-dummy tetrahedra */
-  for (int t0 = 4; t0 < d->tetrahedron_index; t0++) {
+  for (int t0 = d->tetrahedron_start; t0 < d->tetrahedron_index; t0++) {
     /* Skip temporary deleted tetrahedra */
-    if (!d->tetrahedra[t0].active) {
+    if (!tetrahedron_is_active(&d->tetrahedra, t0)) {
       continue;
     }
-    int vt0_0 = d->tetrahedra[t0].vertices[0];
-    int vt0_1 = d->tetrahedra[t0].vertices[1];
-    int vt0_2 = d->tetrahedra[t0].vertices[2];
-    int vt0_3 = d->tetrahedra[t0].vertices[3];
+    int vt0_0 = tetrahedron_get_vertex(&d->tetrahedra, t0, 0);
+    int vt0_1 = tetrahedron_get_vertex(&d->tetrahedra, t0, 1);
+    int vt0_2 = tetrahedron_get_vertex(&d->tetrahedra, t0, 2);
+    int vt0_3 = tetrahedron_get_vertex(&d->tetrahedra, t0, 3);
     /* loop over neighbours */
     for (int i = 0; i < 4; i++) {
-      int t_ngb = d->tetrahedra[t0].neighbours[i];
+      int t_ngb = tetrahedron_get_neighbour(&d->tetrahedra, t0, i);
       /* check neighbour relations */
-      int idx_in_ngb = d->tetrahedra[t0].index_in_neighbour[i];
-      if (!d->tetrahedra[t_ngb].active) {
+      int idx_in_ngb =
+          tetrahedron_get_index_in_neighbour(&d->tetrahedra, t0, i);
+      if (!tetrahedron_is_active(&d->tetrahedra, t_ngb)) {
         fprintf(stderr, "Tetrahedron %i has an inactive neighbour: %i", t0,
                 t_ngb);
       }
-      if (d->tetrahedra[t_ngb].neighbours[idx_in_ngb] != t0) {
+      if (tetrahedron_get_neighbour(&d->tetrahedra, t_ngb, idx_in_ngb) != t0) {
         fprintf(stderr, "Wrong neighbour!\n");
         fprintf(stderr, "Tetrahedron %i: %i %i %i %i\n", t0, vt0_0, vt0_1,
                 vt0_2, vt0_3);
-        fprintf(
-            stderr, "\tNeighbours: %i %i %i %i\n",
-            d->tetrahedra[t0].neighbours[0], d->tetrahedra[t0].neighbours[1],
-            d->tetrahedra[t0].neighbours[2], d->tetrahedra[t0].neighbours[3]);
+        fprintf(stderr, "\tNeighbours: %i %i %i %i\n",
+                tetrahedron_get_neighbour(&d->tetrahedra, t0, 0),
+                tetrahedron_get_neighbour(&d->tetrahedra, t0, 1),
+                tetrahedron_get_neighbour(&d->tetrahedra, t0, 2),
+                tetrahedron_get_neighbour(&d->tetrahedra, t0, 3));
         fprintf(stderr, "\tIndex in neighbour: %i %i %i %i\n",
-                d->tetrahedra[t0].index_in_neighbour[0],
-                d->tetrahedra[t0].index_in_neighbour[1],
-                d->tetrahedra[t0].index_in_neighbour[2],
-                d->tetrahedra[t0].index_in_neighbour[3]);
-        fprintf(
-            stderr, "Neighbour tetrahedron %i: %i %i %i %i\n", t_ngb,
-            d->tetrahedra[t_ngb].vertices[0], d->tetrahedra[t_ngb].vertices[1],
-            d->tetrahedra[t_ngb].vertices[2], d->tetrahedra[t_ngb].vertices[3]);
+                tetrahedron_get_index_in_neighbour(&d->tetrahedra, t0, 0),
+                tetrahedron_get_index_in_neighbour(&d->tetrahedra, t0, 1),
+                tetrahedron_get_index_in_neighbour(&d->tetrahedra, t0, 2),
+                tetrahedron_get_index_in_neighbour(&d->tetrahedra, t0, 3));
+        fprintf(stderr, "Neighbour tetrahedron %i: %i %i %i %i\n", t_ngb,
+                tetrahedron_get_vertex(&d->tetrahedra, t_ngb, 0),
+                tetrahedron_get_vertex(&d->tetrahedra, t_ngb, 1),
+                tetrahedron_get_vertex(&d->tetrahedra, t_ngb, 2),
+                tetrahedron_get_vertex(&d->tetrahedra, t_ngb, 3));
         fprintf(stderr, "\tNeighbours: %i %i %i %i\n",
-                d->tetrahedra[t_ngb].neighbours[0],
-                d->tetrahedra[t_ngb].neighbours[1],
-                d->tetrahedra[t_ngb].neighbours[2],
-                d->tetrahedra[t_ngb].neighbours[3]);
+                tetrahedron_get_neighbour(&d->tetrahedra, t_ngb, 0),
+                tetrahedron_get_neighbour(&d->tetrahedra, t_ngb, 1),
+                tetrahedron_get_neighbour(&d->tetrahedra, t_ngb, 2),
+                tetrahedron_get_neighbour(&d->tetrahedra, t_ngb, 3));
         fprintf(stderr, "\tIndex in neighbour: %i %i %i %i\n",
-                d->tetrahedra[t_ngb].index_in_neighbour[0],
-                d->tetrahedra[t_ngb].index_in_neighbour[1],
-                d->tetrahedra[t_ngb].index_in_neighbour[2],
-                d->tetrahedra[t_ngb].index_in_neighbour[3]);
+                tetrahedron_get_index_in_neighbour(&d->tetrahedra, t_ngb, 0),
+                tetrahedron_get_index_in_neighbour(&d->tetrahedra, t_ngb, 1),
+                tetrahedron_get_index_in_neighbour(&d->tetrahedra, t_ngb, 2),
+                tetrahedron_get_index_in_neighbour(&d->tetrahedra, t_ngb, 3));
         abort();
       }
-      if (t_ngb < 4) {
+      if (t_ngb < d->tetrahedron_start) {
         /* Don't check delaunayness for dummy neighbour tetrahedra */
         continue;
       }
       /* check in-sphere criterion for delaunayness */
-      int vertex_to_check = d->tetrahedra[t_ngb].vertices[idx_in_ngb];
-#ifdef DELAUNAY_NONEXACT
-      // TODO
-#endif
-      unsigned long int aix = d->integer_vertices[3 * vt0_0];
-      unsigned long int aiy = d->integer_vertices[3 * vt0_0 + 1];
-      unsigned long int aiz = d->integer_vertices[3 * vt0_0 + 2];
-
-      unsigned long int bix = d->integer_vertices[3 * vt0_1];
-      unsigned long int biy = d->integer_vertices[3 * vt0_1 + 1];
-      unsigned long int biz = d->integer_vertices[3 * vt0_1 + 2];
-
-      unsigned long int cix = d->integer_vertices[3 * vt0_2];
-      unsigned long int ciy = d->integer_vertices[3 * vt0_2 + 1];
-      unsigned long int ciz = d->integer_vertices[3 * vt0_2 + 2];
-
-      unsigned long int dix = d->integer_vertices[3 * vt0_3];
-      unsigned long int diy = d->integer_vertices[3 * vt0_3 + 1];
-      unsigned long int diz = d->integer_vertices[3 * vt0_3 + 2];
-
-      unsigned long int eix = d->integer_vertices[3 * vertex_to_check];
-      unsigned long int eiy = d->integer_vertices[3 * vertex_to_check + 1];
-      unsigned long int eiz = d->integer_vertices[3 * vertex_to_check + 2];
-
-      int test = geometry3d_in_sphere_exact(&d->geometry, aix, aiy, aiz, bix,
-                                            biy, biz, cix, ciy, ciz, dix, diy,
-                                            diz, eix, eiy, eiz);
+      int vertex_to_check =
+          tetrahedron_get_vertex(&d->tetrahedra, t_ngb, idx_in_ngb);
+      /* always use the exact test here, so that this check does not depend on
+       * the floating point filter */
+      unsigned long int buffer[5][3];
+      const unsigned long int* a =
+          delaunay_get_integer_vertex(d, vt0_0, buffer[0]);
+      const unsigned long int* b =
+          delaunay_get_integer_vertex(d, vt0_1, buffer[1]);
+      const unsigned long int* c =
+          delaunay_get_integer_vertex(d, vt0_2, buffer[2]);
+      const unsigned long int* e =
+          delaunay_get_integer_vertex(d, vt0_3, buffer[3]);
+      const unsigned long int* f =
+          delaunay_get_integer_vertex(d, vertex_to_check, buffer[4]);
+
+      int test = geometry3d_in_sphere_exact(
+          &d->geometry, a[0], a[1], a[2], b[0], b[1], b[2], c[0], c[1], c[2],
+          e[0], e[1], e[2], f[0], f[1], f[2]);
       if (test < 0) {
         fprintf(stderr, "Failed in-sphere test, value: %i!\n", test);
         fprintf(stderr, "\tTetrahedron %i: %i %i %i %i\n", t0, vt0_0, vt0_1,
@@ -9,12 +9,15 @@
 
 #ifndef CVORONOI_DIMENSIONALITY_H
 
-/* Define dimensionality of code */
+/* Define dimensionality of code, unless it was already set on the command
+   line (-DDIMENSIONALITY_2D or -DDIMENSIONALITY_3D) */
+#if !defined(DIMENSIONALITY_2D) && !defined(DIMENSIONALITY_3D)
 //#define DIMENSIONALITY_2D
 #define DIMENSIONALITY_3D
+#endif
 
-#if !defined(DIMENSIONALITY_2D) && !defined(DIMENSIONALITY_3D)
-#error "Invalid or undefined dimensionality"
+#if defined(DIMENSIONALITY_2D) && defined(DIMENSIONALITY_3D)
+#error "Only one of DIMENSIONALITY_2D and DIMENSIONALITY_3D can be defined"
 #endif
 
 #define CVORONOI_DIMENSIONALITY_H
@@ -0,0 +1,206 @@
+/**
+ * @file fixed_int.h
+ *
+ * @brief Small fixed width signed integers, used by the exact geometrical
+ * tests.
+ *
+ * The integer coordinates used by the exact tests only have 52 significant
+ * bits (see delaunay_double_to_int()), so that all intermediate results of the
+ * 2D and 3D orientation and in-sphere tests are bounded. The largest value
+ * occurs in the 3D in-sphere test: the relative coordinates have at most 53
+ * bits, the 2x2 minors at most 106 bits, the lifted coordinates at most 107
+ * bits and the final determinant at most 270 bits. All these values fit in
+ * FIXED_INT_LIMBS 64-bit limbs, so that we can avoid arbitrary precision
+ * arithmetic (and the function call overhead that comes with it).
+ *
+ * Values are stored in two's complement, with the least significant limb
+ * first. The interface mimics the GMP mpz functions used by the old
+ * implementation of the exact tests.
+ */
+
+#ifndef CVORONOI_FIXED_INT_H
+#define CVORONOI_FIXED_INT_H
+
+#include <stdint.h>
+
+#ifndef __SIZEOF_INT128__
+#error "The exact geometrical tests require compiler support for __int128!"
+#endif
+
+/*! @brief Number of 64-bit limbs in a fixed_int. */
+#define FIXED_INT_LIMBS 5
+
+/**
+ * @brief Signed integer of 64 * FIXED_INT_LIMBS bits.
+ */
+struct fixed_int {
+  /*! @brief Two's complement limbs, least significant limb first. */
+  uint64_t limbs[FIXED_INT_LIMBS];
+};
+
+/**
+ * @brief Set the given fixed_int to the given 128-bit signed integer.
+ *
+ * @param r Fixed width integer to set.
+ * @param x Value.
+ */
+inline static void fixed_int_set_int128(struct fixed_int* restrict r,
+                                        __int128 x) {
+  r->limbs[0] = (uint64_t)x;
+  r->limbs[1] = (uint64_t)(x >> 64);
+  /* sign extension */
+  const uint64_t ext = x < 0 ? ~(uint64_t)0 : 0;
+  for (int i = 2; i < FIXED_INT_LIMBS; i++) {
+    r->limbs[i] = ext;
+  }
+}
+
+/**
+ * @brief Compute r = a + b.
+ *
+ * r can be the same as a or b.
+ */
+inline static void fixed_int_add(struct fixed_int* r,
+                                 const struct fixed_int* a,
+                                 const struct fixed_int* b) {
+  uint64_t carry = 0;
+  for (int i = 0; i < FIXED_INT_LIMBS; i++) {
+    const uint64_t ai = a->limbs[i];
+    const uint64_t s = ai + b->limbs[i];
+    const uint64_t sc = s + carry;
+    carry = (s < ai) | (sc < s);
+    r->limbs[i] = sc;
+  }
+}
+
+/**
+ * @brief Compute r = -a.
+ *
+ * r can be the same as a.
+ */
+inline static void fixed_int_neg(struct fixed_int* r,
+                                 const struct fixed_int* a) {
+  uint64_t carry = 1;
+  for (int i = 0; i < FIXED_INT_LIMBS; i++) {
+    const uint64_t s = ~a->limbs[i] + carry;
+    carry = carry & (s == 0);
+    r->limbs[i] = s;
+  }
+}
+
+/**
+ * @brief Compute r = a - b.
+ *
+ * r can be the same as a or b.
+ */
+inline static void fixed_int_sub(struct fixed_int* r,
+                                 const struct fixed_int* a,
+                                 const struct fixed_int* b) {
+  /* a - b = a + ~b + 1 */
+  uint64_t carry = 1;
+  for (int i = 0; i < FIXED_INT_LIMBS; i++) {
+    const uint64_t ai = a->limbs[i];
+    const uint64_t s = ai + ~b->limbs[i];
+    const uint64_t sc = s + carry;
+    carry = (s < ai) | (sc < s);
+    r->limbs[i] = sc;
+  }
+}
+
+/**
+ * @brief Get the sign of the given fixed_int.
+ *
+ * @param a Fixed width integer.
+ * @return -1, 0 or 1, depending on the sign of a.
+ */
+inline static int fixed_int_sgn(const struct fixed_int* restrict a) {
+  if (a->limbs[FIXED_INT_LIMBS - 1] >> 63) {
+    return -1;
+  }
+  for (int i = 0; i < FIXED_INT_LIMBS; i++) {
+    if (a->limbs[i] != 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+ * @brief Compute r = a * b.
+ *
+ * The product is computed on the absolute values of a and b, so that only the
+ * non-zero limbs need to be multiplied. The result is truncated to
+ * FIXED_INT_LIMBS limbs, which is exact as long as the true product fits.
+ *
+ * r can be the same as a or b.
+ */
+inline static void fixed_int_mul(struct fixed_int* r,
+                                 const struct fixed_int* a,
+                                 const struct fixed_int* b) {
+  struct fixed_int abs_a, abs_b;
+  const int neg_a = fixed_int_sgn(a) < 0;
+  const int neg_b = fixed_int_sgn(b) < 0;
+  if (neg_a) {
+    fixed_int_neg(&abs_a, a);
+  } else {
+    abs_a = *a;
+  }
+  if (neg_b) {
+    fixed_int_neg(&abs_b, b);
+  } else {
+    abs_b = *b;
+  }
+
+  /* count the significant limbs */
+  int na = FIXED_INT_LIMBS;
+  while (na > 0 && abs_a.limbs[na - 1] == 0) --na;
+  int nb = FIXED_INT_LIMBS;
+  while (nb > 0 && abs_b.limbs[nb - 1] == 0) --nb;
+
+  /* schoolbook multiplication, truncated to FIXED_INT_LIMBS limbs */
+  uint64_t result[FIXED_INT_LIMBS] = {0};
+  for (int i = 0; i < na; i++) {
+    unsigned __int128 carry = 0;
+    for (int j = 0; j < nb && i + j < FIXED_INT_LIMBS; j++) {
+      const unsigned __int128 p =
+          (unsigned __int128)abs_a.limbs[i] * abs_b.limbs[j] +
+          result[i + j] + carry;
+      result[i + j] = (uint64_t)p;
+      carry = p >> 64;
+    }
+    if (i + nb < FIXED_INT_LIMBS) {
+      result[i + nb] = (uint64_t)carry;
+    }
+  }
+
+  for (int i = 0; i < FIXED_INT_LIMBS; i++) {
+    r->limbs[i] = result[i];
+  }
+  if (neg_a != neg_b) {
+    fixed_int_neg(r, r);
+  }
+}
+
+/**
+ * @brief Compute r = r + a * b.
+ */
+inline static void fixed_int_addmul(struct fixed_int* r,
+                                    const struct fixed_int* a,
+                                    const struct fixed_int* b) {
+  struct fixed_int tmp;
+  fixed_int_mul(&tmp, a, b);
+  fixed_int_add(r, r, &tmp);
+}
+
+/**
+ * @brief Compute r = r - a * b.
+ */
+inline static void fixed_int_submul(struct fixed_int* r,
+                                    const struct fixed_int* a,
+                                    const struct fixed_int* b) {
+  struct fixed_int tmp;
+  fixed_int_mul(&tmp, a, b);
+  fixed_int_sub(r, r, &tmp);
+}
+
+#endif  // CVORONOI_FIXED_INT_H
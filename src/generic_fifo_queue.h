@@ -40,23 +40,37 @@
 
 /**@brief
  * Generic definition of a FIFO queue
+ *
+ * Popped values are not overwritten: values[0, end) contains all values that
+ * were pushed since the last reset. The walks around a Delaunay vertex rely on
+ * this to reset the flags of all visited neighbours (see
+ * delaunay_get_search_radius()). Since these queues are reset for every
+ * vertex, their size is bounded by the largest number of neighbours of a
+ * vertex.
  */
 struct QUEUE_NAME {
   QUEUE_TYPE *values;
   int size;
   int start;
   int end;
+#ifdef INSTRUMENTATION_ACTIVE
+  /* Largest number of values that were stored in the queue at once. */
+  int high_water;
+#endif
 };
 
 inline static void QUEUE_INIT(struct QUEUE_NAME *q, int size) {
-  q->values = (QUEUE_TYPE *)malloc(size * sizeof(QUEUE_TYPE));
+  q->values = (QUEUE_TYPE *)CVORONOI_MALLOC(size * sizeof(QUEUE_TYPE));
   q->size = size;
+#ifdef INSTRUMENTATION_ACTIVE
+  q->high_water = 0;
+#endif
   q->start = 0;
   q->end = 0;
 }
 
 inline static void QUEUE_DESTROY(struct QUEUE_NAME *q) {
-  free(q->values);
+  CVORONOI_FREE(q->values);
 }
 
 inline static void QUEUE_RESET(struct QUEUE_NAME *q) {
@@ -71,10 +85,13 @@ inline static int QUEUE_IS_EMPTY(struct QUEUE_NAME *q) {
 inline static void QUEUE_PUSH(struct QUEUE_NAME *q, QUEUE_TYPE value) {
   if (q->size == q->end) {
     q->size <<= 1;
-    q->values = realloc(q->values, q->size * sizeof(QUEUE_TYPE));
+    q->values = CVORONOI_REALLOC(q->values, q->size * sizeof(QUEUE_TYPE));
   }
   q->values[q->end] = value;
   q->end++;
+#ifdef INSTRUMENTATION_ACTIVE
+  if (q->end > q->high_water) q->high_water = q->end;
+#endif
 }
 
 inline static QUEUE_TYPE QUEUE_POP(struct QUEUE_NAME *q) {
@@ -44,16 +44,23 @@ struct QUEUE_NAME {
   QUEUE_TYPE *values;
   int size;
   int index;
+#ifdef INSTRUMENTATION_ACTIVE
+  /* Largest number of values that were stored in the queue at once. */
+  int high_water;
+#endif
 };
 
 inline static void QUEUE_INIT(struct QUEUE_NAME *q, int size) {
-  q->values = (QUEUE_TYPE *)malloc(size * sizeof(QUEUE_TYPE));
+  q->values = (QUEUE_TYPE *)CVORONOI_MALLOC(size * sizeof(QUEUE_TYPE));
   q->size = size;
+#ifdef INSTRUMENTATION_ACTIVE
+  q->high_water = 0;
+#endif
   q->index = 0;
 }
 
 inline static void QUEUE_DESTROY(struct QUEUE_NAME *q) {
-  free(q->values);
+  CVORONOI_FREE(q->values);
 }
 
 inline static void QUEUE_RESET(struct QUEUE_NAME *q) {
@@ -67,10 +74,13 @@ inline static int QUEUE_IS_EMPTY(struct QUEUE_NAME *q) {
 inline static void QUEUE_PUSH(struct QUEUE_NAME *q, QUEUE_TYPE value) {
   if (q->size == q->index) {
     q->size <<= 1;
-    q->values = realloc(q->values, q->size * sizeof(QUEUE_TYPE));
+    q->values = CVORONOI_REALLOC(q->values, q->size * sizeof(QUEUE_TYPE));
   }
   q->values[q->index] = value;
   q->index++;
+#ifdef INSTRUMENTATION_ACTIVE
+  if (q->index > q->high_water) q->high_water = q->index;
+#endif
 }
 
 inline static QUEUE_TYPE QUEUE_POP(struct QUEUE_NAME *q) {
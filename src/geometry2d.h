@@ -28,14 +28,21 @@
 #ifndef SWIFT_GEOMETRY_H
 #define SWIFT_GEOMETRY_H
 
-#include <gmp.h>
 #include <math.h>
+
+#include "fixed_int.h"
+
+#ifdef HAVE_GMP
+#include <gmp.h>
+#endif
+
 /**
  * @brief Auxiliary variables used by the arbirary exact tests. Since allocating
  * and deallocating these variables poses a significant overhead, they are best
  * reused.
  */
 struct geometry2d {
+#ifdef HAVE_GMP
   /*! @brief Arbitrary exact vertex coordinates */
   mpz_t aix, aiy, bix, biy, cix, ciy, dix, diy;
 
@@ -48,6 +55,11 @@ struct geometry2d {
   /*! @brief Temporary variable used to store final exact results, before their
    *  sign is evaluated and returned as a finite precision integer. */
   mpz_t result;
+#else
+  /*! @brief Unused, the fixed width exact tests do not need any temporary
+   *  variables. Avoids an empty struct. */
+  int unused;
+#endif
 };
 
 /**
@@ -58,9 +70,13 @@ struct geometry2d {
  * @param g Geometry object.
  */
 inline static void geometry2d_init(struct geometry2d* restrict g) {
+#ifdef HAVE_GMP
   mpz_inits(g->aix, g->aiy, g->bix, g->biy, g->cix, g->ciy, g->dix, g->diy,
             g->s1x, g->s1y, g->s2x, g->s2y, g->s3x, g->s3y, g->tmp1, g->tmp2,
             g->result, NULL);
+#else
+  g->unused = 0;
+#endif
 }
 
 /**
@@ -69,9 +85,11 @@ inline static void geometry2d_init(struct geometry2d* restrict g) {
  * @param g Geometry object.
  */
 inline static void geometry2d_destroy(struct geometry2d* restrict g) {
+#ifdef HAVE_GMP
   mpz_clears(g->aix, g->aiy, g->bix, g->biy, g->cix, g->ciy, g->dix, g->diy,
              g->s1x, g->s1y, g->s2x, g->s2y, g->s3x, g->s3y, g->tmp1, g->tmp2,
              g->result, NULL);
+#endif
 }
 
 /**
@@ -123,10 +141,11 @@ inline static double geometry2d_orient(double ax, double ay, double bx,
  * @brief Arbitrary exact alternative for geometry_orient2d().
  *
  * This function calculates exactly the same thing as the non-exact version, but
- * does so in an integer coordinate basis, using arbitrarily large integers.
- * Since we are not interested in the value of the final result, but only in its
- * sign, this function only returns -1, 0, or 1, depending on the sign of the
- * signed integer triangle area.
+ * does so in an integer coordinate basis, using fixed width integers that are
+ * large enough to hold all intermediate results (see fixed_int.h). Since we are
+ * not interested in the value of the final result, but only in its sign, this
+ * function only returns -1, 0, or 1, depending on the sign of the signed
+ * integer triangle area.
  *
  * @param g Geometry object (containing temporary variables that will be used).
  * @param ax, ay, bx, by, cx, cy Integer coordinates of the three points.
@@ -136,6 +155,33 @@ inline static int geometry2d_orient_exact(
     unsigned long int bx, unsigned long int by, unsigned long int cx,
     unsigned long int cy) {
 
+  /* compute the relative coordinates (these fit in 64 bits) */
+  const __int128 s1x = (long)ax - (long)cx;
+  const __int128 s1y = (long)ay - (long)cy;
+
+  const __int128 s2x = (long)bx - (long)cx;
+  const __int128 s2y = (long)by - (long)cy;
+
+  /* now compute the result using the same 2 steps as the non-exact test (the
+     result fits in 128 bits) */
+  const __int128 result = s1x * s2y - s1y * s2x;
+
+  /* evaluate the sign of result and return */
+  return (result > 0) - (result < 0);
+}
+
+#ifdef HAVE_GMP
+/**
+ * @brief Arbitrary precision version of geometry2d_orient_exact(), using GMP.
+ *
+ * This is only used to cross-check the fixed width implementation of
+ * the orientation test.
+ */
+inline static int geometry2d_orient_exact_gmp(
+    struct geometry2d* restrict g, unsigned long int ax, unsigned long int ay,
+    unsigned long int bx, unsigned long int by, unsigned long int cx,
+    unsigned long int cy) {
+
   /* store the input coordinates into the temporary large integer variables */
   mpz_set_ui(g->aix, ax);
   mpz_set_ui(g->aiy, ay);
@@ -161,6 +207,7 @@ inline static int geometry2d_orient_exact(
   /* evaluate the sign of result and return */
   return mpz_sgn(g->result);
 }
+#endif
 
 /**
  * @brief Non-exact 2D in-circle test.
@@ -236,10 +283,11 @@ inline static double geometry2d_in_sphere(double ax, double ay, double bx,
  * @brief Arbitrary exact alternative for geometry2d_in_sphere().
  *
  * This function calculates exactly the same thing as the non-exact version, but
- * does so in an integer coordinate basis, using arbitrarily large integers.
- * Since we are not interested in the value of the final result, but only in its
- * sign, this function only returns -1, 0, or 1, depending on the sign of the
- * signed integer triangle area.
+ * does so in an integer coordinate basis, using fixed width integers that are
+ * large enough to hold all intermediate results (see fixed_int.h). Since we are
+ * not interested in the value of the final result, but only in its sign, this
+ * function only returns -1, 0, or 1, depending on the sign of the signed
+ * integer triangle area.
  *
  * @param g Geometry object (containing temporary variables that will be used).
  * @param ax, ay, bx, by, cx, cy, dx, dy Integer coordinates of the four points.
@@ -249,6 +297,51 @@ inline static int geometry2d_in_sphere_exact(
     unsigned long int bx, unsigned long int by, unsigned long int cx,
     unsigned long int cy, unsigned long int dx, unsigned long int dy) {
 
+  /* compute the relative coordinates (these fit in 64 bits) */
+  const __int128 s1x = (long)ax - (long)dx;
+  const __int128 s1y = (long)ay - (long)dy;
+
+  const __int128 s2x = (long)bx - (long)dx;
+  const __int128 s2y = (long)by - (long)dy;
+
+  const __int128 s3x = (long)cx - (long)dx;
+  const __int128 s3y = (long)cy - (long)dy;
+
+  /* compute the result using the same 3 steps as in the non-exact version */
+  struct fixed_int result, tmp1, tmp2;
+  fixed_int_set_int128(&result, 0);
+
+  /* accumulate temporary terms in tmp1 and tmp2 and update result (both fit
+     in 128 bits) */
+  fixed_int_set_int128(&tmp1, s2x * s3y - s3x * s2y);
+  fixed_int_set_int128(&tmp2, s1x * s1x + s1y * s1y);
+  fixed_int_addmul(&result, &tmp1, &tmp2);
+
+  fixed_int_set_int128(&tmp1, s3x * s1y - s1x * s3y);
+  fixed_int_set_int128(&tmp2, s2x * s2x + s2y * s2y);
+  fixed_int_addmul(&result, &tmp1, &tmp2);
+
+  fixed_int_set_int128(&tmp1, s1x * s2y - s2x * s1y);
+  fixed_int_set_int128(&tmp2, s3x * s3x + s3y * s3y);
+  fixed_int_addmul(&result, &tmp1, &tmp2);
+
+  /* evaluate the sign of the result and return */
+  return fixed_int_sgn(&result);
+}
+
+#ifdef HAVE_GMP
+/**
+ * @brief Arbitrary precision version of geometry2d_in_sphere_exact(), using
+ * GMP.
+ *
+ * This is only used to cross-check the fixed width implementation of
+ * the in-circle test.
+ */
+inline static int geometry2d_in_sphere_exact_gmp(
+    struct geometry2d* restrict g, unsigned long int ax, unsigned long int ay,
+    unsigned long int bx, unsigned long int by, unsigned long int cx,
+    unsigned long int cy, unsigned long int dx, unsigned long int dy) {
+
   /* copy the coordinate values into the large integer temporary variables */
   mpz_set_ui(g->aix, ax);
   mpz_set_ui(g->aiy, ay);
@@ -297,6 +390,7 @@ inline static int geometry2d_in_sphere_exact(
   /* evaluate the sign of the result and return */
   return mpz_sgn(g->result);
 }
+#endif
 
 /**
  * @brief Compute the coordinates of the circumcenter of the triangle
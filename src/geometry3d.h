@@ -11,15 +11,22 @@
 #ifndef CVORONOI_GEOMETRY3D_H
 #define CVORONOI_GEOMETRY3D_H
 
-#include <gmp.h>
+#include <float.h>
 #include <math.h>
 
+#include "fixed_int.h"
+
+#ifdef HAVE_GMP
+#include <gmp.h>
+#endif
+
 /**
  * @brief Auxiliary variables used by the arbirary exact tests. Since allocating
  * and deallocating these variables poses a significant overhead, they are best
  * reused.
  */
 struct geometry3d {
+#ifdef HAVE_GMP
   /*! @brief Arbitrary exact vertex coordinates */
   mpz_t aix, aiy, aiz, bix, biy, biz, cix, ciy, ciz, dix, diy, diz, eix, eiy,
       eiz;
@@ -33,8 +40,33 @@ struct geometry3d {
   /*! @brief Temporary variable used to store final exact results, before their
    *  sign is evaluated and returned as a finite precision integer. */
   mpz_t result;
+#endif
+
+  /*! @brief Number of orientation tests that were decided by the floating
+   *  point filter. */
+  long int orient_filter_hits;
+
+  /*! @brief Number of orientation tests that needed the exact fallback. */
+  long int orient_filter_misses;
+
+  /*! @brief Number of in-sphere tests that were decided by the floating point
+   *  filter. */
+  long int in_sphere_filter_hits;
+
+  /*! @brief Number of in-sphere tests that needed the exact fallback. */
+  long int in_sphere_filter_misses;
 };
 
+/*! @brief Relative error bound for the floating point orientation test
+ *  (Shewchuk, 1997). The epsilon used here is half the machine epsilon. */
+#define GEOMETRY3D_ORIENT_ERRBOUND \
+  ((7. + 56. * (DBL_EPSILON / 2.)) * (DBL_EPSILON / 2.))
+
+/*! @brief Relative error bound for the floating point in-sphere test
+ *  (Shewchuk, 1997). */
+#define GEOMETRY3D_IN_SPHERE_ERRBOUND \
+  ((16. + 224. * (DBL_EPSILON / 2.)) * (DBL_EPSILON / 2.))
+
 /**
  * @brief Initialize the geometry3d object.
  *
@@ -43,11 +75,17 @@ struct geometry3d {
  * @param g Geometry object.
  */
 inline static void geometry3d_init(struct geometry3d* restrict g) {
+#ifdef HAVE_GMP
   mpz_inits(g->aix, g->aiy, g->aiz, g->bix, g->biy, g->biz, g->cix, g->ciy,
             g->ciz, g->dix, g->diy, g->diz, g->eix, g->eiy, g->eiz, g->s1x,
             g->s1y, g->s1z, g->s2x, g->s2y, g->s2z, g->s3x, g->s3y, g->s3z,
             g->s4x, g->s4y, g->s4z, g->tmp1, g->tmp2, g->ab, g->bc, g->cd,
             g->da, g->ac, g->bd, g->result, NULL);
+#endif
+  g->orient_filter_hits = 0;
+  g->orient_filter_misses = 0;
+  g->in_sphere_filter_hits = 0;
+  g->in_sphere_filter_misses = 0;
 }
 
 /**
@@ -56,16 +94,62 @@ inline static void geometry3d_init(struct geometry3d* restrict g) {
  * @param g Geometry object.
  */
 inline static void geometry3d_destroy(struct geometry3d* restrict g) {
+#ifdef HAVE_GMP
   mpz_clears(g->aix, g->aiy, g->aiz, g->bix, g->biy, g->biz, g->cix, g->ciy,
              g->ciz, g->dix, g->diy, g->diz, g->eix, g->eiy, g->eiz, g->s1x,
              g->s1y, g->s1z, g->s2x, g->s2y, g->s2z, g->s3x, g->s3y, g->s3z,
              g->s4x, g->s4y, g->s4z, g->tmp1, g->tmp2, g->ab, g->bc, g->cd,
              g->da, g->ac, g->bd, g->result, NULL);
+#endif
 }
 
-inline static double geometry3d_orient() {
-  // TODO
-  return -1.;
+/**
+ * @brief Non-exact 3D orientation test.
+ *
+ * This function computes exactly the same determinant as
+ * geometry3d_orient_exact(), but using double precision floating point
+ * arithmetic. The return value has the same sign convention as the exact test,
+ * but due to roundoff it can have the wrong sign (or be zero) when the four
+ * points are (nearly) coplanar.
+ *
+ * @param ax, ay, az, bx, by, bz, cx, cy, cz, dx, dy, dz Coordinates of the
+ * four points.
+ * @param permanent (Returned) Upper bound on the absolute value of the sum of
+ * the terms making up the determinant, used to bound the roundoff error.
+ * @return Signed six times the volume of the tetrahedron abcd.
+ */
+inline static double geometry3d_orient(double ax, double ay, double az,
+                                       double bx, double by, double bz,
+                                       double cx, double cy, double cz,
+                                       double dx, double dy, double dz,
+                                       double* permanent) {
+  /* the code below stays as close as possible to the implementation of the
+     exact test below */
+  const double s1x = ax - dx;
+  const double s1y = ay - dy;
+  const double s1z = az - dz;
+
+  const double s2x = bx - dx;
+  const double s2y = by - dy;
+  const double s2z = bz - dz;
+
+  const double s3x = cx - dx;
+  const double s3y = cy - dy;
+  const double s3z = cz - dz;
+
+  const double s2xs3y = s2x * s3y;
+  const double s3xs2y = s3x * s2y;
+  const double s3xs1y = s3x * s1y;
+  const double s1xs3y = s1x * s3y;
+  const double s1xs2y = s1x * s2y;
+  const double s2xs1y = s2x * s1y;
+
+  *permanent = (fabs(s2xs3y) + fabs(s3xs2y)) * fabs(s1z) +
+               (fabs(s3xs1y) + fabs(s1xs3y)) * fabs(s2z) +
+               (fabs(s1xs2y) + fabs(s2xs1y)) * fabs(s3z);
+
+  return s1z * (s2xs3y - s3xs2y) + s2z * (s3xs1y - s1xs3y) +
+         s3z * (s1xs2y - s2xs1y);
 }
 
 /**
@@ -94,6 +178,52 @@ inline static int geometry3d_orient_exact(
     const unsigned long cz, const unsigned long dx, const unsigned long dy,
     const unsigned long dz) {
 
+  /* compute the relative coordinates (these fit in 64 bits) */
+  const __int128 s1x = (long)ax - (long)dx;
+  const __int128 s1y = (long)ay - (long)dy;
+  const __int128 s1z = (long)az - (long)dz;
+
+  const __int128 s2x = (long)bx - (long)dx;
+  const __int128 s2y = (long)by - (long)dy;
+  const __int128 s2z = (long)bz - (long)dz;
+
+  const __int128 s3x = (long)cx - (long)dx;
+  const __int128 s3y = (long)cy - (long)dy;
+  const __int128 s3z = (long)cz - (long)dz;
+
+  /* Compute the result in 3 steps (the 2x2 minors fit in 128 bits) */
+  struct fixed_int result, tmp1, tmp2;
+  fixed_int_set_int128(&result, 0);
+
+  fixed_int_set_int128(&tmp1, s2x * s3y - s3x * s2y);
+  fixed_int_set_int128(&tmp2, s1z);
+  fixed_int_addmul(&result, &tmp1, &tmp2);
+
+  fixed_int_set_int128(&tmp1, s3x * s1y - s1x * s3y);
+  fixed_int_set_int128(&tmp2, s2z);
+  fixed_int_addmul(&result, &tmp1, &tmp2);
+
+  fixed_int_set_int128(&tmp1, s1x * s2y - s2x * s1y);
+  fixed_int_set_int128(&tmp2, s3z);
+  fixed_int_addmul(&result, &tmp1, &tmp2);
+
+  return fixed_int_sgn(&result);
+}
+
+#ifdef HAVE_GMP
+/**
+ * @brief Arbitrary precision version of geometry3d_orient_exact(), using GMP.
+ *
+ * This is only used to cross-check the fixed width implementation of
+ * the orientation test.
+ */
+inline static int geometry3d_orient_exact_gmp(
+    struct geometry3d* g, const unsigned long ax, const unsigned long ay,
+    const unsigned long az, const unsigned long bx, const unsigned long by,
+    const unsigned long bz, const unsigned long cx, const unsigned long cy,
+    const unsigned long cz, const unsigned long dx, const unsigned long dy,
+    const unsigned long dz) {
+
   /* store the input coordinates into the temporary large integer variables */
   mpz_set_ui(g->aix, ax);
   mpz_set_ui(g->aiy, ay);
@@ -141,10 +271,98 @@ inline static int geometry3d_orient_exact(
 
   return mpz_sgn(g->result);
 }
+#endif
+
+/**
+ * @brief Non-exact 3D in-sphere test.
+ *
+ * This function computes exactly the same determinant as
+ * geometry3d_in_sphere_exact(), but using double precision floating point
+ * arithmetic. Due to roundoff, the sign of the result can be wrong when the
+ * fifth point is (nearly) on the circumsphere of the other four.
+ *
+ * @param ax, ay, az, bx, by, bz, cx, cy, cz, dx, dy, dz, ex, ey, ez
+ * Coordinates of the vertices of the tetrahedron and the test point (e).
+ * @param permanent (Returned) Upper bound on the absolute value of the sum of
+ * the terms making up the determinant, used to bound the roundoff error.
+ * @return Value of the in-sphere determinant.
+ */
+inline static double geometry3d_in_sphere(
+    double ax, double ay, double az, double bx, double by, double bz,
+    double cx, double cy, double cz, double dx, double dy, double dz,
+    double ex, double ey, double ez, double* permanent) {
+  /* the code below stays as close as possible to the implementation of the
+     exact test below */
+  const double s1x = ax - ex;
+  const double s1y = ay - ey;
+  const double s1z = az - ez;
+
+  const double s2x = bx - ex;
+  const double s2y = by - ey;
+  const double s2z = bz - ez;
+
+  const double s3x = cx - ex;
+  const double s3y = cy - ey;
+  const double s3z = cz - ez;
+
+  const double s4x = dx - ex;
+  const double s4y = dy - ey;
+  const double s4z = dz - ez;
 
-inline static double geometry3d_in_sphere() {
-  // TODO
-  return -1.;
+  /* compute intermediate values */
+  const double s1xs2y = s1x * s2y;
+  const double s2xs1y = s2x * s1y;
+  const double ab = s1xs2y - s2xs1y;
+
+  const double s2xs3y = s2x * s3y;
+  const double s3xs2y = s3x * s2y;
+  const double bc = s2xs3y - s3xs2y;
+
+  const double s3xs4y = s3x * s4y;
+  const double s4xs3y = s4x * s3y;
+  const double cd = s3xs4y - s4xs3y;
+
+  const double s4xs1y = s4x * s1y;
+  const double s1xs4y = s1x * s4y;
+  const double da = s4xs1y - s1xs4y;
+
+  const double s1xs3y = s1x * s3y;
+  const double s3xs1y = s3x * s1y;
+  const double ac = s1xs3y - s3xs1y;
+
+  const double s2xs4y = s2x * s4y;
+  const double s4xs2y = s4x * s2y;
+  const double bd = s2xs4y - s4xs2y;
+
+  const double lift1 = s1x * s1x + s1y * s1y + s1z * s1z;
+  const double lift2 = s2x * s2x + s2y * s2y + s2z * s2z;
+  const double lift3 = s3x * s3x + s3y * s3y + s3z * s3z;
+  const double lift4 = s4x * s4x + s4y * s4y + s4z * s4z;
+
+  /* absolute values of the intermediate products */
+  const double ab_plus = fabs(s1xs2y) + fabs(s2xs1y);
+  const double bc_plus = fabs(s2xs3y) + fabs(s3xs2y);
+  const double cd_plus = fabs(s3xs4y) + fabs(s4xs3y);
+  const double da_plus = fabs(s4xs1y) + fabs(s1xs4y);
+  const double ac_plus = fabs(s1xs3y) + fabs(s3xs1y);
+  const double bd_plus = fabs(s2xs4y) + fabs(s4xs2y);
+  const double s1z_plus = fabs(s1z);
+  const double s2z_plus = fabs(s2z);
+  const double s3z_plus = fabs(s3z);
+  const double s4z_plus = fabs(s4z);
+
+  *permanent =
+      lift4 * (s1z_plus * bc_plus + s2z_plus * ac_plus + s3z_plus * ab_plus) +
+      lift3 * (s4z_plus * ab_plus + s1z_plus * bd_plus + s2z_plus * da_plus) +
+      lift2 * (s3z_plus * da_plus + s4z_plus * ac_plus + s1z_plus * cd_plus) +
+      lift1 * (s2z_plus * cd_plus + s3z_plus * bd_plus + s4z_plus * bc_plus);
+
+  /* compute the result as a pairwise sum of the 4 terms (this is the
+     evaluation order assumed by GEOMETRY3D_IN_SPHERE_ERRBOUND) */
+  return (lift4 * (s1z * bc - s2z * ac + s3z * ab) -
+          lift3 * (s4z * ab + s1z * bd + s2z * da)) +
+         (lift2 * (s3z * da + s4z * ac + s1z * cd) -
+          lift1 * (s2z * cd - s3z * bd + s4z * bc));
 }
 
 /**
@@ -170,6 +388,85 @@ inline static int geometry3d_in_sphere_exact(
     const unsigned long cy, const unsigned long cz, const unsigned long dx,
     const unsigned long dy, const unsigned long dz, const unsigned long ex,
     const unsigned long ey, const unsigned long ez) {
+
+  /* compute the relative coordinates (these fit in 64 bits) */
+  const __int128 s1x = (long)ax - (long)ex;
+  const __int128 s1y = (long)ay - (long)ey;
+  const __int128 s1z = (long)az - (long)ez;
+
+  const __int128 s2x = (long)bx - (long)ex;
+  const __int128 s2y = (long)by - (long)ey;
+  const __int128 s2z = (long)bz - (long)ez;
+
+  const __int128 s3x = (long)cx - (long)ex;
+  const __int128 s3y = (long)cy - (long)ey;
+  const __int128 s3z = (long)cz - (long)ez;
+
+  const __int128 s4x = (long)dx - (long)ex;
+  const __int128 s4y = (long)dy - (long)ey;
+  const __int128 s4z = (long)dz - (long)ez;
+
+  /* compute intermediate values (these fit in 128 bits) */
+  struct fixed_int ab, bc, cd, da, ac, bd;
+  fixed_int_set_int128(&ab, s1x * s2y - s2x * s1y);
+  fixed_int_set_int128(&bc, s2x * s3y - s3x * s2y);
+  fixed_int_set_int128(&cd, s3x * s4y - s4x * s3y);
+  fixed_int_set_int128(&da, s4x * s1y - s1x * s4y);
+  fixed_int_set_int128(&ac, s1x * s3y - s3x * s1y);
+  fixed_int_set_int128(&bd, s2x * s4y - s4x * s2y);
+
+  struct fixed_int z1, z2, z3, z4;
+  fixed_int_set_int128(&z1, s1z);
+  fixed_int_set_int128(&z2, s2z);
+  fixed_int_set_int128(&z3, s3z);
+  fixed_int_set_int128(&z4, s4z);
+
+  /* compute the result in 4 steps */
+  struct fixed_int result, tmp1, tmp2;
+  fixed_int_set_int128(&result, 0);
+
+  fixed_int_set_int128(&tmp1, s4x * s4x + s4y * s4y + s4z * s4z);
+  fixed_int_mul(&tmp2, &z1, &bc);
+  fixed_int_submul(&tmp2, &z2, &ac);
+  fixed_int_addmul(&tmp2, &z3, &ab);
+  fixed_int_addmul(&result, &tmp1, &tmp2);
+
+  fixed_int_set_int128(&tmp1, s3x * s3x + s3y * s3y + s3z * s3z);
+  fixed_int_mul(&tmp2, &z4, &ab);
+  fixed_int_addmul(&tmp2, &z1, &bd);
+  fixed_int_addmul(&tmp2, &z2, &da);
+  fixed_int_submul(&result, &tmp1, &tmp2);
+
+  fixed_int_set_int128(&tmp1, s2x * s2x + s2y * s2y + s2z * s2z);
+  fixed_int_mul(&tmp2, &z3, &da);
+  fixed_int_addmul(&tmp2, &z4, &ac);
+  fixed_int_addmul(&tmp2, &z1, &cd);
+  fixed_int_addmul(&result, &tmp1, &tmp2);
+
+  fixed_int_set_int128(&tmp1, s1x * s1x + s1y * s1y + s1z * s1z);
+  fixed_int_mul(&tmp2, &z2, &cd);
+  fixed_int_submul(&tmp2, &z3, &bd);
+  fixed_int_addmul(&tmp2, &z4, &bc);
+  fixed_int_submul(&result, &tmp1, &tmp2);
+
+  return fixed_int_sgn(&result);
+}
+
+#ifdef HAVE_GMP
+/**
+ * @brief Arbitrary precision version of geometry3d_in_sphere_exact(), using
+ * GMP.
+ *
+ * This is only used to cross-check the fixed width implementation of
+ * the in-sphere test.
+ */
+inline static int geometry3d_in_sphere_exact_gmp(
+    struct geometry3d* restrict g, const unsigned long ax,
+    const unsigned long ay, const unsigned long az, const unsigned long bx,
+    const unsigned long by, const unsigned long bz, const unsigned long cx,
+    const unsigned long cy, const unsigned long cz, const unsigned long dx,
+    const unsigned long dy, const unsigned long dz, const unsigned long ex,
+    const unsigned long ey, const unsigned long ez) {
   /* store the input coordinates into the temporary large integer variables */
   mpz_set_ui(g->aix, ax);
   mpz_set_ui(g->aiy, ay);
@@ -264,6 +561,129 @@ inline static int geometry3d_in_sphere_exact(
 
   return mpz_sgn(g->result);
 }
+#endif
+
+/**
+ * @brief Floating point filter for the orientation test.
+ *
+ * @param g Geometry struct.
+ * @param a, b, c, d Rescaled coordinates of the four points.
+ * @return -1 or 1 if the sign of the orientation is certain (see
+ * geometry3d_orient_exact()), 0 if the exact test is needed.
+ */
+inline static int geometry3d_orient_filter(struct geometry3d* restrict g,
+                                           const double* a, const double* b,
+                                           const double* c, const double* d) {
+  double permanent;
+  const double result =
+      geometry3d_orient(a[0], a[1], a[2], b[0], b[1], b[2], c[0], c[1], c[2],
+                        d[0], d[1], d[2], &permanent);
+  const double errbound = GEOMETRY3D_ORIENT_ERRBOUND * permanent;
+
+  if (result > errbound) {
+    g->orient_filter_hits++;
+    return 1;
+  }
+  if (result < -errbound) {
+    g->orient_filter_hits++;
+    return -1;
+  }
+
+  g->orient_filter_misses++;
+  return 0;
+}
+
+/**
+ * @brief Floating point filter for the in-sphere test.
+ *
+ * @param g Geometry struct.
+ * @param a, b, c, d Rescaled coordinates of the vertices of the tetrahedron.
+ * @param e Rescaled coordinates of the test point.
+ * @return -1 or 1 if the sign of the result is certain (see
+ * geometry3d_in_sphere_exact()), 0 if the exact test is needed.
+ */
+inline static int geometry3d_in_sphere_filter(struct geometry3d* restrict g,
+                                              const double* a, const double* b,
+                                              const double* c, const double* d,
+                                              const double* e) {
+  double permanent;
+  const double result = geometry3d_in_sphere(
+      a[0], a[1], a[2], b[0], b[1], b[2], c[0], c[1], c[2], d[0], d[1], d[2],
+      e[0], e[1], e[2], &permanent);
+  const double errbound = GEOMETRY3D_IN_SPHERE_ERRBOUND * permanent;
+
+  if (result > errbound) {
+    g->in_sphere_filter_hits++;
+    return 1;
+  }
+  if (result < -errbound) {
+    g->in_sphere_filter_hits++;
+    return -1;
+  }
+
+  g->in_sphere_filter_misses++;
+  return 0;
+}
+
+/**
+ * @brief Filtered orientation test.
+ *
+ * The orientation is first computed using floating point arithmetic on the
+ * rescaled coordinates. If the absolute value of the result is larger than the
+ * bound on the roundoff error, its sign is returned. Otherwise, we fall back
+ * to the arbitrary exact test on the integer coordinates.
+ *
+ * Since all rescaled coordinates lie in the range [1, 2[, their differences are
+ * computed exactly and correspond to the differences of the integer
+ * coordinates, so that both tests compute the same determinant (up to a
+ * constant positive factor).
+ *
+ * @param g Geometry struct.
+ * @param a, b, c, d Rescaled coordinates of the four points.
+ * @param ai, bi, ci, di Integer coordinates of the four points.
+ * @return -1, 0, or 1, depending on the orientation of the tetrahedron (see
+ * geometry3d_orient_exact()).
+ */
+inline static int geometry3d_orient_adaptive(
+    struct geometry3d* restrict g, const double* a, const double* b,
+    const double* c, const double* d, const unsigned long* ai,
+    const unsigned long* bi, const unsigned long* ci,
+    const unsigned long* di) {
+
+  const int result = geometry3d_orient_filter(g, a, b, c, d);
+  if (result != 0) {
+    return result;
+  }
+  return geometry3d_orient_exact(g, ai[0], ai[1], ai[2], bi[0], bi[1], bi[2],
+                                 ci[0], ci[1], ci[2], di[0], di[1], di[2]);
+}
+
+/**
+ * @brief Filtered in-sphere test.
+ *
+ * Same as geometry3d_orient_adaptive(), but for the in-sphere test.
+ *
+ * @param g Geometry struct.
+ * @param a, b, c, d Rescaled coordinates of the vertices of the tetrahedron.
+ * @param e Rescaled coordinates of the test point.
+ * @param ai, bi, ci, di, ei Integer coordinates of the same five points.
+ * @return -1, 0, or 1, depending on the outcome of the geometric test (see
+ * geometry3d_in_sphere_exact()).
+ */
+inline static int geometry3d_in_sphere_adaptive(
+    struct geometry3d* restrict g, const double* a, const double* b,
+    const double* c, const double* d, const double* e,
+    const unsigned long* ai, const unsigned long* bi, const unsigned long* ci,
+    const unsigned long* di, const unsigned long* ei) {
+
+  const int result = geometry3d_in_sphere_filter(g, a, b, c, d, e);
+  if (result != 0) {
+    return result;
+  }
+  return geometry3d_in_sphere_exact(g, ai[0], ai[1], ai[2], bi[0], bi[1],
+                                    bi[2], ci[0], ci[1], ci[2], di[0], di[1],
+                                    di[2], ei[0], ei[1], ei[2]);
+}
 
 /**
  * @brief Compute the coordinates of the circumcenter of the tetrahedron
@@ -408,4 +828,75 @@ inline static double geometry3d_compute_centroid_area(
   return V;
 }
 
+/**
+ * @brief Compute the area and midpoint of a Voronoi face, and add the volume
+ * and centroid of the pyramid spanned by the face and the generator of the
+ * cell to the given totals.
+ *
+ * The face is a fan of triangles around its first vertex, stored in the order
+ * in which voronoi_reset() collects them: triangle i (i >= 1) consists of the
+ * first vertex and vertices 2i - 1 and 2i, and vertex 2i + 1 is a copy of
+ * vertex 2i. This replaces separate calls to
+ * geometry3d_compute_centroid_area() and
+ * geometry3d_compute_centroid_volume_tetrahedron() for every triangle: the
+ * edge vectors and the cross product of every triangle are shared between the
+ * area and the volume, the (degenerate) triangles between copies of the same
+ * vertex are skipped, and the vertices are only read once.
+ *
+ * @param ax, ay, az Coordinates of the generator.
+ * @param points Vertices of the face (3 coordinates per vertex).
+ * @param n_points Number of vertices (including the copies).
+ * @param midpoint (Returned) Sum of the vertices (see
+ * geometry3d_compute_centroid_area()).
+ * @param volume (Updated) Total volume.
+ * @param centroid (Updated) Total volume weighted centroid.
+ * @return Area of the face.
+ */
+inline static double geometry3d_compute_centroid_volume_area_face(
+    double ax, double ay, double az, const double* restrict points,
+    int n_points, double* restrict midpoint, double* restrict volume,
+    double* restrict centroid) {
+  midpoint[0] = 0.;
+  midpoint[1] = 0.;
+  midpoint[2] = 0.;
+  for (int i = 0; i < n_points; i++) {
+    midpoint[0] += points[3 * i];
+    midpoint[1] += points[3 * i + 1];
+    midpoint[2] += points[3 * i + 2];
+  }
+
+  const double v0x = points[0];
+  const double v0y = points[1];
+  const double v0z = points[2];
+  /* generator relative to the first vertex */
+  const double gx = ax - v0x;
+  const double gy = ay - v0y;
+  const double gz = az - v0z;
+
+  double area = 0.;
+  for (int i = 2; i < n_points; i += 2) {
+    const double* restrict p1 = &points[3 * i - 3];
+    const double* restrict p2 = &points[3 * i];
+    const double e1x = p1[0] - v0x;
+    const double e1y = p1[1] - v0y;
+    const double e1z = p1[2] - v0z;
+    const double e2x = p2[0] - v0x;
+    const double e2y = p2[1] - v0y;
+    const double e2z = p2[2] - v0z;
+
+    const double Dx = e1y * e2z - e1z * e2y;
+    const double Dy = e1z * e2x - e1x * e2z;
+    const double Dz = e1x * e2y - e1y * e2x;
+
+    area += sqrt(Dx * Dx + Dy * Dy + Dz * Dz) / 2.;
+
+    const double V = fabs(gx * Dx + gy * Dy + gz * Dz) / 6.;
+    *volume += V;
+    centroid[0] += V * ((ax + v0x + p1[0] + p2[0]) / 4.);
+    centroid[1] += V * ((ay + v0y + p1[1] + p2[1]) / 4.);
+    centroid[2] += V * ((az + v0z + p1[2] + p2[2]) / 4.);
+  }
+  return area;
+}
+
 #endif  // CVORONOI_GEOMETRY3D_H
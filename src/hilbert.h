@@ -22,23 +22,48 @@
  *
  * @brief Hilbert space-filling curve.
  *
+ * hilbert_get_key() computes a single key one bit level at a time, using a
+ * state table for the curve. hilbert_get_keys() computes the keys of many
+ * points at once: the quantised coordinates are first interleaved into a
+ * Morton code (using pdep if BMI2 is available), after which the state table
+ * is walked two bit levels at a time, using a larger table that combines two
+ * steps of the original table.
+ *
  * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
  */
 
 #ifndef SWIFT_HILBERT_H
 #define SWIFT_HILBERT_H
 
+#include <stdint.h>
+
 #include "dimensionality.h"
 
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
 #if defined(DIMENSIONALITY_2D)
 
+/*! @brief Number of dimensions of the curve. */
+#define HILBERT_DIM 2
+/*! @brief Number of bits per coordinate used by hilbert_get_keys(). */
+#define HILBERT_NBITS 32
+/*! @brief Number of states of the Hilbert curve state table. */
+#define HILBERT_NSTATES 8
+/*! @brief Initial state of the Hilbert curve state table. */
+#define HILBERT_START_STATE 7
+/*! @brief State table of the Hilbert curve. */
+#define hilbert_table t2d
+
 static const unsigned int t2d[8][4][2] = {
     {{7, 0}, {0, 1}, {6, 3}, {0, 2}}, {{1, 2}, {7, 3}, {1, 1}, {6, 0}},
     {{2, 1}, {2, 2}, {4, 0}, {5, 3}}, {{4, 3}, {5, 0}, {3, 2}, {3, 1}},
     {{3, 3}, {4, 2}, {2, 0}, {4, 1}}, {{5, 1}, {3, 0}, {5, 2}, {2, 3}},
     {{6, 2}, {6, 1}, {0, 3}, {1, 0}}, {{0, 0}, {1, 3}, {7, 1}, {7, 2}}};
 
-unsigned long hilbert_get_key(unsigned long* bits, unsigned int nbits) {
+inline static unsigned long hilbert_get_key(unsigned long* bits,
+                                            unsigned int nbits) {
   unsigned long key = 0;
   unsigned long mask = 1;
   mask <<= (nbits - 1);
@@ -57,7 +82,48 @@ unsigned long hilbert_get_key(unsigned long* bits, unsigned int nbits) {
   return key;
 }
 
+/**
+ * @brief Spread the lowest HILBERT_NBITS bits of the given value, so that
+ * there is an empty bit in between every two bits.
+ *
+ * @param x Value.
+ * @return Spread value.
+ */
+inline static uint64_t hilbert_spread_bits(uint64_t x) {
+#ifdef __BMI2__
+  return _pdep_u64(x, 0x5555555555555555ull);
 #else
+  x &= 0x00000000ffffffffull;
+  x = (x | (x << 16)) & 0x0000ffff0000ffffull;
+  x = (x | (x << 8)) & 0x00ff00ff00ff00ffull;
+  x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0full;
+  x = (x | (x << 2)) & 0x3333333333333333ull;
+  x = (x | (x << 1)) & 0x5555555555555555ull;
+  return x;
+#endif
+}
+
+/**
+ * @brief Interleave the bits of the given coordinates into a Morton code.
+ *
+ * Every group of HILBERT_DIM bits of the result contains the bits of the
+ * coordinates at the same level, in the same order as the index into the state
+ * table used by hilbert_get_key().
+ *
+ * @param bits Integer coordinates.
+ * @return Morton code.
+ */
+inline static uint64_t hilbert_get_morton_code(const unsigned long* bits) {
+  return (hilbert_spread_bits(bits[0]) << 1) | hilbert_spread_bits(bits[1]);
+}
+
+#else
+
+#define HILBERT_DIM 3
+#define HILBERT_NBITS 21
+#define HILBERT_NSTATES 12
+#define HILBERT_START_STATE 4
+#define hilbert_table t3d
 
 static const unsigned int t3d[12][8][2] = {
     {{5, 0}, {1, 7}, {4, 1}, {2, 6}, {3, 3}, {3, 4}, {4, 2}, {2, 5}},
@@ -73,7 +139,8 @@ static const unsigned int t3d[12][8][2] = {
     {{11, 2}, {11, 1}, {3, 5}, {3, 6}, {5, 3}, {2, 0}, {5, 4}, {8, 7}},
     {{7, 4}, {7, 3}, {4, 5}, {2, 2}, {6, 7}, {10, 0}, {4, 6}, {2, 1}}};
 
-unsigned long hilbert_get_key(unsigned long* bits, unsigned int nbits) {
+inline static unsigned long hilbert_get_key(unsigned long* bits,
+                                            unsigned int nbits) {
   unsigned long key = 0;
   unsigned long mask = 1;
   mask <<= nbits - 1;
@@ -93,6 +160,119 @@ unsigned long hilbert_get_key(unsigned long* bits, unsigned int nbits) {
   return key;
 }
 
+/**
+ * @brief Spread the lowest HILBERT_NBITS bits of the given value, so that
+ * there are two empty bits in between every two bits.
+ *
+ * @param x Value.
+ * @return Spread value.
+ */
+inline static uint64_t hilbert_spread_bits(uint64_t x) {
+#ifdef __BMI2__
+  return _pdep_u64(x, 0x1249249249249249ull);
+#else
+  x &= 0x00000000001fffffull;
+  x = (x | (x << 32)) & 0x001f00000000ffffull;
+  x = (x | (x << 16)) & 0x001f0000ff0000ffull;
+  x = (x | (x << 8)) & 0x100f00f00f00f00full;
+  x = (x | (x << 4)) & 0x10c30c30c30c30c3ull;
+  x = (x | (x << 2)) & 0x1249249249249249ull;
+  return x;
+#endif
+}
+
+/**
+ * @brief Interleave the bits of the given coordinates into a Morton code.
+ *
+ * Every group of HILBERT_DIM bits of the result contains the bits of the
+ * coordinates at the same level, in the same order as the index into the state
+ * table used by hilbert_get_key().
+ *
+ * @param bits Integer coordinates.
+ * @return Morton code.
+ */
+inline static uint64_t hilbert_get_morton_code(const unsigned long* bits) {
+  return (hilbert_spread_bits(bits[0]) << 2) |
+         (hilbert_spread_bits(bits[1]) << 1) | hilbert_spread_bits(bits[2]);
+}
+
 #endif
 
+/*! @brief Number of entries of the state table for two bit levels. */
+#define HILBERT_PAIR_SIZE (1 << (2 * HILBERT_DIM))
+
+/*! @brief Number of points that are quantised at once in hilbert_get_keys().
+ */
+#define HILBERT_BLOCK_SIZE 64
+
+/**
+ * @brief Compute the Hilbert keys of the given points.
+ *
+ * The keys are the same as the ones obtained by calling hilbert_get_key() with
+ * HILBERT_NBITS bits for each of the points. The coordinates are quantised in
+ * blocks (these loops can be vectorised by the compiler), after which the keys
+ * are computed from the Morton codes of the points, two bit levels at a time.
+ *
+ * @param x Coordinates of the points (3 per point, also in 2D).
+ * @param n Number of points.
+ * @param anchor Anchor of the box containing the points.
+ * @param side Side lengths of the box containing the points.
+ * @param keys (Returned) Hilbert keys of the points.
+ */
+inline static void hilbert_get_keys(const double* restrict x, int n,
+                                    const double* anchor, const double* side,
+                                    unsigned long* restrict keys) {
+  /* combine two steps of the state table. The table is small enough to set it
+   * up for every call, which avoids global state. */
+  unsigned char table[HILBERT_NSTATES][HILBERT_PAIR_SIZE][2];
+  for (int s = 0; s < HILBERT_NSTATES; s++) {
+    for (int hi = 0; hi < (1 << HILBERT_DIM); hi++) {
+      const unsigned int s_hi = hilbert_table[s][hi][0];
+      for (int lo = 0; lo < (1 << HILBERT_DIM); lo++) {
+        const int ci = (hi << HILBERT_DIM) | lo;
+        table[s][ci][0] = hilbert_table[s_hi][lo][0];
+        table[s][ci][1] = (hilbert_table[s][hi][1] << HILBERT_DIM) |
+                          hilbert_table[s_hi][lo][1];
+      }
+    }
+  }
+
+  const double scale = (double)(1ul << HILBERT_NBITS);
+  for (int start = 0; start < n; start += HILBERT_BLOCK_SIZE) {
+    const int end =
+        start + HILBERT_BLOCK_SIZE < n ? start + HILBERT_BLOCK_SIZE : n;
+
+    /* quantise the coordinates */
+    unsigned long bits[HILBERT_BLOCK_SIZE][3];
+    for (int i = start; i < end; i++) {
+      for (int k = 0; k < HILBERT_DIM; k++) {
+        bits[i - start][k] = (x[3 * i + k] - anchor[k]) / side[k] * scale;
+      }
+    }
+
+    for (int i = start; i < end; i++) {
+      const uint64_t morton = hilbert_get_morton_code(bits[i - start]);
+      unsigned long key = 0;
+      unsigned int si = HILBERT_START_STATE;
+      int level = HILBERT_NBITS;
+      if (level % 2) {
+        /* odd number of levels: do the first one separately */
+        --level;
+        const unsigned int ci =
+            (morton >> (HILBERT_DIM * level)) & ((1 << HILBERT_DIM) - 1);
+        key = hilbert_table[si][ci][1];
+        si = hilbert_table[si][ci][0];
+      }
+      while (level > 0) {
+        level -= 2;
+        const unsigned int ci =
+            (morton >> (HILBERT_DIM * level)) & (HILBERT_PAIR_SIZE - 1);
+        key = (key << (2 * HILBERT_DIM)) | table[si][ci][1];
+        si = table[si][ci][0];
+      }
+      keys[i] = key;
+    }
+  }
+}
+
 #endif  // SWIFT_HILBERT_H
@@ -0,0 +1,155 @@
+/**
+ * @file instrumentation.h
+ *
+ * @brief Optional counters and timers for the construction of the
+ * tessellations.
+ *
+ * The instrumentation is only compiled in if INSTRUMENTATION_ACTIVE is defined.
+ * Otherwise, all macros in this file expand to nothing, and the structs that
+ * hold the counters and timers are not part of the tessellations and cells, so
+ * that the instrumentation has no cost at all.
+ *
+ * Every Delaunay tessellation keeps a set of event counters (see
+ * enum instrumentation_counter), and every cell keeps the accumulated
+ * wall-clock time of the construction phases (see enum instrumentation_timer).
+ * Both are accumulated over the lifetime of the tessellation and cell (e.g.
+ * over all iterations of a Lloyd relaxation). When active, the queues also
+ * record their high-water mark (see generic_lifo_queue.h). All results for a
+ * cell can be written as JSON with cell_print_instrumentation().
+ */
+
+#ifndef CVORONOI_INSTRUMENTATION_H
+#define CVORONOI_INSTRUMENTATION_H
+
+#include <string.h>
+#include <time.h>
+
+/*! @brief Activate the instrumentation counters and timers. */
+//#define INSTRUMENTATION_ACTIVE
+
+/**
+ * @brief Events that are counted during the construction of a Delaunay
+ * tessellation.
+ */
+enum instrumentation_counter {
+  /*! @brief Simplices visited while walking to the simplex containing a new
+   *  vertex. */
+  INSTRUMENTATION_WALK_STEPS = 0,
+  /*! @brief Flips (3D only). */
+  INSTRUMENTATION_FLIP_1_TO_4,
+  INSTRUMENTATION_FLIP_2_TO_6,
+  INSTRUMENTATION_FLIP_N_TO_2N,
+  INSTRUMENTATION_FLIP_2_TO_3,
+  INSTRUMENTATION_FLIP_3_TO_2,
+  INSTRUMENTATION_FLIP_4_TO_4,
+  /*! @brief New tetrahedra that reuse a free spot in the tetrahedron array
+   *  (3D only). */
+  INSTRUMENTATION_RECYCLED_TETRAHEDRA,
+  /*! @brief Number of counters. */
+  INSTRUMENTATION_COUNTER_COUNT
+};
+
+/**
+ * @brief Get the name of the given counter in the JSON output.
+ *
+ * @param counter Counter.
+ * @return Name.
+ */
+inline static const char *instrumentation_get_counter_name(int counter) {
+  static const char *names[INSTRUMENTATION_COUNTER_COUNT] = {
+      "walk_steps",  "flip_1_to_4", "flip_2_to_6", "flip_n_to_2n",
+      "flip_2_to_3", "flip_3_to_2", "flip_4_to_4", "recycled_tetrahedra"};
+  return names[counter];
+}
+
+/**
+ * @brief Timed phases of the construction of the tessellations of a cell.
+ */
+enum instrumentation_timer {
+  /*! @brief Insertion of the local vertices. */
+  INSTRUMENTATION_LOCAL_INSERTION = 0,
+  /*! @brief Insertion of the ghost vertices. */
+  INSTRUMENTATION_GHOST_INSERTION,
+  /*! @brief Updating the search radii while adding ghosts. */
+  INSTRUMENTATION_SEARCH_RADII,
+  /*! @brief Construction of the Voronoi grid. */
+  INSTRUMENTATION_VORONOI,
+  /*! @brief Number of timers. */
+  INSTRUMENTATION_TIMER_COUNT
+};
+
+/**
+ * @brief Get the name of the given timer in the JSON output.
+ *
+ * @param timer Timer.
+ * @return Name.
+ */
+inline static const char *instrumentation_get_timer_name(int timer) {
+  static const char *names[INSTRUMENTATION_TIMER_COUNT] = {
+      "local_insertion", "ghost_insertion", "search_radii", "voronoi"};
+  return names[timer];
+}
+
+/**
+ * @brief Event counters of a Delaunay tessellation.
+ */
+struct instrumentation_counters {
+  /*! @brief Counter values (indexed by enum instrumentation_counter). */
+  long long values[INSTRUMENTATION_COUNTER_COUNT];
+};
+
+/**
+ * @brief Accumulated wall-clock times of the construction phases of a cell.
+ */
+struct instrumentation_timers {
+  /*! @brief Times in seconds (indexed by enum instrumentation_timer). */
+  double values[INSTRUMENTATION_TIMER_COUNT];
+};
+
+/**
+ * @brief Get the current wall-clock time.
+ *
+ * @return Time in seconds since some arbitrary point in the past.
+ */
+inline static double instrumentation_get_time(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1.e-9 * ts.tv_nsec;
+}
+
+#ifdef INSTRUMENTATION_ACTIVE
+
+/**
+ * @brief Reset all counters (or timers) in the given struct to zero.
+ */
+#define instrumentation_reset(s) memset((s)->values, 0, sizeof((s)->values))
+
+/**
+ * @brief Increase the given counter by 1.
+ */
+#define instrumentation_count(counters, counter) (counters)->values[counter]++
+
+/**
+ * @brief Start timing a phase: store the current time in a new local variable
+ * with the given name.
+ */
+#define instrumentation_timer_start(name) \
+  const double name = instrumentation_get_time()
+
+/**
+ * @brief Stop timing a phase that was started with
+ * instrumentation_timer_start(), and add the elapsed time to the given timer.
+ */
+#define instrumentation_timer_stop(timers, timer, name) \
+  (timers)->values[timer] += instrumentation_get_time() - name
+
+#else
+
+#define instrumentation_reset(s)
+#define instrumentation_count(counters, counter)
+#define instrumentation_timer_start(name)
+#define instrumentation_timer_stop(timers, timer, name)
+
+#endif
+
+#endif  // CVORONOI_INSTRUMENTATION_H
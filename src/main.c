@@ -31,19 +31,19 @@
  * a 2D Voronoi grid in the simulation code SWIFT.
  *
  * The prototype code can be compiled using
- *   gcc -std=gnu99 -o test main.c -lgmp -lm
+ *   gcc -std=gnu99 -o test main.c -lm
+ * (add -DHAVE_GMP -lgmp to also compile the GMP versions of the exact tests).
  *
  * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
  */
 
-/* Since I didn't feel like implementing my own sorting routines, I use the
-   non-standard sorting function qsort_r(). The define below supresses a
-   compiler warning caused by the use of this non-standard function. */
-#define _GNU_SOURCE
-
 #include <math.h>
+#include <unistd.h>
+
 #include "cell.h"
 #include "queues.h"
+#include "space.h"
+#include "threadpool.h"
 #include "tuples.h"
 
 /**
@@ -139,20 +139,61 @@ int main() {
   /* Now print the Voronoi grid for visual inspection. */
   char vor_filename[50];
   char del_filename[50];
-  sprintf(vor_filename, "vtest.txt");
-  sprintf(del_filename, "test.txt");
+  sprintf(vor_filename, "vtest.bin");
+  sprintf(del_filename, "test.bin");
   cell_print_tesselations(&c, vor_filename, del_filename);
 
   /* Lloyd's relaxation */
   for (int loop = 1; loop <= 20; ++loop) {
     printf("Relaxation loop %i\n", loop);
     cell_lloyd_relax_vertices(&c);
-    sprintf(vor_filename, "vtest%03i.txt", loop);
-    sprintf(del_filename, "test%03i.txt", loop);
+    sprintf(vor_filename, "vtest%03i.bin", loop);
+    sprintf(del_filename, "test%03i.bin", loop);
     cell_print_tesselations(&c, vor_filename, del_filename);
   }
+  printf("Memory high-water mark: %g MiB\n",
+         cell_get_memory_size(&c) / (1024. * 1024.));
+  cell_print_instrumentation(&c, "instrumentation.json");
 
   /* cleanup */
   cell_destroy(&c);
+
+  /* Now construct the tessellations of a box split into multiple cells, in
+     parallel */
+  const int n = 4;
+  double *vertices = (double *)malloc(3 * n * n * n * sizeof(double));
+  for (int i = 0; i < n * n * n; i++) {
+    vertices[3 * i] =
+        (i / (n * n) + 0.5 + 0.5 * (get_random_uniform_double() - 0.5)) / n;
+    vertices[3 * i + 1] =
+        ((i / n) % n + 0.5 + 0.5 * (get_random_uniform_double() - 0.5)) / n;
+    vertices[3 * i + 2] =
+        (i % n + 0.5 + 0.5 * (get_random_uniform_double() - 0.5)) / n;
+  }
+#if defined(DIMENSIONALITY_2D)
+  int cdim[3] = {2, 2, 1};
+#else
+  int cdim[3] = {2, 2, 2};
+#endif
+  struct space s;
+  space_init(&s, vertices, n * n * n, dim, cdim);
+  struct threadpool tp;
+  threadpool_init(&tp, (int)sysconf(_SC_NPROCESSORS_ONLN));
+  /* keep the cells on the NUMA domain they were initialized on */
+  threadpool_pin_threads(&tp);
+  space_construct_tessellations(&s, &tp);
+  double total_volume = 0.;
+  for (int i = 0; i < s.nr_cells; i++) {
+    for (int j = 0; j < s.cells[i].v.number_of_cells; j++) {
+      total_volume += s.cells[i].v.cells[j].volume;
+    }
+  }
+  printf("Total volume of %i cells: %g\n", s.nr_cells, total_volume);
+  printf("Memory high-water mark of %i cells: %g MiB\n", s.nr_cells,
+         space_get_memory_size(&s) / (1024. * 1024.));
+  space_print_instrumentation(&s, "space_instrumentation.json");
+  threadpool_destroy(&tp);
+  space_destroy(&s);
+  free(vertices);
   return 0;
 }
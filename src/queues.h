@@ -8,12 +8,16 @@
  * @brief Generates code for a int LIFO queue and an int3 FIFO queue
  */
 
+#include "allocator.h"
+#include "instrumentation.h"
 #include "tuples.h"
 
 #ifndef CVORONOI_QUEUES_H
 #define CVORONOI_QUEUES_H
 
+#ifndef CVORONOI_NO_CHECKS
 #define QUEUE_SAFETY_CHECKS
+#endif
 
 #define QUEUE_TYPE int
 #include "generic_lifo_queue.h"
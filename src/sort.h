@@ -2,144 +2,141 @@
 // Created by yuyttenh on 07/06/2021.
 //
 
-#ifndef CVORONOI_SORT_H
-
 /**
- * @brief Comparison function for two double precision floating point values.
+ * @file sort.h
  *
- * @param a First value.
- * @param b Second value.
- * @return -1 if a < b, 0 if a == b, +1 if a > b.
- */
-int compare_double(const double a, const double b) {
-  if (a < b) {
-    return -1;
-  } else {
-    if (a > b) {
-      return 1;
-    } else {
-      return 0;
-    }
-  }
-}
-
-/**
- * @brief Comparison function for two unsigned long values.
+ * @brief Radix sorts used to arg-sort the vertices of a cell.
  *
- * @param a First value.
- * @param b Second value.
- * @return -1 if a < b, 0 if a == b, +1 if a > b.
+ * All sorts are least significant digit radix sorts on 64-bit unsigned keys
+ * (key-value sorts, with the index of the element as value). Floating point
+ * values are first converted to keys with the same ordering (see
+ * sort_double_to_key()). Radix sorts are stable and run in linear time, and
+ * passes over digits that are the same for all keys are skipped. Since they do
+ * not depend on any (non-standard) comparison function with context, these
+ * sorts are also safe to call concurrently on different arrays.
  */
-int compare_unsigned_long(const unsigned long a, const unsigned long b) {
-  if (a < b) {
-    return -1;
-  } else {
-    if (a > b) {
-      return 1;
-    } else {
-      return 0;
-    }
-  }
-}
 
-/**
- * @brief Sorting function used to sort vertex_indices along the horizontal direction.
- *
- * @param a First index.
- * @param b Second index.
- * @param x Vertex array to sort.
- * @return Return value of compare_double() for the x-coordinates of vertex_indices a
- * and b.
- */
-int sort_x_comp(const void *a, const void *b, void *x) {
-  int ai = *(int *)a;
-  int bi = *(int *)b;
-  double *vertices = (double *)x;
-  double ax = vertices[3 * ai];
-  double bx = vertices[3 * bi];
-  return compare_double(ax, bx);
-}
+#ifndef CVORONOI_SORT_H
+#define CVORONOI_SORT_H
 
-/**
- * @brief Sorting function used to sort vertex_indices along the vertical direction.
- *
- * @param a First index.
- * @param b Second index.
- * @param x Vertex array to sort.
- * @return Return value of compare_double() for the y-coordinates of vertex_indices a
- * and b.
- */
-int sort_y_comp(const void *a, const void *b, void *x) {
-  int ai = *(int *)a;
-  int bi = *(int *)b;
-  double *vertices = (double *)x;
-  double ay = vertices[3 * ai + 1];
-  double by = vertices[3 * bi + 1];
-  return compare_double(ay, by);
-}
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*! @brief Number of bits sorted in a single radix sort pass. */
+#define SORT_RADIX_BITS 8
+
+/*! @brief Number of buckets of a single radix sort pass. */
+#define SORT_RADIX_SIZE (1 << SORT_RADIX_BITS)
+
+/*! @brief Number of radix sort passes needed for a 64-bit key. */
+#define SORT_RADIX_PASSES (64 / SORT_RADIX_BITS)
 
 /**
- * @brief Sorting function used to sort vertex_indices along the first diagonal.
+ * @brief Convert the given double precision floating point value to an
+ * unsigned 64-bit key with the same ordering.
  *
- * The first diagonal is the line x = y.
+ * For positive values, flipping the sign bit suffices. For negative values,
+ * all bits are flipped, so that larger absolute values give smaller keys.
  *
- * @param a First index.
- * @param b Second index.
- * @param x Vertex array to sort.
- * @return Return value of compare_double() for the diagonal sum value (x+y) of
- * the x- and y-coordinates of vertex_indices a and b.
+ * @param x Value (not NaN).
+ * @return Key.
  */
-int sort_xyp_comp(const void *a, const void *b, void *x) {
-  int ai = *(int *)a;
-  int bi = *(int *)b;
-  double *vertices = (double *)x;
-  double ax = vertices[3 * ai];
-  double ay = vertices[3 * ai + 1];
-  double bx = vertices[3 * bi];
-  double by = vertices[3 * bi + 1];
-  return compare_double(ax + ay, bx + by);
+inline static uint64_t sort_double_to_key(double x) {
+  union {
+    double d;
+    uint64_t u;
+  } u;
+  u.d = x;
+  const uint64_t mask = (uint64_t)((int64_t)u.u >> 63) | (1ull << 63);
+  return u.u ^ mask;
 }
 
 /**
- * @brief Sorting function used to sort vertex_indices along the second diagonal.
+ * @brief Sort the given key-value pairs on their keys.
  *
- * The second diagonal is the line x = -y.
+ * The sort is stable: pairs with equal keys keep their order.
  *
- * @param a First index.
- * @param b Second index.
- * @param x Vertex array to sort.
- * @return Return value of compare_double() for the diagonal difference value
- * (x-y) of the x- and y-coordinates of vertex_indices a and b.
+ * @param keys Keys (sorted on return).
+ * @param values Values (sorted along with the keys).
+ * @param n Number of pairs.
  */
-int sort_xym_comp(const void *a, const void *b, void *x) {
-  int ai = *(int *)a;
-  int bi = *(int *)b;
-  double *vertices = (double *)x;
-  double ax = vertices[3 * ai];
-  double ay = vertices[3 * ai + 1];
-  double bx = vertices[3 * bi];
-  double by = vertices[3 * bi + 1];
-  return compare_double(ax - ay, bx - by);
+inline static void sort_radix_pairs(uint64_t *restrict keys,
+                                    int *restrict values, int n) {
+  if (n < 2) return;
+
+  /* histograms of all digits in a single pass over the keys */
+  int *counts = (int *)calloc(SORT_RADIX_PASSES * SORT_RADIX_SIZE, sizeof(int));
+  for (int i = 0; i < n; i++) {
+    uint64_t key = keys[i];
+    for (int p = 0; p < SORT_RADIX_PASSES; p++) {
+      counts[p * SORT_RADIX_SIZE + (key & (SORT_RADIX_SIZE - 1))]++;
+      key >>= SORT_RADIX_BITS;
+    }
+  }
+
+  uint64_t *tmp_keys = (uint64_t *)malloc(n * sizeof(uint64_t));
+  int *tmp_values = (int *)malloc(n * sizeof(int));
+  uint64_t *src_keys = keys, *dst_keys = tmp_keys;
+  int *src_values = values, *dst_values = tmp_values;
+  for (int p = 0; p < SORT_RADIX_PASSES; p++) {
+    int *count = &counts[p * SORT_RADIX_SIZE];
+    const int shift = p * SORT_RADIX_BITS;
+    /* skip passes over digits that are the same for all keys */
+    if (count[(src_keys[0] >> shift) & (SORT_RADIX_SIZE - 1)] == n) continue;
+
+    /* convert the histogram to offsets */
+    int offset = 0;
+    for (int b = 0; b < SORT_RADIX_SIZE; b++) {
+      const int c = count[b];
+      count[b] = offset;
+      offset += c;
+    }
+
+    for (int i = 0; i < n; i++) {
+      const int b = (src_keys[i] >> shift) & (SORT_RADIX_SIZE - 1);
+      const int j = count[b]++;
+      dst_keys[j] = src_keys[i];
+      dst_values[j] = src_values[i];
+    }
+
+    /* swap the buffers */
+    uint64_t *swap_keys = src_keys;
+    src_keys = dst_keys;
+    dst_keys = swap_keys;
+    int *swap_values = src_values;
+    src_values = dst_values;
+    dst_values = swap_values;
+  }
+
+  /* make sure the result ends up in the input arrays */
+  if (src_keys != keys) {
+    memcpy(keys, src_keys, n * sizeof(uint64_t));
+    memcpy(values, src_values, n * sizeof(int));
+  }
+
+  free(tmp_keys);
+  free(tmp_values);
+  free(counts);
 }
 
 /**
- * @brief Sorting function used to sort vertex_indices on their Hilbert key.
+ * @brief Arg-sort the given array of unsigned keys.
  *
- * @param a First index.
- * @param b Second index.
- * @param x Hilbert key array to sort.
- * @return Return value of compare_unsigned_long() for the hilbert key of
- * vertex_indices a and b.
+ * @param keys Keys to sort on.
+ * @param idx Indices into keys. On input, these can be in any order (e.g. the
+ * result of a previous sort, since this does not change the result); on
+ * return, keys[idx[i]] is sorted in ascending order.
+ * @param n Number of keys.
+ * @param tmp Scratch space for n keys.
  */
-int sort_h_comp(const void *a, const void *b, void *x) {
-  int ai = *(int *)a;
-  int bi = *(int *)b;
-  unsigned long *keys = (unsigned long *)x;
-  unsigned long ah = keys[ai];
-  unsigned long bh = keys[bi];
-  return compare_unsigned_long(ah, bh);
+inline static void sort_arg_keys(const unsigned long *restrict keys,
+                                 int *restrict idx, int n,
+                                 uint64_t *restrict tmp) {
+  for (int i = 0; i < n; i++) {
+    tmp[i] = keys[idx[i]];
+  }
+  sort_radix_pairs(tmp, idx, n);
 }
 
-#define CVORONOI_SORT_H
-
 #endif  // CVORONOI_SORT_H
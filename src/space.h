@@ -0,0 +1,765 @@
+/**
+ * @file space.h
+ *
+ * @brief Periodic simulation box that is split into a regular grid of cells,
+ * whose tessellations are constructed in parallel.
+ *
+ * Every cell has its own Delaunay tessellation (and hence its own geometry
+ * scratch variables and queues) and Voronoi grid, so that the tessellations of
+ * different cells can be constructed concurrently without any locking. The
+ * ghost vertices of a cell are taken from its 26 (8 in 2D) neighbouring
+ * cells, using periodic copies at the boundaries of the box. This requires the
+ * cells to contain enough vertices, which is checked when DELAUNAY_CHECKS is
+ * activated.
+ *
+ * The same mechanism is used to construct the grid of a single large cell in
+ * parallel (see space_construct_cell_parallel()).
+ *
+ * The cells are initialized by the threads that construct their
+ * tessellations (see space_init_cells()), so that on NUMA systems, the memory
+ * of every cell is placed on the domain of the thread that uses it. Pinning
+ * the threads of the pool (see threadpool_pin_threads()) keeps the blocks of
+ * neighbouring cells on the same domain for all later mappings.
+ *
+ * To repeatedly rebuild the tessellations of moving vertices, a pipeline (see
+ * struct space_pipeline) passes every grid on to its consumers as soon as it
+ * is complete, and overlaps the output of the grids of one step with the
+ * construction of the next.
+ */
+
+#ifndef CVORONOI_SPACE_H
+#define CVORONOI_SPACE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "binary_input.h"
+#include "cell.h"
+#include "dimensionality.h"
+#include "threadpool.h"
+
+/*! @brief Regular grid of cells covering a periodic box. */
+struct space {
+  /*! @brief Anchor of the periodic box. */
+  double anchor[3];
+
+  /*! @brief Side lengths of the periodic box. */
+  double dim[3];
+
+  /*! @brief Number of cells in every direction. */
+  int cdim[3];
+
+  /*! @brief Side lengths of a single cell. */
+  double width[3];
+
+  /*! @brief Total number of cells. */
+  int nr_cells;
+
+  /*! @brief Cells. */
+  struct cell *cells;
+
+  /*! @brief Offsets of the vertices of every cell in vertex_index (size
+   *  nr_cells + 1). */
+  int *cell_offsets;
+
+  /*! @brief Original indices of the vertices of every cell: vertex k of cell c
+   *  has index vertex_index[cell_offsets[c] + k] in the input array. */
+  int *vertex_index;
+
+  /*! @brief Coordinates of the vertices of every cell (3 per vertex, in the
+   *  same order as vertex_index) until the cells are initialized, NULL
+   *  afterwards (see space_init_cells()). */
+  double *vertices;
+};
+
+/**
+ * @brief Get the index of the cell with the given integer coordinates.
+ *
+ * @param s Space.
+ * @param i, j, k Integer coordinates of the cell (no periodic wrapping).
+ * @return Index of the cell in the cells array.
+ */
+inline static int space_get_cell_index(const struct space *s, int i, int j,
+                                       int k) {
+  return (i * s->cdim[1] + j) * s->cdim[2] + k;
+}
+
+/**
+ * @brief Initialize a space with the given anchor and distribute the given
+ * vertices over its cells.
+ *
+ * @param s Space.
+ * @param vertices Coordinates of the vertices (3 per vertex, also in 2D). All
+ * vertices should lie within the box [anchor, anchor + dim[.
+ * @param count Number of vertices.
+ * @param anchor Anchor of the periodic box.
+ * @param dim Side lengths of the periodic box.
+ * @param cdim Number of cells in every direction (cdim[2] should be 1 in 2D).
+ */
+inline static void space_init_with_anchor(struct space *s,
+                                          const double *vertices, int count,
+                                          const double *anchor,
+                                          const double *dim, const int *cdim) {
+#if defined(DIMENSIONALITY_2D)
+  if (cdim[2] != 1) {
+    fprintf(stderr, "A 2D space can only have 1 cell in the z direction!\n");
+    abort();
+  }
+#endif
+  for (int i = 0; i < 3; i++) {
+    s->anchor[i] = anchor[i];
+    s->dim[i] = dim[i];
+    s->cdim[i] = cdim[i];
+    s->width[i] = dim[i] / cdim[i];
+  }
+  s->nr_cells = cdim[0] * cdim[1] * cdim[2];
+
+  /* find the cell of every vertex */
+  int *vertex_cell = (int *)malloc(count * sizeof(int));
+  s->cell_offsets = (int *)calloc(s->nr_cells + 1, sizeof(int));
+  for (int v = 0; v < count; v++) {
+    int ci[3];
+    for (int i = 0; i < 3; i++) {
+      ci[i] = (int)((vertices[3 * v + i] - anchor[i]) / s->width[i]);
+      if (ci[i] < 0) ci[i] = 0;
+      if (ci[i] >= cdim[i]) ci[i] = cdim[i] - 1;
+    }
+    vertex_cell[v] = space_get_cell_index(s, ci[0], ci[1], ci[2]);
+    s->cell_offsets[vertex_cell[v] + 1]++;
+  }
+
+  /* sort the vertices per cell (counting sort) */
+  for (int c = 0; c < s->nr_cells; c++) {
+    if (s->cell_offsets[c + 1] == 0) {
+      fprintf(stderr, "Cell %i does not contain any vertices!\n", c);
+      abort();
+    }
+    s->cell_offsets[c + 1] += s->cell_offsets[c];
+  }
+  s->vertex_index = (int *)malloc(count * sizeof(int));
+  int *cell_count = (int *)calloc(s->nr_cells, sizeof(int));
+  for (int v = 0; v < count; v++) {
+    const int c = vertex_cell[v];
+    s->vertex_index[s->cell_offsets[c] + cell_count[c]] = v;
+    cell_count[c]++;
+  }
+
+  /* the cells themselves are initialized later, by the threads that use them
+     (see space_init_cells()) */
+  s->cells = (struct cell *)malloc(s->nr_cells * sizeof(struct cell));
+  s->vertices = (double *)malloc(3 * count * sizeof(double));
+  for (int l = 0; l < count; l++) {
+    const int v = s->vertex_index[l];
+    s->vertices[3 * l] = vertices[3 * v];
+    s->vertices[3 * l + 1] = vertices[3 * v + 1];
+    s->vertices[3 * l + 2] = vertices[3 * v + 2];
+  }
+
+  free(cell_count);
+  free(vertex_cell);
+}
+
+/**
+ * @brief Initialize a space with its anchor at the origin and distribute the
+ * given vertices over its cells (see space_init_with_anchor()).
+ *
+ * @param s Space.
+ * @param vertices Coordinates of the vertices (3 per vertex, also in 2D). All
+ * vertices should lie within the box [0, dim[.
+ * @param count Number of vertices.
+ * @param dim Side lengths of the periodic box.
+ * @param cdim Number of cells in every direction (cdim[2] should be 1 in 2D).
+ */
+inline static void space_init(struct space *s, const double *vertices,
+                              int count, const double *dim, const int *cdim) {
+  const double anchor[3] = {0., 0., 0.};
+  space_init_with_anchor(s, vertices, count, anchor, dim, cdim);
+}
+
+/**
+ * @brief Initialize a space from the vertices in the given generator file (see
+ * binary_output_print_generators()).
+ *
+ * The file is memory mapped and the vertices are read from the mapping
+ * directly. The simulation volume stored in the file is used as the periodic
+ * box.
+ *
+ * @param s Space.
+ * @param file_name Name of the generator file.
+ * @param cdim Number of cells in every direction (cdim[2] should be 1 in 2D).
+ */
+inline static void space_init_from_file(struct space *s, const char *file_name,
+                                        const int *cdim) {
+  struct binary_input in;
+  binary_input_open(&in, file_name, BINARY_OUTPUT_TYPE_GENERATORS, 0);
+  const double *anchor =
+      (const double *)binary_input_get_array(&in, sizeof(double), 3);
+  const double *dim =
+      (const double *)binary_input_get_array(&in, sizeof(double), 3);
+  const int count = (int)in.counts[0];
+  const double *vertices =
+      (const double *)binary_input_get_array(&in, 3 * sizeof(double), count);
+  space_init_with_anchor(s, vertices, count, anchor, dim, cdim);
+  binary_input_close(&in);
+}
+
+/**
+ * @brief Free up all memory associated with the space.
+ *
+ * @param s Space.
+ */
+inline static void space_destroy(struct space *s) {
+  if (s->vertices != NULL) {
+    /* the cells were never initialized */
+    free(s->vertices);
+  } else {
+    for (int c = 0; c < s->nr_cells; c++) {
+      cell_destroy(&s->cells[c]);
+    }
+  }
+  free(s->cells);
+  free(s->cell_offsets);
+  free(s->vertex_index);
+}
+
+/**
+ * @brief Get the memory used by the space and all its cells.
+ *
+ * Since the arrays of the cells never shrink, this is also the high-water mark
+ * of the memory use of the space.
+ *
+ * @param s Space.
+ * @return Size in bytes.
+ */
+inline static size_t space_get_memory_size(const struct space *s) {
+  size_t size = (size_t)s->nr_cells * sizeof(struct cell) +
+                (size_t)(s->nr_cells + 1) * sizeof(int) +
+                (size_t)s->cell_offsets[s->nr_cells] * sizeof(int);
+  if (s->vertices != NULL) {
+    return size + 3 * (size_t)s->cell_offsets[s->nr_cells] * sizeof(double);
+  }
+  for (int c = 0; c < s->nr_cells; c++) {
+    size += cell_get_memory_size(&s->cells[c]);
+  }
+  return size;
+}
+
+/**
+ * @brief Write the instrumentation results of all cells to a JSON file, as an
+ * array with one object per cell (see cell_write_instrumentation()).
+ *
+ * @param s Space.
+ * @param file_name Name of the JSON file.
+ */
+inline static void space_print_instrumentation(const struct space *s,
+                                               const char *file_name) {
+  FILE *file = fopen(file_name, "w");
+  if (file == NULL) {
+    fprintf(stderr, "Unable to open file \"%s\" for writing!\n", file_name);
+    abort();
+  }
+  fprintf(file, "[\n");
+  for (int c = 0; c < s->nr_cells; c++) {
+    fprintf(file, "  ");
+    cell_write_instrumentation(&s->cells[c], file);
+    fprintf(file, c + 1 < s->nr_cells ? ",\n" : "\n");
+  }
+  fprintf(file, "]\n");
+  fclose(file);
+}
+
+/**
+ * @brief Get the neighbouring cells of the given cell.
+ *
+ * At the boundaries of the box, the neighbours are periodic copies of the
+ * cells on the other side.
+ *
+ * @param s Space.
+ * @param cid Index of the cell.
+ * @param ngbs (Returned) Indices of the 26 (8 in 2D) neighbouring cells.
+ * @param wraps (Returned) Periodic wrapping of every neighbour (3 per
+ * neighbour): -1 (1) if the neighbour is a copy shifted over minus (plus) the
+ * side length of the box in that direction, 0 otherwise.
+ * @return Number of neighbours.
+ */
+inline static int space_get_ngbs(const struct space *s, int cid, int *ngbs,
+                                 int *wraps) {
+  const int i = cid / (s->cdim[1] * s->cdim[2]);
+  const int j = (cid / s->cdim[2]) % s->cdim[1];
+  const int k = cid % s->cdim[2];
+#if defined(DIMENSIONALITY_2D)
+  const int dk_max = 0;
+#else
+  const int dk_max = 1;
+#endif
+  int nngb = 0;
+  for (int dk = -dk_max; dk <= dk_max; dk++) {
+    for (int dj = -1; dj <= 1; dj++) {
+      for (int di = -1; di <= 1; di++) {
+        if (di == 0 && dj == 0 && dk == 0) continue;
+        int ngb[3] = {i + di, j + dj, k + dk};
+        int *wrap = &wraps[3 * nngb];
+        /* periodic wrapping */
+        for (int l = 0; l < 3; l++) {
+          wrap[l] = 0;
+          if (ngb[l] < 0) {
+            ngb[l] += s->cdim[l];
+            wrap[l] = -1;
+          } else if (ngb[l] >= s->cdim[l]) {
+            ngb[l] -= s->cdim[l];
+            wrap[l] = 1;
+          }
+        }
+        ngbs[nngb] = space_get_cell_index(s, ngb[0], ngb[1], ngb[2]);
+        ++nngb;
+      }
+    }
+  }
+  return nngb;
+}
+
+/**
+ * @brief Add the necessary ghosts from all neighbouring cells of the given
+ * cell to its Delaunay tessellation (see cell_add_ghosts()).
+ *
+ * At the boundaries of the box, periodic copies of the cells on the other side
+ * are used (see space_get_ngbs()).
+ *
+ * @param s Space.
+ * @param cid Index of the cell.
+ */
+inline static void space_add_ghosts(struct space *s, int cid) {
+  int ngb_cells[26];
+  int wraps[3 * 26];
+  const int nngb = space_get_ngbs(s, cid, ngb_cells, wraps);
+  const struct cell *ngbs[26];
+  double shifts[3 * 26];
+  for (int n = 0; n < nngb; n++) {
+    ngbs[n] = &s->cells[ngb_cells[n]];
+    for (int l = 0; l < 3; l++) {
+      shifts[3 * n + l] = wraps[3 * n + l] * s->dim[l];
+    }
+  }
+  cell_add_ghosts(&s->cells[cid], ngbs, shifts, nngb);
+}
+
+/**
+ * @brief Initialize a single cell with its vertices, and place the memory of
+ * its tessellations on the memory domain of the calling thread (see
+ * cell_first_touch()).
+ *
+ * @param data Space.
+ * @param cid Index of the cell.
+ * @param thread_id Index of the thread (unused).
+ */
+inline static void space_init_cell(void *data, int cid, int thread_id) {
+  struct space *s = (struct space *)data;
+  const int i = cid / (s->cdim[1] * s->cdim[2]);
+  const int j = (cid / s->cdim[2]) % s->cdim[1];
+  const int k = cid % s->cdim[2];
+  const double cell_anchor[3] = {s->anchor[0] + i * s->width[0],
+                                 s->anchor[1] + j * s->width[1],
+                                 s->anchor[2] + k * s->width[2]};
+  const int offset = s->cell_offsets[cid];
+  struct cell *c = &s->cells[cid];
+  cell_init_from_vertices(c, &s->vertices[3 * offset],
+                          s->cell_offsets[cid + 1] - offset, cell_anchor,
+                          s->width);
+  cell_first_touch(c);
+}
+
+/**
+ * @brief Initialize the cells of the space, using the threads of the given
+ * thread pool.
+ *
+ * The cells are mapped over in the same way as in
+ * space_construct_tessellations(), so that every cell is (apart from stolen
+ * tasks) initialized by the thread that constructs its tessellations. This is
+ * done automatically by space_construct_tessellations() if necessary.
+ *
+ * @param s Space (whose cells have not been initialized yet).
+ * @param tp Thread pool.
+ */
+inline static void space_init_cells(struct space *s, struct threadpool *tp) {
+  threadpool_map(tp, space_init_cell, s, s->nr_cells);
+  free(s->vertices);
+  s->vertices = NULL;
+}
+
+/**
+ * @brief Construct the Delaunay tessellation and Voronoi grid of a single cell.
+ *
+ * The local vertices of a cell are only read by its neighbours while adding
+ * ghosts, so that this function can be executed for different cells
+ * concurrently.
+ *
+ * @param data Space.
+ * @param cid Index of the cell.
+ * @param thread_id Index of the thread (unused).
+ */
+inline static void space_construct_cell_tessellation(void *data, int cid,
+                                                     int thread_id) {
+  struct space *s = (struct space *)data;
+  struct cell *c = &s->cells[cid];
+  if (c->voronoi_active) {
+    fprintf(stderr, "Voronoi tesselation of cell %i already constructed!\n",
+            cid);
+    abort();
+  }
+  cell_construct_local_delaunay(c);
+  space_add_ghosts(s, cid);
+  cell_check_ghosts(c);
+  cell_construct_voronoi(c);
+}
+
+/**
+ * @brief Construct the Delaunay tessellations and Voronoi grids of all cells,
+ * using the threads of the given thread pool.
+ *
+ * The cells are initialized first if this was not done yet (see
+ * space_init_cells()).
+ *
+ * @param s Space.
+ * @param tp Thread pool.
+ */
+inline static void space_construct_tessellations(struct space *s,
+                                                 struct threadpool *tp) {
+  if (s->vertices != NULL) {
+    space_init_cells(s, tp);
+  }
+  threadpool_map(tp, space_construct_cell_tessellation, s, s->nr_cells);
+}
+
+/*! @brief Function that is executed for the voronoi grid of a single cell by
+ *  a space pipeline (see struct space_pipeline).
+ *
+ * @param data Extra data passed on to space_pipeline_init().
+ * @param c Cell.
+ * @param cid Index of the cell.
+ * @param thread_id Index of the thread executing the function.
+ */
+typedef void (*space_cell_function)(void *data, struct cell *c, int cid,
+                                    int thread_id);
+
+/**
+ * @brief Pipeline that repeatedly constructs the tessellations of all cells
+ * of a space and passes every voronoi grid on to its consumers as soon as it
+ * is complete.
+ *
+ * Every step of the pipeline (see space_pipeline_step()) rebuilds the
+ * tessellations of all cells for the current positions of their vertices.
+ * The voronoi grids of the cells are double buffered (see cell_swap_voronoi()),
+ * so there are two consumers:
+ *  - ready is executed for the new grid of a cell (c->v) by the thread that
+ *    constructed it, right after the construction, while other cells are still
+ *    being constructed.
+ *  - previous is executed for the grid of the previous step (c->v_previous),
+ *    concurrently with the construction of the new grids, e.g. to write a
+ *    snapshot. It should only use the grid, since the delaunay tessellation is
+ *    being rebuilt. The grids of the last step are passed on to previous by
+ *    space_pipeline_flush().
+ * Every cell reports its completion individually (see
+ * space_pipeline_get_cell_step()), so that a consumer can check whether the
+ * grids of other cells of the same step are complete without waiting for all
+ * cells. The only barrier is at the end of a step, after which the vertices
+ * can be moved for the next step. Neither consumer may move vertices, since
+ * these are read by the neighbouring cells.
+ */
+struct space_pipeline {
+  /*! @brief Space whose tessellations are constructed. */
+  struct space *s;
+
+  /*! @brief Consumer of the new grids, or NULL. */
+  space_cell_function ready;
+
+  /*! @brief Extra data for ready. */
+  void *ready_data;
+
+  /*! @brief Consumer of the grids of the previous step, or NULL. */
+  space_cell_function previous;
+
+  /*! @brief Extra data for previous. */
+  void *previous_data;
+
+  /*! @brief Number of steps that were started. */
+  int step;
+
+  /*! @brief For every cell, the last step for which its grid is complete (0
+   * if no grid was constructed yet). */
+  int *cell_steps;
+};
+
+/**
+ * @brief Initialize a pipeline for the given space.
+ *
+ * @param p Pipeline.
+ * @param s Space (its tessellations should not have been constructed yet).
+ * @param ready Consumer of the new grids, or NULL.
+ * @param ready_data Extra data for ready.
+ * @param previous Consumer of the grids of the previous step, or NULL.
+ * @param previous_data Extra data for previous.
+ */
+inline static void space_pipeline_init(struct space_pipeline *p,
+                                       struct space *s,
+                                       space_cell_function ready,
+                                       void *ready_data,
+                                       space_cell_function previous,
+                                       void *previous_data) {
+  p->s = s;
+  p->ready = ready;
+  p->ready_data = ready_data;
+  p->previous = previous;
+  p->previous_data = previous_data;
+  p->step = 0;
+  p->cell_steps = (int *)calloc(s->nr_cells, sizeof(int));
+}
+
+/**
+ * @brief Free up all memory associated with the pipeline (but not the space).
+ *
+ * @param p Pipeline.
+ */
+inline static void space_pipeline_destroy(struct space_pipeline *p) {
+  free(p->cell_steps);
+}
+
+/**
+ * @brief Get the last step for which the grid of the given cell is complete.
+ *
+ * This can be called from a consumer while other cells are being
+ * constructed.
+ *
+ * @param p Pipeline.
+ * @param cid Index of the cell.
+ * @return Step (the grid of the current step is complete if this equals
+ * p->step).
+ */
+inline static int space_pipeline_get_cell_step(const struct space_pipeline *p,
+                                               int cid) {
+  return __atomic_load_n(&p->cell_steps[cid], __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Execute a single task of a pipeline step: even tasks construct the
+ * tessellations of a cell and pass its new grid on to the ready consumer, odd
+ * tasks pass the previous grid of a cell on to the previous consumer.
+ *
+ * The two tasks of every cell are neighbours, so that the contiguous blocks of
+ * tasks of every thread mix construction and output (see threadpool_map()).
+ *
+ * @param data Pipeline.
+ * @param task Index of the task.
+ * @param thread_id Index of the thread.
+ */
+inline static void space_pipeline_task(void *data, int task, int thread_id) {
+  struct space_pipeline *p = (struct space_pipeline *)data;
+  const int cid = task >> 1;
+  struct cell *c = &p->s->cells[cid];
+  if (task & 1) {
+    if (p->previous != NULL && c->voronoi_previous_active) {
+      p->previous(p->previous_data, c, cid, thread_id);
+    }
+    return;
+  }
+  cell_construct_local_delaunay(c);
+  space_add_ghosts(p->s, cid);
+  cell_check_ghosts(c);
+  cell_construct_voronoi(c);
+  __atomic_store_n(&p->cell_steps[cid], p->step, __ATOMIC_RELEASE);
+  if (p->ready != NULL) {
+    p->ready(p->ready_data, c, cid, thread_id);
+  }
+}
+
+/**
+ * @brief Reset the delaunay tessellation of a single cell that was
+ * constructed in the previous step (see cell_reset_delaunay()).
+ *
+ * @param data Space.
+ * @param cid Index of the cell.
+ * @param thread_id Index of the thread (unused).
+ */
+inline static void space_reset_cell_delaunay(void *data, int cid,
+                                             int thread_id) {
+  struct space *s = (struct space *)data;
+  struct cell *c = &s->cells[cid];
+  if (c->d.ghost_offset > 0) {
+    cell_reset_delaunay(c);
+  }
+}
+
+/**
+ * @brief Execute a single step of the pipeline: construct the tessellations
+ * of all cells, while the grids of the previous step are passed on to the
+ * previous consumer.
+ *
+ * The cells are initialized first if this was not done yet (see
+ * space_init_cells()). The tessellations of the previous step are reset in a
+ * separate pass, since this updates the sort lists of the cells, which are
+ * read by their neighbours while adding ghosts. This function returns when all
+ * tasks of the step are complete.
+ *
+ * @param p Pipeline.
+ * @param tp Thread pool.
+ */
+inline static void space_pipeline_step(struct space_pipeline *p,
+                                       struct threadpool *tp) {
+  struct space *s = p->s;
+  if (s->vertices != NULL) {
+    space_init_cells(s, tp);
+  }
+  threadpool_map(tp, space_reset_cell_delaunay, s, s->nr_cells);
+  p->step++;
+  /* keep the grids of the previous step, and reuse the memory of the grids
+     before that */
+  for (int cid = 0; cid < s->nr_cells; cid++) {
+    cell_swap_voronoi(&s->cells[cid]);
+  }
+  threadpool_map(tp, space_pipeline_task, p, 2 * s->nr_cells);
+}
+
+/**
+ * @brief Pass the previous grid of a single cell on to the previous consumer
+ * (see space_pipeline_task()).
+ *
+ * @param data Pipeline.
+ * @param cid Index of the cell.
+ * @param thread_id Index of the thread.
+ */
+inline static void space_pipeline_flush_task(void *data, int cid,
+                                             int thread_id) {
+  space_pipeline_task(data, 2 * cid + 1, thread_id);
+}
+
+/**
+ * @brief Pass the grids of the last step on to the previous consumer.
+ *
+ * Afterwards, the grids of the last step are still the current grids of the
+ * cells (c->v).
+ *
+ * @param p Pipeline.
+ * @param tp Thread pool.
+ */
+inline static void space_pipeline_flush(struct space_pipeline *p,
+                                        struct threadpool *tp) {
+  if (p->previous == NULL || p->step == 0) return;
+  struct space *s = p->s;
+  for (int cid = 0; cid < s->nr_cells; cid++) {
+    cell_swap_voronoi(&s->cells[cid]);
+  }
+  threadpool_map(tp, space_pipeline_flush_task, p, s->nr_cells);
+  for (int cid = 0; cid < s->nr_cells; cid++) {
+    cell_swap_voronoi(&s->cells[cid]);
+  }
+}
+
+/**
+ * @brief Construct the Voronoi grid of a single periodic cell in parallel, by
+ * splitting the cell into a regular grid of sub-cells.
+ *
+ * The vertices of the cell are distributed over a space covering the box of
+ * the cell, and the tessellations of its sub-cells are constructed
+ * concurrently (see space_construct_tessellations()). Every sub-cell takes the
+ * ghosts it needs from its neighbours using the search radius criterion of
+ * cell_add_ghosts(). The grids of the sub-cells are then stitched into the
+ * Voronoi grid of the cell:
+ *  - Faces between two vertices of the same sub-cell are copied.
+ *  - Faces between vertices of two different sub-cells are constructed by both
+ *    sub-cells. Only the copy with the lowest left index is kept, as a face in
+ *    pairs[0].
+ *  - Faces with a periodic copy of a vertex are stored in pairs[1], like in
+ *    cell_make_delaunay_periodic(). Their right index is c->d.ghost_offset + g,
+ *    with c->d.ghost_offset set as in delaunay_consolidate() (past the local
+ *    vertices) and g a new ghost origin of the cell: c->ghost_vertices[g] is
+ *    the vertex and c->ghost_ngbs[g] the index of the periodic copy in the
+ *    neighbours of cell_get_periodic_ngbs().
+ *
+ * Apart from the order of the faces and round off errors, the result is the
+ * same as with cell_make_delaunay_periodic() and cell_construct_voronoi(). The
+ * Delaunay tessellation of the cell itself is not constructed, so that its
+ * grid cannot be rebuilt with cell_construct_voronoi(). The sub-cells need
+ * enough vertices to get all their ghosts from their direct neighbours (see
+ * cell_add_ghosts()).
+ *
+ * @param c Cell (without Voronoi grid).
+ * @param cdim Number of sub-cells in every direction (cdim[2] should be 1 in
+ * 2D).
+ * @param tp Thread pool.
+ */
+inline static void space_construct_cell_parallel(struct cell *c,
+                                                 const int *cdim,
+                                                 struct threadpool *tp) {
+  if (c->voronoi_active) {
+    fprintf(stderr, "Voronoi tesselation of cell already constructed!\n");
+    abort();
+  }
+  struct space s;
+  space_init_with_anchor(&s, c->vertices, c->count, c->hs.anchor, c->hs.side,
+                         cdim);
+  space_construct_tessellations(&s, tp);
+
+  voronoi_init_empty(&c->v, c->count);
+  c->ghost_count = 0;
+  /* the ghost indices start after the local vertices and the vertices of the
+     large initial simplex, like after delaunay_consolidate() */
+  c->d.ghost_offset = c->d.vertex_index;
+  for (int cid = 0; cid < s.nr_cells; cid++) {
+    const struct cell *sc = &s.cells[cid];
+    const int *index = &s.vertex_index[s.cell_offsets[cid]];
+    int ngbs[26];
+    int wraps[3 * 26];
+    space_get_ngbs(&s, cid, ngbs, wraps);
+
+    for (int l = 0; l < sc->count; l++) {
+      c->v.cells[index[l]] = sc->v.cells[l];
+    }
+    for (int i = 0; i < sc->v.pair_index[0]; i++) {
+      const struct voronoi_pair *pair = &sc->v.pairs[0][i];
+      voronoi_copy_pair(&c->v, 0, &sc->v, pair, index[pair->left],
+                        index[pair->right]);
+    }
+    for (int i = 0; i < sc->v.pair_index[1]; i++) {
+      const struct voronoi_pair *pair = &sc->v.pairs[1][i];
+      const int g = pair->right - sc->d.ghost_offset;
+      const int n = sc->ghost_ngbs[g];
+      const int *wrap = &wraps[3 * n];
+      const int left = index[pair->left];
+      const int right =
+          s.vertex_index[s.cell_offsets[ngbs[n]] + sc->ghost_vertices[g]];
+      if (wrap[0] == 0 && wrap[1] == 0 && wrap[2] == 0) {
+        /* only store pairs once */
+        if (left < right) {
+          voronoi_copy_pair(&c->v, 0, &sc->v, pair, left, right);
+        }
+      } else {
+        /* index of the shift in cell_get_periodic_ngbs(), which skips the
+           unshifted copy (13) */
+        int periodic_ngb =
+            (wrap[0] + 1) + 3 * (wrap[1] + 1) + 9 * (wrap[2] + 1);
+        if (periodic_ngb > 13) --periodic_ngb;
+        const int ghost = cell_add_ghost_origin(c, periodic_ngb, right);
+        voronoi_copy_pair(&c->v, 1, &sc->v, pair, left,
+                          c->d.ghost_offset + ghost);
+      }
+    }
+  }
+#ifdef VORONOI_STORE_FACE_TABLE
+  /* positions of the periodic copies */
+  const struct cell *periodic_ngbs[26];
+  double shifts[3 * 26];
+  cell_get_periodic_ngbs(c, periodic_ngbs, shifts);
+  double *ghosts = (double *)malloc(3 * c->ghost_count * sizeof(double));
+  for (int g = 0; g < c->ghost_count; g++) {
+    for (int i = 0; i < 3; i++) {
+      ghosts[3 * g + i] = c->vertices[3 * c->ghost_vertices[g] + i] +
+                          shifts[3 * c->ghost_ngbs[g] + i];
+    }
+  }
+  voronoi_update_face_table(&c->v, c->vertices, ghosts, c->d.ghost_offset, 3);
+  free(ghosts);
+#endif
+  c->voronoi_active = 1;
+  space_destroy(&s);
+}
+
+#endif  // CVORONOI_SPACE_H
@@ -5,24 +5,305 @@
 /**
  * @file tetrahedron.h
  *
- * @brief Tetrahedron struct and functionality.
+ * @brief Tetrahedron storage and functionality.
+ *
+ * For every tetrahedron, we store the indices of the 4 vertex_indices, the
+ * indices of the neighbouring tetrahedra (that share a face with this
+ * tetrahedron) and the indices of this tetrahedron in the neighbour lists of
+ * its neighbours.
+ *
+ * Conventions:
+ * 1. neighbour i is the tetrahedron sharing the face oposite of vertex i.
+ * 2. index_in_neighbour follows the same ordering as the neighbours
+ *
+ * All tetrahedra of a tessellation are stored in a tetrahedron_array, which is
+ * only accessed through the functions in this file. By default, this is an
+ * array of tetrahedron structs. If TETRAHEDRON_SOA is defined, a more compact
+ * structure-of-arrays layout is used instead: the vertices and neighbours are
+ * stored in separate (cache line aligned) arrays, the index in the neighbour
+ * is packed into the 2 lowest bits of the neighbour index and the active flags
+ * are stored in a bitmap. This reduces the memory footprint of a tetrahedron
+ * from 52 to 32 bytes, and the point location walk and search radius
+ * computation only touch the neighbours and vertices. The tetrahedron
+ * indices are then limited to 2^29.
+ *
+ * If TETRAHEDRON_HUGE_PAGES is defined, the (large) tetrahedron arrays are
+ * backed by transparent huge pages where the system supports this, which
+ * reduces the number of TLB misses during the point location walks.
+ *
+ * The array of tetrahedron structs is allocated with the allocation hooks of
+ * allocator.h. The aligned arrays of TETRAHEDRON_SOA use posix_memalign()
+ * instead, since the hooks do not guarantee any alignment.
  */
 
 #ifndef CVORONOI_TETRAHEDRON_H
 #define CVORONOI_TETRAHEDRON_H
 
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef TETRAHEDRON_HUGE_PAGES
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "allocator.h"
+
 /**
- * @brief Tetrahedron
+ * @brief Ask the system to back the given array with transparent huge pages.
  *
- * A tetrahedron connects 4 points in 3D space, has 6 edges and 4 faces.
+ * Only the pages that lie completely within the array are affected. This only
+ * does something if TETRAHEDRON_HUGE_PAGES is defined and the system supports
+ * transparent huge pages, and it has to be repeated after every reallocation.
+ *
+ * @param ptr Array.
+ * @param size Size of the array in bytes.
+ */
+inline static void tetrahedron_advise_huge_pages(void *ptr, size_t size) {
+#if defined(TETRAHEDRON_HUGE_PAGES) && defined(MADV_HUGEPAGE)
+  const uintptr_t page_size = (uintptr_t)sysconf(_SC_PAGESIZE);
+  const uintptr_t start = ((uintptr_t)ptr + page_size - 1) & ~(page_size - 1);
+  const uintptr_t end = ((uintptr_t)ptr + size) & ~(page_size - 1);
+  if (end > start) {
+    /* this is only a hint, so failure is not an error */
+    madvise((void *)start, end - start, MADV_HUGEPAGE);
+  }
+#endif
+}
+
+#ifdef TETRAHEDRON_SOA
+
+/*! @brief Alignment of the tetrahedron arrays (one cache line). */
+#define TETRAHEDRON_ALIGNMENT 64
+
+/**
+ * @brief Tetrahedra, stored in a structure-of-arrays layout.
+ */
+struct tetrahedron_array {
+  /*! @brief Indices in the associated delaunay tesselation of the particles
+   * that make up the tetrahedra (4 per tetrahedron). */
+  int *vertices;
+
+  /*! @brief Indices of the neighbour tetrahedra, multiplied by 4 and combined
+   * with the index of this tetrahedron in the neighbour list of the neighbour
+   * (4 per tetrahedron). */
+  int *neighbours;
+
+  /*! @brief Bitmap indicating whether or not a tetrahedron is active (or has
+   * been invalidated). */
+  uint64_t *active;
+};
+
+/**
+ * @brief Allocate cache line aligned memory.
  *
- * In this struct, we store the indices of the 4 vertex_indices, the indices of the
- * neighbouring tetrahedra (that share a face with this tetrahedron) and the
- * indices of this tetrahedron in the neighbour lists of its neighbours.
+ * @param size Size in bytes.
+ * @return Pointer to the allocated memory.
+ */
+inline static void *tetrahedron_aligned_malloc(size_t size) {
+  void *ptr;
+  if (posix_memalign(&ptr, TETRAHEDRON_ALIGNMENT, size) != 0) {
+    fprintf(stderr, "Failed to allocate %zu bytes for tetrahedra!\n", size);
+    abort();
+  }
+  return ptr;
+}
+
+/**
+ * @brief Grow the given aligned array, preserving its contents and alignment.
  *
- * Conventions:
- * 1. neighbours[i] is the tetrahedron sharing the face oposite of vertex_indices[i].
- * 2. index_in_neighbours follows the same ordering as neighbours
+ * @param ptr Array allocated with tetrahedron_aligned_malloc().
+ * @param old_size Old size of the array in bytes.
+ * @param new_size New size of the array in bytes.
+ * @return Pointer to the new array.
+ */
+inline static void *tetrahedron_aligned_realloc(void *ptr, size_t old_size,
+                                                size_t new_size) {
+  void *new_ptr = tetrahedron_aligned_malloc(new_size);
+  memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+  free(ptr);
+  return new_ptr;
+}
+
+/**
+ * @brief Initialize an array that can hold the given number of tetrahedra.
+ *
+ * @param a Tetrahedron array.
+ * @param size Number of tetrahedra.
+ */
+inline static void tetrahedron_array_init(struct tetrahedron_array *a,
+                                          int size) {
+  a->vertices = (int *)tetrahedron_aligned_malloc(4 * size * sizeof(int));
+  a->neighbours = (int *)tetrahedron_aligned_malloc(4 * size * sizeof(int));
+  tetrahedron_advise_huge_pages(a->vertices, 4 * size * sizeof(int));
+  tetrahedron_advise_huge_pages(a->neighbours, 4 * size * sizeof(int));
+  const int nwords = (size + 63) / 64;
+  a->active =
+      (uint64_t *)tetrahedron_aligned_malloc(nwords * sizeof(uint64_t));
+  memset(a->active, 0, nwords * sizeof(uint64_t));
+}
+
+/**
+ * @brief Change the number of tetrahedra the given array can hold.
+ *
+ * @param a Tetrahedron array.
+ * @param old_size Old number of tetrahedra.
+ * @param new_size New number of tetrahedra.
+ */
+inline static void tetrahedron_array_resize(struct tetrahedron_array *a,
+                                            int old_size, int new_size) {
+  a->vertices = (int *)tetrahedron_aligned_realloc(
+      a->vertices, 4 * old_size * sizeof(int), 4 * new_size * sizeof(int));
+  a->neighbours = (int *)tetrahedron_aligned_realloc(
+      a->neighbours, 4 * old_size * sizeof(int), 4 * new_size * sizeof(int));
+  tetrahedron_advise_huge_pages(a->vertices, 4 * new_size * sizeof(int));
+  tetrahedron_advise_huge_pages(a->neighbours, 4 * new_size * sizeof(int));
+  const int old_nwords = (old_size + 63) / 64;
+  const int new_nwords = (new_size + 63) / 64;
+  a->active = (uint64_t *)tetrahedron_aligned_realloc(
+      a->active, old_nwords * sizeof(uint64_t), new_nwords * sizeof(uint64_t));
+  if (new_nwords > old_nwords) {
+    memset(&a->active[old_nwords], 0,
+           (new_nwords - old_nwords) * sizeof(uint64_t));
+  }
+}
+
+/**
+ * @brief Free up all memory used by the given tetrahedron array.
+ *
+ * @param a Tetrahedron array.
+ */
+inline static void tetrahedron_array_destroy(struct tetrahedron_array *a) {
+  free(a->vertices);
+  free(a->neighbours);
+  free(a->active);
+}
+
+/**
+ * @brief Place the memory of the given tetrahedron array on the memory domain
+ * of the calling thread (see allocator_first_touch()).
+ *
+ * @param a Tetrahedron array.
+ * @param size Number of tetrahedra the array can hold.
+ */
+inline static void tetrahedron_array_first_touch(struct tetrahedron_array *a,
+                                                 int size) {
+  allocator_first_touch(a->vertices, 4 * size * sizeof(int));
+  allocator_first_touch(a->neighbours, 4 * size * sizeof(int));
+  allocator_first_touch(a->active, ((size + 63) / 64) * sizeof(uint64_t));
+}
+
+/**
+ * @brief Get the memory used by a tetrahedron array of the given size.
+ *
+ * @param size Number of tetrahedra the array can hold.
+ * @return Size in bytes.
+ */
+inline static size_t tetrahedron_array_get_memory_size(int size) {
+  return 8 * (size_t)size * sizeof(int) +
+         (size_t)((size + 63) / 64) * sizeof(uint64_t);
+}
+
+/**
+ * @brief Get a vertex of a tetrahedron.
+ *
+ * @param a Tetrahedron array.
+ * @param t Index of the tetrahedron.
+ * @param i Index of the vertex within the tetrahedron (0-3).
+ * @return Index of the vertex.
+ */
+inline static int tetrahedron_get_vertex(const struct tetrahedron_array *a,
+                                         int t, int i) {
+  return a->vertices[4 * t + i];
+}
+
+/**
+ * @brief Get a neighbour of a tetrahedron.
+ *
+ * @param a Tetrahedron array.
+ * @param t Index of the tetrahedron.
+ * @param i Index of the neighbour (the neighbour opposite vertex i).
+ * @return Index of the neighbouring tetrahedron.
+ */
+inline static int tetrahedron_get_neighbour(const struct tetrahedron_array *a,
+                                            int t, int i) {
+  return a->neighbours[4 * t + i] >> 2;
+}
+
+/**
+ * @brief Get the index of a tetrahedron in the neighbour list of one of its
+ * neighbours.
+ *
+ * @param a Tetrahedron array.
+ * @param t Index of the tetrahedron.
+ * @param i Index of the neighbour.
+ * @return Index of t in the neighbour list of neighbour i.
+ */
+inline static int tetrahedron_get_index_in_neighbour(
+    const struct tetrahedron_array *a, int t, int i) {
+  return a->neighbours[4 * t + i] & 3;
+}
+
+/**
+ * @brief Check whether the given tetrahedron is active.
+ *
+ * @param a Tetrahedron array.
+ * @param t Index of the tetrahedron.
+ * @return 1 if the tetrahedron is active, 0 if it was invalidated.
+ */
+inline static int tetrahedron_is_active(const struct tetrahedron_array *a,
+                                        int t) {
+  return (a->active[t >> 6] >> (t & 63)) & 1;
+}
+
+/**
+ * @brief Set all vertices and neighbours of a tetrahedron and its active
+ * flag.
+ */
+inline static void tetrahedron_set(struct tetrahedron_array *a, int t, int v0,
+                                   int v1, int v2, int v3, int active) {
+  int *vertices = &a->vertices[4 * t];
+  vertices[0] = v0;
+  vertices[1] = v1;
+  vertices[2] = v2;
+  vertices[3] = v3;
+
+  int *neighbours = &a->neighbours[4 * t];
+  neighbours[0] = -1;
+  neighbours[1] = -1;
+  neighbours[2] = -1;
+  neighbours[3] = -1;
+
+  if (active) {
+    a->active[t >> 6] |= (uint64_t)1 << (t & 63);
+  } else {
+    a->active[t >> 6] &= ~((uint64_t)1 << (t & 63));
+  }
+}
+
+/**
+ * @brief Replace the neighbour at the given index with the given new neighbour.
+ *
+ * @param a Tetrahedron array.
+ * @param t Index of the tetrahedron.
+ * @param index Index of the neighbour in the list of neighbours.
+ * @param neighbour New neighbour.
+ * @param index_in_neighbour Index of this tetrahedron in the neighbour list of
+ * the new neighbour.
+ */
+inline static void tetrahedron_swap_neighbour(struct tetrahedron_array *a,
+                                              int t, int index, int neighbour,
+                                              int index_in_neighbour) {
+  a->neighbours[4 * t + index] = 4 * neighbour + index_in_neighbour;
+}
+
+#else
+
+/**
+ * @brief Tetrahedron
+ *
+ * A tetrahedron connects 4 points in 3D space, has 6 edges and 4 faces.
  */
 struct tetrahedron {
   /*! @brief Indices in the associated delaunay tesselation of the particles
@@ -42,101 +323,226 @@ struct tetrahedron {
 };
 
 /**
- * @brief Initialize a tetrahedron with the given vertex_indices.
+ * @brief Tetrahedra, stored as an array of tetrahedron structs.
+ */
+struct tetrahedron_array {
+  /*! @brief Tetrahedra. */
+  struct tetrahedron *tetrahedra;
+};
+
+/**
+ * @brief Initialize an array that can hold the given number of tetrahedra.
  *
- * Neighbour information is set to nonsensical negative values
+ * @param a Tetrahedron array.
+ * @param size Number of tetrahedra.
+ */
+inline static void tetrahedron_array_init(struct tetrahedron_array *a,
+                                          int size) {
+  a->tetrahedra =
+      (struct tetrahedron *)CVORONOI_MALLOC(size * sizeof(struct tetrahedron));
+  tetrahedron_advise_huge_pages(a->tetrahedra,
+                                size * sizeof(struct tetrahedron));
+}
+
+/**
+ * @brief Change the number of tetrahedra the given array can hold.
  *
- * @param t Tetrahedron
- * @param v0, v1, v2, v3 Vertices
+ * @param a Tetrahedron array.
+ * @param old_size Old number of tetrahedra.
+ * @param new_size New number of tetrahedra.
  */
-inline static void tetrahedron_init(struct tetrahedron *t, int v0, int v1,
-                                    int v2, int v3) {
-  t->vertices[0] = v0;
-  t->vertices[1] = v1;
-  t->vertices[2] = v2;
-  t->vertices[3] = v3;
+inline static void tetrahedron_array_resize(struct tetrahedron_array *a,
+                                            int old_size, int new_size) {
+  a->tetrahedra = (struct tetrahedron *)CVORONOI_REALLOC(
+      a->tetrahedra, new_size * sizeof(struct tetrahedron));
+  tetrahedron_advise_huge_pages(a->tetrahedra,
+                                new_size * sizeof(struct tetrahedron));
+}
 
-  t->neighbours[0] = -1;
-  t->neighbours[1] = -1;
-  t->neighbours[2] = -1;
-  t->neighbours[3] = -1;
+/**
+ * @brief Free up all memory used by the given tetrahedron array.
+ *
+ * @param a Tetrahedron array.
+ */
+inline static void tetrahedron_array_destroy(struct tetrahedron_array *a) {
+  CVORONOI_FREE(a->tetrahedra);
+}
 
-  t->index_in_neighbour[0] = -1;
-  t->index_in_neighbour[1] = -1;
-  t->index_in_neighbour[2] = -1;
-  t->index_in_neighbour[3] = -1;
+/**
+ * @brief Place the memory of the given tetrahedron array on the memory domain
+ * of the calling thread (see allocator_first_touch()).
+ *
+ * @param a Tetrahedron array.
+ * @param size Number of tetrahedra the array can hold.
+ */
+inline static void tetrahedron_array_first_touch(struct tetrahedron_array *a,
+                                                 int size) {
+  allocator_first_touch(a->tetrahedra, size * sizeof(struct tetrahedron));
+}
 
-  t->active = 1;
+/**
+ * @brief Get the memory used by a tetrahedron array of the given size.
+ *
+ * @param size Number of tetrahedra the array can hold.
+ * @return Size in bytes.
+ */
+inline static size_t tetrahedron_array_get_memory_size(int size) {
+  return (size_t)size * sizeof(struct tetrahedron);
 }
 
 /**
- * @brief Deactivates the given tetrahedron (set all values to nonsensical
- * negative values) and sets the active flag to 0
- * @param t Tetrahedron
+ * @brief Get a vertex of a tetrahedron.
+ *
+ * @param a Tetrahedron array.
+ * @param t Index of the tetrahedron.
+ * @param i Index of the vertex within the tetrahedron (0-3).
+ * @return Index of the vertex.
  */
-inline static void tetrahedron_deactivate(struct tetrahedron *restrict t) {
-  t->vertices[0] = -1;
-  t->vertices[1] = -1;
-  t->vertices[2] = -1;
-  t->vertices[3] = -1;
+inline static int tetrahedron_get_vertex(const struct tetrahedron_array *a,
+                                         int t, int i) {
+  return a->tetrahedra[t].vertices[i];
+}
 
-  t->neighbours[0] = -1;
-  t->neighbours[1] = -1;
-  t->neighbours[2] = -1;
-  t->neighbours[3] = -1;
+/**
+ * @brief Get a neighbour of a tetrahedron.
+ *
+ * @param a Tetrahedron array.
+ * @param t Index of the tetrahedron.
+ * @param i Index of the neighbour (the neighbour opposite vertex i).
+ * @return Index of the neighbouring tetrahedron.
+ */
+inline static int tetrahedron_get_neighbour(const struct tetrahedron_array *a,
+                                            int t, int i) {
+  return a->tetrahedra[t].neighbours[i];
+}
 
-  t->index_in_neighbour[0] = -1;
-  t->index_in_neighbour[1] = -1;
-  t->index_in_neighbour[2] = -1;
-  t->index_in_neighbour[3] = -1;
+/**
+ * @brief Get the index of a tetrahedron in the neighbour list of one of its
+ * neighbours.
+ *
+ * @param a Tetrahedron array.
+ * @param t Index of the tetrahedron.
+ * @param i Index of the neighbour.
+ * @return Index of t in the neighbour list of neighbour i.
+ */
+inline static int tetrahedron_get_index_in_neighbour(
+    const struct tetrahedron_array *a, int t, int i) {
+  return a->tetrahedra[t].index_in_neighbour[i];
+}
 
-  t->active = 0;
+/**
+ * @brief Check whether the given tetrahedron is active.
+ *
+ * @param a Tetrahedron array.
+ * @param t Index of the tetrahedron.
+ * @return 1 if the tetrahedron is active, 0 if it was invalidated.
+ */
+inline static int tetrahedron_is_active(const struct tetrahedron_array *a,
+                                        int t) {
+  return a->tetrahedra[t].active;
+}
+
+/**
+ * @brief Set all vertices and neighbours of a tetrahedron and its active
+ * flag.
+ */
+inline static void tetrahedron_set(struct tetrahedron_array *a, int t, int v0,
+                                   int v1, int v2, int v3, int active) {
+  struct tetrahedron *tetrahedron = &a->tetrahedra[t];
+  tetrahedron->vertices[0] = v0;
+  tetrahedron->vertices[1] = v1;
+  tetrahedron->vertices[2] = v2;
+  tetrahedron->vertices[3] = v3;
+
+  tetrahedron->neighbours[0] = -1;
+  tetrahedron->neighbours[1] = -1;
+  tetrahedron->neighbours[2] = -1;
+  tetrahedron->neighbours[3] = -1;
+
+  tetrahedron->index_in_neighbour[0] = -1;
+  tetrahedron->index_in_neighbour[1] = -1;
+  tetrahedron->index_in_neighbour[2] = -1;
+  tetrahedron->index_in_neighbour[3] = -1;
+
+  tetrahedron->active = active;
 }
 
 /**
  * @brief Replace the neighbour at the given index with the given new neighbour.
  *
- * @param t Tetrahedron
+ * @param a Tetrahedron array.
+ * @param t Index of the tetrahedron.
  * @param index Index of the neighbour in the list of neighbours.
  * @param neighbour New neighbour.
  * @param index_in_neighbour Index of this tetrahedron in the neighbour list of
  * the new neighbour.
  */
-inline static void tetrahedron_swap_neighbour(struct tetrahedron *restrict t,
-                                              int index, int neighbour,
+inline static void tetrahedron_swap_neighbour(struct tetrahedron_array *a,
+                                              int t, int index, int neighbour,
                                               int index_in_neighbour) {
-  t->neighbours[index] = neighbour;
-  t->index_in_neighbour[index] = index_in_neighbour;
+  a->tetrahedra[t].neighbours[index] = neighbour;
+  a->tetrahedra[t].index_in_neighbour[index] = index_in_neighbour;
+}
+
+#endif
+
+/**
+ * @brief Initialize a tetrahedron with the given vertex_indices.
+ *
+ * Neighbour information is set to nonsensical negative values
+ *
+ * @param a Tetrahedron array.
+ * @param t Index of the tetrahedron.
+ * @param v0, v1, v2, v3 Vertices
+ */
+inline static void tetrahedron_init(struct tetrahedron_array *a, int t, int v0,
+                                    int v1, int v2, int v3) {
+  tetrahedron_set(a, t, v0, v1, v2, v3, 1);
+}
+
+/**
+ * @brief Deactivates the given tetrahedron (set all values to nonsensical
+ * negative values) and sets the active flag to 0
+ *
+ * @param a Tetrahedron array.
+ * @param t Index of the tetrahedron.
+ */
+inline static void tetrahedron_deactivate(struct tetrahedron_array *a, int t) {
+  tetrahedron_set(a, t, -1, -1, -1, -1, 0);
 }
 
 /**
  * @brief Replace all neighbour relations at once.
  *
- * @param t Tetrahedron.
+ * @param a Tetrahedron array.
+ * @param t Index of the tetrahedron.
  * @param n0, n1, n2, n3 New neighbours.
  * @param idx_in_n0, idx_in_n1, idx_in_n2, idx_in_n3 Indices of this tetrahedron
  * the neighbour lists of its new neighbours.
  */
-inline static void tetrahedron_swap_neighbours(struct tetrahedron *restrict t,
-                                               int n0, int n1, int n2, int n3,
-                                               int idx_in_n0, int idx_in_n1,
-                                               int idx_in_n2, int idx_in_n3) {
-  tetrahedron_swap_neighbour(t, 0, n0, idx_in_n0);
-  tetrahedron_swap_neighbour(t, 1, n1, idx_in_n1);
-  tetrahedron_swap_neighbour(t, 2, n2, idx_in_n2);
-  tetrahedron_swap_neighbour(t, 3, n3, idx_in_n3);
+inline static void tetrahedron_swap_neighbours(struct tetrahedron_array *a,
+                                               int t, int n0, int n1, int n2,
+                                               int n3, int idx_in_n0,
+                                               int idx_in_n1, int idx_in_n2,
+                                               int idx_in_n3) {
+  tetrahedron_swap_neighbour(a, t, 0, n0, idx_in_n0);
+  tetrahedron_swap_neighbour(a, t, 1, n1, idx_in_n1);
+  tetrahedron_swap_neighbour(a, t, 2, n2, idx_in_n2);
+  tetrahedron_swap_neighbour(a, t, 3, n3, idx_in_n3);
 }
 
 /**
  * @brief Find the index of ngb in t
- * @param t Tetrahedron
+ *
+ * @param a Tetrahedron array.
+ * @param t Index of the tetrahedron.
  * @param ngb Index of potential neighbour in delaunay tesselation
  * @return Index of ngb in t or 4 if ngb is not a neighbour of t
  */
-inline static int tetrahedron_is_neighbour(struct tetrahedron *restrict t,
-                                           int ngb) {
+inline static int tetrahedron_is_neighbour(const struct tetrahedron_array *a,
+                                           int t, int ngb) {
   int i;
-  for (i = 0; i < 4 && t->neighbours[i] != ngb; i++) {
+  for (i = 0; i < 4 && tetrahedron_get_neighbour(a, t, i) != ngb; i++) {
   }
   return i;
 }
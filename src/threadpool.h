@@ -0,0 +1,491 @@
+/**
+ * @file threadpool.h
+ *
+ * @brief Simple pthreads thread pool that maps a function over a range of
+ * independent tasks, using work stealing to balance the load.
+ *
+ * The worker threads are created once by threadpool_init() and wait on a
+ * condition variable in between mappings, so that mapping a function only
+ * costs a wake-up of the workers, and every worker keeps its CPU (and hence
+ * its caches and NUMA domain) from one mapping to the next.
+ *
+ * The tasks are initially distributed over the threads in contiguous blocks,
+ * so that neighbouring tasks (e.g. neighbouring cells) are executed by the
+ * same thread. A thread that runs out of tasks steals half of the remaining
+ * tasks of another thread.
+ *
+ * The threads can be pinned to CPUs (see threadpool_pin_threads()) in the
+ * order of the NUMA domains of the system, so that every block of tasks is
+ * executed on the same domain every time a function is mapped. Pinning needs
+ * the GNU affinity extensions (_GNU_SOURCE, which the build defines) and is
+ * only supported on Linux.
+ */
+
+#ifndef CVORONOI_THREADPOOL_H
+#define CVORONOI_THREADPOOL_H
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__linux__) && defined(CPU_SET)
+/*! @brief Defined if the threads can be pinned to CPUs. */
+#define THREADPOOL_HAVE_AFFINITY
+#endif
+
+/*! @brief Function that is executed for every task.
+ *
+ * @param data Extra data passed on to threadpool_map().
+ * @param task Index of the task.
+ * @param thread_id Index of the thread executing the task (in the range
+ * [0, num_threads[), which can be used to index per thread scratch space.
+ */
+typedef void (*threadpool_map_function)(void *data, int task, int thread_id);
+
+/**
+ * @brief Range of tasks owned by a single thread.
+ *
+ * The owning thread takes tasks from the front, other threads steal tasks from
+ * the back.
+ */
+struct threadpool_deque {
+  /*! @brief Index of the next task to execute. */
+  int front;
+
+  /*! @brief Index past the last task in this deque. */
+  int back;
+
+  /*! @brief Lock protecting front and back. */
+  pthread_mutex_t lock;
+};
+
+struct threadpool;
+inline static void *threadpool_runner_main(void *arg);
+
+/**
+ * @brief Arguments for a single thread of the pool.
+ */
+struct threadpool_runner {
+  /*! @brief Thread pool this thread belongs to. */
+  struct threadpool *tp;
+
+  /*! @brief Index of this thread. */
+  int thread_id;
+
+  /*! @brief CPU this thread is currently pinned to, or -1. */
+  int cpu;
+};
+
+/**
+ * @brief Thread pool.
+ */
+struct threadpool {
+  /*! @brief Number of threads (including the calling thread). */
+  int num_threads;
+
+  /*! @brief Thread handles (the calling thread has index 0 and no handle). */
+  pthread_t *threads;
+
+  /*! @brief Per thread task ranges. */
+  struct threadpool_deque *deques;
+
+  /*! @brief Per thread arguments. */
+  struct threadpool_runner *runners;
+
+  /*! @brief Function that is currently being mapped. */
+  threadpool_map_function map_function;
+
+  /*! @brief Extra data for the function that is currently being mapped. */
+  void *map_data;
+
+  /*! @brief Lock protecting generation, num_running and shutdown. */
+  pthread_mutex_t lock;
+
+  /*! @brief Signals the workers that a new mapping started (or that they have
+   * to shut down). */
+  pthread_cond_t start;
+
+  /*! @brief Signals the calling thread that all workers are done. */
+  pthread_cond_t done;
+
+  /*! @brief Number of mappings that were started. */
+  int generation;
+
+  /*! @brief Number of workers that did not finish the current mapping yet. */
+  int num_running;
+
+  /*! @brief Set by threadpool_destroy() to stop the workers. */
+  int shutdown;
+
+  /*! @brief CPU every thread is pinned to, or NULL if the threads are not
+   * pinned (see threadpool_pin_threads()). */
+  int *cpus;
+};
+
+/**
+ * @brief Initialize the thread pool.
+ *
+ * @param tp Thread pool.
+ * @param num_threads Number of threads to use. Values smaller than 1 are
+ * interpreted as 1.
+ */
+inline static void threadpool_init(struct threadpool *tp, int num_threads) {
+  if (num_threads < 1) num_threads = 1;
+  tp->num_threads = num_threads;
+  tp->threads = (pthread_t *)malloc(num_threads * sizeof(pthread_t));
+  tp->deques = (struct threadpool_deque *)malloc(
+      num_threads * sizeof(struct threadpool_deque));
+  tp->runners = (struct threadpool_runner *)malloc(
+      num_threads * sizeof(struct threadpool_runner));
+  for (int i = 0; i < num_threads; i++) {
+    pthread_mutex_init(&tp->deques[i].lock, NULL);
+    tp->deques[i].front = 0;
+    tp->deques[i].back = 0;
+    tp->runners[i].tp = tp;
+    tp->runners[i].thread_id = i;
+    tp->runners[i].cpu = -1;
+  }
+  tp->map_function = NULL;
+  tp->map_data = NULL;
+  tp->cpus = NULL;
+  pthread_mutex_init(&tp->lock, NULL);
+  pthread_cond_init(&tp->start, NULL);
+  pthread_cond_init(&tp->done, NULL);
+  tp->generation = 0;
+  tp->num_running = 0;
+  tp->shutdown = 0;
+
+  for (int i = 1; i < num_threads; i++) {
+    if (pthread_create(&tp->threads[i], NULL, threadpool_runner_main,
+                       &tp->runners[i]) != 0) {
+      fprintf(stderr, "Failed to create thread %i!\n", i);
+      abort();
+    }
+  }
+}
+
+#ifdef THREADPOOL_HAVE_AFFINITY
+/**
+ * @brief Append the CPUs in the given set that are listed in the given sysfs
+ * CPU list (e.g. "0-7,16-23") and not in the given order yet.
+ *
+ * @param file_name Name of the CPU list file.
+ * @param allowed CPUs that can be used.
+ * @param order (Updated) CPUs in order.
+ * @param count (Updated) Number of CPUs in order.
+ * @return Number of CPUs that were appended.
+ */
+inline static int threadpool_append_cpu_list(const char *file_name,
+                                             cpu_set_t *allowed, int *order,
+                                             int *count) {
+  FILE *file = fopen(file_name, "r");
+  if (file == NULL) return 0;
+  const int old_count = *count;
+  int first, last;
+  while (fscanf(file, "%d", &first) == 1) {
+    last = first;
+    int separator = fgetc(file);
+    if (separator == '-') {
+      if (fscanf(file, "%d", &last) != 1) break;
+      separator = fgetc(file);
+    }
+    for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, allowed)) {
+        CPU_CLR(cpu, allowed);
+        order[(*count)++] = cpu;
+      }
+    }
+    if (separator != ',') break;
+  }
+  fclose(file);
+  return *count - old_count;
+}
+
+/**
+ * @brief Pin the calling thread to the given CPU.
+ *
+ * @param cpu CPU.
+ */
+inline static void threadpool_pin_current_thread(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  /* only a performance hint, so failure is not an error */
+  pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set);
+}
+#endif
+
+/**
+ * @brief Pin the threads of the pool to the CPUs the process is allowed to
+ * run on, so that they are spread evenly over the NUMA domains of the system.
+ *
+ * The CPUs are ordered by NUMA domain (as listed in /sys/devices/system/node)
+ * and assigned to the threads in order, so that consecutive threads, and
+ * hence the contiguous blocks of tasks they start with, share a domain.
+ * Memory that a task allocates and first touches is then placed on the domain
+ * of the thread executing it (see allocator_first_touch()), and later
+ * mappings over the same tasks mostly run on the same domain (apart from
+ * stolen tasks). The workers pin themselves at the start of the next mapping,
+ * and stay pinned afterwards. The calling thread is only pinned while a
+ * function is mapped.
+ *
+ * @param tp Thread pool.
+ * @return Number of NUMA domains the threads were spread over (1 if the
+ * domains are unknown), or 0 if pinning is not supported.
+ */
+inline static int threadpool_pin_threads(struct threadpool *tp) {
+#ifdef THREADPOOL_HAVE_AFFINITY
+  cpu_set_t allowed;
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &allowed) != 0) return 0;
+  const int num_cpus = CPU_COUNT(&allowed);
+  if (num_cpus == 0) return 0;
+  int *order = (int *)malloc(num_cpus * sizeof(int));
+  int count = 0;
+  /* offsets of the CPUs of every NUMA domain in order */
+  int *domains = (int *)malloc((num_cpus + 1) * sizeof(int));
+  int num_domains = 0;
+  for (int node = 0; node < CPU_SETSIZE && count < num_cpus; node++) {
+    char file_name[64];
+    sprintf(file_name, "/sys/devices/system/node/node%i/cpulist", node);
+    const int start = count;
+    if (threadpool_append_cpu_list(file_name, &allowed, order, &count) > 0) {
+      domains[num_domains++] = start;
+    }
+  }
+  /* CPUs without domain (e.g. if sysfs is not available) */
+  if (count < num_cpus) {
+    domains[num_domains++] = count;
+    for (int cpu = 0; cpu < CPU_SETSIZE && count < num_cpus; cpu++) {
+      if (CPU_ISSET(cpu, &allowed)) order[count++] = cpu;
+    }
+  }
+  domains[num_domains] = count;
+
+  free(tp->cpus);
+  tp->cpus = (int *)malloc(tp->num_threads * sizeof(int));
+  int used = 0;
+  for (int i = 0, domain = -1; i < tp->num_threads; i++) {
+    const int k = (int)((long)count * i / tp->num_threads);
+    tp->cpus[i] = order[k];
+    int d = domain < 0 ? 0 : domain;
+    while (k >= domains[d + 1]) d++;
+    if (d != domain) {
+      domain = d;
+      used++;
+    }
+  }
+  free(order);
+  free(domains);
+  return used;
+#else
+  return 0;
+#endif
+}
+
+/**
+ * @brief Free up all memory associated with the thread pool.
+ *
+ * @param tp Thread pool.
+ */
+inline static void threadpool_destroy(struct threadpool *tp) {
+  pthread_mutex_lock(&tp->lock);
+  tp->shutdown = 1;
+  pthread_cond_broadcast(&tp->start);
+  pthread_mutex_unlock(&tp->lock);
+  for (int i = 1; i < tp->num_threads; i++) {
+    pthread_join(tp->threads[i], NULL);
+  }
+  pthread_mutex_destroy(&tp->lock);
+  pthread_cond_destroy(&tp->start);
+  pthread_cond_destroy(&tp->done);
+  for (int i = 0; i < tp->num_threads; i++) {
+    pthread_mutex_destroy(&tp->deques[i].lock);
+  }
+  free(tp->threads);
+  free(tp->deques);
+  free(tp->runners);
+  free(tp->cpus);
+}
+
+/**
+ * @brief Get the next task from the given thread's own deque.
+ *
+ * @param tp Thread pool.
+ * @param thread_id Index of the thread.
+ * @return Index of the task, or -1 if the deque is empty.
+ */
+inline static int threadpool_pop_task(struct threadpool *tp, int thread_id) {
+  struct threadpool_deque *q = &tp->deques[thread_id];
+  int task = -1;
+  pthread_mutex_lock(&q->lock);
+  if (q->front < q->back) {
+    task = q->front++;
+  }
+  pthread_mutex_unlock(&q->lock);
+  return task;
+}
+
+/**
+ * @brief Steal half of the remaining tasks of another thread.
+ *
+ * The other threads are tried in a round robin fashion, starting with the next
+ * thread.
+ *
+ * @param tp Thread pool.
+ * @param thread_id Index of the (idle) thread that steals the tasks.
+ * @return 1 if tasks were stolen, 0 if all deques are empty.
+ */
+inline static int threadpool_steal_tasks(struct threadpool *tp,
+                                         int thread_id) {
+  for (int i = 1; i < tp->num_threads; i++) {
+    struct threadpool_deque *victim =
+        &tp->deques[(thread_id + i) % tp->num_threads];
+    pthread_mutex_lock(&victim->lock);
+    const int remaining = victim->back - victim->front;
+    if (remaining > 0) {
+      /* take the back half (rounded up) */
+      const int start = victim->front + remaining / 2;
+      const int end = victim->back;
+      victim->back = start;
+      pthread_mutex_unlock(&victim->lock);
+
+      struct threadpool_deque *q = &tp->deques[thread_id];
+      pthread_mutex_lock(&q->lock);
+      q->front = start;
+      q->back = end;
+      pthread_mutex_unlock(&q->lock);
+      return 1;
+    }
+    pthread_mutex_unlock(&victim->lock);
+  }
+  /* since no new tasks are created while mapping, there is no more work once
+     all deques are empty */
+  return 0;
+}
+
+/**
+ * @brief Execute and steal tasks of the current mapping until there is no
+ * more work.
+ *
+ * @param runner Thread executing the tasks.
+ */
+inline static void threadpool_runner_execute(struct threadpool_runner *runner) {
+  struct threadpool *tp = runner->tp;
+  const int thread_id = runner->thread_id;
+#ifdef THREADPOOL_HAVE_AFFINITY
+  if (tp->cpus != NULL && runner->cpu != tp->cpus[thread_id]) {
+    threadpool_pin_current_thread(tp->cpus[thread_id]);
+    runner->cpu = tp->cpus[thread_id];
+  }
+#endif
+  while (1) {
+    const int task = threadpool_pop_task(tp, thread_id);
+    if (task < 0) {
+      if (!threadpool_steal_tasks(tp, thread_id)) break;
+      continue;
+    }
+    tp->map_function(tp->map_data, task, thread_id);
+  }
+}
+
+/**
+ * @brief Main loop of a worker thread: wait for a new mapping, execute its
+ * tasks and report back, until the pool is destroyed.
+ *
+ * @param arg Pointer to the threadpool_runner of this thread.
+ * @return NULL.
+ */
+inline static void *threadpool_runner_main(void *arg) {
+  struct threadpool_runner *runner = (struct threadpool_runner *)arg;
+  struct threadpool *tp = runner->tp;
+  int generation = 0;
+  pthread_mutex_lock(&tp->lock);
+  while (1) {
+    while (tp->generation == generation && !tp->shutdown) {
+      pthread_cond_wait(&tp->start, &tp->lock);
+    }
+    if (tp->shutdown) break;
+    generation = tp->generation;
+    pthread_mutex_unlock(&tp->lock);
+
+    threadpool_runner_execute(runner);
+
+    pthread_mutex_lock(&tp->lock);
+    if (--tp->num_running == 0) {
+      pthread_cond_signal(&tp->done);
+    }
+  }
+  pthread_mutex_unlock(&tp->lock);
+  return NULL;
+}
+
+/**
+ * @brief Execute the given function for all tasks in the range
+ * [0, num_tasks[, using all threads of the pool.
+ *
+ * The calling thread participates as thread 0, the workers are woken up
+ * (without creating any threads). This function returns when all tasks have
+ * been executed. Tasks should be independent of each other.
+ *
+ * @param tp Thread pool.
+ * @param map_function Function to execute for every task.
+ * @param map_data Extra data passed on to map_function.
+ * @param num_tasks Number of tasks.
+ */
+inline static void threadpool_map(struct threadpool *tp,
+                                  threadpool_map_function map_function,
+                                  void *map_data, int num_tasks) {
+  if (num_tasks <= 0) return;
+
+  /* no need to wake any workers for a single thread */
+  if (tp->num_threads == 1) {
+    for (int i = 0; i < num_tasks; i++) {
+      map_function(map_data, i, 0);
+    }
+    return;
+  }
+
+  tp->map_function = map_function;
+  tp->map_data = map_data;
+
+  /* distribute the tasks over the threads in contiguous blocks */
+  for (int i = 0; i < tp->num_threads; i++) {
+    tp->deques[i].front = (int)((long)num_tasks * i / tp->num_threads);
+    tp->deques[i].back = (int)((long)num_tasks * (i + 1) / tp->num_threads);
+  }
+
+  /* wake up the workers */
+  pthread_mutex_lock(&tp->lock);
+  tp->num_running = tp->num_threads - 1;
+  tp->generation++;
+  pthread_cond_broadcast(&tp->start);
+  pthread_mutex_unlock(&tp->lock);
+#ifdef THREADPOOL_HAVE_AFFINITY
+  /* the calling thread is pinned by threadpool_runner_execute(), restore its
+     affinity afterwards */
+  cpu_set_t caller_affinity;
+  const int restore_affinity =
+      tp->cpus != NULL &&
+      pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t),
+                             &caller_affinity) == 0;
+#endif
+  threadpool_runner_execute(&tp->runners[0]);
+  pthread_mutex_lock(&tp->lock);
+  while (tp->num_running > 0) {
+    pthread_cond_wait(&tp->done, &tp->lock);
+  }
+  pthread_mutex_unlock(&tp->lock);
+#ifdef THREADPOOL_HAVE_AFFINITY
+  if (restore_affinity) {
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t),
+                           &caller_affinity);
+    tp->runners[0].cpu = -1;
+  }
+#endif
+
+  tp->map_function = NULL;
+  tp->map_data = NULL;
+}
+
+#endif  // CVORONOI_THREADPOOL_H
@@ -16,6 +16,7 @@
 #include "delaunay.h"
 #include "geometry.h"
 #include "dimensionality.h"
+#include "voronoi_face_table.h"
 
 #define voronoi_error(s, ...) \
   fprintf(stderr, s, ##__VA_ARGS__); \
@@ -31,9 +32,15 @@
 /*! @brief Store cell generators. */
 #define VORONOI_STORE_GENERATORS
 
-/*! @brief Activate runtime assertions. */
+/*! @brief Store a compact table of all faces with their normals and an index
+ *  of the faces of every cell (see voronoi_face_table.h). */
+#define VORONOI_STORE_FACE_TABLE
 
+#ifndef CVORONOI_NO_CHECKS
+/*! @brief Activate runtime assertions. */
 #define VORONOI_DO_ASSERTIONS
+#endif
+
 /**
  *@brief Evaluate the given condition and abort if it evaluates to true.
  *
@@ -48,10 +55,22 @@
     abort();                                                          \
   }
 #else
-#define delaunay_assert(condition)
+#define voronoi_assert(condition)
 #endif
 
+#ifndef CVORONOI_NO_CHECKS
+/*! @brief Activate consistency checks during and after the construction of the
+ *  Voronoi grid. */
 #define VORONOI_CHECKS
+#endif
+
+/*! @brief Construct the complete grid: cells, faces and the face table (see
+ *  voronoi_set_mode()). */
+#define VORONOI_MODE_FULL 0
+
+/*! @brief Only construct the volumes and centroids of the cells, without
+ *  storing any faces (see voronoi_set_mode()). */
+#define VORONOI_MODE_VOLUMES 1
 
 #if defined(DIMENSIONALITY_2D)
 #include "voronoi2d.h"
@@ -30,6 +30,9 @@
 
 #include <string.h>
 
+#include "allocator.h"
+#include "binary_output.h"
+
 /**
  * @brief Voronoi interface.
  *
@@ -104,6 +107,9 @@ struct voronoi {
   /*! @brief Number of cells. */
   int number_of_cells;
 
+  /*! @brief Allocated number of cells. */
+  int cell_size;
+
   /*! @brief Voronoi cell pairs. We store these per (SWIFT) cell, i.e. pairs[0]
    *  contains all pairs that are completely contained within this cell, while
    *  pairs[1] corresponds to pairs crossing the boundary between this cell and
@@ -116,6 +122,24 @@ struct voronoi {
 
   /*! @brief Allocated number of pairs per cell index. */
   int pair_size[2];
+
+  /*! @brief Vertices of the grid (circumcenters of the Delaunay triangles),
+   *  scratch space that is kept so that the grid can be rebuilt without
+   *  reallocating it (see voronoi_reset()). */
+  double *vertices;
+
+  /*! @brief Allocated number of vertices. */
+  int vertex_size;
+
+#ifdef VORONOI_STORE_FACE_TABLE
+  /*! @brief Compact table of all pairs, with the pairs of every cell (see
+   *  voronoi_update_face_table()). */
+  struct voronoi_face_table faces;
+#endif
+
+  /*! @brief Parts of the grid that are constructed (VORONOI_MODE_FULL or
+   *  VORONOI_MODE_VOLUMES, see voronoi_set_mode()). */
+  int mode;
 };
 
 /* Forward declarations */
@@ -124,37 +148,126 @@ static inline void voronoi_add_pair(struct voronoi *v, int sid,
                                     int left_part_pointer,
                                     int right_part_pointer, double ax,
                                     double ay, double bx, double by);
+static inline void voronoi_reset(struct voronoi *restrict v,
+                                 const struct delaunay *restrict d);
+#ifdef VORONOI_STORE_FACE_TABLE
+static inline void voronoi_update_face_table(struct voronoi *restrict v,
+                                             const double *generators,
+                                             const double *ghosts,
+                                             int ghost_offset, int stride);
+#endif
+
+/**
+ * @brief Initialise an empty Voronoi grid with the given number of cells.
+ *
+ * This function allocates the memory for the Voronoi grid arrays. The cells
+ * are not initialised and the grid contains no pairs; these are either
+ * constructed from a Delaunay tessellation (see voronoi_reset()) or filled in
+ * by the caller (see voronoi_copy_pair()).
+ *
+ * @param v Voronoi grid.
+ * @param number_of_cells Number of cells.
+ */
+static inline void voronoi_init_empty(struct voronoi *restrict v,
+                                      int number_of_cells) {
+  v->number_of_cells = number_of_cells;
+  v->cell_size = number_of_cells;
+  v->cells = (struct voronoi_cell *)CVORONOI_MALLOC(
+      v->cell_size * sizeof(struct voronoi_cell));
+  /* the vertices are allocated with the correct size by voronoi_reset() */
+  v->vertices = NULL;
+  v->vertex_size = 0;
+
+  /* Allocate memory for the voronoi pairs. */
+  for (int i = 0; i < 2; ++i) {
+    v->pairs[i] = (struct voronoi_pair *)CVORONOI_MALLOC(
+        10 * sizeof(struct voronoi_pair));
+    v->pair_size[i] = 10;
+    v->pair_index[i] = 0;
+  }
+#ifdef VORONOI_STORE_FACE_TABLE
+  voronoi_face_table_init(&v->faces);
+#endif
+  v->mode = VORONOI_MODE_FULL;
+}
 
 /**
  * @brief Initialise the Voronoi grid based on the given Delaunay tessellation.
  *
- * This function allocates the memory for the Voronoi grid arrays and creates
- * the grid in linear time by
+ * This function allocates the memory for the Voronoi grid arrays and then
+ * creates the grid (see voronoi_reset()).
+ *
+ * @param v Voronoi grid.
+ * @param d Delaunay tessellation (read-only).
+ */
+static inline void voronoi_init(struct voronoi *restrict v,
+                                const struct delaunay *restrict d) {
+  /* the cells are allocated with the correct size by voronoi_reset() */
+  voronoi_init_empty(v, 0);
+  voronoi_reset(v, d);
+}
+
+/**
+ * @brief Choose which parts of the grid are constructed by the next calls to
+ * voronoi_reset().
+ *
+ * In VORONOI_MODE_VOLUMES, only the volumes and centroids of the cells are
+ * computed (and their generators and number of faces, if these are stored),
+ * while the pairs and the face table of the grid stay empty.
+ *
+ * @param v Voronoi grid.
+ * @param mode VORONOI_MODE_FULL (default) or VORONOI_MODE_VOLUMES.
+ */
+static inline void voronoi_set_mode(struct voronoi *restrict v, int mode) {
+  if (mode != VORONOI_MODE_FULL && mode != VORONOI_MODE_VOLUMES) {
+    fprintf(stderr, "Unknown Voronoi mode: %i!\n", mode);
+    abort();
+  }
+  v->mode = mode;
+}
+
+/**
+ * @brief (Re)construct the Voronoi grid based on the given Delaunay
+ * tessellation.
+ *
+ * The grid is created in linear time by
  *  1. Computing the grid vertices as the midpoints of the circumcircles of the
  *     Delaunay triangles.
  *  2. Looping over all vertices and for each vertex looping (in
  *     counterclockwise order) over all triangles that link to that vertex.
  *
  * During the second step, the geometrical properties (cell centroid, volume
- * and face midpoint, area) are computed as well.
+ * and face midpoint, area) are computed as well. The pairs are only stored in
+ * VORONOI_MODE_FULL (see voronoi_set_mode()).
  *
- * @param v Voronoi grid.
+ * All memory of the grid is reused; arrays are only reallocated if they are
+ * too small.
+ *
+ * @param v Voronoi grid (initialised with voronoi_init()).
  * @param d Delaunay tessellation (read-only).
  */
-static inline void voronoi_init(struct voronoi *restrict v,
-                                const struct delaunay *restrict d) {
+static inline void voronoi_reset(struct voronoi *restrict v,
+                                 const struct delaunay *restrict d) {
 
   delaunay_assert(d->vertex_end > 0);
 
   /* the number of cells equals the number of non-ghost and non-dummy vertices
      in the Delaunay tessellation */
   v->number_of_cells = d->vertex_end - d->vertex_start;
-  /* allocate memory for the voronoi cells */
-  v->cells = (struct voronoi_cell *)malloc(v->number_of_cells *
-                                           sizeof(struct voronoi_cell));
-  /* Allocate memory to store vertices (will be freed at end) */
-  double *vertices =
-      (double *)malloc(2 * (d->triangle_index - 3) * sizeof(double));
+  /* make sure there is enough memory for the voronoi cells */
+  if (v->number_of_cells > v->cell_size) {
+    v->cell_size = v->number_of_cells;
+    v->cells = (struct voronoi_cell *)CVORONOI_REALLOC(
+        v->cells, v->cell_size * sizeof(struct voronoi_cell));
+  }
+  /* make sure there is enough memory to store the vertices */
+  if (d->triangle_index - 3 > v->vertex_size) {
+    v->vertex_size = d->triangle_index - 3;
+    v->vertices =
+        (double *)CVORONOI_REALLOC(v->vertices,
+                                   2 * v->vertex_size * sizeof(double));
+  }
+  double *vertices = v->vertices;
 
   /* loop over the triangles in the Delaunay tessellation and compute the
      midpoints of their circumcircles. These happen to be the vertices of the
@@ -209,13 +322,11 @@ static inline void voronoi_init(struct voronoi *restrict v,
     geometry2d_compute_circumcenter(v0x, v0y, v1x, v1y, v2x, v2y, &vertices[2 * i]);
   } /* loop over the Delaunay triangles and compute the circumcenters */
 
-  /* Allocate memory for the voronoi pairs. */
+  /* Remove all voronoi pairs. */
   for (int i = 0; i < 2; ++i) {
-    v->pairs[i] =
-        (struct voronoi_pair *)malloc(10 * sizeof(struct voronoi_pair));
     v->pair_index[i] = 0;
-    v->pair_size[i] = 10;
   }
+  const int store_faces = v->mode == VORONOI_MODE_FULL;
 
   /* loop over all cell generators, and hence over all non-ghost, non-dummy
      Delaunay vertices */
@@ -292,7 +403,9 @@ static inline void voronoi_init(struct voronoi *restrict v,
       /* the neighbour corresponding to the face is the same vertex that
          determines the next triangle */
       int ngb_del_vert_ix = d->triangles[t1].vertices[next_t_ix_in_cur_t];
-      if (ngb_del_vert_ix < d->ghost_offset) {
+      if (!store_faces) {
+        /* only the cell geometry is needed */
+      } else if (ngb_del_vert_ix < d->ghost_offset) {
         /* only store pairs once */
         if (ngb_del_vert_ix > del_vert_ix) {
           voronoi_add_pair(v, 0, NULL, del_vert_ix, ngb_del_vert_ix, bx, by, cx,
@@ -301,7 +414,8 @@ static inline void voronoi_init(struct voronoi *restrict v,
       } else {
         /* no check on ngb_del_vert_ix > del_vert_ix required, since this is
          * always true (del_vert_ix < d->ngb_offset) */
-        voronoi_add_pair(v, 1, NULL, del_vert_ix, -1, bx, by, cx, cy);
+        voronoi_add_pair(v, 1, NULL, del_vert_ix, ngb_del_vert_ix, bx, by, cx,
+                         cy);
       }
 
       cur_t_ix_in_next_t =
@@ -321,7 +435,9 @@ static inline void voronoi_init(struct voronoi *restrict v,
     cell_centroid[0] += V * centroid[0];
     cell_centroid[1] += V * centroid[1];
 
-    if (first_ngb_del_vert_ix < d->ghost_offset) {
+    if (!store_faces) {
+      /* only the cell geometry is needed */
+    } else if (first_ngb_del_vert_ix < d->ghost_offset) {
       if (first_ngb_del_vert_ix > del_vert_ix) {
         /* only store pairs once */
         voronoi_add_pair(v, 0, NULL, del_vert_ix, first_ngb_del_vert_ix, bx, by,
@@ -329,7 +445,8 @@ static inline void voronoi_init(struct voronoi *restrict v,
       }
     } else {
       /* no check on other_vertex > i required, since this is always true */
-      voronoi_add_pair(v, 1, NULL, del_vert_ix, -1, bx, by, cx, cy);
+      voronoi_add_pair(v, 1, NULL, del_vert_ix, first_ngb_del_vert_ix, bx,
+                       by, cx, cy);
     }
 
     /* now compute the actual centroid by dividing the volume-weighted
@@ -343,9 +460,10 @@ static inline void voronoi_init(struct voronoi *restrict v,
     this_cell->nface = nface;
 #endif
   } /* loop over all cell generators */
-
-  /* free allocated memory */
-  free(vertices);
+#ifdef VORONOI_STORE_FACE_TABLE
+  /* the Delaunay vertices contain both the generators and the ghosts */
+  voronoi_update_face_table(v, d->vertices, d->vertices, 0, 2);
+#endif
 }
 
 /**
@@ -354,10 +472,34 @@ static inline void voronoi_init(struct voronoi *restrict v,
  * @param v Voronoi grid.
  */
 static inline void voronoi_destroy(struct voronoi *restrict v) {
-  free(v->cells);
+  CVORONOI_FREE(v->cells);
   for (int i = 0; i < 2; ++i) {
-    free(v->pairs[i]);
+    CVORONOI_FREE(v->pairs[i]);
   }
+  CVORONOI_FREE(v->vertices);
+#ifdef VORONOI_STORE_FACE_TABLE
+  voronoi_face_table_destroy(&v->faces);
+#endif
+}
+
+/**
+ * @brief Get the memory used by the Voronoi grid.
+ *
+ * Since the arrays of a grid never shrink (also not when it is reset), this is
+ * also the high-water mark of its memory use.
+ *
+ * @param v Voronoi grid.
+ * @return Size in bytes.
+ */
+static inline size_t voronoi_get_memory_size(const struct voronoi *v) {
+  size_t size = (size_t)v->cell_size * sizeof(struct voronoi_cell) +
+                (size_t)(v->pair_size[0] + v->pair_size[1]) *
+                    sizeof(struct voronoi_pair) +
+                (size_t)v->vertex_size * 2 * sizeof(double);
+#ifdef VORONOI_STORE_FACE_TABLE
+  size += voronoi_face_table_get_memory_size(&v->faces);
+#endif
+  return size;
 }
 
 /**
@@ -381,8 +523,9 @@ static inline void voronoi_destroy(struct voronoi *restrict v) {
  * cell linked to this grid). FUTURE NOTE: For SWIFT, replace this with direct
  * pointer to the left particle.
  * @param right_part_pointer Index of right particle in cell (particle in the
- * cell linked to this grid), or -1 for ghost vertices. FUTURE NOTE: For SWIFT,
- * replace this with direct pointer to the right particle.
+ * cell linked to this grid), or index of the ghost vertex in the Delaunay
+ * tessellation (sid=1). FUTURE NOTE: For SWIFT, replace this with direct
+ * pointer to the right particle.
  * @param ax,ay,bx,by Vertices of the interface.
  */
 static inline void voronoi_add_pair(struct voronoi *v, int sid,
@@ -393,7 +536,7 @@ static inline void voronoi_add_pair(struct voronoi *v, int sid,
 
   if (v->pair_index[sid] == v->pair_size[sid]) {
     v->pair_size[sid] <<= 1;
-    v->pairs[sid] = (struct voronoi_pair *)realloc(
+    v->pairs[sid] = (struct voronoi_pair *)CVORONOI_REALLOC(
         v->pairs[sid], v->pair_size[sid] * sizeof(struct voronoi_pair));
   }
   struct voronoi_pair *this_pair = &v->pairs[sid][v->pair_index[sid]];
@@ -411,6 +554,79 @@ static inline void voronoi_add_pair(struct voronoi *v, int sid,
   ++v->pair_index[sid];
 }
 
+/**
+ * @brief Add a copy of a pair of another grid to the grid, with new indices
+ * for the particles on both sides.
+ *
+ * This is used to stitch the grids of multiple cells into a single grid (see
+ * space_construct_cell_parallel()).
+ *
+ * @param v Voronoi grid.
+ * @param sid 0 for pairs entirely in this cell, 1 for pairs between this cell
+ * and a neighbouring cell (see voronoi_add_pair()).
+ * @param src Voronoi grid containing the pair (unused in 2D, since the pairs
+ * store their own vertices).
+ * @param pair Pair to copy.
+ * @param left_part_pointer New index of the left particle.
+ * @param right_part_pointer New index of the right particle.
+ */
+static inline void voronoi_copy_pair(struct voronoi *v, int sid,
+                                     const struct voronoi *src,
+                                     const struct voronoi_pair *pair,
+                                     int left_part_pointer,
+                                     int right_part_pointer) {
+  if (v->pair_index[sid] == v->pair_size[sid]) {
+    v->pair_size[sid] <<= 1;
+    v->pairs[sid] = (struct voronoi_pair *)CVORONOI_REALLOC(
+        v->pairs[sid], v->pair_size[sid] * sizeof(struct voronoi_pair));
+  }
+  struct voronoi_pair *this_pair = &v->pairs[sid][v->pair_index[sid]];
+  *this_pair = *pair;
+  this_pair->left = left_part_pointer;
+  this_pair->right = right_part_pointer;
+  ++v->pair_index[sid];
+}
+
+#ifdef VORONOI_STORE_FACE_TABLE
+/**
+ * @brief (Re)build the face table of the grid from its pairs (see
+ * voronoi_face_table.h).
+ *
+ * @param v Voronoi grid.
+ * @param generators Positions of the local generators, indexed by the left
+ * index (and for pairs[0] also the right index) of the pairs.
+ * @param ghosts Positions of the ghost generators, indexed by the right index
+ * of pairs[1] minus ghost_offset.
+ * @param ghost_offset Offset of the ghost indices.
+ * @param stride Number of values per position in generators and ghosts (at
+ * least 2).
+ */
+static inline void voronoi_update_face_table(struct voronoi *restrict v,
+                                             const double *generators,
+                                             const double *ghosts,
+                                             int ghost_offset, int stride) {
+  struct voronoi_face_table *t = &v->faces;
+  voronoi_face_table_reset(t, v->pair_index[0] + v->pair_index[1],
+                           v->pair_index[0]);
+  int f = 0;
+  for (int sid = 0; sid < 2; sid++) {
+    for (int i = 0; i < v->pair_index[sid]; i++, f++) {
+      const struct voronoi_pair *pair = &v->pairs[sid][i];
+      const double *r =
+          sid == 0 ? &generators[stride * pair->right]
+                   : &ghosts[stride * (pair->right - ghost_offset)];
+      const double *l = &generators[stride * pair->left];
+      const double left_generator[3] = {l[0], l[1], 0.};
+      const double right_generator[3] = {r[0], r[1], 0.};
+      voronoi_face_table_set_face(t, f, pair->left, pair->right,
+                                  pair->surface_area, pair->midpoint,
+                                  left_generator, right_generator);
+    }
+  }
+  voronoi_face_table_build_index(t, v->number_of_cells);
+}
+#endif
+
 /**
  * @brief Sanity checks on the grid.
  *
@@ -488,4 +704,102 @@ static inline void voronoi_print_grid(const struct voronoi *restrict v,
   fclose(file);
 }
 
+/**
+ * @brief Write the Voronoi grid to a binary file with the given name.
+ *
+ * The file has the same layout as in 3D (see the 3D version of this
+ * function), but with 2 coordinates per position. Every face has exactly two
+ * vertices.
+ *
+ * @param v Voronoi grid (read-only).
+ * @param file_name Name of the output file.
+ */
+static inline void voronoi_print_grid_binary(const struct voronoi *restrict v,
+                                             const char *file_name) {
+
+  uint32_t flags = 0;
+#ifdef VORONOI_STORE_GENERATORS
+  flags |= BINARY_OUTPUT_FLAG_GENERATORS;
+#endif
+#ifdef VORONOI_STORE_CELL_STATS
+  flags |= BINARY_OUTPUT_FLAG_CELL_STATS;
+#endif
+  const int nface = v->pair_index[0] + v->pair_index[1];
+  int64_t nface_vertex = 0;
+#ifdef VORONOI_STORE_CONNECTIONS
+  flags |= BINARY_OUTPUT_FLAG_CONNECTIONS;
+  nface_vertex = 2 * nface;
+#endif
+  const int64_t counts[BINARY_OUTPUT_NCOUNT] = {v->number_of_cells, nface,
+                                                nface_vertex, 0};
+
+  struct binary_output o;
+  binary_output_open(&o, file_name);
+  binary_output_write_header(&o, BINARY_OUTPUT_TYPE_VORONOI, 2, flags, counts);
+
+  /* cell arrays */
+#ifdef VORONOI_STORE_GENERATORS
+  for (int i = 0; i < v->number_of_cells; ++i) {
+    binary_output_write_doubles(&o, v->cells[i].generator, 2);
+  }
+#endif
+  for (int i = 0; i < v->number_of_cells; ++i) {
+    binary_output_write_doubles(&o, v->cells[i].centroid, 2);
+  }
+  for (int i = 0; i < v->number_of_cells; ++i) {
+    binary_output_write_double(&o, v->cells[i].volume);
+  }
+#ifdef VORONOI_STORE_CELL_STATS
+  for (int i = 0; i < v->number_of_cells; ++i) {
+    binary_output_write_int32(&o, v->cells[i].nface);
+  }
+  binary_output_align(&o);
+#endif
+
+  /* face arrays */
+  for (int ngb = 0; ngb < 2; ++ngb) {
+    for (int i = 0; i < v->pair_index[ngb]; ++i) {
+      binary_output_write_int32(&o, v->pairs[ngb][i].left);
+    }
+  }
+  binary_output_align(&o);
+  for (int ngb = 0; ngb < 2; ++ngb) {
+    for (int i = 0; i < v->pair_index[ngb]; ++i) {
+      binary_output_write_int32(&o, v->pairs[ngb][i].right);
+    }
+  }
+  binary_output_align(&o);
+  for (int ngb = 0; ngb < 2; ++ngb) {
+    for (int i = 0; i < v->pair_index[ngb]; ++i) {
+      binary_output_write_int32(&o, ngb);
+    }
+  }
+  binary_output_align(&o);
+  for (int ngb = 0; ngb < 2; ++ngb) {
+    for (int i = 0; i < v->pair_index[ngb]; ++i) {
+      binary_output_write_double(&o, v->pairs[ngb][i].surface_area);
+    }
+  }
+  for (int ngb = 0; ngb < 2; ++ngb) {
+    for (int i = 0; i < v->pair_index[ngb]; ++i) {
+      binary_output_write_doubles(&o, v->pairs[ngb][i].midpoint, 2);
+    }
+  }
+
+#ifdef VORONOI_STORE_CONNECTIONS
+  /* face vertices, in compressed sparse row format */
+  for (int64_t i = 0; i <= nface; ++i) {
+    binary_output_write_int64(&o, 2 * i);
+  }
+  for (int ngb = 0; ngb < 2; ++ngb) {
+    for (int i = 0; i < v->pair_index[ngb]; ++i) {
+      binary_output_write_doubles(&o, v->pairs[ngb][i].a, 2);
+      binary_output_write_doubles(&o, v->pairs[ngb][i].b, 2);
+    }
+  }
+#endif
+
+  binary_output_close(&o);
+}
+
 #endif /* CVORONOI_VORONOI2D_H */
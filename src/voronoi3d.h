@@ -11,6 +11,10 @@
 #ifndef CVORONOI_VORONOI3D_H
 #define CVORONOI_VORONOI3D_H
 
+#include <string.h>
+
+#include "allocator.h"
+#include "binary_output.h"
 #include "queues.h"
 #include "tuples.h"
 
@@ -40,8 +44,9 @@ struct voronoi_pair {
   double midpoint[3];
 
 #ifdef VORONOI_STORE_CONNECTIONS
-  /*! Vertices of the interface. */
-  double *vertices;
+  /*! Index of the first vertex of the interface in the face vertex array of
+   * the voronoi grid (see voronoi_get_face_vertices()). */
+  int vertex_offset;
 
   /*! Number of vertices of this face. */
   int n_vertices;
@@ -50,49 +55,30 @@ struct voronoi_pair {
 
 /**
  * @brief Initializes a voronoi pair (i.e. a face). The vertices of the face are
- * only stored if VORONOI_STORE_CONNECTIONS is defined.
+ * stored by voronoi_new_face().
  *
  * @param pair Voronoi pair to initialize
  * @param c Pointer to the SWIFT cell in which the right particle lives
  * (NULL if this is the same cell as the left particle)
  * @param left_part_pointer Pointer to the left particle of this pair
  * @param right_part_pointer Pointer to the right particle of this pair
- * @param vertices Vertices making up the face
- * @param n_vertices Number of vertices in the vertices array.
+ * @param surface_area Area of the face.
+ * @param midpoint Midpoint of the face.
  */
 inline static void voronoi_pair_init(struct voronoi_pair *pair,
                                      struct cell *restrict c,
                                      int left_part_pointer,
-                                     int right_part_pointer, double *vertices,
-                                     int n_vertices) {
+                                     int right_part_pointer,
+                                     double surface_area,
+                                     const double *midpoint) {
   pair->right_cell = c;
   pair->left = left_part_pointer;
   pair->right = right_part_pointer;
 
-  pair->surface_area =
-      geometry3d_compute_centroid_area(vertices, n_vertices, pair->midpoint);
-
-#ifdef VORONOI_STORE_CONNECTIONS
-  pair->vertices = (double *)malloc(3 * n_vertices * sizeof(double));
-  pair->n_vertices = n_vertices;
-  for (int i = 0; i < n_vertices; i++) {
-    pair->vertices[3 * i] = vertices[3 * i];
-    pair->vertices[3 * i + 1] = vertices[3 * i + 1];
-    pair->vertices[3 * i + 2] = vertices[3 * i + 2];
-  }
-#endif
-}
-
-/**
- * @brief Free up memory allocated by a voronoi pair (only necessary if
- * VORONOI_STORE_CONNECTIONS is defined).
- *
- * @param pair
- */
-inline static void voronoi_pair_destroy(struct voronoi_pair *pair) {
-#ifdef VORONOI_STORE_CONNECTIONS
-  free(pair->vertices);
-#endif
+  pair->surface_area = surface_area;
+  pair->midpoint[0] = midpoint[0];
+  pair->midpoint[1] = midpoint[1];
+  pair->midpoint[2] = midpoint[2];
 }
 
 /**
@@ -126,6 +112,9 @@ struct voronoi {
   /*! @brief Number of cells. */
   int number_of_cells;
 
+  /*! @brief Allocated number of cells. */
+  int cell_size;
+
   /*! @brief Voronoi cell pairs. We store these per (SWIFT) cell, i.e. pairs[0]
    *  contains all pairs that are completely contained within this cell, while
    *  pairs[1] corresponds to pairs crossing the boundary between this cell and
@@ -138,6 +127,56 @@ struct voronoi {
 
   /*! @brief Allocated number of pairs per cell index. */
   int pair_size[2];
+
+#ifdef VORONOI_STORE_CONNECTIONS
+  /*! @brief Vertices of all faces (3 coordinates per vertex). The vertices of
+   *  every face are stored contiguously, so that all faces share a single
+   *  allocation instead of allocating every face separately. */
+  double *face_vertices;
+
+  /*! @brief Current number of vertices in face_vertices. */
+  int face_vertex_index;
+
+  /*! @brief Allocated number of vertices in face_vertices. */
+  int face_vertex_size;
+#endif
+
+#ifdef VORONOI_STORE_FACE_TABLE
+  /*! @brief Compact table of all faces, with the faces of every cell (see
+   *  voronoi_update_face_table()). */
+  struct voronoi_face_table faces;
+#endif
+
+  /*! @brief Parts of the grid that are constructed (VORONOI_MODE_FULL or
+   *  VORONOI_MODE_VOLUMES, see voronoi_set_mode()). */
+  int mode;
+
+  /* Scratch space used during the construction of the grid, which is kept so
+     that the grid can be rebuilt without reallocating it (see
+     voronoi_reset()). */
+
+  /*! @brief Vertices of the grid (circumcenters of the tetrahedra, 3 values
+   *  per tetrahedron). */
+  double *voronoi_vertices;
+
+  /*! @brief Allocated number of vertices in voronoi_vertices. */
+  int voronoi_vertex_size;
+
+  /*! @brief Flags for the vertices of the Delaunay tessellation that were
+   *  already encountered as neighbour of the current generator. */
+  int *neighbour_flags;
+
+  /*! @brief Allocated number of neighbour flags. */
+  int neighbour_flags_size;
+
+  /*! @brief Queue of Delaunay edges around which we still need to loop. */
+  struct int3_fifo_queue neighbour_info_q;
+
+  /*! @brief Vertices of the face that is currently being constructed. */
+  double *face_vertex_buffer;
+
+  /*! @brief Allocated number of vertices in face_vertex_buffer. */
+  int face_vertex_buffer_size;
 };
 
 /* Forward declarations */
@@ -147,14 +186,388 @@ inline static int voronoi_new_face(struct voronoi *v, int sid,
                                    struct cell *restrict c,
                                    int left_part_pointer,
                                    int right_part_pointer, double *vertices,
-                                   int n_vertices);
+                                   int n_vertices, double surface_area,
+                                   const double *midpoint);
 inline static void voronoi_check_grid(struct voronoi *restrict v);
+#ifdef VORONOI_STORE_FACE_TABLE
+inline static void voronoi_update_face_table(struct voronoi *restrict v,
+                                             const double *generators,
+                                             const double *ghosts,
+                                             int ghost_offset, int stride);
+#endif
+inline static void voronoi_reset(struct voronoi *restrict v,
+                                 struct delaunay *restrict d);
+
+/**
+ * @brief Walk around the Delaunay edges of a single generator, which yields
+ * the faces of its Voronoi cell one by one (see voronoi_walk_next_face()).
+ *
+ * The same walk is used to construct the complete grid (see voronoi_reset())
+ * and to query single cells without constructing the grid (see
+ * voronoi_cell_faces()).
+ */
+struct voronoi_walk {
+  /*! @brief Delaunay tessellation (only the circumcenter cache is modified).
+   */
+  struct delaunay *d;
+
+  /*! @brief Vertices of the grid (3 per tetrahedron, starting from
+   *  d->tetrahedron_start), or NULL if the circumcenters are computed during
+   *  the walk. */
+  const double *voronoi_vertices;
+
+  /*! @brief Flags for the vertices of the Delaunay tessellation that were
+   *  already encountered as neighbour of the generator (all 0 outside a walk),
+   *  or NULL if the queue is searched instead. */
+  int *neighbour_flags;
+
+  /*! @brief Queue of Delaunay edges around which we still need to loop. Values
+   *  are never removed from its array, so that it also contains all
+   *  neighbours that were encountered so far. */
+  struct int3_fifo_queue *queue;
+
+  /*! @brief Vertices of the current face (3 per vertex). */
+  double *face_vertices;
+
+  /*! @brief Allocated number of vertices in face_vertices. */
+  int face_vertices_size;
+
+  /*! @brief Generator of the cell. */
+  int generator;
+};
+
+/**
+ * @brief Initialise a walk.
+ *
+ * @param w Walk.
+ * @param d Delaunay tessellation.
+ * @param voronoi_vertices Precomputed vertices of the grid, or NULL (see
+ * struct voronoi_walk).
+ * @param neighbour_flags Flags (one per Delaunay vertex, all 0), or NULL.
+ * @param queue Queue.
+ * @param face_vertices Buffer for the vertices of the current face. It is
+ * grown during the walk, and should be taken back from w->face_vertices
+ * afterwards.
+ * @param face_vertices_size Allocated number of vertices in face_vertices.
+ */
+inline static void voronoi_walk_init(struct voronoi_walk *w,
+                                     struct delaunay *d,
+                                     const double *voronoi_vertices,
+                                     int *neighbour_flags,
+                                     struct int3_fifo_queue *queue,
+                                     double *face_vertices,
+                                     int face_vertices_size) {
+  w->d = d;
+  w->voronoi_vertices = voronoi_vertices;
+  w->neighbour_flags = neighbour_flags;
+  w->queue = queue;
+  w->face_vertices = face_vertices;
+  w->face_vertices_size = face_vertices_size;
+  w->generator = -1;
+}
+
+/**
+ * @brief Check whether the given Delaunay vertex was already encountered as
+ * neighbour of the generator (or is the generator itself).
+ */
+inline static int voronoi_walk_is_flagged(const struct voronoi_walk *w,
+                                          int vertex) {
+  if (w->neighbour_flags != NULL) {
+    return w->neighbour_flags[vertex];
+  }
+  if (vertex == w->generator) return 1;
+  for (int i = 0; i < w->queue->end; i++) {
+    if (w->queue->values[i]._1 == vertex) return 1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Queue the Delaunay edge between the generator and the given vertex of
+ * the given tetrahedron, and flag the vertex.
+ */
+inline static void voronoi_walk_queue(struct voronoi_walk *w, int t_idx,
+                                      int v_idx_in_d, int v_idx_in_t) {
+  int3 info = {._0 = t_idx, ._1 = v_idx_in_d, ._2 = v_idx_in_t};
+  int3_fifo_queue_push(w->queue, info);
+  if (w->neighbour_flags != NULL) {
+    w->neighbour_flags[v_idx_in_d] = 1;
+  }
+}
+
+/**
+ * @brief Copy the vertex of the grid corresponding to the given tetrahedron.
+ */
+inline static void voronoi_walk_get_vertex(struct voronoi_walk *w, int t_idx,
+                                           double *vertex) {
+  if (w->voronoi_vertices != NULL) {
+    const double *x =
+        &w->voronoi_vertices[3 * (t_idx - w->d->tetrahedron_start)];
+    vertex[0] = x[0];
+    vertex[1] = x[1];
+    vertex[2] = x[2];
+  } else {
+    delaunay_get_circumcenter(w->d, t_idx, vertex);
+  }
+}
+
+/**
+ * @brief Start walking around the given (local) generator.
+ *
+ * @param w Walk.
+ * @param generator Index of the generator in the Delaunay tessellation.
+ */
+inline static void voronoi_walk_start(struct voronoi_walk *w, int generator) {
+  const struct delaunay *d = w->d;
+  voronoi_assert(generator >= d->vertex_start && generator < d->vertex_end);
+  int3_fifo_queue_reset(w->queue);
+  w->generator = generator;
+  /* Set the flag of the central generator so that we never pick it as
+   * possible neighbour */
+  if (w->neighbour_flags != NULL) {
+    w->neighbour_flags[generator] = 1;
+  }
+
+  /* Get a tetrahedron containing the central generator */
+  const int t_idx = d->vertex_tetrahedron_links[generator];
+  const int gen_idx_in_t = d->vertex_tetrahedron_index[generator];
+
+  /* Pick another vertex (generator) from this tetrahedron and add it to the
+   * queue */
+  const int other_v_idx_in_t = (gen_idx_in_t + 1) % 4;
+  const int other_v_idx_in_d =
+      tetrahedron_get_vertex(&d->tetrahedra, t_idx, other_v_idx_in_t);
+  voronoi_walk_queue(w, t_idx, other_v_idx_in_d, other_v_idx_in_t);
+}
+
+/**
+ * @brief Get the next face of the cell.
+ *
+ * With each Delaunay edge of the generator corresponds a face. We loop around
+ * the edge (the axis) to get the vertices of the face, and add the other
+ * edges of the tetrahedra we encounter to the queue (if we did not already do
+ * so).
+ *
+ * @param w Walk (see voronoi_walk_start()).
+ * @param axis (Returned) Delaunay vertex on the other side of the face.
+ * @return Number of vertices of the face, which are stored in
+ * w->face_vertices, or 0 if all faces have been visited.
+ */
+inline static int voronoi_walk_next_face(struct voronoi_walk *w, int *axis) {
+  if (int3_fifo_queue_is_empty(w->queue)) return 0;
+  struct delaunay *d = w->d;
+  const int gen_idx_in_d = w->generator;
+
+  /* Pop the next axis vertex and corresponding tetrahedron from the queue */
+  const int3 info = int3_fifo_queue_pop(w->queue);
+  const int first_t_idx = info._0;
+  const int axis_idx_in_d = info._1;
+  const int axis_idx_in_t = info._2;
+  voronoi_assert(axis_idx_in_d >= 0 && (axis_idx_in_d < d->vertex_end ||
+                                        axis_idx_in_d >= d->ghost_offset));
+
+  /* Get a non axis vertex from first_t */
+  int non_axis_idx_in_first_t = (axis_idx_in_t + 1) % 4;
+  if (tetrahedron_get_vertex(&d->tetrahedra, first_t_idx,
+                             non_axis_idx_in_first_t) == gen_idx_in_d) {
+    non_axis_idx_in_first_t = (non_axis_idx_in_first_t + 1) % 4;
+  }
+  const int non_axis_idx_in_d = tetrahedron_get_vertex(
+      &d->tetrahedra, first_t_idx, non_axis_idx_in_first_t);
+
+  if (!voronoi_walk_is_flagged(w, non_axis_idx_in_d)) {
+    /* Add this vertex and tetrahedron to the queue and update its flag */
+    voronoi_walk_queue(w, first_t_idx, non_axis_idx_in_d,
+                       non_axis_idx_in_first_t);
+  }
+
+  /* Get a neighbouring tetrahedron of first_t sharing the axis */
+  int cur_t_idx = tetrahedron_get_neighbour(&d->tetrahedra, first_t_idx,
+                                            non_axis_idx_in_first_t);
+  int prev_t_idx_in_cur_t = tetrahedron_get_index_in_neighbour(
+      &d->tetrahedra, first_t_idx, non_axis_idx_in_first_t);
+
+  /* Get a neighbouring tetrahedron of cur_t that is not first_t, sharing the
+   * same axis */
+  int next_t_idx_in_cur_t = (prev_t_idx_in_cur_t + 1) % 4;
+  while (tetrahedron_get_vertex(&d->tetrahedra, cur_t_idx,
+                                next_t_idx_in_cur_t) == gen_idx_in_d ||
+         tetrahedron_get_vertex(&d->tetrahedra, cur_t_idx,
+                                next_t_idx_in_cur_t) == axis_idx_in_d) {
+    next_t_idx_in_cur_t = (next_t_idx_in_cur_t + 1) % 4;
+  }
+  int next_t_idx = tetrahedron_get_neighbour(&d->tetrahedra, cur_t_idx,
+                                             next_t_idx_in_cur_t);
+
+  /* Get the next non axis vertex and add it to the queue if necessary */
+  int next_non_axis_idx_in_d =
+      tetrahedron_get_vertex(&d->tetrahedra, cur_t_idx, next_t_idx_in_cur_t);
+  if (!voronoi_walk_is_flagged(w, next_non_axis_idx_in_d)) {
+    voronoi_walk_queue(w, cur_t_idx, next_non_axis_idx_in_d,
+                       next_t_idx_in_cur_t);
+  }
+
+  /* Get the coordinates of the voronoi vertex of the new face */
+  voronoi_walk_get_vertex(w, first_t_idx, w->face_vertices);
+  int face_vertices_index = 1;
+
+  /* Loop around the axis */
+  while (next_t_idx != first_t_idx) {
+    /* Get the coordinates of the voronoi vertex corresponding to cur_t and
+     * next_t */
+    if (face_vertices_index + 6 > w->face_vertices_size) {
+      w->face_vertices_size <<= 1;
+      w->face_vertices = (double *)CVORONOI_REALLOC(
+          w->face_vertices, 3 * w->face_vertices_size * sizeof(double));
+    }
+    voronoi_walk_get_vertex(w, cur_t_idx,
+                            &w->face_vertices[3 * face_vertices_index]);
+    voronoi_walk_get_vertex(w, next_t_idx,
+                            &w->face_vertices[3 * face_vertices_index + 3]);
+    face_vertices_index += 2;
+
+    /* Update variables */
+    prev_t_idx_in_cur_t = tetrahedron_get_index_in_neighbour(
+        &d->tetrahedra, cur_t_idx, next_t_idx_in_cur_t);
+    cur_t_idx = next_t_idx;
+    next_t_idx_in_cur_t = (prev_t_idx_in_cur_t + 1) % 4;
+    while (tetrahedron_get_vertex(&d->tetrahedra, cur_t_idx,
+                                  next_t_idx_in_cur_t) == gen_idx_in_d ||
+           tetrahedron_get_vertex(&d->tetrahedra, cur_t_idx,
+                                  next_t_idx_in_cur_t) == axis_idx_in_d) {
+      next_t_idx_in_cur_t = (next_t_idx_in_cur_t + 1) % 4;
+    }
+    next_t_idx = tetrahedron_get_neighbour(&d->tetrahedra, cur_t_idx,
+                                           next_t_idx_in_cur_t);
+    /* Get the next non axis vertex and add it to the queue if necessary */
+    next_non_axis_idx_in_d = tetrahedron_get_vertex(&d->tetrahedra, cur_t_idx,
+                                                    next_t_idx_in_cur_t);
+    if (!voronoi_walk_is_flagged(w, next_non_axis_idx_in_d)) {
+      voronoi_walk_queue(w, cur_t_idx, next_non_axis_idx_in_d,
+                         next_t_idx_in_cur_t);
+    }
+  }
+  *axis = axis_idx_in_d;
+  return face_vertices_index;
+}
+
+/**
+ * @brief Finish the walk around the current generator by resetting the flags
+ * of the generator and all its neighbours.
+ *
+ * @param w Walk (after voronoi_walk_next_face() returned 0).
+ */
+inline static void voronoi_walk_finish(struct voronoi_walk *w) {
+  if (w->neighbour_flags == NULL) return;
+  w->neighbour_flags[w->generator] = 0;
+  for (int i = 0; i < w->queue->end; i++) {
+    voronoi_assert(w->queue->values[i]._1 < w->d->vertex_index);
+    w->neighbour_flags[w->queue->values[i]._1] = 0;
+  }
+#ifdef VORONOI_CHECKS
+  for (int i = 0; i < w->d->vertex_index; i++) {
+    voronoi_assert(w->neighbour_flags[i] == 0);
+  }
+#endif
+}
+
+/**
+ * @brief Initialise an empty Voronoi grid with the given number of cells.
+ *
+ * This function allocates the memory for the Voronoi grid arrays. The cells
+ * are not initialised and the grid contains no faces; these are either
+ * constructed from a Delaunay tessellation (see voronoi_reset()) or filled in
+ * by the caller (see voronoi_copy_pair()).
+ *
+ * @param v Voronoi grid.
+ * @param number_of_cells Number of cells.
+ */
+inline static void voronoi_init_empty(struct voronoi *restrict v,
+                                      int number_of_cells) {
+  v->number_of_cells = number_of_cells;
+  v->cell_size = number_of_cells;
+  v->cells = (struct voronoi_cell *)CVORONOI_MALLOC(
+      v->cell_size * sizeof(struct voronoi_cell));
+  /* the remaining scratch arrays are allocated with the correct size by
+     voronoi_reset() */
+  v->voronoi_vertices = NULL;
+  v->voronoi_vertex_size = 0;
+  v->neighbour_flags = NULL;
+  v->neighbour_flags_size = 0;
+
+  /* Allocate memory for the voronoi pairs (faces). */
+  for (int i = 0; i < 2; ++i) {
+    v->pairs[i] = (struct voronoi_pair *)CVORONOI_MALLOC(
+        10 * sizeof(struct voronoi_pair));
+    v->pair_size[i] = 10;
+    v->pair_index[i] = 0;
+  }
+#ifdef VORONOI_STORE_CONNECTIONS
+  /* same estimate as in voronoi_reset() */
+  v->face_vertex_size =
+      40 * number_of_cells > 10 ? 40 * number_of_cells : 10;
+  v->face_vertices =
+      (double *)CVORONOI_MALLOC(3 * v->face_vertex_size * sizeof(double));
+  v->face_vertex_index = 0;
+#endif
+#ifdef VORONOI_STORE_FACE_TABLE
+  voronoi_face_table_init(&v->faces);
+#endif
+  v->mode = VORONOI_MODE_FULL;
+
+  /* Allocate a tetrahedron_vertex_queue */
+  int3_fifo_queue_init(&v->neighbour_info_q, 10);
+
+  /* The size of the array used to temporarily store the vertices of the voronoi
+   * faces in */
+  v->face_vertex_buffer_size = 10;
+  v->face_vertex_buffer = (double *)CVORONOI_MALLOC(
+      3 * v->face_vertex_buffer_size * sizeof(double));
+}
 
 /**
  * @brief Initialise the Voronoi grid based on the given Delaunay tessellation.
  *
- * This function allocates the memory for the Voronoi grid arrays and creates
- * the grid in linear time by
+ * This function allocates the memory for the Voronoi grid arrays and then
+ * creates the grid (see voronoi_reset()).
+ *
+ * @param v Voronoi grid.
+ * @param d Delaunay tessellation (only the circumcenter cache is modified).
+ */
+inline static void voronoi_init(struct voronoi *restrict v,
+                                struct delaunay *restrict d) {
+  /* the cells are allocated with the correct size by voronoi_reset() */
+  voronoi_init_empty(v, 0);
+  voronoi_reset(v, d);
+}
+
+/**
+ * @brief Choose which parts of the grid are constructed by the next calls to
+ * voronoi_reset().
+ *
+ * In VORONOI_MODE_VOLUMES, only the volumes and centroids of the cells are
+ * computed (and their generators and number of faces, if these are stored).
+ * No faces are stored: the pairs, face vertices and face table of the grid are
+ * empty, so that their memory is neither touched nor grown. This is useful if
+ * only the volumes are needed, e.g. for refinement criteria. The faces of
+ * single cells can still be queried afterwards (see voronoi_cell_faces()).
+ *
+ * @param v Voronoi grid.
+ * @param mode VORONOI_MODE_FULL (default) or VORONOI_MODE_VOLUMES.
+ */
+inline static void voronoi_set_mode(struct voronoi *restrict v, int mode) {
+  if (mode != VORONOI_MODE_FULL && mode != VORONOI_MODE_VOLUMES) {
+    fprintf(stderr, "Unknown Voronoi mode: %i!\n", mode);
+    abort();
+  }
+  v->mode = mode;
+}
+
+/**
+ * @brief (Re)construct the Voronoi grid based on the given Delaunay
+ * tessellation.
+ *
+ * The grid is created in linear time by
  *  1. Computing the grid vertices as the midpoints of the circumcircles of the
  *     Delaunay tetrahedra.
  *  2. Looping over all vertices and for each generator looping over all
@@ -165,42 +578,57 @@ inline static void voronoi_check_grid(struct voronoi *restrict v);
  *     around (if we did not already do so).
  *
  * During the second step, the geometrical properties (cell centroid, volume
- * and face midpoint, area) are computed as well.
+ * and face midpoint, area) are computed as well. The faces are only stored in
+ * VORONOI_MODE_FULL (see voronoi_set_mode()).
  *
- * @param v Voronoi grid.
- * @param d Delaunay tessellation (read-only).
+ * All memory of the grid (including the scratch space used during the
+ * construction) is reused; arrays are only reallocated if they are too small.
+ * This avoids allocations when the grid is rebuilt for a similar tessellation
+ * (e.g. every iteration of a Lloyd relaxation).
+ *
+ * @param v Voronoi grid (initialised with voronoi_init()).
+ * @param d Delaunay tessellation (only the circumcenter cache is modified).
  */
-inline static void voronoi_init(struct voronoi *restrict v,
-                                struct delaunay *restrict d) {
+inline static void voronoi_reset(struct voronoi *restrict v,
+                                 struct delaunay *restrict d) {
   delaunay_assert(d->vertex_end > 0);
 
   /* the number of cells equals the number of non-ghost and non-dummy
      vertex_indices in the Delaunay tessellation */
   v->number_of_cells = d->vertex_end - d->vertex_start;
-  /* allocate memory for the voronoi cells */
-  v->cells = (struct voronoi_cell *)malloc(v->number_of_cells *
-                                           sizeof(struct voronoi_cell));
-  /* Allocate memory to store voronoi vertices (will be freed at end) */
-  double *voronoi_vertices =
-      (double *)malloc(3 * (d->tetrahedron_index - 4) * sizeof(double));
+  /* make sure there is enough memory for the voronoi cells */
+  if (v->number_of_cells > v->cell_size) {
+    v->cell_size = v->number_of_cells;
+    v->cells = (struct voronoi_cell *)CVORONOI_REALLOC(
+        v->cells, v->cell_size * sizeof(struct voronoi_cell));
+  }
+  /* Make sure there is enough memory to store the voronoi vertices */
+  const int tetrahedron_start = d->tetrahedron_start;
+  if (d->tetrahedron_index - tetrahedron_start > v->voronoi_vertex_size) {
+    v->voronoi_vertex_size = d->tetrahedron_index - tetrahedron_start;
+    v->voronoi_vertices = (double *)CVORONOI_REALLOC(
+        v->voronoi_vertices, 3 * v->voronoi_vertex_size * sizeof(double));
+  }
+  double *voronoi_vertices = v->voronoi_vertices;
 
   /* loop over the tetrahedra in the Delaunay tessellation and compute the
      midpoints of their circumspheres. These happen to be the vertices of
      the Voronoi grid (because they are the points of equal distance to 3
      generators, while the Voronoi edges are the lines of equal distance to 2
      generators) */
-  for (int i = 0; i < d->tetrahedron_index - 4; i++) {
-    struct tetrahedron *t = &d->tetrahedra[i + 4];
+  for (int i = 0; i < d->tetrahedron_index - tetrahedron_start; i++) {
     /* Get the indices of the vertices of the tetrahedron */
-    int v0 = t->vertices[0];
-    int v1 = t->vertices[1];
-    int v2 = t->vertices[2];
-    int v3 = t->vertices[3];
+    const int t_idx = i + tetrahedron_start;
+    int v0 = tetrahedron_get_vertex(&d->tetrahedra, t_idx, 0);
+    int v1 = tetrahedron_get_vertex(&d->tetrahedra, t_idx, 1);
+    int v2 = tetrahedron_get_vertex(&d->tetrahedra, t_idx, 2);
+    int v3 = tetrahedron_get_vertex(&d->tetrahedra, t_idx, 3);
 
     /* if the tetrahedron is inactive or not linked to a non-ghost, non-dummy
      * vertex, it is not a grid vertex and we can skip it. */
-    if (!t->active || (v0 >= v->number_of_cells && v1 >= v->number_of_cells &&
-        v2 >= v->number_of_cells && v3 >= v->number_of_cells)) {
+    if (!tetrahedron_is_active(&d->tetrahedra, t_idx) ||
+        (v0 >= v->number_of_cells && v1 >= v->number_of_cells &&
+         v2 >= v->number_of_cells && v3 >= v->number_of_cells)) {
       voronoi_vertices[3 * i] = NAN;
       voronoi_vertices[3 * i + 1] = NAN;
       voronoi_vertices[3 * i + 2] = NAN;
@@ -209,54 +637,43 @@ inline static void voronoi_init(struct voronoi *restrict v,
     /* Check that the vertices are valid */
     voronoi_assert(v0 >= 0 && v1 >= 0 && v2 >= 0 && v3 >= 0);
 
-    /* Extract coordinates from the Delaunay vertices (generators)
-     * FUTURE NOTE: In swift we should read this from the particles themselves!
-     * */
-    double v0x, v0y, v0z, v1x, v1y, v1z, v2x, v2y, v2z, v3x, v3y, v3z;
-    if (v0 < d->vertex_end || v0 >= d->ghost_offset) {
-      v0x = d->vertices[3 * v0];
-      v0y = d->vertices[3 * v0 + 1];
-      v0z = d->vertices[3 * v0 + 2];
-    } else {
-      /* This could mean that a neighbouring cell of this grids cell is empty!
-       * Or that we did not add all the necessary ghost vertex_indices to the
-       * delaunay tesselation. */
-      voronoi_error(
-          "Vertex is part of tetrahedron with Dummy vertex! This could mean "
-          "that one of the neighbouring cells is empty.");
-    }
-    if (v1 < d->vertex_end || v1 >= d->ghost_offset) {
-      v1x = d->vertices[3 * v1];
-      v1y = d->vertices[3 * v1 + 1];
-      v1z = d->vertices[3 * v1 + 2];
-    } else {
-      voronoi_error(
-          "Vertex is part of tetrahedron with Dummy vertex! This could mean "
-          "that one of the neighbouring cells is empty.");
-    }
-    if (v2 < d->vertex_end || v2 >= d->ghost_offset) {
-      v2x = d->vertices[3 * v2];
-      v2y = d->vertices[3 * v2 + 1];
-      v2z = d->vertices[3 * v2 + 2];
-    } else {
-      voronoi_error(
-          "Vertex is part of tetrahedron with Dummy vertex! This could mean "
-          "that "
-          "one of the neighbouring cells is empty.");
-    }
-    if (v3 < d->vertex_end || v3 >= d->ghost_offset) {
-      v3x = d->vertices[3 * v3];
-      v3y = d->vertices[3 * v3 + 1];
-      v3z = d->vertices[3 * v3 + 2];
-    } else {
+    /* The vertices should be local vertices or ghosts. A dummy vertex could
+     * mean that a neighbouring cell of this grids cell is empty! Or that we
+     * did not add all the necessary ghost vertex_indices to the delaunay
+     * tesselation. */
+    if ((v0 >= d->vertex_end && v0 < d->ghost_offset) ||
+        (v1 >= d->vertex_end && v1 < d->ghost_offset) ||
+        (v2 >= d->vertex_end && v2 < d->ghost_offset) ||
+        (v3 >= d->vertex_end && v3 < d->ghost_offset)) {
       voronoi_error(
           "Vertex is part of tetrahedron with Dummy vertex! This could mean "
           "that one of the neighbouring cells is empty.");
     }
 
-    geometry3d_compute_circumcenter(v0x, v0y, v0z, v1x, v1y, v1z, v2x, v2y, v2z,
-                                    v3x, v3y, v3z, &voronoi_vertices[3 * i]);
+    /* this reuses the circumcenters computed for the search radii */
+    delaunay_get_circumcenter(d, t_idx, &voronoi_vertices[3 * i]);
 #ifdef VORONOI_CHECKS
+    /* Extract coordinates from the Delaunay vertices (generators)
+     * FUTURE NOTE: In swift we should read this from the particles themselves!
+     * */
+    double buffer[4][3];
+    const double *x0 = delaunay_get_vertex(d, v0, buffer[0]);
+    const double *x1 = delaunay_get_vertex(d, v1, buffer[1]);
+    const double *x2 = delaunay_get_vertex(d, v2, buffer[2]);
+    const double *x3 = delaunay_get_vertex(d, v3, buffer[3]);
+    const double v0x = x0[0];
+    const double v0y = x0[1];
+    const double v0z = x0[2];
+    const double v1x = x1[0];
+    const double v1y = x1[1];
+    const double v1z = x1[2];
+    const double v2x = x2[0];
+    const double v2y = x2[1];
+    const double v2z = x2[2];
+    const double v3x = x3[0];
+    const double v3y = x3[1];
+    const double v3z = x3[2];
+
     const double cx = voronoi_vertices[3 * i];
     const double cy = voronoi_vertices[3 * i + 1];
     const double cz = voronoi_vertices[3 * i + 2];
@@ -274,41 +691,43 @@ inline static void voronoi_init(struct voronoi *restrict v,
 #endif
   } /* loop over the Delaunay tetrahedra and compute the circumcenters */
 
-  /* Allocate memory for the voronoi pairs (faces). */
+  /* Remove all voronoi pairs (faces). */
   for (int i = 0; i < 2; ++i) {
-    v->pairs[i] =
-        (struct voronoi_pair *)malloc(10 * sizeof(struct voronoi_pair));
     v->pair_index[i] = 0;
-    v->pair_size[i] = 10;
   }
+  const int store_faces = v->mode == VORONOI_MODE_FULL;
+#ifdef VORONOI_STORE_CONNECTIONS
+  /* A typical cell has about 15 faces with 5 vertices, and every face is
+     shared by 2 cells */
+  if (store_faces && 40 * v->number_of_cells > v->face_vertex_size) {
+    v->face_vertex_size = 40 * v->number_of_cells;
+    v->face_vertices = (double *)CVORONOI_REALLOC(
+        v->face_vertices, 3 * v->face_vertex_size * sizeof(double));
+  }
+  v->face_vertex_index = 0;
+#endif
 
-  /* Allocate memory for the neighbour flags and initialize them to 0 */
-  int *neighbour_flags = (int *)malloc(d->vertex_index * sizeof(int));
+  /* Make sure there is enough memory for the neighbour flags and initialize
+     them to 0 */
+  if (d->vertex_index > v->neighbour_flags_size) {
+    v->neighbour_flags_size = d->vertex_index;
+    v->neighbour_flags = (int *)CVORONOI_REALLOC(
+        v->neighbour_flags, v->neighbour_flags_size * sizeof(int));
+  }
+  int *neighbour_flags = v->neighbour_flags;
   for (int i = 0; i < d->vertex_index; i++) {
     neighbour_flags[i] = 0;
   }
 
-  /* Allocate a tetrahedron_vertex_queue */
-  struct int3_fifo_queue neighbour_info_q;
-  int3_fifo_queue_init(&neighbour_info_q, 10);
-
-  /* The size of the array used to temporarily store the vertices of the voronoi
-   * faces in */
-  int face_vertices_size = 10;
-  /* Temporary array to store face vertices in */
-  double *face_vertices =
-      (double *)malloc(3 * face_vertices_size * sizeof(double));
+  struct voronoi_walk walk;
+  voronoi_walk_init(&walk, d, voronoi_vertices, neighbour_flags,
+                    &v->neighbour_info_q, v->face_vertex_buffer,
+                    v->face_vertex_buffer_size);
 
   /* loop over all cell generators, and hence over all non-ghost, non-dummy
      Delaunay vertex_indices */
   for (int gen_idx_in_d = 0; gen_idx_in_d < v->number_of_cells;
        gen_idx_in_d++) {
-    /* First reset the tetrahedron_vertex_queue */
-    int3_fifo_queue_reset(&neighbour_info_q);
-    /* Set the flag of the central generator so that we never pick it as
-     * possible neighbour */
-    neighbour_flags[gen_idx_in_d] = 1;
-
     /* Create a new voronoi cell for this generator */
     struct voronoi_cell *this_cell = &v->cells[gen_idx_in_d - d->vertex_start];
     this_cell->volume = 0.;
@@ -330,151 +749,31 @@ inline static void voronoi_init(struct voronoi *restrict v,
     this_cell->generator[2] = az;
 #endif
 
-    /* Get a tetrahedron containing the central generator */
-    int t_idx = d->vertex_tetrahedron_links[gen_idx_in_d];
-    int gen_idx_in_t = d->vertex_tetrahedron_index[gen_idx_in_d];
-
-    /* Pick another vertex (generator) from this tetrahedron and add it to the
-     * queue */
-    int other_v_idx_in_t = (gen_idx_in_t + 1) % 4;
-    struct tetrahedron *t = &d->tetrahedra[t_idx];
-    int other_v_idx_in_d = t->vertices[other_v_idx_in_t];
-    int3 info = {._0 = t_idx, ._1 = other_v_idx_in_d, ._2 = other_v_idx_in_t};
-    int3_fifo_queue_push(&neighbour_info_q, info);
-    /* update flag of the other vertex */
-    neighbour_flags[other_v_idx_in_d] = 1;
-
-    while (!int3_fifo_queue_is_empty(&neighbour_info_q)) {
-      /* with each delaunay edge corresponds a voronoi face */
+    voronoi_walk_start(&walk, gen_idx_in_d);
+    int axis_idx_in_d;
+    int face_vertices_index;
+    while ((face_vertices_index =
+                voronoi_walk_next_face(&walk, &axis_idx_in_d)) > 0) {
       nface++;
-
-      /* Pop the next axis vertex and corresponding tetrahedron from the queue
-       */
-      info = int3_fifo_queue_pop(&neighbour_info_q);
-      int first_t_idx = info._0;
-      int axis_idx_in_d = info._1;
-      int axis_idx_in_t = info._2;
-      voronoi_assert(axis_idx_in_d >= 0 && (axis_idx_in_d < d->vertex_end ||
-                                            axis_idx_in_d >= d->ghost_offset));
-      struct tetrahedron *first_t = &d->tetrahedra[first_t_idx];
-
-      /* Get a non axis vertex from first_t */
-      int non_axis_idx_in_first_t = (axis_idx_in_t + 1) % 4;
-      if (first_t->vertices[non_axis_idx_in_first_t] == gen_idx_in_d) {
-        non_axis_idx_in_first_t = (non_axis_idx_in_first_t + 1) % 4;
-      }
-      int non_axis_idx_in_d = first_t->vertices[non_axis_idx_in_first_t];
-
-      if (!neighbour_flags[non_axis_idx_in_d]) {
-        /* Add this vertex and tetrahedron to the queue and update its flag */
-        int3 new_info = {._0 = first_t_idx,
-                         ._1 = non_axis_idx_in_d,
-                         ._2 = non_axis_idx_in_first_t};
-        int3_fifo_queue_push(&neighbour_info_q, new_info);
-        neighbour_flags[non_axis_idx_in_d] |= 1;
-      }
-
-      /* Get a neighbouring tetrahedron of first_t sharing the axis */
-      int cur_t_idx = first_t->neighbours[non_axis_idx_in_first_t];
-      struct tetrahedron *cur_t = &d->tetrahedra[cur_t_idx];
-      int prev_t_idx_in_cur_t =
-          first_t->index_in_neighbour[non_axis_idx_in_first_t];
-
-      /* Get a neighbouring tetrahedron of cur_t that is not first_t, sharing
-       * the same axis */
-      int next_t_idx_in_cur_t = (prev_t_idx_in_cur_t + 1) % 4;
-      while (cur_t->vertices[next_t_idx_in_cur_t] == gen_idx_in_d ||
-             cur_t->vertices[next_t_idx_in_cur_t] == axis_idx_in_d) {
-        next_t_idx_in_cur_t = (next_t_idx_in_cur_t + 1) % 4;
-      }
-      int next_t_idx = cur_t->neighbours[next_t_idx_in_cur_t];
-
-      /* Get the next non axis vertex and add it to the queue if necessary */
-      int next_non_axis_idx_in_d = cur_t->vertices[next_t_idx_in_cur_t];
-      if (!neighbour_flags[next_non_axis_idx_in_d]) {
-        int3 new_info = {._0 = cur_t_idx,
-                         ._1 = next_non_axis_idx_in_d,
-                         ._2 = next_t_idx_in_cur_t};
-        int3_fifo_queue_push(&neighbour_info_q, new_info);
-        neighbour_flags[next_non_axis_idx_in_d] |= 1;
-      }
-
-      /* Get the coordinates of the voronoi vertex of the new face */
-      int vor_vertex0_idx = first_t_idx - 4;
-      face_vertices[0] = voronoi_vertices[3 * vor_vertex0_idx];
-      face_vertices[1] = voronoi_vertices[3 * vor_vertex0_idx + 1];
-      face_vertices[2] = voronoi_vertices[3 * vor_vertex0_idx + 2];
-      int face_vertices_index = 1;
-
-      /* Loop around the axis */
-      while (next_t_idx != first_t_idx) {
-        /* Get the coordinates of the voronoi vertex corresponding to cur_t and
-         * next_t */
-        if (face_vertices_index + 6 > face_vertices_size) {
-          face_vertices_size <<= 1;
-          face_vertices = (double *)realloc(
-              face_vertices, 3 * face_vertices_size * sizeof(double));
-        }
-        const int vor_vertex1_idx = cur_t_idx - 4;
-        face_vertices[3 * face_vertices_index] =
-            voronoi_vertices[3 * vor_vertex1_idx];
-        face_vertices[3 * face_vertices_index + 1] =
-            voronoi_vertices[3 * vor_vertex1_idx + 1];
-        face_vertices[3 * face_vertices_index + 2] =
-            voronoi_vertices[3 * vor_vertex1_idx + 2];
-        const int vor_vertex2_idx = next_t_idx - 4;
-        face_vertices[3 * face_vertices_index + 3] =
-            voronoi_vertices[3 * vor_vertex2_idx];
-        face_vertices[3 * face_vertices_index + 4] =
-            voronoi_vertices[3 * vor_vertex2_idx + 1];
-        face_vertices[3 * face_vertices_index + 5] =
-            voronoi_vertices[3 * vor_vertex2_idx + 2];
-        face_vertices_index += 2;
-
-        /* Update cell volume and tetrahedron_centroid */
-        double tetrahedron_centroid[3];
-        const double V = geometry3d_compute_centroid_volume_tetrahedron(
-            ax, ay, az, face_vertices[0], face_vertices[1], face_vertices[2],
-            face_vertices[3 * face_vertices_index - 6],
-            face_vertices[3 * face_vertices_index - 5],
-            face_vertices[3 * face_vertices_index - 4],
-            face_vertices[3 * face_vertices_index - 3],
-            face_vertices[3 * face_vertices_index - 2],
-            face_vertices[3 * face_vertices_index - 1], tetrahedron_centroid);
-        this_cell->volume += V;
-        this_cell->centroid[0] += V * tetrahedron_centroid[0];
-        this_cell->centroid[1] += V * tetrahedron_centroid[1];
-        this_cell->centroid[2] += V * tetrahedron_centroid[2];
-
-        /* Update variables */
-        prev_t_idx_in_cur_t = cur_t->index_in_neighbour[next_t_idx_in_cur_t];
-        cur_t_idx = next_t_idx;
-        cur_t = &d->tetrahedra[cur_t_idx];
-        next_t_idx_in_cur_t = (prev_t_idx_in_cur_t + 1) % 4;
-        while (cur_t->vertices[next_t_idx_in_cur_t] == gen_idx_in_d ||
-               cur_t->vertices[next_t_idx_in_cur_t] == axis_idx_in_d) {
-          next_t_idx_in_cur_t = (next_t_idx_in_cur_t + 1) % 4;
-        }
-        next_t_idx = cur_t->neighbours[next_t_idx_in_cur_t];
-        /* Get the next non axis vertex and add it to the queue if necessary */
-        next_non_axis_idx_in_d = cur_t->vertices[next_t_idx_in_cur_t];
-        if (!neighbour_flags[next_non_axis_idx_in_d]) {
-          int3 new_info = {._0 = cur_t_idx,
-                           ._1 = next_non_axis_idx_in_d,
-                           ._2 = next_t_idx_in_cur_t};
-          int3_fifo_queue_push(&neighbour_info_q, new_info);
-          neighbour_flags[next_non_axis_idx_in_d] |= 1;
-        }
-      }
+      double *face_vertices = walk.face_vertices;
+      /* Update the cell volume and centroid with the pyramid spanned by the
+       * generator and the face, and compute the area and midpoint of the face
+       * in the same pass */
+      double midpoint[3];
+      const double area = geometry3d_compute_centroid_volume_area_face(
+          ax, ay, az, face_vertices, face_vertices_index, midpoint,
+          &this_cell->volume, this_cell->centroid);
+      if (!store_faces) continue;
       if (axis_idx_in_d < d->vertex_end) {
         /* Store faces only once */
         if (gen_idx_in_d < axis_idx_in_d) {
           voronoi_new_face(v, 0, NULL, gen_idx_in_d, axis_idx_in_d,
-                           face_vertices, face_vertices_index);
+                           face_vertices, face_vertices_index, area,
+                           midpoint);
         }
       } else { /* axis_idx_in_d >= d->ghost_offset */
         voronoi_new_face(v, 1, NULL, gen_idx_in_d, axis_idx_in_d, face_vertices,
-                         face_vertices_index);
+                         face_vertices_index, area, midpoint);
       }
     }
     this_cell->centroid[0] /= this_cell->volume;
@@ -484,38 +783,315 @@ inline static void voronoi_init(struct voronoi *restrict v,
     this_cell->nface = nface;
 #endif
     /* reset flags for all neighbours of this cell */
-    neighbour_flags[gen_idx_in_d] = 0;
-    for (int i = 0; i < neighbour_info_q.end; i++) {
-      voronoi_assert(neighbour_info_q.values[i]._1 < d->vertex_index)
-          neighbour_flags[neighbour_info_q.values[i]._1] = 0;
-    }
-#ifdef VORONOI_CHECKS
-    for (int i = 0; i < d->vertex_index; i++) {
-      voronoi_assert(neighbour_flags[i] == 0);
+    voronoi_walk_finish(&walk);
+  }
+  /* keep the (possibly reallocated) face vertex buffer */
+  v->face_vertex_buffer = walk.face_vertices;
+  v->face_vertex_buffer_size = walk.face_vertices_size;
+#ifdef VORONOI_STORE_FACE_TABLE
+  if (store_faces && d->periodic_shift_count > 0) {
+    /* the positions of the periodic ghosts are not stored */
+    const int ghost_count = d->vertex_index - d->ghost_offset;
+    double *ghosts =
+        (double *)CVORONOI_MALLOC(3 * ghost_count * sizeof(double));
+    for (int g = 0; g < ghost_count; g++) {
+      const double *x =
+          delaunay_get_vertex(d, d->ghost_offset + g, &ghosts[3 * g]);
+      ghosts[3 * g] = x[0];
+      ghosts[3 * g + 1] = x[1];
+      ghosts[3 * g + 2] = x[2];
     }
-#endif
+    voronoi_update_face_table(v, d->vertices, ghosts, d->ghost_offset, 3);
+    CVORONOI_FREE(ghosts);
+  } else {
+    /* the Delaunay vertices contain both the generators and the ghosts (in
+       VORONOI_MODE_VOLUMES, this only empties the table) */
+    voronoi_update_face_table(v, d->vertices, d->vertices, 0, 3);
   }
-  free(voronoi_vertices);
-  free(neighbour_flags);
-  int3_fifo_queue_destroy(&neighbour_info_q);
-  free(face_vertices);
+#endif
   voronoi_check_grid(v);
 }
 
+/**
+ * @brief Faces and geometry of a single Voronoi cell, computed directly from
+ * the Delaunay tessellation (see voronoi_cell_faces()).
+ *
+ * The arrays are reused (and only grown) by subsequent queries, so that many
+ * cells can be queried without reallocating memory.
+ */
+struct voronoi_cell_query {
+  /*! @brief Volume of the cell. */
+  double volume;
+
+  /*! @brief Centroid of the cell. */
+  double centroid[3];
+
+  /*! @brief Number of faces of the cell. */
+  int nface;
+
+  /*! @brief Allocated number of faces. */
+  int face_size;
+
+  /*! @brief Delaunay vertex on the other side of every face (a generator or a
+   *  ghost, see voronoi_pair::right). */
+  int *neighbours;
+
+  /*! @brief Area of every face. */
+  double *areas;
+
+  /*! @brief Midpoint of every face (3 per face). */
+  double *midpoints;
+
+  /*! @brief Offset of the vertices of every face in vertices (nface + 1
+   *  values). */
+  int *vertex_offsets;
+
+  /*! @brief Vertices of all faces (3 per vertex). */
+  double *vertices;
+
+  /*! @brief Allocated number of vertices. */
+  int vertex_size;
+
+  /*! @brief Queue of Delaunay edges, scratch space for the walk. */
+  struct int3_fifo_queue queue;
+
+  /*! @brief Vertices of the current face, scratch space for the walk. */
+  double *face_vertex_buffer;
+
+  /*! @brief Allocated number of vertices in face_vertex_buffer. */
+  int face_vertex_buffer_size;
+};
+
+/**
+ * @brief Initialise an empty cell query.
+ *
+ * @param q Cell query.
+ */
+inline static void voronoi_cell_query_init(struct voronoi_cell_query *q) {
+  q->volume = 0.;
+  q->centroid[0] = 0.;
+  q->centroid[1] = 0.;
+  q->centroid[2] = 0.;
+  q->nface = 0;
+  q->face_size = 16;
+  q->neighbours = (int *)CVORONOI_MALLOC(q->face_size * sizeof(int));
+  q->areas = (double *)CVORONOI_MALLOC(q->face_size * sizeof(double));
+  q->midpoints = (double *)CVORONOI_MALLOC(3 * q->face_size * sizeof(double));
+  q->vertex_offsets =
+      (int *)CVORONOI_MALLOC((q->face_size + 1) * sizeof(int));
+  q->vertex_offsets[0] = 0;
+  q->vertex_size = 96;
+  q->vertices = (double *)CVORONOI_MALLOC(3 * q->vertex_size * sizeof(double));
+  int3_fifo_queue_init(&q->queue, 10);
+  q->face_vertex_buffer_size = 10;
+  q->face_vertex_buffer = (double *)CVORONOI_MALLOC(
+      3 * q->face_vertex_buffer_size * sizeof(double));
+}
+
+/**
+ * @brief Free up all memory used by a cell query.
+ *
+ * @param q Cell query.
+ */
+inline static void voronoi_cell_query_destroy(struct voronoi_cell_query *q) {
+  CVORONOI_FREE(q->neighbours);
+  CVORONOI_FREE(q->areas);
+  CVORONOI_FREE(q->midpoints);
+  CVORONOI_FREE(q->vertex_offsets);
+  CVORONOI_FREE(q->vertices);
+  int3_fifo_queue_destroy(&q->queue);
+  CVORONOI_FREE(q->face_vertex_buffer);
+}
+
+/**
+ * @brief Walk around the given generator and compute the geometry of its
+ * cell, optionally storing its faces in the query.
+ */
+inline static void voronoi_cell_query_run(struct delaunay *restrict d, int i,
+                                          struct voronoi_cell_query *q,
+                                          int store_faces) {
+  if (i < d->vertex_start || i >= d->vertex_end) {
+    fprintf(stderr, "Vertex %i is not a local vertex of the tessellation!\n",
+            i);
+    abort();
+  }
+
+  /* the walk searches the queue for visited neighbours rather than using a
+     flag per Delaunay vertex, so that a query does not touch memory
+     proportional to the size of the tessellation */
+  struct voronoi_walk walk;
+  voronoi_walk_init(&walk, d, NULL, NULL, &q->queue, q->face_vertex_buffer,
+                    q->face_vertex_buffer_size);
+
+  const double ax = d->vertices[3 * i];
+  const double ay = d->vertices[3 * i + 1];
+  const double az = d->vertices[3 * i + 2];
+  q->volume = 0.;
+  q->centroid[0] = 0.;
+  q->centroid[1] = 0.;
+  q->centroid[2] = 0.;
+  q->nface = 0;
+
+  voronoi_walk_start(&walk, i);
+  int axis;
+  int nvertex;
+  while ((nvertex = voronoi_walk_next_face(&walk, &axis)) > 0) {
+    double midpoint[3];
+    const double area = geometry3d_compute_centroid_volume_area_face(
+        ax, ay, az, walk.face_vertices, nvertex, midpoint, &q->volume,
+        q->centroid);
+    if (store_faces) {
+      if (q->nface == q->face_size) {
+        q->face_size <<= 1;
+        q->neighbours = (int *)CVORONOI_REALLOC(
+            q->neighbours, q->face_size * sizeof(int));
+        q->areas = (double *)CVORONOI_REALLOC(q->areas,
+                                              q->face_size * sizeof(double));
+        q->midpoints = (double *)CVORONOI_REALLOC(
+            q->midpoints, 3 * q->face_size * sizeof(double));
+        q->vertex_offsets = (int *)CVORONOI_REALLOC(
+            q->vertex_offsets, (q->face_size + 1) * sizeof(int));
+      }
+      const int offset = q->vertex_offsets[q->nface];
+      while (offset + nvertex > q->vertex_size) {
+        q->vertex_size <<= 1;
+        q->vertices = (double *)CVORONOI_REALLOC(
+            q->vertices, 3 * q->vertex_size * sizeof(double));
+      }
+      memcpy(&q->vertices[3 * offset], walk.face_vertices,
+             3 * nvertex * sizeof(double));
+      q->neighbours[q->nface] = axis;
+      q->areas[q->nface] = area;
+      q->midpoints[3 * q->nface] = midpoint[0];
+      q->midpoints[3 * q->nface + 1] = midpoint[1];
+      q->midpoints[3 * q->nface + 2] = midpoint[2];
+      q->vertex_offsets[q->nface + 1] = offset + nvertex;
+    }
+    q->nface++;
+  }
+  voronoi_walk_finish(&walk);
+  q->face_vertex_buffer = walk.face_vertices;
+  q->face_vertex_buffer_size = walk.face_vertices_size;
+
+  q->centroid[0] /= q->volume;
+  q->centroid[1] /= q->volume;
+  q->centroid[2] /= q->volume;
+}
+
+/**
+ * @brief Compute the faces of the Voronoi cell of a single generator, without
+ * constructing the Voronoi grid.
+ *
+ * This walks the same Delaunay edges in the same order as voronoi_reset(), so
+ * that the volume, centroid and faces are identical to those of the grid
+ * (faces between two generators are stored for both of them). Only the
+ * circumcenters of the tetrahedra around the generator are computed (or taken
+ * from the cache, see delaunay_get_circumcenter()). This is much cheaper than
+ * constructing the full grid if only a few cells are needed.
+ *
+ * @param d Delaunay tessellation (complete, i.e. with ghosts; only its
+ * circumcenter cache is modified).
+ * @param i Index of the generator in the tessellation (a local vertex).
+ * @param q Cell query (initialised with voronoi_cell_query_init()), which
+ * receives the faces and geometry of the cell.
+ * @return Number of faces of the cell.
+ */
+inline static int voronoi_cell_faces(struct delaunay *restrict d, int i,
+                                     struct voronoi_cell_query *q) {
+  voronoi_cell_query_run(d, i, q, 1);
+  return q->nface;
+}
+
+/**
+ * @brief Compute the volume of the Voronoi cell of a single generator, without
+ * constructing the Voronoi grid.
+ *
+ * Same as voronoi_cell_faces(), but the faces are not stored. Queries of many
+ * cells should use voronoi_cell_faces() with a single query, since this
+ * function allocates its scratch space for every call.
+ *
+ * @param d Delaunay tessellation (complete, i.e. with ghosts).
+ * @param i Index of the generator in the tessellation (a local vertex).
+ * @param centroid (Optional, returned) Centroid of the cell (can be NULL).
+ * @return Volume of the cell.
+ */
+inline static double voronoi_cell_volume(struct delaunay *restrict d, int i,
+                                         double *centroid) {
+  struct voronoi_cell_query q;
+  voronoi_cell_query_init(&q);
+  voronoi_cell_query_run(d, i, &q, 0);
+  if (centroid != NULL) {
+    centroid[0] = q.centroid[0];
+    centroid[1] = q.centroid[1];
+    centroid[2] = q.centroid[2];
+  }
+  const double volume = q.volume;
+  voronoi_cell_query_destroy(&q);
+  return volume;
+}
+
 /**
  * @brief Free up all memory used by the Voronoi grid.
  *
  * @param v Voronoi grid.
  */
 inline static void voronoi_destroy(struct voronoi *restrict v) {
-  free(v->cells);
+  CVORONOI_FREE(v->cells);
   for (int i = 0; i < 2; ++i) {
-    for (int j = 0; j < v->pair_index[i]; j++) {
-      voronoi_pair_destroy(&v->pairs[i][j]);
-    }
-    free(v->pairs[i]);
+    CVORONOI_FREE(v->pairs[i]);
   }
+#ifdef VORONOI_STORE_CONNECTIONS
+  CVORONOI_FREE(v->face_vertices);
+#endif
+#ifdef VORONOI_STORE_FACE_TABLE
+  voronoi_face_table_destroy(&v->faces);
+#endif
+  CVORONOI_FREE(v->voronoi_vertices);
+  CVORONOI_FREE(v->neighbour_flags);
+  int3_fifo_queue_destroy(&v->neighbour_info_q);
+  CVORONOI_FREE(v->face_vertex_buffer);
+}
+
+/**
+ * @brief Get the memory used by the Voronoi grid.
+ *
+ * Since the arrays of a grid never shrink (also not when it is reset), this is
+ * also the high-water mark of its memory use.
+ *
+ * @param v Voronoi grid.
+ * @return Size in bytes.
+ */
+inline static size_t voronoi_get_memory_size(const struct voronoi *v) {
+  size_t size = (size_t)v->cell_size * sizeof(struct voronoi_cell) +
+                (size_t)(v->pair_size[0] + v->pair_size[1]) *
+                    sizeof(struct voronoi_pair);
+#ifdef VORONOI_STORE_CONNECTIONS
+  size += (size_t)v->face_vertex_size * 3 * sizeof(double);
+#endif
+#ifdef VORONOI_STORE_FACE_TABLE
+  size += voronoi_face_table_get_memory_size(&v->faces);
+#endif
+  size += (size_t)v->voronoi_vertex_size * 3 * sizeof(double) +
+          (size_t)v->neighbour_flags_size * sizeof(int) +
+          (size_t)v->neighbour_info_q.size * sizeof(int3) +
+          (size_t)v->face_vertex_buffer_size * 3 * sizeof(double);
+  return size;
+}
+
+#ifdef VORONOI_STORE_CONNECTIONS
+/**
+ * @brief Get the vertices of the given face.
+ *
+ * @param v Voronoi grid.
+ * @param pair Face of the grid.
+ * @return Pointer to the 3 * pair->n_vertices coordinates of the vertices of
+ * the face. Only valid until the next face is added.
+ */
+inline static const double *voronoi_get_face_vertices(
+    const struct voronoi *restrict v, const struct voronoi_pair *pair) {
+  return &v->face_vertices[3 * pair->vertex_offset];
 }
+#endif
 
 /**
  * @brief Add a face (two particle pair) to the mesh.
@@ -539,29 +1115,120 @@ inline static void voronoi_destroy(struct voronoi *restrict v) {
  * cell linked to this grid). FUTURE NOTE: For SWIFT, replace this with direct
  * pointer to the left particle.
  * @param right_part_pointer Index of right particle in cell (particle in the
- * cell linked to this grid), or -1 for ghost vertices. FUTURE NOTE: For SWIFT,
- * replace this with direct pointer to the right particle.
+ * cell linked to this grid), or index of the ghost vertex in the Delaunay
+ * tessellation (sid=1). FUTURE NOTE: For SWIFT, replace this with direct
+ * pointer to the right particle.
  * @param vertices Vertices of the interface.
  * @param n_vertices Number of vertices in the vertices array.
+ * @param surface_area Area of the interface.
+ * @param midpoint Midpoint of the interface.
  */
 inline static int voronoi_new_face(struct voronoi *v, int sid,
                                    struct cell *restrict c,
                                    int left_part_pointer,
                                    int right_part_pointer, double *vertices,
-                                   int n_vertices) {
+                                   int n_vertices, double surface_area,
+                                   const double *midpoint) {
   if (v->pair_index[sid] == v->pair_size[sid]) {
     v->pair_size[sid] <<= 1;
-    v->pairs[sid] = (struct voronoi_pair *)realloc(
+    v->pairs[sid] = (struct voronoi_pair *)CVORONOI_REALLOC(
         v->pairs[sid], v->pair_size[sid] * sizeof(struct voronoi_pair));
   }
   /* Initialize pair */
   struct voronoi_pair *this_pair = &v->pairs[sid][v->pair_index[sid]];
   voronoi_pair_init(this_pair, c, left_part_pointer, right_part_pointer,
-                    vertices, n_vertices);
+                    surface_area, midpoint);
+#ifdef VORONOI_STORE_CONNECTIONS
+  /* Append the vertices of the face to the face vertex array */
+  if (v->face_vertex_index + n_vertices > v->face_vertex_size) {
+    while (v->face_vertex_index + n_vertices > v->face_vertex_size) {
+      v->face_vertex_size <<= 1;
+    }
+    v->face_vertices = (double *)CVORONOI_REALLOC(
+        v->face_vertices, 3 * v->face_vertex_size * sizeof(double));
+  }
+  this_pair->vertex_offset = v->face_vertex_index;
+  this_pair->n_vertices = n_vertices;
+  double *face_vertices = &v->face_vertices[3 * v->face_vertex_index];
+  for (int i = 0; i < 3 * n_vertices; i++) {
+    face_vertices[i] = vertices[i];
+  }
+  v->face_vertex_index += n_vertices;
+#endif
   /* return and then increase */
   return v->pair_index[sid]++;
 }
 
+/**
+ * @brief Add a copy of a face of another grid to the grid, with new indices
+ * for the generators on both sides.
+ *
+ * This is used to stitch the grids of multiple cells into a single grid (see
+ * space_construct_cell_parallel()).
+ *
+ * @param v Voronoi grid.
+ * @param sid 0 for pairs entirely in this cell, 1 for pairs between this cell
+ * and a neighbouring cell (see voronoi_new_face()).
+ * @param src Voronoi grid containing the face.
+ * @param pair Face to copy.
+ * @param left_part_pointer New index of the left particle.
+ * @param right_part_pointer New index of the right particle.
+ */
+inline static void voronoi_copy_pair(struct voronoi *v, int sid,
+                                     const struct voronoi *src,
+                                     const struct voronoi_pair *pair,
+                                     int left_part_pointer,
+                                     int right_part_pointer) {
+#ifdef VORONOI_STORE_CONNECTIONS
+  double *vertices = &src->face_vertices[3 * pair->vertex_offset];
+  const int n_vertices = pair->n_vertices;
+#else
+  double *vertices = NULL;
+  const int n_vertices = 0;
+#endif
+  voronoi_new_face(v, sid, pair->right_cell, left_part_pointer,
+                   right_part_pointer, vertices, n_vertices,
+                   pair->surface_area, pair->midpoint);
+}
+
+#ifdef VORONOI_STORE_FACE_TABLE
+/**
+ * @brief (Re)build the face table of the grid from its pairs (see
+ * voronoi_face_table.h).
+ *
+ * @param v Voronoi grid.
+ * @param generators Positions of the local generators, indexed by the left
+ * index (and for pairs[0] also the right index) of the pairs.
+ * @param ghosts Positions of the ghost generators, indexed by the right index
+ * of pairs[1] minus ghost_offset.
+ * @param ghost_offset Offset of the ghost indices.
+ * @param stride Number of values per position in generators and ghosts (at
+ * least 3).
+ */
+inline static void voronoi_update_face_table(struct voronoi *restrict v,
+                                             const double *generators,
+                                             const double *ghosts,
+                                             int ghost_offset, int stride) {
+  struct voronoi_face_table *t = &v->faces;
+  voronoi_face_table_reset(t, v->pair_index[0] + v->pair_index[1],
+                           v->pair_index[0]);
+  int f = 0;
+  for (int sid = 0; sid < 2; sid++) {
+    for (int i = 0; i < v->pair_index[sid]; i++, f++) {
+      const struct voronoi_pair *pair = &v->pairs[sid][i];
+      const double *right_generator =
+          sid == 0 ? &generators[stride * pair->right]
+                   : &ghosts[stride * (pair->right - ghost_offset)];
+      voronoi_face_table_set_face(t, f, pair->left, pair->right,
+                                  pair->surface_area, pair->midpoint,
+                                  &generators[stride * pair->left],
+                                  right_generator);
+    }
+  }
+  voronoi_face_table_build_index(t, v->number_of_cells);
+}
+#endif
+
 /**
  * @brief Sanity checks on the grid.
  *
@@ -617,9 +1284,10 @@ inline static void voronoi_print_grid(const struct voronoi *v,
       fprintf(file, "F\t%i\t%g\t%g\t%g\t%g", ngb, pair->surface_area,
               pair->midpoint[0], pair->midpoint[1], pair->midpoint[2]);
 #ifdef VORONOI_STORE_CONNECTIONS
+      const double *vertices = voronoi_get_face_vertices(v, pair);
       for (int j = 0; j < pair->n_vertices; j++) {
-        fprintf(file, "\t(%g, %g, %g)", pair->vertices[3 * j],
-                pair->vertices[3 * j + 1], pair->vertices[3 * j + 2]);
+        fprintf(file, "\t(%g, %g, %g)", vertices[3 * j], vertices[3 * j + 1],
+                vertices[3 * j + 2]);
       }
 #endif
       fprintf(file, "\n");
@@ -629,6 +1297,127 @@ inline static void voronoi_print_grid(const struct voronoi *v,
   fclose(file);
 }
 
+/**
+ * @brief Write the Voronoi grid to a binary file with the given name.
+ *
+ * The file starts with a header (see binary_output_write_header()) with file
+ * type BINARY_OUTPUT_TYPE_VORONOI, with as counts the number of cells, the
+ * number of faces and the total number of face vertices. The header is
+ * followed by these arrays (every array is padded to a multiple of 8 bytes):
+ *  - generators: double[ncell][3] (only if VORONOI_STORE_GENERATORS is set),
+ *  - centroids: double[ncell][3],
+ *  - volumes: double[ncell],
+ *  - nface: int32[ncell] (only if VORONOI_STORE_CELL_STATS is set),
+ *  - left, right and sid: int32[nface] each,
+ *  - areas: double[nface],
+ *  - midpoints: double[nface][3],
+ *  - face vertex offsets: int64[nface + 1] and face vertices:
+ *    double[nface_vertex][3] (only if VORONOI_STORE_CONNECTIONS is set). The
+ *    vertices of face i are at indices [offsets[i], offsets[i + 1][.
+ * The faces are ordered by sid, in the same order as in voronoi_print_grid().
+ * Which of the optional arrays are present is indicated by the flags in the
+ * header.
+ *
+ * @param v Voronoi grid.
+ * @param file_name Name of the output file.
+ */
+inline static void voronoi_print_grid_binary(const struct voronoi *v,
+                                             const char *file_name) {
+  uint32_t flags = 0;
+#ifdef VORONOI_STORE_GENERATORS
+  flags |= BINARY_OUTPUT_FLAG_GENERATORS;
+#endif
+#ifdef VORONOI_STORE_CELL_STATS
+  flags |= BINARY_OUTPUT_FLAG_CELL_STATS;
+#endif
+  const int nface = v->pair_index[0] + v->pair_index[1];
+  int64_t nface_vertex = 0;
+#ifdef VORONOI_STORE_CONNECTIONS
+  flags |= BINARY_OUTPUT_FLAG_CONNECTIONS;
+  for (int ngb = 0; ngb < 2; ++ngb) {
+    for (int i = 0; i < v->pair_index[ngb]; ++i) {
+      nface_vertex += v->pairs[ngb][i].n_vertices;
+    }
+  }
+#endif
+  const int64_t counts[BINARY_OUTPUT_NCOUNT] = {v->number_of_cells, nface,
+                                                nface_vertex, 0};
+
+  struct binary_output o;
+  binary_output_open(&o, file_name);
+  binary_output_write_header(&o, BINARY_OUTPUT_TYPE_VORONOI, 3, flags, counts);
+
+  /* cell arrays */
+#ifdef VORONOI_STORE_GENERATORS
+  for (int i = 0; i < v->number_of_cells; ++i) {
+    binary_output_write_doubles(&o, v->cells[i].generator, 3);
+  }
+#endif
+  for (int i = 0; i < v->number_of_cells; ++i) {
+    binary_output_write_doubles(&o, v->cells[i].centroid, 3);
+  }
+  for (int i = 0; i < v->number_of_cells; ++i) {
+    binary_output_write_double(&o, v->cells[i].volume);
+  }
+#ifdef VORONOI_STORE_CELL_STATS
+  for (int i = 0; i < v->number_of_cells; ++i) {
+    binary_output_write_int32(&o, v->cells[i].nface);
+  }
+  binary_output_align(&o);
+#endif
+
+  /* face arrays */
+  for (int ngb = 0; ngb < 2; ++ngb) {
+    for (int i = 0; i < v->pair_index[ngb]; ++i) {
+      binary_output_write_int32(&o, v->pairs[ngb][i].left);
+    }
+  }
+  binary_output_align(&o);
+  for (int ngb = 0; ngb < 2; ++ngb) {
+    for (int i = 0; i < v->pair_index[ngb]; ++i) {
+      binary_output_write_int32(&o, v->pairs[ngb][i].right);
+    }
+  }
+  binary_output_align(&o);
+  for (int ngb = 0; ngb < 2; ++ngb) {
+    for (int i = 0; i < v->pair_index[ngb]; ++i) {
+      binary_output_write_int32(&o, ngb);
+    }
+  }
+  binary_output_align(&o);
+  for (int ngb = 0; ngb < 2; ++ngb) {
+    for (int i = 0; i < v->pair_index[ngb]; ++i) {
+      binary_output_write_double(&o, v->pairs[ngb][i].surface_area);
+    }
+  }
+  for (int ngb = 0; ngb < 2; ++ngb) {
+    for (int i = 0; i < v->pair_index[ngb]; ++i) {
+      binary_output_write_doubles(&o, v->pairs[ngb][i].midpoint, 3);
+    }
+  }
+
+#ifdef VORONOI_STORE_CONNECTIONS
+  /* face vertices, in compressed sparse row format */
+  int64_t offset = 0;
+  binary_output_write_int64(&o, offset);
+  for (int ngb = 0; ngb < 2; ++ngb) {
+    for (int i = 0; i < v->pair_index[ngb]; ++i) {
+      offset += v->pairs[ngb][i].n_vertices;
+      binary_output_write_int64(&o, offset);
+    }
+  }
+  for (int ngb = 0; ngb < 2; ++ngb) {
+    for (int i = 0; i < v->pair_index[ngb]; ++i) {
+      const struct voronoi_pair *pair = &v->pairs[ngb][i];
+      binary_output_write_doubles(&o, voronoi_get_face_vertices(v, pair),
+                                  3 * pair->n_vertices);
+    }
+  }
+#endif
+
+  binary_output_close(&o);
+}
+
 /**
  * @brief Check whether two doubles are equal up to the given precision.
  *
@@ -0,0 +1,265 @@
+/**
+ * @file voronoi_face_table.h
+ *
+ * @brief Compact, dimension independent table of the faces of a Voronoi grid,
+ * with an index of the faces of every cell.
+ *
+ * The faces (pairs) of a grid are constructed per generator and stored in two
+ * unsorted arrays of structs (see voronoi2d.h and voronoi3d.h), so that finding
+ * all faces of a given cell requires a scan over all faces. The face table
+ * stores the same faces as separate arrays per quantity (in the order of the
+ * pairs: first the faces between two local cells, then the faces with a
+ * ghost), together with the unit normal of every face and a compressed sparse
+ * row index of the faces of every cell. A flux loop over the faces of a cell
+ * hence only touches contiguous memory.
+ *
+ * Positions are stored with 3 coordinates, also in 2D (the third coordinate is
+ * 0). By default, all quantities are stored in double precision. If
+ * VORONOI_FACE_TABLE_SINGLE_PRECISION is defined, the areas, midpoints and
+ * normals are stored in single precision instead, which halves the size of
+ * the table.
+ */
+
+#ifndef CVORONOI_VORONOI_FACE_TABLE_H
+#define CVORONOI_VORONOI_FACE_TABLE_H
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "allocator.h"
+
+/*! @brief Floating point type of the areas, midpoints and normals. */
+#ifdef VORONOI_FACE_TABLE_SINGLE_PRECISION
+typedef float voronoi_face_real;
+#else
+typedef double voronoi_face_real;
+#endif
+
+/**
+ * @brief Faces of a Voronoi grid, and index of the faces of every cell.
+ */
+struct voronoi_face_table {
+  /*! @brief Number of faces. */
+  int count;
+
+  /*! @brief Number of faces between two local cells. These are the first faces
+   *  in the table, the remaining faces connect a local cell (left) with a
+   *  ghost (right). */
+  int local_count;
+
+  /*! @brief Allocated number of faces. */
+  int size;
+
+  /*! @brief Index of the cell on the left of every face. */
+  int *left;
+
+  /*! @brief Index of the cell (or ghost) on the right of every face. */
+  int *right;
+
+  /*! @brief Area of every face. */
+  voronoi_face_real *area;
+
+  /*! @brief Midpoint of every face (3 per face). */
+  voronoi_face_real *midpoint;
+
+  /*! @brief Unit normal of every face, pointing from the left to the right
+   *  generator (3 per face). */
+  voronoi_face_real *normal;
+
+  /*! @brief Number of cells in the index. */
+  int number_of_cells;
+
+  /*! @brief Offsets of the faces of every cell in cell_faces (size
+   *  number_of_cells + 1). */
+  int *cell_offsets;
+
+  /*! @brief Allocated number of cell offsets. */
+  int cell_offset_size;
+
+  /*! @brief Faces of every cell, in increasing order. Faces between two local
+   *  cells are part of both cells. */
+  int *cell_faces;
+
+  /*! @brief Allocated number of cell faces. */
+  int cell_face_size;
+};
+
+/**
+ * @brief Initialise an empty face table.
+ *
+ * The arrays are allocated by voronoi_face_table_reset() and
+ * voronoi_face_table_build_index().
+ *
+ * @param t Face table.
+ */
+inline static void voronoi_face_table_init(struct voronoi_face_table *t) {
+  t->count = 0;
+  t->local_count = 0;
+  t->size = 0;
+  t->left = NULL;
+  t->right = NULL;
+  t->area = NULL;
+  t->midpoint = NULL;
+  t->normal = NULL;
+  t->number_of_cells = 0;
+  t->cell_offsets = NULL;
+  t->cell_offset_size = 0;
+  t->cell_faces = NULL;
+  t->cell_face_size = 0;
+}
+
+/**
+ * @brief Free up all memory used by the face table.
+ *
+ * @param t Face table.
+ */
+inline static void voronoi_face_table_destroy(struct voronoi_face_table *t) {
+  CVORONOI_FREE(t->left);
+  CVORONOI_FREE(t->right);
+  CVORONOI_FREE(t->area);
+  CVORONOI_FREE(t->midpoint);
+  CVORONOI_FREE(t->normal);
+  CVORONOI_FREE(t->cell_offsets);
+  CVORONOI_FREE(t->cell_faces);
+}
+
+/**
+ * @brief Get the memory used by the face table.
+ *
+ * @param t Face table.
+ * @return Size in bytes.
+ */
+inline static size_t voronoi_face_table_get_memory_size(
+    const struct voronoi_face_table *t) {
+  return (size_t)t->size * (2 * sizeof(int) + 7 * sizeof(voronoi_face_real)) +
+         (size_t)(t->cell_offset_size + t->cell_face_size) * sizeof(int);
+}
+
+/**
+ * @brief Set the number of faces of the table.
+ *
+ * The arrays are only reallocated if they are too small. The faces themselves
+ * are set with voronoi_face_table_set_face().
+ *
+ * @param t Face table.
+ * @param count Number of faces.
+ * @param local_count Number of faces between two local cells.
+ */
+inline static void voronoi_face_table_reset(struct voronoi_face_table *t,
+                                            int count, int local_count) {
+  t->count = count;
+  t->local_count = local_count;
+  if (count > t->size) {
+    t->size = count;
+    t->left = (int *)CVORONOI_REALLOC(t->left, t->size * sizeof(int));
+    t->right = (int *)CVORONOI_REALLOC(t->right, t->size * sizeof(int));
+    t->area = (voronoi_face_real *)CVORONOI_REALLOC(
+        t->area, t->size * sizeof(voronoi_face_real));
+    t->midpoint = (voronoi_face_real *)CVORONOI_REALLOC(
+        t->midpoint, 3 * t->size * sizeof(voronoi_face_real));
+    t->normal = (voronoi_face_real *)CVORONOI_REALLOC(
+        t->normal, 3 * t->size * sizeof(voronoi_face_real));
+  }
+}
+
+/**
+ * @brief Set the properties of a face.
+ *
+ * @param t Face table.
+ * @param f Index of the face.
+ * @param left Index of the cell on the left of the face.
+ * @param right Index of the cell (or ghost) on the right of the face.
+ * @param area Area of the face.
+ * @param midpoint Midpoint of the face (3 coordinates).
+ * @param left_generator, right_generator Positions of the generators on both
+ * sides of the face (3 coordinates, the normal is the normalised difference).
+ */
+inline static void voronoi_face_table_set_face(
+    struct voronoi_face_table *t, int f, int left, int right, double area,
+    const double *midpoint, const double *left_generator,
+    const double *right_generator) {
+  t->left[f] = left;
+  t->right[f] = right;
+  t->area[f] = (voronoi_face_real)area;
+  double normal[3];
+  double norm2 = 0.;
+  for (int i = 0; i < 3; i++) {
+    normal[i] = right_generator[i] - left_generator[i];
+    norm2 += normal[i] * normal[i];
+  }
+  const double inv_norm = 1. / sqrt(norm2);
+  for (int i = 0; i < 3; i++) {
+    t->midpoint[3 * f + i] = (voronoi_face_real)midpoint[i];
+    t->normal[3 * f + i] = (voronoi_face_real)(normal[i] * inv_norm);
+  }
+}
+
+/**
+ * @brief Build the index of the faces of every cell.
+ *
+ * This is a counting sort of the faces on their left (and for local faces
+ * also their right) cell, so that the faces of every cell are in increasing
+ * order.
+ *
+ * @param t Face table (with all faces set).
+ * @param number_of_cells Number of local cells.
+ */
+inline static void voronoi_face_table_build_index(struct voronoi_face_table *t,
+                                                  int number_of_cells) {
+  t->number_of_cells = number_of_cells;
+  if (number_of_cells + 1 > t->cell_offset_size) {
+    t->cell_offset_size = number_of_cells + 1;
+    t->cell_offsets =
+        (int *)CVORONOI_REALLOC(t->cell_offsets,
+                                t->cell_offset_size * sizeof(int));
+  }
+  const int cell_face_count = t->count + t->local_count;
+  if (cell_face_count > t->cell_face_size) {
+    t->cell_face_size = cell_face_count;
+    t->cell_faces =
+        (int *)CVORONOI_REALLOC(t->cell_faces, t->cell_face_size * sizeof(int));
+  }
+
+  /* count the faces of every cell (shifted by one) */
+  int *offsets = t->cell_offsets;
+  for (int i = 0; i <= number_of_cells; i++) {
+    offsets[i] = 0;
+  }
+  for (int f = 0; f < t->count; f++) {
+    ++offsets[t->left[f] + 1];
+    if (f < t->local_count) {
+      ++offsets[t->right[f] + 1];
+    }
+  }
+  for (int i = 0; i < number_of_cells; i++) {
+    offsets[i + 1] += offsets[i];
+  }
+  /* distribute the faces, using the offsets as insertion points; this shifts
+     every offset to the offset of the next cell */
+  for (int f = 0; f < t->count; f++) {
+    t->cell_faces[offsets[t->left[f]]++] = f;
+    if (f < t->local_count) {
+      t->cell_faces[offsets[t->right[f]]++] = f;
+    }
+  }
+  for (int i = number_of_cells; i > 0; i--) {
+    offsets[i] = offsets[i - 1];
+  }
+  offsets[0] = 0;
+}
+
+/**
+ * @brief Get the faces of the given cell.
+ *
+ * @param t Face table.
+ * @param cell Index of the cell.
+ * @param count (Returned) Number of faces of the cell.
+ * @return Indices of the faces of the cell in the table.
+ */
+inline static const int *voronoi_face_table_get_cell_faces(
+    const struct voronoi_face_table *t, int cell, int *count) {
+  *count = t->cell_offsets[cell + 1] - t->cell_offsets[cell];
+  return &t->cell_faces[t->cell_offsets[cell]];
+}
+
+#endif  // CVORONOI_VORONOI_FACE_TABLE_H
@@ -0,0 +1,163 @@
+/**
+ * @file test_binary_io.c
+ *
+ * @brief Tests for the binary output format and the memory mapped reader
+ * (binary_output.h and binary_input.h).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "binary_input.h"
+#include "cell.h"
+
+/**
+ * @brief Check that a Voronoi grid and Delaunay tessellation are read back
+ * exactly as they were written.
+ */
+inline static void test_snapshots(const struct cell *c) {
+  cell_print_tesselations(c, "test_binary_io_vor.bin",
+                          "test_binary_io_del.bin");
+
+  const struct voronoi *v = &c->v;
+  struct voronoi_snapshot vs;
+  voronoi_snapshot_open(&vs, "test_binary_io_vor.bin");
+  if (vs.dimension != 3 || vs.ncell != v->number_of_cells ||
+      vs.nface != v->pair_index[0] + v->pair_index[1] ||
+      vs.generators == NULL || vs.cell_nface == NULL ||
+      vs.face_vertex_offsets == NULL) {
+    abort();
+  }
+  for (int i = 0; i < v->number_of_cells; i++) {
+    for (int j = 0; j < 3; j++) {
+      if (vs.generators[3 * i + j] != v->cells[i].generator[j] ||
+          vs.centroids[3 * i + j] != v->cells[i].centroid[j]) {
+        abort();
+      }
+    }
+    if (vs.volumes[i] != v->cells[i].volume ||
+        vs.cell_nface[i] != v->cells[i].nface) {
+      abort();
+    }
+  }
+  int f = 0;
+  for (int ngb = 0; ngb < 2; ngb++) {
+    for (int i = 0; i < v->pair_index[ngb]; i++, f++) {
+      const struct voronoi_pair *pair = &v->pairs[ngb][i];
+      if (vs.left[f] != pair->left || vs.right[f] != pair->right ||
+          vs.sid[f] != ngb || vs.areas[f] != pair->surface_area) {
+        abort();
+      }
+      const int64_t offset = vs.face_vertex_offsets[f];
+      if (vs.face_vertex_offsets[f + 1] - offset != pair->n_vertices) {
+        abort();
+      }
+      const double *vertices = voronoi_get_face_vertices(v, pair);
+      for (int j = 0; j < 3 * pair->n_vertices; j++) {
+        if (vs.face_vertices[3 * offset + j] != vertices[j]) {
+          abort();
+        }
+      }
+    }
+  }
+  if (vs.face_vertex_offsets[vs.nface] != vs.nface_vertex) {
+    abort();
+  }
+  voronoi_snapshot_close(&vs);
+
+  const struct delaunay *d = &c->d;
+  struct delaunay_snapshot ds;
+  delaunay_snapshot_open(&ds, "test_binary_io_del.bin");
+  if (ds.dimension != 3 || ds.nvertex != d->vertex_index) {
+    abort();
+  }
+  for (int i = 0; i < d->vertex_index; i++) {
+    double buffer[3];
+    const double *x = delaunay_get_vertex(d, i, buffer);
+    for (int j = 0; j < 3; j++) {
+      if (ds.vertices[3 * i + j] != x[j]) {
+        abort();
+      }
+    }
+  }
+  int t = 0;
+  for (int i = 4; i < d->tetrahedron_index; i++) {
+    if (!tetrahedron_is_active(&d->tetrahedra, i)) continue;
+    for (int j = 0; j < 4; j++) {
+      if (ds.simplices[4 * t + j] !=
+          tetrahedron_get_vertex(&d->tetrahedra, i, j)) {
+        abort();
+      }
+    }
+    t++;
+  }
+  if (t != ds.nsimplex) {
+    abort();
+  }
+  delaunay_snapshot_close(&ds);
+
+  remove("test_binary_io_vor.bin");
+  remove("test_binary_io_del.bin");
+}
+
+/**
+ * @brief Check that a cell that is restarted from a generator file gives the
+ * same tessellation, and that relaxing it does not change the file.
+ */
+inline static void test_restart(const struct cell *c) {
+  cell_print_generators(c, "test_binary_io_gen.bin");
+
+  struct cell r;
+  cell_init_from_file(&r, "test_binary_io_gen.bin");
+  if (r.count != c->count) {
+    abort();
+  }
+  cell_construct_local_delaunay(&r);
+  cell_make_delaunay_periodic(&r);
+  cell_construct_voronoi(&r);
+  for (int i = 0; i < c->count; i++) {
+    if (r.v.cells[i].volume != c->v.cells[i].volume) {
+      abort();
+    }
+  }
+
+  /* the mapping is private */
+  cell_lloyd_relax_vertices(&r);
+  struct binary_input in;
+  binary_input_open(&in, "test_binary_io_gen.bin",
+                    BINARY_OUTPUT_TYPE_GENERATORS, 0);
+  binary_input_get_array(&in, sizeof(double), 6);
+  const double *vertices =
+      (const double *)binary_input_get_array(&in, 3 * sizeof(double), c->count);
+  for (int i = 0; i < 3 * c->count; i++) {
+    if (vertices[i] != c->vertices[i]) {
+      abort();
+    }
+  }
+  binary_input_close(&in);
+  cell_destroy(&r);
+
+  remove("test_binary_io_gen.bin");
+}
+
+/**
+ * @brief Tests for the binary input and output.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ */
+int main(int argc, char **argv) {
+  srand(42);
+  int count[3] = {3, 3, 3};
+  double dim[3] = {1., 1., 1.};
+  struct cell c;
+  cell_init(&c, count, 0.75, dim);
+  cell_construct_local_delaunay(&c);
+  cell_make_delaunay_periodic(&c);
+  cell_construct_voronoi(&c);
+
+  test_snapshots(&c);
+  test_restart(&c);
+
+  cell_destroy(&c);
+}
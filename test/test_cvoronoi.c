@@ -0,0 +1,173 @@
+/**
+ * @file test_cvoronoi.c
+ *
+ * @brief Tests for the public API of the cvoronoi library (cvoronoi.h), which
+ * links the 2D and 3D versions of the code into a single program.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cell.h"
+#include "cvoronoi.h"
+
+/**
+ * @brief Check the cells and faces of a grid with the given number of
+ * generators per direction.
+ *
+ * The volumes should add up to the volume of the box, all faces should
+ * connect valid generators and the faces of every cell should form a closed
+ * surface.
+ *
+ * @param dimension Number of dimensions.
+ * @param n Number of generators per direction.
+ * @param vertices (Returned) Generators (3 per generator).
+ * @return Grid (should be destroyed by the caller).
+ */
+inline static struct cvoronoi_grid *test_grid(int dimension, int n,
+                                              double *vertices) {
+  const int count = dimension == 2 ? n * n : n * n * n;
+  for (int i = 0; i < count; i++) {
+    const int ix[3] = {i % n, (i / n) % n, i / (n * n)};
+    for (int j = 0; j < 3; j++) {
+      vertices[3 * i + j] =
+          j < dimension
+              ? (ix[j] + 0.5 + 0.5 * (get_random_uniform_double() - 0.5)) / n
+              : 0.5;
+    }
+  }
+  const double anchor[3] = {0., 0., 0.};
+  const double side[3] = {1., 1., 1.};
+  struct cvoronoi_grid *g =
+      cvoronoi_grid_create(dimension, vertices, count, anchor, side);
+
+  if (cvoronoi_grid_get_dimension(g) != dimension ||
+      cvoronoi_grid_get_cell_count(g) != count) {
+    abort();
+  }
+  double *volumes = (double *)malloc(count * sizeof(double));
+  double *centroids = (double *)malloc(3 * count * sizeof(double));
+  cvoronoi_grid_get_cells(g, volumes, centroids);
+  double total_volume = 0.;
+  for (int i = 0; i < count; i++) {
+    total_volume += volumes[i];
+  }
+  if (fabs(total_volume - 1.) > 1.e-10) {
+    fprintf(stderr, "Wrong total volume in %iD: %g!\n", dimension,
+            total_volume);
+    abort();
+  }
+
+  const int nface = cvoronoi_grid_get_face_count(g);
+  int *left = (int *)malloc(nface * sizeof(int));
+  int *right = (int *)malloc(nface * sizeof(int));
+  double *areas = (double *)malloc(nface * sizeof(double));
+  cvoronoi_grid_get_faces(g, left, right, areas, NULL);
+  for (int i = 0; i < nface; i++) {
+    if (left[i] < 0 || left[i] >= count || right[i] >= count ||
+        (right[i] < 0 && dimension == 3) || right[i] < -1 || areas[i] < 0.) {
+      abort();
+    }
+  }
+
+  /* every cell is closed: the sum of the outward area vectors of its faces
+     vanishes */
+  double *normals = (double *)malloc(3 * nface * sizeof(double));
+  cvoronoi_grid_get_face_normals(g, normals);
+  const int ncell_face = cvoronoi_grid_get_cell_faces(g, NULL, NULL);
+  int *offsets = (int *)malloc((count + 1) * sizeof(int));
+  int *faces = (int *)malloc(ncell_face * sizeof(int));
+  if (cvoronoi_grid_get_cell_faces(g, offsets, faces) != ncell_face ||
+      offsets[0] != 0 || offsets[count] != ncell_face) {
+    abort();
+  }
+  for (int i = 0; i < count; i++) {
+    double sum[3] = {0., 0., 0.};
+    for (int j = offsets[i]; j < offsets[i + 1]; j++) {
+      const int f = faces[j];
+      if ((left[f] != i && right[f] != i) ||
+          (j > offsets[i] && faces[j - 1] >= f)) {
+        abort();
+      }
+      const double sign = left[f] == i ? 1. : -1.;
+      for (int k = 0; k < 3; k++) {
+        sum[k] += sign * areas[f] * normals[3 * f + k];
+      }
+    }
+    if (fabs(sum[0]) + fabs(sum[1]) + fabs(sum[2]) > 1.e-10) {
+      fprintf(stderr, "Cell %i is not closed in %iD!\n", i, dimension);
+      abort();
+    }
+  }
+  for (int i = 0; i < nface; i++) {
+    const double norm2 = normals[3 * i] * normals[3 * i] +
+                         normals[3 * i + 1] * normals[3 * i + 1] +
+                         normals[3 * i + 2] * normals[3 * i + 2];
+    if (fabs(norm2 - 1.) > 1.e-12) {
+      abort();
+    }
+  }
+
+  free(volumes);
+  free(centroids);
+  free(left);
+  free(right);
+  free(areas);
+  free(normals);
+  free(offsets);
+  free(faces);
+  return g;
+}
+
+/**
+ * @brief Tests for the front-end.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ */
+int main(int argc, char **argv) {
+  srand(42);
+  /* the runtime checks of the direct construction are expensive, so we keep
+     the grids small */
+  const int n = 3;
+  double *vertices = (double *)malloc(3 * 64 * sizeof(double));
+
+  int major, minor;
+  cvoronoi_get_version(&major, &minor);
+  if (major != CVORONOI_VERSION_MAJOR || minor != CVORONOI_VERSION_MINOR) {
+    abort();
+  }
+
+  struct cvoronoi_grid *g2 = test_grid(2, 8, vertices);
+  struct cvoronoi_grid *g3 = test_grid(3, n, vertices);
+
+  /* the 3D grid is the same as the one constructed directly (this file is
+     compiled with the default 3D headers and with the runtime checks, the
+     library without them) */
+  const double anchor[3] = {0., 0., 0.};
+  const double side[3] = {1., 1., 1.};
+  struct cell c;
+  cell_init_from_vertices(&c, vertices, n * n * n, anchor, side);
+  cell_construct_local_delaunay(&c);
+  cell_make_delaunay_periodic(&c);
+  cell_construct_voronoi(&c);
+  if (cvoronoi_grid_get_face_count(g3) !=
+      c.v.pair_index[0] + c.v.pair_index[1]) {
+    abort();
+  }
+  double *volumes = (double *)malloc(n * n * n * sizeof(double));
+  cvoronoi_grid_get_cells(g3, volumes, NULL);
+  for (int i = 0; i < n * n * n; i++) {
+    if (volumes[i] != c.v.cells[i].volume) {
+      abort();
+    }
+  }
+  free(volumes);
+  cell_destroy(&c);
+
+  cvoronoi_grid_destroy(g2);
+  cvoronoi_grid_destroy(g3);
+  free(vertices);
+  return 0;
+}
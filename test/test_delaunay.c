@@ -2,8 +2,28 @@
 // Created by yuyttenh on 21/06/2021.
 //
 
+#include <cell.h>
 #include <delaunay.h>
 
+/**
+ * @brief Generate the same random vertices in the unit cube for every test.
+ *
+ * @param n Number of vertices.
+ * @param x Array for the vertices (3 coordinates per vertex).
+ * @param anchor, side Anchor and side of the unit cube (3 values each).
+ */
+inline static void test_random_vertices(int n, double *x, double *anchor,
+                                        double *side) {
+  srand(42);
+  for (int i = 0; i < 3 * n; i++) {
+    x[i] = rand() / (RAND_MAX + 1.);
+  }
+  for (int i = 0; i < 3; i++) {
+    anchor[i] = 0.;
+    side[i] = 1.;
+  }
+}
+
 inline static void test_cube() {
   struct delaunay d;
   struct hydro_space hs;
@@ -25,7 +45,404 @@ inline static void test_cube() {
   delaunay_destroy(&d);
 }
 
+inline static void test_move_vertices() {
+  struct delaunay d;
+  struct hydro_space hs;
+  double dim[3] = {1, 1, 1};
+  hydro_space_init(&hs, dim);
+  const int n = 200;
+  delaunay_init(&d, &hs, n, 10 * n);
+
+  srand(42);
+  double x[3 * n];
+  for (int i = 0; i < 3 * n; i++) {
+    x[i] = 0.1 + 0.8 * rand() / ((double)RAND_MAX);
+  }
+  for (int i = 0; i < n; i++) {
+    delaunay_add_local_vertex(&d, i, x[3 * i], x[3 * i + 1], x[3 * i + 2]);
+  }
+  delaunay_consolidate(&d);
+
+  /* small displacements can be repaired by flipping (the repaired
+     tessellation is checked if DELAUNAY_CHECKS is active) */
+  int n_repaired = 0;
+  for (int k = 0; k < 10; k++) {
+    for (int i = 0; i < 3 * n; i++) {
+      x[i] += 1.e-4 * (rand() / ((double)RAND_MAX) - 0.5);
+    }
+    for (int i = 0; i < n; i++) {
+      delaunay_move_vertex(&d, i, x[3 * i], x[3 * i + 1], x[3 * i + 2]);
+    }
+    n_repaired += delaunay_repair(&d);
+  }
+  if (n_repaired == 0) {
+    fprintf(stderr, "No small displacement could be repaired!\n");
+    abort();
+  }
+
+  /* swapping two distant vertices inverts their tetrahedra */
+  delaunay_move_vertex(&d, 0, x[3], x[4], x[5]);
+  delaunay_move_vertex(&d, 1, x[0], x[1], x[2]);
+  if (delaunay_repair(&d)) {
+    fprintf(stderr, "Inverted tetrahedra were not detected!\n");
+    abort();
+  }
+
+  delaunay_destroy(&d);
+}
+
+/**
+ * @brief Check that updating the tessellation of a periodic cell in place
+ * during Lloyd relaxation (see cell_move_vertices()) gives the same voronoi
+ * grid as rebuilding it from scratch.
+ */
+inline static void test_lloyd_in_place() {
+  const int n = 50;
+  double *x = (double *)malloc(3 * n * sizeof(double));
+  double anchor[3], side[3];
+  test_random_vertices(n, x, anchor, side);
+
+  struct cell moved, rebuilt;
+  cell_init_from_vertices(&moved, x, n, anchor, side);
+  cell_init_from_vertices(&rebuilt, x, n, anchor, side);
+  cell_construct_local_delaunay(&moved);
+  cell_make_delaunay_periodic(&moved);
+  cell_construct_voronoi(&moved);
+  cell_construct_local_delaunay(&rebuilt);
+  cell_make_delaunay_periodic(&rebuilt);
+  cell_construct_voronoi(&rebuilt);
+
+  int n_moved = 0;
+  for (int k = 0; k < 10; k++) {
+    /* both cells get exactly the same new vertices */
+    for (int i = 0; i < n; i++) {
+      for (int j = 0; j < 3; j++) {
+        moved.vertices[3 * i + j] = rebuilt.v.cells[i].centroid[j];
+        rebuilt.vertices[3 * i + j] = rebuilt.v.cells[i].centroid[j];
+      }
+    }
+    if (cell_move_vertices(&moved)) {
+      n_moved++;
+    } else {
+      cell_reset_delaunay(&moved);
+      cell_construct_local_delaunay(&moved);
+      cell_make_delaunay_periodic(&moved);
+    }
+    cell_construct_voronoi(&moved);
+    cell_reset_delaunay(&rebuilt);
+    cell_construct_local_delaunay(&rebuilt);
+    cell_make_delaunay_periodic(&rebuilt);
+    cell_construct_voronoi(&rebuilt);
+
+    for (int i = 0; i < n; i++) {
+      if (fabs(moved.v.cells[i].volume - rebuilt.v.cells[i].volume) >
+          1.e-12) {
+        fprintf(stderr, "Different voronoi grid after moving vertices!\n");
+        abort();
+      }
+    }
+  }
+  if (n_moved == 0) {
+    fprintf(stderr, "No Lloyd step was done in place!\n");
+    abort();
+  }
+
+  cell_destroy(&moved);
+  cell_destroy(&rebuilt);
+  free(x);
+}
+
+/**
+ * @brief Check the biased randomized insertion order of a cell (see
+ * cell_get_brio_order()): it should be a permutation of the vertices in which
+ * every walk hint was inserted earlier, and which consists of a few rounds
+ * that are each in hilbert order.
+ */
+inline static void test_brio_order() {
+  const int n = 5000;
+  double *x = (double *)malloc(3 * n * sizeof(double));
+  double anchor[3], side[3];
+  test_random_vertices(n, x, anchor, side);
+  struct cell c;
+  cell_init_from_vertices(&c, x, n, anchor, side);
+
+  int *order = (int *)malloc(n * sizeof(int));
+  int *hints = (int *)malloc(n * sizeof(int));
+  int *position = (int *)malloc(n * sizeof(int));
+  cell_get_brio_order(&c, order, hints);
+  for (int i = 0; i < n; i++) {
+    position[i] = -1;
+  }
+  int nround = 1;
+  for (int i = 0; i < n; i++) {
+    if (order[i] < 0 || order[i] >= n || position[order[i]] >= 0) {
+      fprintf(stderr, "Insertion order is not a permutation!\n");
+      abort();
+    }
+    position[order[i]] = i;
+    if (hints[i] >= 0 && (position[hints[i]] < 0 || hints[i] == order[i])) {
+      fprintf(stderr, "Walk hint was not inserted yet!\n");
+      abort();
+    }
+    if (i > 0 && c.hilbert_keys[order[i]] < c.hilbert_keys[order[i - 1]]) {
+      nround++;
+    }
+  }
+  if (nround != 3) {
+    fprintf(stderr, "Wrong number of insertion rounds: %i!\n", nround);
+    abort();
+  }
+
+  free(order);
+  free(hints);
+  free(position);
+  cell_destroy(&c);
+  free(x);
+}
+
+/**
+ * @brief Check that the compacted tessellation of a periodic cell (see
+ * delaunay_compact()) only contains active tetrahedra with a local vertex and
+ * consistent neighbour relations, and that it gives the same voronoi grid as
+ * the original tessellation, with and without reordering the tetrahedra.
+ */
+inline static void test_compact() {
+  const int n = 50;
+  double *x = (double *)malloc(3 * n * sizeof(double));
+  double anchor[3], side[3];
+  test_random_vertices(n, x, anchor, side);
+
+  for (int hilbert_order = 0; hilbert_order < 2; hilbert_order++) {
+    struct cell c;
+    cell_init_from_vertices(&c, x, n, anchor, side);
+    cell_construct_local_delaunay(&c);
+    cell_make_delaunay_periodic(&c);
+    cell_construct_voronoi(&c);
+    double *volumes = (double *)malloc(n * sizeof(double));
+    for (int i = 0; i < n; i++) {
+      volumes[i] = c.v.cells[i].volume;
+    }
+    const int npair[2] = {c.v.pair_index[0], c.v.pair_index[1]};
+    const size_t size = delaunay_get_memory_size(&c.d);
+
+    cell_compact_delaunay(&c, hilbert_order);
+    const struct delaunay *d = &c.d;
+    if (d->tetrahedron_start != 0 || delaunay_get_memory_size(d) >= size) {
+      fprintf(stderr, "Tessellation was not compacted!\n");
+      abort();
+    }
+    for (int t = 0; t < d->tetrahedron_index; t++) {
+      int is_local = 0;
+      for (int i = 0; i < 4; i++) {
+        is_local |= tetrahedron_get_vertex(&d->tetrahedra, t, i) < n;
+        const int ngb = tetrahedron_get_neighbour(&d->tetrahedra, t, i);
+        const int j = tetrahedron_get_index_in_neighbour(&d->tetrahedra, t, i);
+        if (ngb >= 0 &&
+            (tetrahedron_get_neighbour(&d->tetrahedra, ngb, j) != t ||
+             tetrahedron_get_index_in_neighbour(&d->tetrahedra, ngb, j) != i)) {
+          fprintf(stderr, "Inconsistent neighbours after compaction!\n");
+          abort();
+        }
+      }
+      if (!tetrahedron_is_active(&d->tetrahedra, t) || !is_local) {
+        fprintf(stderr, "Inactive or remote tetrahedron after compaction!\n");
+        abort();
+      }
+    }
+    for (int v = 0; v < n; v++) {
+      if (tetrahedron_get_vertex(&d->tetrahedra, d->vertex_tetrahedron_links[v],
+                                 d->vertex_tetrahedron_index[v]) != v) {
+        fprintf(stderr, "Wrong vertex-tetrahedron link after compaction!\n");
+        abort();
+      }
+    }
+
+    cell_construct_voronoi(&c);
+    if (c.v.pair_index[0] != npair[0] || c.v.pair_index[1] != npair[1]) {
+      fprintf(stderr, "Different number of faces after compaction!\n");
+      abort();
+    }
+    for (int i = 0; i < n; i++) {
+      if (c.v.cells[i].volume != volumes[i]) {
+        fprintf(stderr, "Different voronoi grid after compaction!\n");
+        abort();
+      }
+    }
+
+    /* a compacted tessellation is rebuilt when the vertices move */
+    cell_lloyd_relax_vertices(&c);
+    double total_volume = 0.;
+    for (int i = 0; i < n; i++) {
+      total_volume += c.v.cells[i].volume;
+    }
+    if (c.d.compact || fabs(total_volume - 1.) > 1.e-10) {
+      fprintf(stderr, "Compacted tessellation was not rebuilt!\n");
+      abort();
+    }
+
+    free(volumes);
+    cell_destroy(&c);
+  }
+  free(x);
+}
+
+/**
+ * @brief Check that storing the periodic ghosts as (vertex, shift) pairs
+ * gives the same tessellation as storing copies of their coordinates, using
+ * less memory.
+ */
+inline static void test_periodic_ghosts() {
+  const int n = 50;
+  double *x = (double *)malloc(3 * n * sizeof(double));
+  double anchor[3], side[3];
+  test_random_vertices(n, x, anchor, side);
+
+  struct cell periodic;
+  cell_init_from_vertices(&periodic, x, n, anchor, side);
+  cell_construct_local_delaunay(&periodic);
+  cell_make_delaunay_periodic(&periodic);
+  cell_construct_voronoi(&periodic);
+
+  /* same ghosts, but added as new vertices with their own coordinates */
+  struct cell copies;
+  cell_init_from_vertices(&copies, x, n, anchor, side);
+  cell_construct_local_delaunay(&copies);
+  const struct cell *ngbs[26];
+  double shifts[3 * 26];
+  const int nngb = cell_get_periodic_ngbs(&copies, ngbs, shifts);
+  cell_add_ghosts(&copies, ngbs, shifts, nngb);
+  cell_construct_voronoi(&copies);
+
+  const struct delaunay *d = &periodic.d;
+  if (d->periodic_shift_count != 26 || copies.d.periodic_shift_count != 0 ||
+      d->vertex_index != copies.d.vertex_index ||
+      d->tetrahedron_index != copies.d.tetrahedron_index ||
+      delaunay_get_memory_size(d) >= delaunay_get_memory_size(&copies.d)) {
+    fprintf(stderr, "Different tessellation with periodic ghosts!\n");
+    abort();
+  }
+  for (int v = 0; v < d->vertex_index; v++) {
+    double buffer[3];
+    const double *xv = delaunay_get_vertex(d, v, buffer);
+    for (int i = 0; i < 3; i++) {
+      if (xv[i] != copies.d.vertices[3 * v + i]) {
+        fprintf(stderr, "Wrong position of periodic ghost!\n");
+        abort();
+      }
+    }
+  }
+  if (periodic.v.pair_index[0] != copies.v.pair_index[0] ||
+      periodic.v.pair_index[1] != copies.v.pair_index[1]) {
+    fprintf(stderr, "Different number of faces with periodic ghosts!\n");
+    abort();
+  }
+  for (int i = 0; i < n; i++) {
+    if (periodic.v.cells[i].volume != copies.v.cells[i].volume) {
+      fprintf(stderr, "Different voronoi grid with periodic ghosts!\n");
+      abort();
+    }
+  }
+
+  cell_destroy(&periodic);
+  cell_destroy(&copies);
+  free(x);
+}
+
+/**
+ * @brief Check that the queries of single cells and the construction of only
+ * the volumes give the same cells as the full Voronoi grid.
+ */
+inline static void test_cell_queries() {
+  const int n = 50;
+  double *x = (double *)malloc(3 * n * sizeof(double));
+  double anchor[3], side[3];
+  test_random_vertices(n, x, anchor, side);
+
+  struct cell c;
+  cell_init_from_vertices(&c, x, n, anchor, side);
+  cell_construct_local_delaunay(&c);
+  cell_make_delaunay_periodic(&c);
+  cell_construct_voronoi(&c);
+  const int npair[2] = {c.v.pair_index[0], c.v.pair_index[1]};
+
+  struct voronoi_cell_query q;
+  voronoi_cell_query_init(&q);
+  for (int i = 0; i < n; i++) {
+    const struct voronoi_cell *cell = &c.v.cells[i];
+    const int nface = voronoi_cell_faces(&c.d, i, &q);
+    if (nface != cell->nface || q.volume != cell->volume ||
+        q.centroid[0] != cell->centroid[0] ||
+        q.centroid[1] != cell->centroid[1] ||
+        q.centroid[2] != cell->centroid[2]) {
+      fprintf(stderr, "Different voronoi cell from query!\n");
+      abort();
+    }
+    /* every face of the cell is a face of the grid */
+    for (int j = 0; j < nface; j++) {
+      const int sid = q.neighbours[j] < c.d.vertex_end ? 0 : 1;
+      const int left = i < q.neighbours[j] ? i : q.neighbours[j];
+      const int right = i < q.neighbours[j] ? q.neighbours[j] : i;
+      int found = 0;
+      for (int k = 0; k < npair[sid]; k++) {
+        const struct voronoi_pair *pair = &c.v.pairs[sid][k];
+        /* the area is only bitwise identical if the face was stored while
+           walking around this cell */
+        if (pair->left == left && pair->right == right) {
+          found = fabs(pair->surface_area - q.areas[j]) <=
+                      (left == i ? 0. : 1.e-12 * q.areas[j]) &&
+                  pair->n_vertices ==
+                      q.vertex_offsets[j + 1] - q.vertex_offsets[j];
+        }
+      }
+      if (!found) {
+        fprintf(stderr, "Face of voronoi cell query not found in grid!\n");
+        abort();
+      }
+    }
+
+    double centroid[3];
+    if (voronoi_cell_volume(&c.d, i, centroid) != cell->volume ||
+        centroid[0] != cell->centroid[0]) {
+      fprintf(stderr, "Different voronoi cell volume from query!\n");
+      abort();
+    }
+  }
+  voronoi_cell_query_destroy(&q);
+
+  double *volumes = (double *)malloc(n * sizeof(double));
+  for (int i = 0; i < n; i++) {
+    volumes[i] = c.v.cells[i].volume;
+  }
+  cell_construct_voronoi_volumes(&c);
+  if (c.v.pair_index[0] != 0 || c.v.pair_index[1] != 0 ||
+      c.v.faces.count != 0) {
+    fprintf(stderr, "Faces stored when only constructing volumes!\n");
+    abort();
+  }
+  for (int i = 0; i < n; i++) {
+    if (c.v.cells[i].volume != volumes[i]) {
+      fprintf(stderr, "Different volumes when only constructing volumes!\n");
+      abort();
+    }
+  }
+  cell_construct_voronoi(&c);
+  if (c.v.pair_index[0] != npair[0] || c.v.pair_index[1] != npair[1]) {
+    fprintf(stderr, "Different number of faces after rebuilding grid!\n");
+    abort();
+  }
+
+  free(volumes);
+  cell_destroy(&c);
+  free(x);
+}
+
 int main() {
   test_cube();
+  test_move_vertices();
+  test_lloyd_in_place();
+  test_brio_order();
+  test_compact();
+  test_periodic_ghosts();
+  test_cell_queries();
 }
 
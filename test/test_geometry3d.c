@@ -62,13 +62,12 @@ inline static void test_volume() {
 
   V = 0.;
   for (int i = 4; i < d.tetrahedron_index; i++) {
-    struct tetrahedron *t = &d.tetrahedra[i];
-    if (!t->active) continue;
+    if (!tetrahedron_is_active(&d.tetrahedra, i)) continue;
 
-    int v0 = t->vertices[0];
-    int v1 = t->vertices[1];
-    int v2 = t->vertices[2];
-    int v3 = t->vertices[3];
+    int v0 = tetrahedron_get_vertex(&d.tetrahedra, i, 0);
+    int v1 = tetrahedron_get_vertex(&d.tetrahedra, i, 1);
+    int v2 = tetrahedron_get_vertex(&d.tetrahedra, i, 2);
+    int v3 = tetrahedron_get_vertex(&d.tetrahedra, i, 3);
 
     V += geometry3d_compute_volume_tetrahedron(
         d.vertices[3 * v0], d.vertices[3 * v0 + 1], d.vertices[3 * v0 + 2],
@@ -82,6 +81,137 @@ inline static void test_volume() {
   delaunay_destroy(&d);
 }
 
+/**
+ * @brief Test the combined face area and pyramid volume computation for a unit
+ * square face and a generator at a distance 1 from its centre.
+ */
+inline static void test_face() {
+  /* fan layout used by voronoi_reset(): vertex 3 is a copy of vertex 2 */
+  const double points[15] = {0., 0., 0., 1., 0., 0., 1., 1., 0.,
+                             1., 1., 0., 0., 1., 0.};
+  double midpoint[3];
+  double volume = 0.;
+  double centroid[3] = {0., 0., 0.};
+  const double area = geometry3d_compute_centroid_volume_area_face(
+      0.5, 0.5, 1., points, 5, midpoint, &volume, centroid);
+  if (area != 1. || midpoint[0] != 3. || midpoint[1] != 3. ||
+      midpoint[2] != 0.) {
+    abort();
+  }
+  if (fabs(volume - 1. / 3.) > 1.e-15 ||
+      fabs(centroid[0] / volume - 0.5) > 1.e-15 ||
+      fabs(centroid[1] / volume - 0.5) > 1.e-15 ||
+      fabs(centroid[2] / volume - 0.25) > 1.e-15) {
+    abort();
+  }
+}
+
+/**
+ * @brief Generate a random point with coordinates in the range [1, 2[, so that
+ * it can be used for both the filtered and exact tests.
+ *
+ * If grid is set, the coordinates are restricted to a coarse grid, which makes
+ * degenerate configurations (coplanar or cospherical points) very likely.
+ */
+inline static void test_random_point(double *p, unsigned long *pi, int grid) {
+  for (int i = 0; i < 3; i++) {
+    if (grid) {
+      p[i] = 1. + (rand() % 8) / 8.;
+    } else {
+      p[i] = 1. + rand() / (RAND_MAX + 1.);
+    }
+    pi[i] = delaunay_double_to_int(p[i]);
+  }
+}
+
+inline static void test_adaptive_predicates() {
+  struct geometry3d g;
+  geometry3d_init(&g);
+
+  double p[15];
+  unsigned long pi[15];
+  srand(42);
+  for (int n = 0; n < 100000; n++) {
+    const int grid = n % 2;
+    for (int i = 0; i < 5; i++) {
+      test_random_point(&p[3 * i], &pi[3 * i], grid);
+    }
+
+    const int orient = geometry3d_orient_adaptive(
+        &g, &p[0], &p[3], &p[6], &p[9], &pi[0], &pi[3], &pi[6], &pi[9]);
+    const int orient_exact = geometry3d_orient_exact(
+        &g, pi[0], pi[1], pi[2], pi[3], pi[4], pi[5], pi[6], pi[7], pi[8],
+        pi[9], pi[10], pi[11]);
+    if (orient != orient_exact) {
+      abort();
+    }
+
+    const int in_sphere = geometry3d_in_sphere_adaptive(
+        &g, &p[0], &p[3], &p[6], &p[9], &p[12], &pi[0], &pi[3], &pi[6], &pi[9],
+        &pi[12]);
+    const int in_sphere_exact = geometry3d_in_sphere_exact(
+        &g, pi[0], pi[1], pi[2], pi[3], pi[4], pi[5], pi[6], pi[7], pi[8],
+        pi[9], pi[10], pi[11], pi[12], pi[13], pi[14]);
+    if (in_sphere != in_sphere_exact) {
+      abort();
+    }
+  }
+
+  /* the degenerate grid configurations should have triggered the exact
+   * fallback, but the filter should have decided most random cases */
+  if (g.orient_filter_misses == 0 || g.in_sphere_filter_misses == 0 ||
+      g.orient_filter_hits == 0 || g.in_sphere_filter_hits == 0) {
+    abort();
+  }
+
+  geometry3d_destroy(&g);
+}
+
+#ifdef HAVE_GMP
+/**
+ * @brief Compare the fixed width exact tests with their GMP counterparts, for
+ * integer coordinates covering the full 52-bit range.
+ */
+inline static void test_exact_predicates_gmp() {
+  struct geometry3d g;
+  geometry3d_init(&g);
+
+  const unsigned long max = (1ul << 52) - 1;
+  unsigned long pi[15];
+  srand(1);
+  for (int n = 0; n < 100000; n++) {
+    for (int i = 0; i < 15; i++) {
+      const int r = rand() % 4;
+      if (r == 0) {
+        /* extreme values, to test the largest possible intermediate results */
+        pi[i] = (rand() % 2) ? max : 0;
+      } else {
+        pi[i] = (((unsigned long)rand() << 31) ^ (unsigned long)rand()) & max;
+      }
+    }
+
+    if (geometry3d_orient_exact(&g, pi[0], pi[1], pi[2], pi[3], pi[4], pi[5],
+                                pi[6], pi[7], pi[8], pi[9], pi[10], pi[11]) !=
+        geometry3d_orient_exact_gmp(&g, pi[0], pi[1], pi[2], pi[3], pi[4],
+                                    pi[5], pi[6], pi[7], pi[8], pi[9], pi[10],
+                                    pi[11])) {
+      abort();
+    }
+    if (geometry3d_in_sphere_exact(&g, pi[0], pi[1], pi[2], pi[3], pi[4],
+                                   pi[5], pi[6], pi[7], pi[8], pi[9], pi[10],
+                                   pi[11], pi[12], pi[13], pi[14]) !=
+        geometry3d_in_sphere_exact_gmp(&g, pi[0], pi[1], pi[2], pi[3], pi[4],
+                                       pi[5], pi[6], pi[7], pi[8], pi[9],
+                                       pi[10], pi[11], pi[12], pi[13],
+                                       pi[14])) {
+      abort();
+    }
+  }
+
+  geometry3d_destroy(&g);
+}
+#endif
+
 /**
  * @brief Test for functions of geometry3d.h
  *
@@ -92,4 +222,9 @@ int main(int argc, char **argv) {
   test_circumcenter();
   test_area();
   test_volume();
+  test_face();
+  test_adaptive_predicates();
+#ifdef HAVE_GMP
+  test_exact_predicates_gmp();
+#endif
 }
\ No newline at end of file
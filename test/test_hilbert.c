@@ -28,8 +28,6 @@
  * @author Bert Vandenbroucke (bert.vandenbroucke@ugent.be)
  */
 
-#define _GNU_SOURCE
-
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -54,9 +52,9 @@ static inline double get_random_uniform_double() {
  *
  * This program takes one optional extra command line argument: the number of
  * points to randomly generate (default: 100). It then moves on to randomly
- * generate these points in 2D, computes a Hilbert key for each point, arg-sorts
- * the points on this key and outputs the point coordinates and their keys to
- * the standard output.
+ * generate these points, computes a Hilbert key for each point (and checks
+ * that hilbert_get_keys() gives the same keys), arg-sorts the points on this
+ * key and outputs the point coordinates and their keys to the standard output.
  *
  * @param argc Number of command line arguments.
  * @param argv Command line arguments.
@@ -68,17 +66,31 @@ int main(int argc, char **argv) {
     nvert = atoi(argv[1]);
   }
 
-  double *x = (double *)malloc(nvert * 2 * sizeof(double));
-  for (int i = 0; i < 2 * nvert; ++i) {
+  double *x = (double *)malloc(nvert * 3 * sizeof(double));
+  for (int i = 0; i < 3 * nvert; ++i) {
     x[i] = get_random_uniform_double();
   }
 
   unsigned long *keys = (unsigned long *)malloc(nvert * sizeof(unsigned long));
   for (int i = 0; i < nvert; ++i) {
-    unsigned long bits[2];
-    bits[0] = x[2 * i] * (1ul << 32);
-    bits[1] = x[2 * i + 1] * (1ul << 32);
-    keys[i] = hilbert_get_key(bits, 32);
+    unsigned long bits[3];
+    for (int k = 0; k < HILBERT_DIM; ++k) {
+      bits[k] = x[3 * i + k] * (1ul << HILBERT_NBITS);
+    }
+    keys[i] = hilbert_get_key(bits, HILBERT_NBITS);
+  }
+
+  const double anchor[3] = {0., 0., 0.};
+  const double side[3] = {1., 1., 1.};
+  unsigned long *bulk_keys =
+      (unsigned long *)malloc(nvert * sizeof(unsigned long));
+  hilbert_get_keys(x, nvert, anchor, side, bulk_keys);
+  for (int i = 0; i < nvert; ++i) {
+    if (bulk_keys[i] != keys[i]) {
+      fprintf(stderr, "Wrong Hilbert key for point %i: %lu instead of %lu!\n",
+              i, bulk_keys[i], keys[i]);
+      abort();
+    }
   }
 
   int *sorth = (int *)malloc(nvert * sizeof(int));
@@ -86,12 +98,20 @@ int main(int argc, char **argv) {
     sorth[i] = i;
   }
 
-  qsort_r(sorth, nvert, sizeof(int), sort_h_comp, keys);
+  uint64_t *tmp = (uint64_t *)malloc(nvert * sizeof(uint64_t));
+  sort_arg_keys(keys, sorth, nvert, tmp);
 
   for (int i = 0; i < nvert; ++i) {
     int j = sorth[i];
-    printf("%.3f\t%.3f\t%lu\n", x[2 * j], x[2 * j + 1], keys[j]);
+    printf("%.3f\t%.3f\t%.3f\t%lu\n", x[3 * j], x[3 * j + 1], x[3 * j + 2],
+           keys[j]);
   }
 
+  free(x);
+  free(keys);
+  free(bulk_keys);
+  free(sorth);
+  free(tmp);
+
   return 0;
 }
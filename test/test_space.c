@@ -0,0 +1,392 @@
+/**
+ * @file test_space.c
+ *
+ * @brief Tests for the parallel construction of the tessellations of multiple
+ * cells and of a single split cell (space.h and threadpool.h).
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+/* count the live allocations of the tessellations and cells, to check that
+   all memory goes through the allocation hooks (see allocator.h) */
+static long test_live_allocations = 0;
+
+static void *test_malloc(size_t size) {
+  __atomic_fetch_add(&test_live_allocations, 1, __ATOMIC_RELAXED);
+  return malloc(size);
+}
+
+static void *test_calloc(size_t count, size_t size) {
+  __atomic_fetch_add(&test_live_allocations, 1, __ATOMIC_RELAXED);
+  return calloc(count, size);
+}
+
+static void *test_realloc(void *ptr, size_t size) {
+  if (ptr == NULL) {
+    __atomic_fetch_add(&test_live_allocations, 1, __ATOMIC_RELAXED);
+  }
+  return realloc(ptr, size);
+}
+
+static void test_free(void *ptr) {
+  if (ptr != NULL) {
+    __atomic_fetch_sub(&test_live_allocations, 1, __ATOMIC_RELAXED);
+  }
+  free(ptr);
+}
+
+#define CVORONOI_MALLOC(size) test_malloc(size)
+#define CVORONOI_CALLOC(count, size) test_calloc(count, size)
+#define CVORONOI_REALLOC(ptr, size) test_realloc(ptr, size)
+#define CVORONOI_FREE(ptr) test_free(ptr)
+
+#include "space.h"
+#include "threadpool.h"
+
+/**
+ * @brief Task that counts how many times it is executed.
+ */
+inline static void test_count_task(void *data, int task, int thread_id) {
+  int *counts = (int *)data;
+  __atomic_fetch_add(&counts[task], 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Check that all tasks are executed exactly once, also when the workers
+ * of a pool are woken up for many mappings in a row.
+ */
+inline static void test_threadpool() {
+  const int num_tasks = 1000;
+  int *counts = (int *)calloc(num_tasks, sizeof(int));
+  for (int num_threads = 1; num_threads <= 8; num_threads *= 2) {
+    struct threadpool tp;
+    threadpool_init(&tp, num_threads);
+    threadpool_map(&tp, test_count_task, counts, num_tasks);
+    for (int k = 0; k < 100; k++) {
+      threadpool_map(&tp, test_count_task, counts, 1);
+    }
+    threadpool_destroy(&tp);
+  }
+  for (int i = 0; i < num_tasks; i++) {
+    if (counts[i] != (i == 0 ? 404 : 4)) {
+      abort();
+    }
+  }
+  free(counts);
+}
+
+/**
+ * @brief Generate the vertices of a randomly perturbed n x n x n grid in the
+ * unit cube with the given anchor (the same vertices for every test).
+ *
+ * @param n Number of vertices in every direction.
+ * @param anchor Anchor of the cube.
+ * @return Vertices (3 coordinates per vertex, to be freed by the caller).
+ */
+inline static double *test_perturbed_grid(int n, const double *anchor) {
+  const int count = n * n * n;
+  double *vertices = (double *)malloc(3 * count * sizeof(double));
+  srand(42);
+  for (int i = 0; i < count; i++) {
+    const int ix[3] = {i / (n * n), (i / n) % n, i % n};
+    for (int j = 0; j < 3; j++) {
+      vertices[3 * i + j] =
+          anchor[j] +
+          (ix[j] + 0.5 + 0.5 * (get_random_uniform_double() - 0.5)) / n;
+    }
+  }
+  return vertices;
+}
+
+/**
+ * @brief Construct the tessellations of a space with the given number of
+ * threads (optionally pinned to CPUs) and return the volume of the Voronoi
+ * cell of every vertex.
+ */
+inline static void test_space_volumes(const double *vertices, int count,
+                                      int num_threads, int pin_threads,
+                                      double *volumes) {
+  double dim[3] = {1., 1., 1.};
+  int cdim[3] = {2, 2, 2};
+  struct space s;
+  space_init(&s, vertices, count, dim, cdim);
+
+  struct threadpool tp;
+  threadpool_init(&tp, num_threads);
+  if (pin_threads && threadpool_pin_threads(&tp) > 0) {
+    for (int i = 0; i < num_threads; i++) {
+      if (tp.cpus[i] < 0) {
+        abort();
+      }
+    }
+  }
+  space_construct_tessellations(&s, &tp);
+  threadpool_destroy(&tp);
+  if (s.vertices != NULL) {
+    abort();
+  }
+
+  for (int c = 0; c < s.nr_cells; c++) {
+    if (s.cells[c].v.number_of_cells !=
+        s.cell_offsets[c + 1] - s.cell_offsets[c]) {
+      abort();
+    }
+    for (int l = 0; l < s.cells[c].v.number_of_cells; l++) {
+      volumes[s.vertex_index[s.cell_offsets[c] + l]] =
+          s.cells[c].v.cells[l].volume;
+    }
+  }
+  space_destroy(&s);
+}
+
+/**
+ * @brief Check that the cells of the space tile the box and that the result
+ * does not depend on the number of threads.
+ */
+inline static void test_space() {
+  const int n = 4;
+  const int count = n * n * n;
+  const double anchor[3] = {0., 0., 0.};
+  double *vertices = test_perturbed_grid(n, anchor);
+
+  double *volumes_serial = (double *)malloc(count * sizeof(double));
+  double *volumes_parallel = (double *)malloc(count * sizeof(double));
+  double *volumes_pinned = (double *)malloc(count * sizeof(double));
+  test_space_volumes(vertices, count, 1, 0, volumes_serial);
+  test_space_volumes(vertices, count, 4, 0, volumes_parallel);
+  test_space_volumes(vertices, count, 4, 1, volumes_pinned);
+  if (test_live_allocations != 0) {
+    fprintf(stderr, "Allocations that did not go through the hooks!\n");
+    abort();
+  }
+
+  double total_volume = 0.;
+  for (int i = 0; i < count; i++) {
+    if (volumes_serial[i] != volumes_parallel[i] ||
+        volumes_serial[i] != volumes_pinned[i]) {
+      abort();
+    }
+    total_volume += volumes_serial[i];
+  }
+  if (fabs(total_volume - 1.) > 1.e-10) {
+    abort();
+  }
+
+  free(vertices);
+  free(volumes_serial);
+  free(volumes_parallel);
+  free(volumes_pinned);
+}
+
+/**
+ * @brief Check that the parallel construction of the grid of a single cell
+ * (space_construct_cell_parallel()) gives the same grid as the serial
+ * construction.
+ */
+inline static void test_space_cell() {
+  const int n = 6;
+  const int count = n * n * n;
+  const double anchor[3] = {-0.5, 0.25, 2.};
+  const double side[3] = {1., 1., 1.};
+  double *vertices = test_perturbed_grid(n, anchor);
+
+  struct cell serial;
+  cell_init_from_vertices(&serial, vertices, count, anchor, side);
+  cell_construct_local_delaunay(&serial);
+  cell_make_delaunay_periodic(&serial);
+  cell_construct_voronoi(&serial);
+
+  struct cell parallel;
+  cell_init_from_vertices(&parallel, vertices, count, anchor, side);
+  struct threadpool tp;
+  threadpool_init(&tp, 4);
+  const int cdim[3] = {2, 2, 2};
+  space_construct_cell_parallel(&parallel, cdim, &tp);
+  threadpool_destroy(&tp);
+
+  if (parallel.v.number_of_cells != count ||
+      parallel.v.pair_index[0] != serial.v.pair_index[0] ||
+      parallel.v.pair_index[1] != serial.v.pair_index[1] ||
+      parallel.ghost_count != parallel.v.pair_index[1] ||
+      parallel.d.ghost_offset != serial.d.ghost_offset) {
+    abort();
+  }
+  double total_volume = 0.;
+  for (int i = 0; i < count; i++) {
+    if (fabs(parallel.v.cells[i].volume - serial.v.cells[i].volume) >
+        1.e-12) {
+      abort();
+    }
+    total_volume += parallel.v.cells[i].volume;
+  }
+  if (fabs(total_volume - 1.) > 1.e-10) {
+    abort();
+  }
+  for (int i = 0; i < parallel.v.pair_index[0]; i++) {
+    const struct voronoi_pair *pair = &parallel.v.pairs[0][i];
+    if (pair->left >= pair->right || pair->right >= count) {
+      abort();
+    }
+  }
+  for (int i = 0; i < parallel.v.pair_index[1]; i++) {
+    const struct voronoi_pair *pair = &parallel.v.pairs[1][i];
+    const int g = pair->right - parallel.d.ghost_offset;
+    if (pair->right < count || g < 0 || g >= parallel.ghost_count ||
+        parallel.ghost_vertices[g] >= count || parallel.ghost_ngbs[g] < 0 ||
+        parallel.ghost_ngbs[g] >= 26) {
+      abort();
+    }
+  }
+
+  /* the faces of every cell in the face table form a closed surface */
+  const struct voronoi_face_table *t = &parallel.v.faces;
+  if (t->count != parallel.v.pair_index[0] + parallel.v.pair_index[1]) {
+    abort();
+  }
+  for (int i = 0; i < count; i++) {
+    int nface;
+    const int *faces = voronoi_face_table_get_cell_faces(t, i, &nface);
+    double sum[3] = {0., 0., 0.};
+    for (int j = 0; j < nface; j++) {
+      const int f = faces[j];
+      const double sign = t->left[f] == i ? 1. : -1.;
+      for (int k = 0; k < 3; k++) {
+        sum[k] += sign * t->area[f] * t->normal[3 * f + k];
+      }
+    }
+    if (fabs(sum[0]) + fabs(sum[1]) + fabs(sum[2]) > 1.e-10) {
+      abort();
+    }
+  }
+
+  cell_destroy(&serial);
+  cell_destroy(&parallel);
+  free(vertices);
+}
+
+/**
+ * @brief Volumes of the grids seen by the consumers of a pipeline.
+ */
+struct test_pipeline_data {
+  const struct space *s;
+  const struct space_pipeline *p;
+  /* volumes of the new grids of the current step */
+  double *volumes;
+  /* volumes of the grids of the previous step */
+  double *previous_volumes;
+};
+
+/**
+ * @brief Consumer of the new grids: check that the cell reports its completion
+ * and store the volumes.
+ */
+inline static void test_pipeline_ready(void *data, struct cell *c, int cid,
+                                       int thread_id) {
+  struct test_pipeline_data *t = (struct test_pipeline_data *)data;
+  if (space_pipeline_get_cell_step(t->p, cid) != t->p->step) {
+    abort();
+  }
+  const int *index = &t->s->vertex_index[t->s->cell_offsets[cid]];
+  for (int l = 0; l < c->v.number_of_cells; l++) {
+    t->volumes[index[l]] = c->v.cells[l].volume;
+  }
+}
+
+/**
+ * @brief Consumer of the grids of the previous step: store the volumes.
+ */
+inline static void test_pipeline_previous(void *data, struct cell *c, int cid,
+                                          int thread_id) {
+  struct test_pipeline_data *t = (struct test_pipeline_data *)data;
+  const int *index = &t->s->vertex_index[t->s->cell_offsets[cid]];
+  for (int l = 0; l < c->v_previous.number_of_cells; l++) {
+    t->previous_volumes[index[l]] = c->v_previous.cells[l].volume;
+  }
+}
+
+/**
+ * @brief Check that every step of a pipeline gives the same grids as
+ * constructing the tessellations of a new space, and that the grids of every
+ * step are passed on to both consumers.
+ */
+inline static void test_space_pipeline() {
+  const int n = 4;
+  const int count = n * n * n;
+  const double anchor[3] = {0., 0., 0.};
+  double *vertices = test_perturbed_grid(n, anchor);
+
+  double dim[3] = {1., 1., 1.};
+  int cdim[3] = {2, 2, 2};
+  struct space s;
+  space_init(&s, vertices, count, dim, cdim);
+  struct space_pipeline p;
+  struct test_pipeline_data t;
+  t.s = &s;
+  t.p = &p;
+  t.volumes = (double *)malloc(count * sizeof(double));
+  t.previous_volumes = (double *)malloc(count * sizeof(double));
+  double *expected = (double *)malloc(count * sizeof(double));
+  double *last = (double *)malloc(count * sizeof(double));
+  space_pipeline_init(&p, &s, test_pipeline_ready, &t, test_pipeline_previous,
+                      &t);
+
+  struct threadpool tp;
+  threadpool_init(&tp, 4);
+  for (int step = 1; step <= 3; step++) {
+    space_pipeline_step(&p, &tp);
+    test_space_volumes(vertices, count, 1, 0, expected);
+    for (int i = 0; i < count; i++) {
+      if (t.volumes[i] != expected[i] ||
+          (step > 1 && t.previous_volumes[i] != last[i])) {
+        abort();
+      }
+      last[i] = t.volumes[i];
+    }
+
+    /* move the vertices within their cells */
+    for (int c = 0; c < s.nr_cells; c++) {
+      struct cell *cell = &s.cells[c];
+      for (int l = 0; l < cell->count; l++) {
+        const int v = s.vertex_index[s.cell_offsets[c] + l];
+        for (int k = 0; k < 3; k++) {
+          double x = cell->vertices[3 * l + k] +
+                     0.02 * (get_random_uniform_double() - 0.5) / n;
+          const double lo = cell->hs.anchor[k] + 1.e-3 / n;
+          const double hi = cell->hs.anchor[k] + cell->hs.side[k] - 1.e-3 / n;
+          x = x < lo ? lo : x > hi ? hi : x;
+          cell->vertices[3 * l + k] = x;
+          vertices[3 * v + k] = x;
+        }
+      }
+    }
+  }
+  space_pipeline_flush(&p, &tp);
+  for (int i = 0; i < count; i++) {
+    if (t.previous_volumes[i] != last[i]) {
+      abort();
+    }
+  }
+  threadpool_destroy(&tp);
+  space_pipeline_destroy(&p);
+  space_destroy(&s);
+
+  free(vertices);
+  free(t.volumes);
+  free(t.previous_volumes);
+  free(expected);
+  free(last);
+}
+
+/**
+ * @brief Tests for the parallel construction of multiple cells.
+ *
+ * @param argc Number of command line arguments.
+ * @param argv Command line arguments.
+ */
+int main(int argc, char **argv) {
+  test_threadpool();
+  test_space();
+  test_space_cell();
+  test_space_pipeline();
+}